@@ -0,0 +1,355 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <mongoc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mongoc-array-private.h"
+#include "mongoc-rpc-private.h"
+
+#include "benchmark-stream.h"
+
+
+#define MONGOC_STREAM_BENCHMARK 8
+#define BENCHMARK_DEFAULT_BATCH_SIZE 101
+
+
+typedef struct
+{
+   mongoc_stream_t         vtable;
+   benchmark_stream_opts_t opts;
+   mongoc_array_t          in;       /* bytes of an incomplete request */
+   mongoc_array_t          out;      /* replies not yet read */
+   size_t                  out_pos;
+   int32_t                 request_id;
+   int32_t                 remaining;
+   int32_t                 batch_n;  /* number of docs in "batch" */
+   bson_t                  batch;
+} benchmark_stream_t;
+
+
+static void
+_benchmark_stream_reply (benchmark_stream_t *stream,
+                         int32_t             response_to,
+                         const bson_t       *doc)
+{
+   mongoc_rpc_t rpc = { { 0 } };
+   mongoc_array_t ar;
+   mongoc_iovec_t *iov;
+   size_t i;
+
+   _mongoc_array_init (&ar, sizeof (mongoc_iovec_t));
+
+   rpc.reply.request_id = ++stream->request_id;
+   rpc.reply.response_to = response_to;
+   rpc.reply.opcode = MONGOC_OPCODE_REPLY;
+   rpc.reply.flags = MONGOC_REPLY_NONE;
+   rpc.reply.cursor_id = 0;
+   rpc.reply.start_from = 0;
+   rpc.reply.n_returned = 1;
+   rpc.reply.documents = bson_get_data (doc);
+   rpc.reply.documents_len = (int32_t) doc->len;
+
+   _mongoc_rpc_gather (&rpc, &ar);
+   _mongoc_rpc_swab_to_le (&rpc);
+
+   for (i = 0; i < ar.len; i++) {
+      iov = &_mongoc_array_index (&ar, mongoc_iovec_t, i);
+      _mongoc_array_append_vals (&stream->out, iov->iov_base,
+                                 (uint32_t) iov->iov_len);
+   }
+
+   _mongoc_array_destroy (&ar);
+}
+
+
+/* a cursor document whose batch has the next n documents */
+static void
+_benchmark_stream_append_cursor (benchmark_stream_t *stream,
+                                 bson_t             *reply,
+                                 const char         *batch_name,
+                                 int32_t             batch_size)
+{
+   bson_t cursor;
+   int32_t n;
+   int32_t i;
+   char str[16];
+   const char *key;
+
+   n = BSON_MIN (batch_size, stream->remaining);
+   stream->remaining -= n;
+
+   /* build each batch once, the server's cost isn't what we measure */
+   if (n != stream->batch_n) {
+      bson_reinit (&stream->batch);
+
+      for (i = 0; i < n; i++) {
+         bson_uint32_to_string ((uint32_t) i, &key, str, sizeof str);
+         bson_append_document (&stream->batch, key, -1, stream->opts.doc);
+      }
+
+      stream->batch_n = n;
+   }
+
+   bson_append_document_begin (reply, "cursor", -1, &cursor);
+   BSON_APPEND_INT64 (&cursor, "id", stream->remaining ? 1 : 0);
+   BSON_APPEND_UTF8 (&cursor, "ns", "benchmark.benchmark");
+   bson_append_array (&cursor, batch_name, -1, &stream->batch);
+   bson_append_document_end (reply, &cursor);
+}
+
+
+static int32_t
+_benchmark_stream_batch_size (const bson_t *cmd)
+{
+   bson_iter_t iter;
+
+   if (bson_iter_init_find (&iter, cmd, "batchSize") &&
+       BSON_ITER_HOLDS_NUMBER (&iter) &&
+       bson_iter_as_int64 (&iter) > 0) {
+      return (int32_t) bson_iter_as_int64 (&iter);
+   }
+
+   return BENCHMARK_DEFAULT_BATCH_SIZE;
+}
+
+
+static void
+_benchmark_stream_handle (benchmark_stream_t *stream,
+                          const uint8_t      *buf,
+                          size_t              buflen)
+{
+   mongoc_rpc_t rpc;
+   bson_iter_t iter;
+   bson_iter_t child;
+   const char *name;
+   int32_t len;
+   int32_t n;
+   bson_t cmd;
+   bson_t reply = BSON_INITIALIZER;
+
+   if (!_mongoc_rpc_scatter (&rpc, buf, buflen)) {
+      fprintf (stderr, "benchmark stream received an invalid message\n");
+      abort ();
+   }
+
+   _mongoc_rpc_swab_from_le (&rpc);
+
+   if (rpc.header.opcode != MONGOC_OPCODE_QUERY) {
+      /* e.g. OP_KILL_CURSORS, which has no reply */
+      bson_destroy (&reply);
+      return;
+   }
+
+   memcpy (&len, rpc.query.query, 4);
+   len = BSON_UINT32_FROM_LE (len);
+   bson_init_static (&cmd, rpc.query.query, (size_t) len);
+
+   if (!bson_iter_init (&iter, &cmd) || !bson_iter_next (&iter)) {
+      name = "";
+   } else {
+      name = bson_iter_key (&iter);
+   }
+
+   if (!strcmp (name, "$query") && BSON_ITER_HOLDS_DOCUMENT (&iter)) {
+      /* a command with $readPreference */
+      bson_iter_recurse (&iter, &child);
+      name = bson_iter_next (&child) ? bson_iter_key (&child) : "";
+   }
+
+   if (!strcmp (name, "ismaster") || !strcmp (name, "isMaster")) {
+      BSON_APPEND_BOOL (&reply, "ismaster", true);
+      BSON_APPEND_INT32 (&reply, "minWireVersion", 0);
+      BSON_APPEND_INT32 (&reply, "maxWireVersion", 4);
+      BSON_APPEND_INT32 (&reply, "maxBsonObjectSize", 16 * 1024 * 1024);
+      BSON_APPEND_INT32 (&reply, "maxMessageSizeBytes", 48000000);
+      BSON_APPEND_INT32 (&reply, "maxWriteBatchSize", 1000);
+   } else if (!strcmp (name, "find")) {
+      stream->remaining = stream->opts.n_docs;
+      _benchmark_stream_append_cursor (
+         stream, &reply, "firstBatch", _benchmark_stream_batch_size (&cmd));
+   } else if (!strcmp (name, "getMore")) {
+      _benchmark_stream_append_cursor (
+         stream, &reply, "nextBatch", _benchmark_stream_batch_size (&cmd));
+   } else if (!strcmp (name, "insert")) {
+      n = 0;
+
+      if (bson_iter_init_find (&iter, &cmd, "documents") &&
+          bson_iter_recurse (&iter, &child)) {
+         while (bson_iter_next (&child)) {
+            n++;
+         }
+      }
+
+      BSON_APPEND_INT32 (&reply, "n", n);
+   }
+
+   BSON_APPEND_DOUBLE (&reply, "ok", 1.0);
+   _benchmark_stream_reply (stream, rpc.query.request_id, &reply);
+   bson_destroy (&reply);
+}
+
+
+static ssize_t
+_benchmark_stream_writev (mongoc_stream_t *base,
+                          mongoc_iovec_t  *iov,
+                          size_t           iovcnt,
+                          int32_t          timeout_msec)
+{
+   benchmark_stream_t *stream = (benchmark_stream_t *)base;
+   uint8_t *data;
+   ssize_t ret = 0;
+   int32_t msg_len;
+   size_t i;
+
+   for (i = 0; i < iovcnt; i++) {
+      _mongoc_array_append_vals (&stream->in, iov[i].iov_base,
+                                 (uint32_t) iov[i].iov_len);
+      ret += iov[i].iov_len;
+   }
+
+   while (stream->in.len >= 4) {
+      data = (uint8_t *)stream->in.data;
+      memcpy (&msg_len, data, 4);
+      msg_len = BSON_UINT32_FROM_LE (msg_len);
+
+      if (stream->in.len < (size_t) msg_len) {
+         break;
+      }
+
+      _benchmark_stream_handle (stream, data, (size_t) msg_len);
+      memmove (data, data + msg_len, stream->in.len - msg_len);
+      stream->in.len -= msg_len;
+   }
+
+   return ret;
+}
+
+
+static ssize_t
+_benchmark_stream_readv (mongoc_stream_t *base,
+                         mongoc_iovec_t  *iov,
+                         size_t           iovcnt,
+                         size_t           min_bytes,
+                         int32_t          timeout_msec)
+{
+   benchmark_stream_t *stream = (benchmark_stream_t *)base;
+   ssize_t ret = 0;
+   size_t avail;
+   size_t n;
+   size_t i;
+
+   for (i = 0; i < iovcnt; i++) {
+      avail = stream->out.len - stream->out_pos;
+      n = BSON_MIN (avail, iov[i].iov_len);
+      memcpy (iov[i].iov_base, (uint8_t *)stream->out.data + stream->out_pos,
+              n);
+      stream->out_pos += n;
+      ret += n;
+
+      if (n < iov[i].iov_len) {
+         break;
+      }
+   }
+
+   if (stream->out_pos == stream->out.len) {
+      _mongoc_array_clear (&stream->out);
+      stream->out_pos = 0;
+   }
+
+   return ret;
+}
+
+
+static int
+_benchmark_stream_close (mongoc_stream_t *base)
+{
+   return 0;
+}
+
+
+static int
+_benchmark_stream_flush (mongoc_stream_t *base)
+{
+   return 0;
+}
+
+
+static int
+_benchmark_stream_setsockopt (mongoc_stream_t *base,
+                              int              level,
+                              int              optname,
+                              void            *optval,
+                              socklen_t        optlen)
+{
+   return 0;
+}
+
+
+static bool
+_benchmark_stream_check_closed (mongoc_stream_t *base)
+{
+   return false;
+}
+
+
+static void
+_benchmark_stream_destroy (mongoc_stream_t *base)
+{
+   benchmark_stream_t *stream = (benchmark_stream_t *)base;
+
+   _mongoc_array_destroy (&stream->in);
+   _mongoc_array_destroy (&stream->out);
+   bson_destroy (&stream->batch);
+   bson_free (stream);
+}
+
+
+mongoc_stream_t *
+benchmark_stream_new (const benchmark_stream_opts_t *opts)
+{
+   benchmark_stream_t *stream;
+
+   stream = (benchmark_stream_t *)bson_malloc0 (sizeof *stream);
+   stream->vtable.type = MONGOC_STREAM_BENCHMARK;
+   stream->vtable.close = _benchmark_stream_close;
+   stream->vtable.destroy = _benchmark_stream_destroy;
+   stream->vtable.flush = _benchmark_stream_flush;
+   stream->vtable.readv = _benchmark_stream_readv;
+   stream->vtable.writev = _benchmark_stream_writev;
+   stream->vtable.setsockopt = _benchmark_stream_setsockopt;
+   stream->vtable.check_closed = _benchmark_stream_check_closed;
+
+   memcpy (&stream->opts, opts, sizeof stream->opts);
+   _mongoc_array_init (&stream->in, 1);
+   _mongoc_array_init (&stream->out, 1);
+   bson_init (&stream->batch);
+   stream->batch_n = 0;
+
+   return (mongoc_stream_t *)stream;
+}
+
+
+mongoc_stream_t *
+benchmark_stream_initiator (const mongoc_uri_t       *uri,
+                            const mongoc_host_list_t *host,
+                            void                     *user_data,
+                            bson_error_t             *error)
+{
+   return benchmark_stream_new ((const benchmark_stream_opts_t *)user_data);
+}
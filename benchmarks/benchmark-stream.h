@@ -0,0 +1,46 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BENCHMARK_STREAM_H
+#define BENCHMARK_STREAM_H
+
+#include <mongoc.h>
+
+
+/*
+ * An in-process server for benchmarks: a stream that answers each
+ * request the moment it is written, so a client using it measures the
+ * driver alone, with no network and no MongoDB.
+ *
+ * It speaks wire version 4. "find" returns n_docs copies of doc in
+ * batches of the requested batchSize, "insert" acknowledges all its
+ * documents, and any other command replies {ok: 1}.
+ */
+typedef struct
+{
+   int32_t       n_docs;
+   const bson_t *doc;
+} benchmark_stream_opts_t;
+
+
+mongoc_stream_t *benchmark_stream_new       (const benchmark_stream_opts_t *opts);
+mongoc_stream_t *benchmark_stream_initiator (const mongoc_uri_t            *uri,
+                                             const mongoc_host_list_t      *host,
+                                             void                          *user_data,
+                                             bson_error_t                  *error);
+
+
+#endif /* BENCHMARK_STREAM_H */
@@ -0,0 +1,924 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * mongoc-benchmark times the driver's hot paths with no MongoDB: wire
+ * protocol encoding and decoding, cursor iteration and bulk inserts
+ * against an in-process server stream, sending a message of many iovecs
+ * over a local socket with and without TLS, server selection and the
+ * matcher.
+ *
+ * Each benchmark runs a fixed unit of work repeatedly, doubling the
+ * number of iterations until a run takes at least the minimum time.
+ * Results are printed as one JSON document so that a release script can
+ * compare them with a baseline. Benchmarks that send also report the
+ * send system calls and TLS records per operation.
+ */
+
+
+#include <mongoc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "mongoc-array-private.h"
+#include "mongoc-counters-private.h"
+#include "mongoc-rpc-private.h"
+#include "mongoc-set-private.h"
+#include "mongoc-socket-private.h"
+#include "mongoc-thread-private.h"
+#include "mongoc-topology-description-private.h"
+
+#include "benchmark-stream.h"
+
+
+#define CURSOR_N_DOCS 10000
+#define CURSOR_BATCH_SIZE 100
+#define BULK_N_DOCS 10000
+#define RPC_N_DOCS 100
+#define SENDV_N_DOCS 1000
+
+#ifndef CERT_TEST_DIR
+# define CERT_TEST_DIR "tests/x509gen"
+#endif
+
+
+typedef struct
+{
+   const char  *name;
+   const char  *unit;
+   int64_t      ops_per_iteration;
+   void      *(*setup)    (void);
+   void       (*run)      (void *ctx);
+   void       (*teardown) (void *ctx);
+} benchmark_t;
+
+
+static void
+make_doc (bson_t *doc,
+          int32_t i)
+{
+   bson_t child;
+
+   bson_init (doc);
+   BSON_APPEND_INT32 (doc, "_id", i);
+   BSON_APPEND_UTF8 (doc, "name", "benchmark document");
+   BSON_APPEND_DOUBLE (doc, "score", i * 1.5);
+   BSON_APPEND_BOOL (doc, "active", i % 2 == 0);
+   BSON_APPEND_DOCUMENT_BEGIN (doc, "address", &child);
+   BSON_APPEND_UTF8 (&child, "street", "1633 Broadway");
+   BSON_APPEND_UTF8 (&child, "city", "New York");
+   BSON_APPEND_INT32 (&child, "zip", 10019);
+   bson_append_document_end (doc, &child);
+}
+
+
+/*
+ * rpc_gather: encode a command with RPC_N_DOCS documents into iovecs, as
+ * the cluster does before each send.
+ */
+
+static void *
+rpc_gather_setup (void)
+{
+   bson_t *cmd;
+   bson_t ar;
+   bson_t doc;
+   char str[16];
+   const char *key;
+   int32_t i;
+
+   cmd = bson_new ();
+   BSON_APPEND_UTF8 (cmd, "insert", "benchmark");
+   BSON_APPEND_ARRAY_BEGIN (cmd, "documents", &ar);
+
+   for (i = 0; i < RPC_N_DOCS; i++) {
+      bson_uint32_to_string ((uint32_t) i, &key, str, sizeof str);
+      make_doc (&doc, i);
+      BSON_APPEND_DOCUMENT (&ar, key, &doc);
+      bson_destroy (&doc);
+   }
+
+   bson_append_array_end (cmd, &ar);
+
+   return cmd;
+}
+
+
+static void
+rpc_gather_run (void *ctx)
+{
+   mongoc_rpc_t rpc;
+   mongoc_array_t ar;
+
+   _mongoc_array_init (&ar, sizeof (mongoc_iovec_t));
+   _mongoc_rpc_prep_command (&rpc, "benchmark.$cmd", (const bson_t *)ctx,
+                             MONGOC_QUERY_NONE);
+   _mongoc_rpc_gather (&rpc, &ar);
+   _mongoc_rpc_swab_to_le (&rpc);
+   _mongoc_array_destroy (&ar);
+}
+
+
+static void
+bson_teardown (void *ctx)
+{
+   bson_destroy ((bson_t *)ctx);
+}
+
+
+/*
+ * rpc_scatter: decode an OP_REPLY with RPC_N_DOCS documents and iterate
+ * them, as a cursor does with each batch.
+ */
+
+static void *
+rpc_scatter_setup (void)
+{
+   mongoc_rpc_t rpc = { { 0 } };
+   mongoc_array_t docs;
+   mongoc_array_t ar;
+   mongoc_iovec_t *iov;
+   mongoc_array_t *buf;
+   bson_t doc;
+   size_t i;
+
+   /* an OP_REPLY's documents are concatenated, not in an array */
+   _mongoc_array_init (&docs, 1);
+
+   for (i = 0; i < RPC_N_DOCS; i++) {
+      make_doc (&doc, (int32_t) i);
+      _mongoc_array_append_vals (&docs, bson_get_data (&doc), doc.len);
+      bson_destroy (&doc);
+   }
+
+   rpc.reply.opcode = MONGOC_OPCODE_REPLY;
+   rpc.reply.n_returned = RPC_N_DOCS;
+   rpc.reply.documents = (const uint8_t *)docs.data;
+   rpc.reply.documents_len = (int32_t) docs.len;
+
+   _mongoc_array_init (&ar, sizeof (mongoc_iovec_t));
+   _mongoc_rpc_gather (&rpc, &ar);
+   _mongoc_rpc_swab_to_le (&rpc);
+
+   buf = (mongoc_array_t *)bson_malloc (sizeof *buf);
+   _mongoc_array_init (buf, 1);
+
+   for (i = 0; i < ar.len; i++) {
+      iov = &_mongoc_array_index (&ar, mongoc_iovec_t, i);
+      _mongoc_array_append_vals (buf, iov->iov_base, (uint32_t) iov->iov_len);
+   }
+
+   _mongoc_array_destroy (&ar);
+   _mongoc_array_destroy (&docs);
+
+   return buf;
+}
+
+
+static void
+rpc_scatter_run (void *ctx)
+{
+   mongoc_array_t *buf = (mongoc_array_t *)ctx;
+   mongoc_rpc_t rpc;
+   bson_reader_t *reader;
+   const bson_t *doc;
+   bool eof = false;
+   int n = 0;
+
+   if (!_mongoc_rpc_scatter (&rpc, (const uint8_t *)buf->data, buf->len)) {
+      fprintf (stderr, "could not scatter reply\n");
+      abort ();
+   }
+
+   _mongoc_rpc_swab_from_le (&rpc);
+
+   reader = bson_reader_new_from_data (rpc.reply.documents,
+                                       (size_t) rpc.reply.documents_len);
+
+   while ((doc = bson_reader_read (reader, &eof))) {
+      n++;
+   }
+
+   BSON_ASSERT (n == RPC_N_DOCS);
+   bson_reader_destroy (reader);
+}
+
+
+static void
+rpc_scatter_teardown (void *ctx)
+{
+   _mongoc_array_destroy ((mongoc_array_t *)ctx);
+   bson_free (ctx);
+}
+
+
+/*
+ * cursor and bulk: a client whose streams are benchmark streams.
+ */
+
+typedef struct
+{
+   bson_t                   doc;
+   benchmark_stream_opts_t  opts;
+   mongoc_client_t         *client;
+   mongoc_collection_t     *collection;
+} client_ctx_t;
+
+
+static void *
+client_setup (void)
+{
+   client_ctx_t *ctx;
+
+   ctx = (client_ctx_t *)bson_malloc0 (sizeof *ctx);
+   make_doc (&ctx->doc, 0);
+   ctx->opts.n_docs = CURSOR_N_DOCS;
+   ctx->opts.doc = &ctx->doc;
+   ctx->client = mongoc_client_new ("mongodb://benchmark");
+   mongoc_client_set_stream_initiator (ctx->client,
+                                       benchmark_stream_initiator,
+                                       &ctx->opts);
+   ctx->collection = mongoc_client_get_collection (ctx->client, "benchmark",
+                                                   "benchmark");
+
+   return ctx;
+}
+
+
+static void
+cursor_run (void *data)
+{
+   client_ctx_t *ctx = (client_ctx_t *)data;
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   bson_error_t error;
+   bson_t query = BSON_INITIALIZER;
+   int n = 0;
+
+   cursor = mongoc_collection_find (ctx->collection, MONGOC_QUERY_NONE, 0, 0,
+                                    CURSOR_BATCH_SIZE, &query, NULL, NULL);
+
+   while (mongoc_cursor_next (cursor, &doc)) {
+      n++;
+   }
+
+   if (mongoc_cursor_error (cursor, &error)) {
+      fprintf (stderr, "cursor error: %s\n", error.message);
+      abort ();
+   }
+
+   BSON_ASSERT (n == CURSOR_N_DOCS);
+   mongoc_cursor_destroy (cursor);
+   bson_destroy (&query);
+}
+
+
+static void
+bulk_insert_run (void *data)
+{
+   client_ctx_t *ctx = (client_ctx_t *)data;
+   mongoc_bulk_operation_t *bulk;
+   bson_error_t error;
+   bson_t reply;
+   int i;
+
+   bulk = mongoc_collection_create_bulk_operation (ctx->collection, false,
+                                                   NULL);
+
+   for (i = 0; i < BULK_N_DOCS; i++) {
+      mongoc_bulk_operation_insert (bulk, &ctx->doc);
+   }
+
+   if (!mongoc_bulk_operation_execute (bulk, &reply, &error)) {
+      fprintf (stderr, "bulk error: %s\n", error.message);
+      abort ();
+   }
+
+   bson_destroy (&reply);
+   mongoc_bulk_operation_destroy (bulk);
+}
+
+
+static void
+client_teardown (void *data)
+{
+   client_ctx_t *ctx = (client_ctx_t *)data;
+
+   mongoc_collection_destroy (ctx->collection);
+   mongoc_client_destroy (ctx->client);
+   bson_destroy (&ctx->doc);
+   bson_free (ctx);
+}
+
+
+#ifndef _WIN32
+/*
+ * socket_sendv: send a legacy insert of SENDV_N_DOCS documents, which
+ * _mongoc_rpc_gather turns into an iovec per header field and document,
+ * through one end of a socket pair while a thread drains the other end.
+ */
+
+typedef struct
+{
+   int              sv[2];
+   mongoc_socket_t  sock;
+   mongoc_stream_t *tls;        /* over sv[0] for socket_sendv_tls */
+   mongoc_thread_t  reader;
+   bson_t           doc;
+   mongoc_iovec_t  *docs;
+   mongoc_array_t   iov;
+   mongoc_rpc_t     rpc;
+} sendv_ctx_t;
+
+
+static void *
+sendv_reader (void *data)
+{
+   sendv_ctx_t *ctx = (sendv_ctx_t *)data;
+   char buf[65536];
+
+   while (read (ctx->sv[1], buf, sizeof buf) > 0) {
+   }
+
+   return NULL;
+}
+
+
+static sendv_ctx_t *
+sendv_ctx_new (void)
+{
+   sendv_ctx_t *ctx;
+   int32_t i;
+
+   ctx = (sendv_ctx_t *)bson_malloc0 (sizeof *ctx);
+
+   if (socketpair (AF_UNIX, SOCK_STREAM, 0, ctx->sv) != 0) {
+      perror ("socketpair");
+      abort ();
+   }
+
+   make_doc (&ctx->doc, 0);
+   ctx->docs = (mongoc_iovec_t *)bson_malloc (SENDV_N_DOCS *
+                                              sizeof *ctx->docs);
+
+   for (i = 0; i < SENDV_N_DOCS; i++) {
+      ctx->docs[i].iov_base = (void *)bson_get_data (&ctx->doc);
+      ctx->docs[i].iov_len = ctx->doc.len;
+   }
+
+   ctx->rpc.insert.opcode = MONGOC_OPCODE_INSERT;
+   ctx->rpc.insert.collection = "benchmark.benchmark";
+   ctx->rpc.insert.documents = ctx->docs;
+   ctx->rpc.insert.n_documents = SENDV_N_DOCS;
+
+   _mongoc_array_init (&ctx->iov, sizeof (mongoc_iovec_t));
+   _mongoc_rpc_gather (&ctx->rpc, &ctx->iov);
+   _mongoc_rpc_swab_to_le (&ctx->rpc);
+
+   return ctx;
+}
+
+
+static void *
+sendv_setup (void)
+{
+   sendv_ctx_t *ctx = sendv_ctx_new ();
+
+   ctx->sock.sd = ctx->sv[0];
+   ctx->sock.domain = AF_UNIX;
+   mongoc_thread_create (&ctx->reader, sendv_reader, ctx);
+
+   return ctx;
+}
+
+
+static void
+sendv_run (void *data)
+{
+   sendv_ctx_t *ctx = (sendv_ctx_t *)data;
+   ssize_t r;
+
+   r = mongoc_socket_sendv (&ctx->sock, (mongoc_iovec_t *)ctx->iov.data,
+                            ctx->iov.len, -1);
+
+   if (r != (ssize_t) BSON_UINT32_FROM_LE (ctx->rpc.insert.msg_len)) {
+      fprintf (stderr, "sendv failed: %d\n", (int)r);
+      abort ();
+   }
+}
+
+
+static void
+sendv_teardown (void *data)
+{
+   sendv_ctx_t *ctx = (sendv_ctx_t *)data;
+
+   /* the reader sees EOF */
+   close (ctx->sv[0]);
+   mongoc_thread_join (ctx->reader);
+   close (ctx->sv[1]);
+
+   bson_free (ctx->sock.send_iov);
+   bson_free (ctx->sock.send_buf);
+   _mongoc_array_destroy (&ctx->iov);
+   bson_free (ctx->docs);
+   bson_destroy (&ctx->doc);
+   bson_free (ctx);
+}
+
+
+#ifdef MONGOC_ENABLE_SSL_OPENSSL
+/*
+ * socket_sendv_tls: the same message through an OpenSSL stream, with a
+ * thread decrypting it at the other end.
+ */
+
+static mongoc_stream_t *
+sendv_tls_stream (int               sd,
+                  mongoc_ssl_opt_t *opt,
+                  int               client)
+{
+   mongoc_socket_t *sock;
+   mongoc_stream_t *stream;
+   bson_error_t error;
+
+   /* the socket stream frees the socket and closes sd */
+   sock = (mongoc_socket_t *)bson_malloc0 (sizeof *sock);
+   sock->sd = sd;
+   sock->domain = AF_UNIX;
+
+   stream = mongoc_stream_tls_new_with_hostname (
+      mongoc_stream_socket_new (sock), "localhost", opt, client);
+
+   if (!stream ||
+       !mongoc_stream_tls_handshake_block (stream, "localhost", 10000,
+                                           &error)) {
+      fprintf (stderr, "TLS handshake failed: %s\n",
+               stream ? error.message : "no stream");
+      abort ();
+   }
+
+   return stream;
+}
+
+
+static void *
+sendv_tls_reader (void *data)
+{
+   sendv_ctx_t *ctx = (sendv_ctx_t *)data;
+   mongoc_ssl_opt_t opt = { 0 };
+   mongoc_stream_t *stream;
+   char buf[65536];
+
+   opt.pem_file = CERT_TEST_DIR "/server.pem";
+   opt.ca_file = CERT_TEST_DIR "/ca.pem";
+   stream = sendv_tls_stream (ctx->sv[1], &opt, 0);
+
+   while (mongoc_stream_read (stream, buf, sizeof buf, 1, -1) > 0) {
+   }
+
+   mongoc_stream_destroy (stream);
+
+   return NULL;
+}
+
+
+static void *
+sendv_tls_setup (void)
+{
+   sendv_ctx_t *ctx = sendv_ctx_new ();
+   mongoc_ssl_opt_t opt = { 0 };
+
+   opt.weak_cert_validation = true;
+   mongoc_thread_create (&ctx->reader, sendv_tls_reader, ctx);
+   ctx->tls = sendv_tls_stream (ctx->sv[0], &opt, 1);
+
+   return ctx;
+}
+
+
+static void
+sendv_tls_run (void *data)
+{
+   sendv_ctx_t *ctx = (sendv_ctx_t *)data;
+   ssize_t r;
+
+   r = mongoc_stream_writev (ctx->tls, (mongoc_iovec_t *)ctx->iov.data,
+                             ctx->iov.len, -1);
+
+   if (r != (ssize_t) BSON_UINT32_FROM_LE (ctx->rpc.insert.msg_len)) {
+      fprintf (stderr, "TLS writev failed: %d\n", (int)r);
+      abort ();
+   }
+}
+
+
+static void
+sendv_tls_teardown (void *data)
+{
+   sendv_ctx_t *ctx = (sendv_ctx_t *)data;
+
+   /* closes sv[0], the reader sees EOF and closes sv[1] */
+   mongoc_stream_destroy (ctx->tls);
+   mongoc_thread_join (ctx->reader);
+
+   _mongoc_array_destroy (&ctx->iov);
+   bson_free (ctx->docs);
+   bson_destroy (&ctx->doc);
+   bson_free (ctx);
+}
+#endif
+#endif
+
+
+/*
+ * server_selection: choose among a primary and two secondaries with
+ * secondaryPreferred.
+ */
+
+typedef struct
+{
+   mongoc_topology_description_t  td;
+   mongoc_read_prefs_t           *prefs;
+} selection_ctx_t;
+
+
+static void *
+server_selection_setup (void)
+{
+   const char *hosts[] = { "a:27017", "b:27017", "c:27017" };
+   selection_ctx_t *ctx;
+   mongoc_server_description_t *sd;
+   bson_error_t error;
+   bson_t ismaster;
+   bson_t ar;
+   uint32_t id;
+   char str[16];
+   const char *key;
+   int i;
+   int j;
+
+   ctx = (selection_ctx_t *)bson_malloc0 (sizeof *ctx);
+   mongoc_topology_description_init (&ctx->td, MONGOC_TOPOLOGY_RS_NO_PRIMARY);
+
+   for (i = 0; i < 3; i++) {
+      mongoc_topology_description_add_server (&ctx->td, hosts[i], &id);
+   }
+
+   for (i = 0; i < 3; i++) {
+      bson_init (&ismaster);
+      BSON_APPEND_INT32 (&ismaster, "ok", 1);
+      BSON_APPEND_BOOL (&ismaster, "ismaster", i == 0);
+      BSON_APPEND_BOOL (&ismaster, "secondary", i != 0);
+      BSON_APPEND_UTF8 (&ismaster, "setName", "rs");
+      BSON_APPEND_UTF8 (&ismaster, "me", hosts[i]);
+      BSON_APPEND_INT32 (&ismaster, "maxWireVersion", 4);
+      BSON_APPEND_ARRAY_BEGIN (&ismaster, "hosts", &ar);
+
+      for (j = 0; j < 3; j++) {
+         bson_uint32_to_string ((uint32_t) j, &key, str, sizeof str);
+         BSON_APPEND_UTF8 (&ar, key, hosts[j]);
+      }
+
+      bson_append_array_end (&ismaster, &ar);
+
+      sd = (mongoc_server_description_t *)mongoc_set_get_item (
+         ctx->td.servers, i);
+      mongoc_topology_description_handle_ismaster (&ctx->td, sd, &ismaster,
+                                                   10 + i, &error);
+      bson_destroy (&ismaster);
+   }
+
+   ctx->prefs = mongoc_read_prefs_new (MONGOC_READ_SECONDARY_PREFERRED);
+
+   return ctx;
+}
+
+
+static void
+server_selection_run (void *data)
+{
+   selection_ctx_t *ctx = (selection_ctx_t *)data;
+   mongoc_server_description_t *sd;
+
+   sd = mongoc_topology_description_select (&ctx->td, MONGOC_SS_READ,
+                                            ctx->prefs, 15, 10000);
+   BSON_ASSERT (sd);
+}
+
+
+static void
+server_selection_teardown (void *data)
+{
+   selection_ctx_t *ctx = (selection_ctx_t *)data;
+
+   mongoc_read_prefs_destroy (ctx->prefs);
+   mongoc_topology_description_destroy (&ctx->td);
+   bson_free (ctx);
+}
+
+
+/*
+ * matcher: match a document against a query on a nested field.
+ */
+
+typedef struct
+{
+   mongoc_matcher_t *matcher;
+   bson_t            doc;
+} matcher_ctx_t;
+
+
+static void *
+matcher_setup (void)
+{
+   matcher_ctx_t *ctx;
+   bson_t query;
+   bson_t child;
+
+   ctx = (matcher_ctx_t *)bson_malloc0 (sizeof *ctx);
+   make_doc (&ctx->doc, 42);
+
+   bson_init (&query);
+   BSON_APPEND_UTF8 (&query, "address.city", "New York");
+   BSON_APPEND_DOCUMENT_BEGIN (&query, "score", &child);
+   BSON_APPEND_INT32 (&child, "$gt", 10);
+   bson_append_document_end (&query, &child);
+
+   ctx->matcher = mongoc_matcher_new (&query, NULL);
+   BSON_ASSERT (ctx->matcher);
+   bson_destroy (&query);
+
+   return ctx;
+}
+
+
+static void
+matcher_run (void *data)
+{
+   matcher_ctx_t *ctx = (matcher_ctx_t *)data;
+
+   BSON_ASSERT (mongoc_matcher_match (ctx->matcher, &ctx->doc));
+}
+
+
+static void
+matcher_teardown (void *data)
+{
+   matcher_ctx_t *ctx = (matcher_ctx_t *)data;
+
+   mongoc_matcher_destroy (ctx->matcher);
+   bson_destroy (&ctx->doc);
+   bson_free (ctx);
+}
+
+
+static benchmark_t gBenchmarks[] = {
+   { "rpc_gather", "messages", 1,
+     rpc_gather_setup, rpc_gather_run, bson_teardown },
+   { "rpc_scatter", "messages", 1,
+     rpc_scatter_setup, rpc_scatter_run, rpc_scatter_teardown },
+   { "cursor_iterate", "documents", CURSOR_N_DOCS,
+     client_setup, cursor_run, client_teardown },
+   { "bulk_insert", "documents", BULK_N_DOCS,
+     client_setup, bulk_insert_run, client_teardown },
+#ifndef _WIN32
+   { "socket_sendv", "messages", 1,
+     sendv_setup, sendv_run, sendv_teardown },
+#ifdef MONGOC_ENABLE_SSL_OPENSSL
+   { "socket_sendv_tls", "messages", 1,
+     sendv_tls_setup, sendv_tls_run, sendv_tls_teardown },
+#endif
+#endif
+   { "server_selection", "selections", 1,
+     server_selection_setup, server_selection_run,
+     server_selection_teardown },
+   { "matcher", "matches", 1,
+     matcher_setup, matcher_run, matcher_teardown },
+};
+
+
+static bool
+selected (const benchmark_t *benchmark,
+          int                n_filters,
+          char             **filters)
+{
+   int i;
+
+   if (!n_filters) {
+      return true;
+   }
+
+   for (i = 0; i < n_filters; i++) {
+      if (strstr (benchmark->name, filters[i])) {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+
+static void
+run_benchmark (const benchmark_t *benchmark,
+               int64_t            min_usec,
+               bson_t            *results,
+               const char        *key)
+{
+   void *ctx;
+   int64_t iterations = 1;
+   int64_t started;
+   int64_t elapsed;
+   int64_t i;
+   int64_t calls = 0;
+   int64_t records = 0;
+   double ns_per_op;
+   double ops_per_sec;
+   double n_ops;
+   bson_t result;
+
+   ctx = benchmark->setup ();
+
+   /* warm up */
+   benchmark->run (ctx);
+
+   for (;;) {
+      calls = mongoc_counter_streams_egress_calls_count ();
+      records = mongoc_counter_streams_tls_records_count ();
+      started = bson_get_monotonic_time ();
+
+      for (i = 0; i < iterations; i++) {
+         benchmark->run (ctx);
+      }
+
+      elapsed = bson_get_monotonic_time () - started;
+      calls = mongoc_counter_streams_egress_calls_count () - calls;
+      records = mongoc_counter_streams_tls_records_count () - records;
+
+      if (elapsed >= min_usec || iterations >= INT64_MAX / 2) {
+         break;
+      }
+
+      iterations *= 2;
+   }
+
+   benchmark->teardown (ctx);
+
+   if (elapsed <= 0) {
+      elapsed = 1;
+   }
+
+   n_ops = (double) (iterations * benchmark->ops_per_iteration);
+   ns_per_op = (double) elapsed * 1000.0 / n_ops;
+   ops_per_sec = 1e9 / ns_per_op;
+
+   fprintf (stderr, "%-20s %12.1f ns/op %14.0f %s/s",
+            benchmark->name, ns_per_op, ops_per_sec, benchmark->unit);
+
+   if (calls) {
+      fprintf (stderr, " %8.1f sends/op", (double) calls / n_ops);
+   }
+
+   if (records) {
+      fprintf (stderr, " %8.1f records/op", (double) records / n_ops);
+   }
+
+   fprintf (stderr, "\n");
+
+   BSON_APPEND_DOCUMENT_BEGIN (results, key, &result);
+   BSON_APPEND_UTF8 (&result, "name", benchmark->name);
+   BSON_APPEND_UTF8 (&result, "unit", benchmark->unit);
+   BSON_APPEND_INT64 (&result, "iterations", iterations);
+   BSON_APPEND_INT64 (&result, "ops",
+                      iterations * benchmark->ops_per_iteration);
+   BSON_APPEND_INT64 (&result, "elapsed_usec", elapsed);
+   BSON_APPEND_DOUBLE (&result, "ns_per_op", ns_per_op);
+   BSON_APPEND_DOUBLE (&result, "ops_per_sec", ops_per_sec);
+
+   if (calls) {
+      BSON_APPEND_DOUBLE (&result, "sends_per_op", (double) calls / n_ops);
+   }
+
+   if (records) {
+      BSON_APPEND_DOUBLE (&result, "tls_records_per_op",
+                          (double) records / n_ops);
+   }
+   bson_append_document_end (results, &result);
+}
+
+
+static void
+usage (FILE *stream)
+{
+   fprintf (stream,
+"Usage: mongoc-benchmark [OPTIONS] [NAME...]\n"
+"\n"
+"Run the benchmarks whose names contain one of NAME, or all of them.\n"
+"Progress goes to stderr, JSON results to stdout.\n"
+"\n"
+"Options:\n"
+"\n"
+"  -t MSEC   Minimum time per benchmark [1000].\n"
+"  -o FILE   Write JSON results to FILE instead of stdout.\n"
+"  -l        List benchmarks.\n"
+"\n");
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+   const char *out_path = NULL;
+   int64_t min_msec = 1000;
+   char **filters;
+   int n_filters = 0;
+   size_t i;
+   uint32_t n_results = 0;
+   char str[16];
+   const char *key;
+   char *json;
+   bson_t doc = BSON_INITIALIZER;
+   bson_t results;
+   FILE *out;
+   int arg;
+
+   filters = (char **)bson_malloc0 (argc * sizeof (char *));
+
+   for (arg = 1; arg < argc; arg++) {
+      if (!strcmp (argv[arg], "-t") && arg + 1 < argc) {
+         min_msec = strtol (argv[++arg], NULL, 10);
+      } else if (!strcmp (argv[arg], "-o") && arg + 1 < argc) {
+         out_path = argv[++arg];
+      } else if (!strcmp (argv[arg], "-l")) {
+         for (i = 0; i < sizeof gBenchmarks / sizeof gBenchmarks[0]; i++) {
+            printf ("%s\n", gBenchmarks[i].name);
+         }
+
+         bson_free (filters);
+         return EXIT_SUCCESS;
+      } else if (argv[arg][0] == '-') {
+         usage (stderr);
+         bson_free (filters);
+         return EXIT_FAILURE;
+      } else {
+         filters[n_filters++] = argv[arg];
+      }
+   }
+
+   mongoc_init ();
+
+   /* logging would dominate the measurements */
+   mongoc_log_set_handler (NULL, NULL);
+
+   BSON_APPEND_UTF8 (&doc, "version", MONGOC_VERSION_S);
+   BSON_APPEND_INT64 (&doc, "min_time_ms", min_msec);
+   BSON_APPEND_ARRAY_BEGIN (&doc, "results", &results);
+
+   for (i = 0; i < sizeof gBenchmarks / sizeof gBenchmarks[0]; i++) {
+      if (selected (&gBenchmarks[i], n_filters, filters)) {
+         bson_uint32_to_string (n_results++, &key, str, sizeof str);
+         run_benchmark (&gBenchmarks[i], min_msec * 1000, &results, key);
+      }
+   }
+
+   bson_append_array_end (&doc, &results);
+
+   out = out_path ? fopen (out_path, "w") : stdout;
+
+   if (!out) {
+      perror ("Failed to open output file");
+      return EXIT_FAILURE;
+   }
+
+   json = bson_as_json (&doc, NULL);
+   fprintf (out, "%s\n", json);
+   bson_free (json);
+
+   if (out != stdout) {
+      fclose (out);
+   }
+
+   bson_destroy (&doc);
+   bson_free (filters);
+   mongoc_cleanup ();
+
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,22 @@
+AC_ARG_ENABLE([usdt],
+              [AS_HELP_STRING([--enable-usdt=@<:@auto/yes/no@:>@],
+                              [Add USDT probes for bpftrace, perf and SystemTap, using sys/sdt.h.])],
+              [],
+              [enable_usdt=auto])
+
+usdt_mode=no
+
+AS_IF([test "$enable_usdt" != "no"],[
+  AC_CHECK_HEADER([sys/sdt.h],[usdt_mode=yes],[usdt_mode=no])
+])
+
+if test "$enable_usdt" = "yes" -a "$usdt_mode" = "no" ; then
+  AC_MSG_ERROR([You must install sys/sdt.h (from systemtap-sdt-dev or systemtap-sdt-devel) to enable USDT probes.])
+fi
+
+dnl Let mongoc-config.h.in know about USDT probes.
+if test "$usdt_mode" = "yes" ; then
+  AC_SUBST(MONGOC_ENABLE_USDT, 1)
+else
+  AC_SUBST(MONGOC_ENABLE_USDT, 0)
+fi
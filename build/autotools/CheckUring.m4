@@ -0,0 +1,33 @@
+AC_ARG_ENABLE([uring],
+              [AS_HELP_STRING([--enable-uring=@<:@auto/yes/no@:>@],
+                              [Use liburing for the io_uring socket stream.])],
+              [],
+              [enable_uring=auto])
+
+uring_mode=no
+
+AS_IF([test "$enable_uring" != "no" -a "$os_linux" = "yes"],[
+  PKG_CHECK_MODULES(URING, [liburing], [uring_mode=yes], [
+    AC_CHECK_LIB([uring],[io_uring_queue_init],[have_uring_lib=yes],[have_uring_lib=no])
+    AC_CHECK_HEADER([liburing.h],[have_uring_headers=yes],[have_uring_headers=no])
+
+    if test "$have_uring_lib" = "yes" -a "$have_uring_headers" = "yes" ; then
+      uring_mode=yes
+      URING_LIBS=-luring
+    fi
+  ])
+])
+
+if test "$enable_uring" = "yes" -a "$uring_mode" = "no" ; then
+  AC_MSG_ERROR([You must install liburing and its development headers to enable io_uring support.])
+fi
+
+AC_SUBST(URING_CFLAGS)
+AC_SUBST(URING_LIBS)
+
+dnl Let mongoc-config.h.in know about io_uring status.
+if test "$uring_mode" = "yes" ; then
+  AC_SUBST(MONGOC_ENABLE_URING, 1)
+else
+  AC_SUBST(MONGOC_ENABLE_URING, 0)
+fi
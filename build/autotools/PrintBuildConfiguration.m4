@@ -48,6 +48,8 @@ Build configuration:
   Fast counters                                    : ${enable_rdtscp}
   Shared memory performance counters               : ${enable_shm_counters}
   SASL                                             : ${sasl_mode}
+  io_uring                                         : ${uring_mode}
+  USDT probes                                      : ${usdt_mode}
   SSL                                              : ${enable_ssl}
   Libbson                                          : ${with_libbson}${enable_experimental_text}
 
@@ -0,0 +1,29 @@
+message (STATUS "Searching for liburing.h")
+find_path (
+    URING_INCLUDE_DIR NAMES liburing.h
+    PATHS /include /usr/include /usr/local/include /opt/include
+    DOC "Searching for liburing.h")
+
+if (URING_INCLUDE_DIR)
+    message (STATUS "  Found in ${URING_INCLUDE_DIR}")
+else ()
+    message (STATUS "  Not found (the io_uring stream will be disabled)")
+endif ()
+
+message (STATUS "Searching for liburing")
+find_library(
+    URING_LIBRARY NAMES uring
+    PATHS /usr/lib /lib /usr/local/lib /opt/lib
+    DOC "Searching for liburing")
+
+if (URING_LIBRARY)
+    message (STATUS "  Found ${URING_LIBRARY}")
+else ()
+    message (STATUS "  Not found (the io_uring stream will be disabled)")
+endif ()
+
+if (URING_INCLUDE_DIR AND URING_LIBRARY AND CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    set (URING_FOUND 1)
+else ()
+    set (URING_FOUND 0)
+endif ()
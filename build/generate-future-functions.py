@@ -55,6 +55,7 @@ typedef_list = [
     typedef("int", None),
     typedef("int64_t", None),
     typedef("size_t", None),
+    typedef("size_t_ptr", "size_t *"),
     typedef("ssize_t", None),
     typedef("uint32_t", None),
 
@@ -85,6 +86,7 @@ typedef_list = [
     typedef("mongoc_topology_ptr", "mongoc_topology_t *"),
 
     # Const libmongoc.
+    typedef("const_mongoc_doc_view_ptr_ptr", "const mongoc_doc_view_t **"),
     typedef("const_mongoc_find_and_modify_opts_ptr", "const mongoc_find_and_modify_opts_t *"),
     typedef("const_mongoc_read_prefs_ptr", "const mongoc_read_prefs_t *"),
     typedef("const_mongoc_write_concern_ptr", "const mongoc_write_concern_t *"),
@@ -204,6 +206,12 @@ future_functions = [
                     [param("mongoc_cursor_ptr", "cursor"),
                      param("const_bson_ptr_ptr", "doc")]),
 
+    future_function("bool",
+                    "mongoc_cursor_next_batch",
+                    [param("mongoc_cursor_ptr", "cursor"),
+                     param("const_mongoc_doc_view_ptr_ptr", "docs"),
+                     param("size_t_ptr", "n_docs")]),
+
     future_function("char_ptr_ptr",
                     "mongoc_client_get_database_names",
                     [param("mongoc_client_ptr", "client"),
@@ -217,6 +225,11 @@ future_functions = [
                      param("bson_ptr", "reply"),
                      param("bson_error_ptr", "error")]),
 
+    future_function("bool",
+                    "mongoc_database_drop",
+                    [param("mongoc_database_ptr", "database"),
+                     param("bson_error_ptr", "error")]),
+
     future_function("char_ptr_ptr",
                     "mongoc_database_get_collection_names",
                     [param("mongoc_database_ptr", "database"),
@@ -67,6 +67,9 @@ bool
 mongoc_async_run (mongoc_async_t *async,
                   int32_t         timeout_msec);
 
+void
+mongoc_async_run_cmd (struct _mongoc_async_cmd *acmd);
+
 struct _mongoc_async_cmd *
 mongoc_async_cmd (mongoc_async_t          *async,
                   mongoc_stream_t         *stream,
@@ -159,3 +159,50 @@ mongoc_async_run (mongoc_async_t *async,
 
    return async->ncmds;
 }
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_async_run_cmd --
+ *
+ *       Run @acmd alone until it completes or times out, leaving the
+ *       other commands as they are. @acmd is destroyed on return.
+ *
+ *--------------------------------------------------------------------------
+ */
+void
+mongoc_async_run_cmd (mongoc_async_cmd_t *acmd)
+{
+   mongoc_stream_poll_t poller;
+   ssize_t nactive;
+   int64_t now;
+
+   for (;;) {
+      now = bson_get_monotonic_time ();
+
+      if (now > acmd->expire_at) {
+         acmd->cb (MONGOC_ASYNC_CMD_TIMEOUT, NULL, (now - acmd->start_time), acmd->data,
+                   &acmd->error);
+         mongoc_async_cmd_destroy (acmd);
+         return;
+      }
+
+      poller.stream = acmd->stream;
+      poller.events = acmd->events;
+      poller.revents = 0;
+
+      nactive = mongoc_stream_poll (&poller, 1,
+                                    (int32_t) ((acmd->expire_at - now) / 1000));
+
+      if (nactive < 0 || (poller.revents & (POLLERR | POLLHUP))) {
+         acmd->state = MONGOC_ASYNC_CMD_ERROR_STATE;
+      }
+
+      if (acmd->state == MONGOC_ASYNC_CMD_ERROR_STATE
+          || (poller.revents & poller.events)) {
+         if (!mongoc_async_cmd_run (acmd)) {
+            return;
+         }
+      }
+   }
+}
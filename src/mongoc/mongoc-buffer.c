@@ -20,6 +20,7 @@
 
 #include "mongoc-error.h"
 #include "mongoc-buffer-private.h"
+#include "mongoc-memory-private.h"
 #include "mongoc-trace.h"
 
 
@@ -42,7 +43,8 @@
  * @realloc_func: A function to resize @buf.
  *
  * Initializes @buffer for use. If additional space is needed by @buffer, then
- * @realloc_func will be called to resize @buf.
+ * @realloc_func will be called to resize @buf. If both @buf and @realloc_func
+ * are NULL, the buffer's memory is counted as MONGOC_MEMORY_BUFFERS.
  *
  * @buffer takes ownership of @buf and will realloc it to zero bytes when
  * cleaning up the data structure.
@@ -58,7 +60,7 @@ _mongoc_buffer_init (mongoc_buffer_t   *buffer,
    BSON_ASSERT (buflen || !buf);
 
    if (!realloc_func) {
-      realloc_func = bson_realloc_ctx;
+      realloc_func = buf ? bson_realloc_ctx : _mongoc_memory_buffer_realloc;
    }
 
    if (!buflen) {
@@ -66,7 +68,7 @@ _mongoc_buffer_init (mongoc_buffer_t   *buffer,
    }
 
    if (!buf) {
-      buf = (uint8_t *)realloc_func (NULL, buflen, NULL);
+      buf = (uint8_t *)realloc_func (NULL, buflen, realloc_data);
    }
 
    memset (buffer, 0, sizeof *buffer);
@@ -163,7 +165,8 @@ _mongoc_buffer_append_from_stream (mongoc_buffer_t *buffer,
       buffer->off = 0;
       if (!SPACE_FOR (buffer, size)) {
          buffer->datalen = bson_next_power_of_two (size + buffer->len + buffer->off);
-         buffer->data = (uint8_t *)buffer->realloc_func (buffer->data, buffer->datalen, NULL);
+         buffer->data = (uint8_t *)buffer->realloc_func (buffer->data, buffer->datalen,
+                                                         buffer->realloc_data);
       }
    }
 
@@ -306,7 +309,8 @@ _mongoc_buffer_try_append_from_stream (mongoc_buffer_t *buffer,
       buffer->off = 0;
       if (!SPACE_FOR (buffer, size)) {
          buffer->datalen = bson_next_power_of_two (size + buffer->len + buffer->off);
-         buffer->data = (uint8_t *)buffer->realloc_func (buffer->data, buffer->datalen, NULL);
+         buffer->data = (uint8_t *)buffer->realloc_func (buffer->data, buffer->datalen,
+                                                         buffer->realloc_data);
       }
    }
 
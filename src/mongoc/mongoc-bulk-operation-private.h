@@ -23,6 +23,7 @@
 
 #include "mongoc-array-private.h"
 #include "mongoc-client.h"
+#include "mongoc-client-pool.h"
 #include "mongoc-write-command-private.h"
 
 
@@ -40,6 +41,11 @@ struct _mongoc_bulk_operation_t
    mongoc_write_result_t          result;
    bool                           executed;
    int64_t                        operation_id;
+   mongoc_client_pool_t          *pool;
+   uint32_t                       n_threads;
+   bool                           shard_routing;
+   mongoc_validate_level_t        validate_level;
+   uint32_t                       operation_timeout_ms;
 };
 
 
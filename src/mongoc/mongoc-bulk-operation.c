@@ -19,6 +19,8 @@
 #include "mongoc-bulk-operation-private.h"
 #include "mongoc-client-private.h"
 #include "mongoc-error.h"
+#include "mongoc-shard-map-private.h"
+#include "mongoc-thread-private.h"
 #include "mongoc-trace.h"
 #include "mongoc-write-concern-private.h"
 
@@ -51,6 +53,7 @@ mongoc_bulk_operation_new (bool ordered)
    bulk->flags.bypass_document_validation = MONGOC_BYPASS_DOCUMENT_VALIDATION_DEFAULT;
    bulk->flags.ordered = ordered;
    bulk->server_id = 0;
+   bulk->validate_level = MONGOC_VALIDATE_FULL;
 
    _mongoc_array_init (&bulk->commands, sizeof (mongoc_write_command_t));
 
@@ -255,7 +258,10 @@ mongoc_bulk_operation_replace_one (mongoc_bulk_operation_t *bulk,
 
    ENTRY;
 
-   if (!bson_validate (document, (bson_validate_flags_t)flags, &err_off)) {
+   flags = _mongoc_validate_flags (bulk->validate_level, flags);
+
+   if (flags &&
+       !bson_validate (document, (bson_validate_flags_t)flags, &err_off)) {
       MONGOC_WARNING ("%s(): replacement document may not contain "
                       "$ or . in keys. Ignoring document.",
                       BSON_FUNC);
@@ -370,6 +376,354 @@ mongoc_bulk_operation_update_one (mongoc_bulk_operation_t *bulk,
 }
 
 
+typedef struct
+{
+   mongoc_bulk_operation_t *bulk;
+   mongoc_array_t          *commands;
+   uint32_t                 server_id;
+   mongoc_mutex_t           mutex;
+   int                      next;
+   uint32_t                *offsets;
+   mongoc_write_result_t   *results;
+} mongoc_bulk_parallel_t;
+
+
+typedef struct
+{
+   mongoc_bulk_parallel_t  *parallel;
+   mongoc_client_t         *client;
+   mongoc_server_stream_t  *server_stream;
+   mongoc_thread_t          thread;
+} mongoc_bulk_worker_t;
+
+
+static void *
+_mongoc_bulk_operation_worker (void *data)
+{
+   mongoc_bulk_worker_t *worker = (mongoc_bulk_worker_t *)data;
+   mongoc_bulk_parallel_t *parallel = worker->parallel;
+   mongoc_bulk_operation_t *bulk = parallel->bulk;
+   mongoc_write_command_t *command;
+   mongoc_write_result_t *result;
+   int i;
+
+   for (;;) {
+      mongoc_mutex_lock (&parallel->mutex);
+      i = parallel->next++;
+      mongoc_mutex_unlock (&parallel->mutex);
+
+      if (i >= parallel->commands->len) {
+         break;
+      }
+
+      command = &_mongoc_array_index (parallel->commands,
+                                      mongoc_write_command_t, i);
+      result = &parallel->results[i];
+
+      if (!worker->server_stream) {
+         if (parallel->server_id) {
+            worker->server_stream = mongoc_cluster_stream_for_server (
+               &worker->client->cluster, parallel->server_id,
+               true /* reconnect_ok */, &result->error);
+         } else {
+            /* with several mongos, spread the threads among them */
+            worker->server_stream = mongoc_cluster_stream_for_writes (
+               &worker->client->cluster, &result->error);
+         }
+
+         if (!worker->server_stream) {
+            result->failed = true;
+            continue;
+         }
+      }
+
+      _mongoc_write_command_execute (command, worker->client,
+                                     worker->server_stream,
+                                     bulk->database, bulk->collection,
+                                     bulk->write_concern, parallel->offsets[i],
+                                     result);
+   }
+
+   return NULL;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_bulk_operation_execute_parallel --
+ *
+ *       Execute the write commands of an unordered bulk operation
+ *       concurrently. The calling thread uses @server_stream, and up to
+ *       bulk->n_threads - 1 helper threads each use a client popped from
+ *       bulk->pool. Unless bulk has a server hint, helper threads select
+ *       their own server for writes, spreading batches among mongos.
+ *       Each command is executed into its own result; results are merged
+ *       in command order so the reply matches a sequential run.
+ *
+ * Side effects:
+ *       bulk->result is updated.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_bulk_operation_execute_parallel (mongoc_bulk_operation_t *bulk,
+                                         mongoc_array_t          *commands,
+                                         mongoc_server_stream_t  *server_stream)
+{
+   mongoc_bulk_parallel_t parallel;
+   mongoc_bulk_worker_t *workers;
+   mongoc_write_command_t *command;
+   mongoc_client_t *client;
+   uint32_t n_workers = 1;
+   uint32_t offset = 0;
+   uint32_t i;
+
+   ENTRY;
+
+   parallel.bulk = bulk;
+   parallel.commands = commands;
+   /* with a hint, every thread uses the server this run selected */
+   parallel.server_id = bulk->server_id ? server_stream->sd->id : 0;
+   parallel.next = 0;
+   parallel.offsets = (uint32_t *)bson_malloc (
+      commands->len * sizeof (uint32_t));
+   parallel.results = (mongoc_write_result_t *)bson_malloc (
+      commands->len * sizeof (mongoc_write_result_t));
+   mongoc_mutex_init (&parallel.mutex);
+
+   for (i = 0; i < commands->len; i++) {
+      command = &_mongoc_array_index (commands, mongoc_write_command_t, i);
+      parallel.offsets[i] = offset;
+      _mongoc_write_result_init (&parallel.results[i]);
+      offset += command->n_documents;
+   }
+
+   workers = (mongoc_bulk_worker_t *)bson_malloc0 (
+      BSON_MIN (bulk->n_threads, commands->len) * sizeof *workers);
+
+   workers[0].parallel = &parallel;
+   workers[0].client = bulk->client;
+   workers[0].server_stream = server_stream;
+
+   /* don't wait for a client, use the ones that are free now */
+   while (n_workers < BSON_MIN (bulk->n_threads, commands->len) &&
+          (client = mongoc_client_pool_try_pop (bulk->pool))) {
+      if (client->topology != bulk->client->topology) {
+         /* server ids are only meaningful within one topology */
+         mongoc_client_pool_push (bulk->pool, client);
+         break;
+      }
+
+      client->cluster.operation_id = bulk->operation_id;
+      client->cluster.operation_expire_at =
+         bulk->client->cluster.operation_expire_at;
+      workers[n_workers].parallel = &parallel;
+      workers[n_workers].client = client;
+
+      if (mongoc_thread_create (&workers[n_workers].thread,
+                                _mongoc_bulk_operation_worker,
+                                &workers[n_workers])) {
+         /* the threads started so far do the rest */
+         MONGOC_WARNING ("Cannot start a bulk operation thread");
+         client->cluster.operation_expire_at = 0;
+         mongoc_client_pool_push (bulk->pool, client);
+         break;
+      }
+
+      n_workers++;
+   }
+
+   _mongoc_bulk_operation_worker (&workers[0]);
+
+   for (i = 1; i < n_workers; i++) {
+      mongoc_thread_join (workers[i].thread);
+      mongoc_server_stream_cleanup (workers[i].server_stream);
+      workers[i].client->cluster.operation_expire_at = 0;
+      mongoc_client_pool_push (bulk->pool, workers[i].client);
+   }
+
+   for (i = 0; i < commands->len; i++) {
+      command = &_mongoc_array_index (commands, mongoc_write_command_t, i);
+
+      if (command->server_id) {
+         bulk->server_id = command->server_id;
+      }
+
+      _mongoc_write_result_merge_result (&bulk->result, &parallel.results[i]);
+      _mongoc_write_result_destroy (&parallel.results[i]);
+   }
+
+   mongoc_mutex_destroy (&parallel.mutex);
+   bson_free (workers);
+   bson_free (parallel.results);
+   bson_free (parallel.offsets);
+
+   EXIT;
+}
+
+
+typedef struct
+{
+   const char             *shard;   /* NULL if we can't tell */
+   mongoc_write_command_t  command;
+   mongoc_array_t          indexes;
+} mongoc_bulk_shard_group_t;
+
+
+static void
+_mongoc_bulk_shard_group_flush (mongoc_bulk_shard_group_t *group,
+                                mongoc_array_t            *commands,
+                                mongoc_array_t            *indexes)
+{
+   mongoc_write_command_t command;
+
+   if (!group->command.n_documents) {
+      return;
+   }
+
+   _mongoc_array_append_val (commands, group->command);
+   _mongoc_array_append_vals (indexes, group->indexes.data,
+                              (uint32_t) group->indexes.len);
+   _mongoc_array_clear (&group->indexes);
+
+   command = group->command;
+   _mongoc_write_command_init_insert (&group->command, NULL, command.flags,
+                                      command.operation_id,
+                                      command.u.insert.allow_bulk_op_insert);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_bulk_operation_group_by_shard --
+ *
+ *       Copy bulk->commands into @commands, regrouping the documents of
+ *       all insert commands into commands whose documents all belong to
+ *       one shard according to @map, so mongos can pass each batch to a
+ *       single shard instead of scattering it. Groups span the whole bulk
+ *       operation and are split only at the batch size; the write command
+ *       splits them further at the server's message size. Other commands
+ *       are copied as-is, ahead of the grouped inserts.
+ *
+ *       Only used for unordered bulk operations, since inserts are
+ *       reordered.
+ *
+ * Side effects:
+ *       @indexes receives, for each operation in the new order, its index
+ *       in the bulk operation.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_bulk_operation_group_by_shard (mongoc_bulk_operation_t  *bulk,
+                                       const mongoc_shard_map_t *map,
+                                       mongoc_array_t           *commands,
+                                       mongoc_array_t           *indexes)
+{
+   mongoc_write_command_t *command;
+   mongoc_write_command_t copy;
+   mongoc_array_t groups;
+   mongoc_bulk_shard_group_t *group;
+   mongoc_bulk_shard_group_t new_group;
+   const uint8_t *data;
+   const char *shard;
+   bson_iter_t iter;
+   uint32_t offset = 0;
+   uint32_t len;
+   uint32_t idx;
+   bson_t doc;
+   size_t i;
+   size_t j;
+
+   ENTRY;
+
+   _mongoc_array_init (&groups, sizeof (mongoc_bulk_shard_group_t));
+
+   for (i = 0; i < bulk->commands.len; i++) {
+      command = &_mongoc_array_index (&bulk->commands,
+                                      mongoc_write_command_t, i);
+
+      if (command->type != MONGOC_WRITE_COMMAND_INSERT) {
+         copy = *command;
+         copy.documents = bson_copy (command->documents);
+         copy.server_id = 0;
+         _mongoc_array_append_val (commands, copy);
+
+         for (idx = offset; idx < offset + command->n_documents; idx++) {
+            _mongoc_array_append_val (indexes, idx);
+         }
+
+         offset += command->n_documents;
+         continue;
+      }
+
+      idx = offset;
+
+      if (bson_iter_init (&iter, command->documents)) {
+         while (bson_iter_next (&iter)) {
+            bson_iter_document (&iter, &len, &data);
+            bson_init_static (&doc, data, len);
+            shard = _mongoc_shard_map_get_shard (map, &doc);
+            group = NULL;
+
+            for (j = 0; j < groups.len; j++) {
+               group = &_mongoc_array_index (&groups,
+                                             mongoc_bulk_shard_group_t, j);
+
+               if ((group->shard == shard ||
+                    (group->shard && shard && !strcmp (group->shard, shard))) &&
+                   group->command.u.insert.allow_bulk_op_insert ==
+                   command->u.insert.allow_bulk_op_insert) {
+                  break;
+               }
+
+               group = NULL;
+            }
+
+            if (!group) {
+               new_group.shard = shard;
+               _mongoc_write_command_init_insert (
+                  &new_group.command, NULL, command->flags,
+                  command->operation_id,
+                  command->u.insert.allow_bulk_op_insert);
+               _mongoc_array_init (&new_group.indexes, sizeof (uint32_t));
+               _mongoc_array_append_val (&groups, new_group);
+               group = &_mongoc_array_index (&groups,
+                                             mongoc_bulk_shard_group_t,
+                                             groups.len - 1);
+            }
+
+            _mongoc_write_command_insert_append (&group->command, &doc);
+            _mongoc_array_append_val (&group->indexes, idx);
+            idx++;
+
+            if (group->command.n_documents >=
+                MONGOC_DEFAULT_WRITE_BATCH_SIZE) {
+               _mongoc_bulk_shard_group_flush (group, commands, indexes);
+            }
+         }
+      }
+
+      offset += command->n_documents;
+   }
+
+   for (j = 0; j < groups.len; j++) {
+      group = &_mongoc_array_index (&groups, mongoc_bulk_shard_group_t, j);
+      _mongoc_bulk_shard_group_flush (group, commands, indexes);
+      _mongoc_write_command_destroy (&group->command);
+      _mongoc_array_destroy (&group->indexes);
+   }
+
+   _mongoc_array_destroy (&groups);
+
+   EXIT;
+}
+
+
 uint32_t
 mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk,  /* IN */
                                bson_t                  *reply, /* OUT */
@@ -378,8 +732,16 @@ mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk,  /* IN */
    mongoc_cluster_t *cluster;
    mongoc_write_command_t *command;
    mongoc_server_stream_t *server_stream;
+   mongoc_shard_map_t *shard_map;
+   mongoc_array_t *commands;
+   mongoc_array_t grouped;
+   mongoc_array_t indexes;
    bool ret;
    uint32_t offset = 0;
+   char ns[MONGOC_NAMESPACE_MAX];
+   bson_error_t shard_error;
+   int64_t expire_at = 0;
+   int64_t saved_deadline;
    int i;
 
    ENTRY;
@@ -387,6 +749,7 @@ mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk,  /* IN */
    BSON_ASSERT (bulk);
 
    cluster = &bulk->client->cluster;
+   commands = &bulk->commands;
 
    if (bulk->executed) {
       _mongoc_write_result_destroy (&bulk->result);
@@ -431,6 +794,14 @@ mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk,  /* IN */
       RETURN (false);
    }
 
+   /* the timeout starts now and covers every batch */
+   if (bulk->operation_timeout_ms) {
+      expire_at = bson_get_monotonic_time ()
+                  + (int64_t) bulk->operation_timeout_ms * 1000;
+   }
+
+   saved_deadline = mongoc_cluster_push_deadline (cluster, expire_at);
+
    if (bulk->server_id) {
       server_stream = mongoc_cluster_stream_for_server (cluster,
                                                         bulk->server_id,
@@ -441,12 +812,37 @@ mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk,  /* IN */
    }
 
    if (!server_stream) {
+      mongoc_cluster_pop_deadline (cluster, saved_deadline);
       RETURN (false);
    }
 
-   for (i = 0; i < bulk->commands.len; i++) {
-      command = &_mongoc_array_index (&bulk->commands,
-                                      mongoc_write_command_t, i);
+   if (bulk->shard_routing && !bulk->flags.ordered &&
+       server_stream->sd->type == MONGOC_SERVER_MONGOS) {
+      bson_snprintf (ns, sizeof ns, "%s.%s", bulk->database, bulk->collection);
+      shard_map = _mongoc_shard_map_cache_get (bulk->client, ns,
+                                               &shard_error);
+
+      /* routing only affects grouping: without a map, e.g. if we can't
+       * read the config database, batch as usual */
+      if (!shard_map) {
+         TRACE ("Not grouping by shard: %s", shard_error.message);
+      } else if (shard_map->chunks.len) {
+         _mongoc_array_init (&grouped, sizeof (mongoc_write_command_t));
+         _mongoc_array_init (&indexes, sizeof (uint32_t));
+         _mongoc_bulk_operation_group_by_shard (bulk, shard_map,
+                                                &grouped, &indexes);
+         commands = &grouped;
+      }
+   }
+
+   if (bulk->pool && bulk->n_threads > 1 && !bulk->flags.ordered &&
+       commands->len > 1) {
+      _mongoc_bulk_operation_execute_parallel (bulk, commands, server_stream);
+      GOTO (cleanup);
+   }
+
+   for (i = 0; i < commands->len; i++) {
+      command = &_mongoc_array_index (commands, mongoc_write_command_t, i);
 
       _mongoc_write_command_execute (command, bulk->client, server_stream,
                                      bulk->database, bulk->collection,
@@ -463,12 +859,28 @@ mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk,  /* IN */
    }
 
 cleanup:
+   if (commands == &grouped) {
+      /* report errors by each operation's index in the bulk operation */
+      _mongoc_write_result_remap_indexes (&bulk->result,
+                                          (uint32_t *)indexes.data,
+                                          (uint32_t)indexes.len);
+
+      for (i = 0; i < grouped.len; i++) {
+         command = &_mongoc_array_index (&grouped, mongoc_write_command_t, i);
+         _mongoc_write_command_destroy (command);
+      }
+
+      _mongoc_array_destroy (&grouped);
+      _mongoc_array_destroy (&indexes);
+   }
+
    ret = _mongoc_write_result_complete (&bulk->result,
                                         bulk->client->error_api_version,
                                         bulk->write_concern,
                                         reply,
                                         error);
    mongoc_server_stream_cleanup (server_stream);
+   mongoc_cluster_pop_deadline (cluster, saved_deadline);
 
    RETURN (ret ? bulk->server_id : 0);
 }
@@ -556,6 +968,28 @@ mongoc_bulk_operation_set_hint (mongoc_bulk_operation_t *bulk,
 }
 
 
+void
+mongoc_bulk_operation_set_parallel (mongoc_bulk_operation_t *bulk,
+                                    mongoc_client_pool_t    *pool,
+                                    uint32_t                 n_threads)
+{
+   BSON_ASSERT (bulk);
+
+   bulk->pool = pool;
+   bulk->n_threads = n_threads;
+}
+
+
+void
+mongoc_bulk_operation_set_shard_routing (mongoc_bulk_operation_t *bulk,
+                                         bool                     shard_routing)
+{
+   BSON_ASSERT (bulk);
+
+   bulk->shard_routing = shard_routing;
+}
+
+
 void
 mongoc_bulk_operation_set_bypass_document_validation (mongoc_bulk_operation_t *bulk,
                                                       bool                     bypass)
@@ -566,3 +1000,23 @@ mongoc_bulk_operation_set_bypass_document_validation (mongoc_bulk_operation_t *b
       MONGOC_BYPASS_DOCUMENT_VALIDATION_TRUE :
       MONGOC_BYPASS_DOCUMENT_VALIDATION_FALSE;
 }
+
+
+void
+mongoc_bulk_operation_set_validate_level (mongoc_bulk_operation_t *bulk,
+                                          mongoc_validate_level_t  level)
+{
+   BSON_ASSERT (bulk);
+
+   bulk->validate_level = level;
+}
+
+
+void
+mongoc_bulk_operation_set_operation_timeout_ms (mongoc_bulk_operation_t *bulk,
+                                                uint32_t                 timeout_ms)
+{
+   BSON_ASSERT (bulk);
+
+   bulk->operation_timeout_ms = timeout_ms;
+}
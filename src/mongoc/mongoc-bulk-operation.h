@@ -21,6 +21,7 @@
 
 #include <bson.h>
 
+#include "mongoc-flags.h"
 #include "mongoc-write-concern.h"
 
 #define MONGOC_BULK_WRITE_FLAGS_INIT { true, MONGOC_BYPASS_DOCUMENT_VALIDATION_DEFAULT }
@@ -31,6 +32,9 @@ BSON_BEGIN_DECLS
 typedef struct _mongoc_bulk_operation_t mongoc_bulk_operation_t;
 typedef struct _mongoc_bulk_write_flags_t mongoc_bulk_write_flags_t;
 
+/* forward decl */
+struct _mongoc_client_pool_t;
+
 
 void mongoc_bulk_operation_destroy     (mongoc_bulk_operation_t       *bulk);
 uint32_t mongoc_bulk_operation_execute (mongoc_bulk_operation_t       *bulk,
@@ -62,6 +66,10 @@ void mongoc_bulk_operation_update_one  (mongoc_bulk_operation_t       *bulk,
                                         bool                           upsert);
 void mongoc_bulk_operation_set_bypass_document_validation (mongoc_bulk_operation_t   *bulk,
                                                            bool                       bypass);
+void mongoc_bulk_operation_set_validate_level             (mongoc_bulk_operation_t   *bulk,
+                                                           mongoc_validate_level_t    level);
+void mongoc_bulk_operation_set_operation_timeout_ms       (mongoc_bulk_operation_t   *bulk,
+                                                           uint32_t                   timeout_ms);
 
 
 /*
@@ -83,6 +91,11 @@ void                          mongoc_bulk_operation_set_client        (mongoc_bu
 void                          mongoc_bulk_operation_set_hint          (mongoc_bulk_operation_t       *bulk,
                                                                        uint32_t                       server_id);
 uint32_t                      mongoc_bulk_operation_get_hint          (const mongoc_bulk_operation_t *bulk);
+void                          mongoc_bulk_operation_set_parallel      (mongoc_bulk_operation_t       *bulk,
+                                                                       struct _mongoc_client_pool_t  *pool,
+                                                                       uint32_t                       n_threads);
+void                          mongoc_bulk_operation_set_shard_routing (mongoc_bulk_operation_t       *bulk,
+                                                                       bool                           shard_routing);
 const mongoc_write_concern_t *mongoc_bulk_operation_get_write_concern (const mongoc_bulk_operation_t *bulk);
 BSON_END_DECLS
 
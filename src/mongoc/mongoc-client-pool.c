@@ -21,10 +21,13 @@
 #include "mongoc-client-pool-private.h"
 #include "mongoc-client-pool.h"
 #include "mongoc-client-private.h"
+#include "mongoc-cursor-reaper-private.h"
 #include "mongoc-queue-private.h"
+#include "mongoc-query-cache-private.h"
 #include "mongoc-thread-private.h"
 #include "mongoc-topology-private.h"
 #include "mongoc-trace.h"
+#include "mongoc-write-coalescer-private.h"
 
 #ifdef MONGOC_ENABLE_SSL
 #include "mongoc-ssl-private.h"
@@ -47,6 +50,9 @@ struct _mongoc_client_pool_t
    mongoc_apm_callbacks_t  apm_callbacks;
    void                   *apm_context;
    int32_t                 error_api_version;
+   mongoc_query_cache_t   *query_cache;
+   mongoc_cursor_reaper_t *cursor_reaper;
+   mongoc_write_coalescer_t *write_coalescer;
 };
 
 
@@ -107,6 +113,9 @@ mongoc_client_pool_new (const mongoc_uri_t *uri)
    topology = mongoc_topology_new(uri, false);
    pool->topology = topology;
    pool->error_api_version = MONGOC_ERROR_API_VERSION_LEGACY;
+   pool->query_cache = _mongoc_query_cache_new ();
+   pool->cursor_reaper = _mongoc_cursor_reaper_new (pool);
+   pool->write_coalescer = _mongoc_write_coalescer_new ();
 
    b = mongoc_uri_get_options(pool->uri);
 
@@ -137,11 +146,16 @@ mongoc_client_pool_destroy (mongoc_client_pool_t *pool)
 
    BSON_ASSERT (pool);
 
+   /* borrows a client to kill the cursors still queued */
+   _mongoc_cursor_reaper_destroy (pool->cursor_reaper);
+
    while ((client = (mongoc_client_t *)_mongoc_queue_pop_head(&pool->queue))) {
       mongoc_client_destroy(client);
    }
 
    mongoc_topology_destroy (pool->topology);
+   _mongoc_query_cache_destroy (pool->query_cache);
+   _mongoc_write_coalescer_destroy (pool->write_coalescer);
 
    mongoc_uri_destroy(pool->uri);
    mongoc_mutex_destroy(&pool->mutex);
@@ -190,6 +204,9 @@ again:
       if (pool->size < pool->max_pool_size) {
          client = _mongoc_client_new_from_uri(pool->uri, pool->topology);
          client->error_api_version = pool->error_api_version;
+         client->query_cache = pool->query_cache;
+         client->cursor_reaper = pool->cursor_reaper;
+         client->write_coalescer = pool->write_coalescer;
          _mongoc_client_set_apm_callbacks_private (client,
                                                    &pool->apm_callbacks,
                                                    pool->apm_context);
@@ -226,6 +243,9 @@ mongoc_client_pool_try_pop (mongoc_client_pool_t *pool)
    if (!(client = (mongoc_client_t *)_mongoc_queue_pop_head(&pool->queue))) {
       if (pool->size < pool->max_pool_size) {
          client = _mongoc_client_new_from_uri(pool->uri, pool->topology);
+         client->query_cache = pool->query_cache;
+         client->cursor_reaper = pool->cursor_reaper;
+         client->write_coalescer = pool->write_coalescer;
 #ifdef MONGOC_ENABLE_SSL
          if (pool->ssl_opts_set) {
             mongoc_client_set_ssl_opts (client, &pool->ssl_opts);
@@ -349,6 +369,59 @@ mongoc_client_pool_set_error_api (mongoc_client_pool_t *pool,
    return true;
 }
 
+/* a max_bytes of 0 disables the cache, a ttl_msec of 0 never expires */
+void
+mongoc_client_pool_set_query_cache (mongoc_client_pool_t *pool,
+                                    size_t                max_bytes,
+                                    int64_t               ttl_msec)
+{
+   BSON_ASSERT (pool);
+
+   _mongoc_query_cache_configure (pool->query_cache, max_bytes, ttl_msec);
+}
+
+void
+mongoc_client_pool_cache_namespace (mongoc_client_pool_t *pool,
+                                    const char           *ns)
+{
+   BSON_ASSERT (pool);
+   BSON_ASSERT (ns);
+
+   _mongoc_query_cache_add_ns (pool->query_cache, ns);
+}
+
+/* thread-safe, e.g. for an oplog-tailing thread */
+void
+mongoc_client_pool_invalidate_query_cache (mongoc_client_pool_t *pool,
+                                           const char           *ns)
+{
+   BSON_ASSERT (pool);
+
+   _mongoc_query_cache_invalidate (pool->query_cache, ns);
+}
+
+/* an interval_msec of 0 kills each cursor when it is destroyed */
+void
+mongoc_client_pool_set_kill_cursors_interval (mongoc_client_pool_t *pool,
+                                              int32_t               interval_msec)
+{
+   BSON_ASSERT (pool);
+
+   _mongoc_cursor_reaper_set_interval (pool->cursor_reaper, interval_msec);
+}
+
+/* a window_msec of 0 sends each insert on its own */
+void
+mongoc_client_pool_set_write_coalescing (mongoc_client_pool_t *pool,
+                                         int32_t               window_msec,
+                                         uint32_t              max_documents)
+{
+   BSON_ASSERT (pool);
+
+   _mongoc_write_coalescer_configure (pool->write_coalescer, window_msec,
+                                      max_documents);
+}
+
 #ifdef MONGOC_EXPERIMENTAL_FEATURES
 bool
 mongoc_client_pool_set_appname (mongoc_client_pool_t *pool,
@@ -57,6 +57,21 @@ bool                  mongoc_client_pool_set_apm_callbacks (mongoc_client_pool_t
                                                             void                   *context);
 bool                  mongoc_client_pool_set_error_api     (mongoc_client_pool_t   *pool,
                                                             int32_t                 version);
+void                  mongoc_client_pool_set_query_cache   (mongoc_client_pool_t   *pool,
+                                                            size_t                  max_bytes,
+                                                            int64_t                 ttl_msec);
+void                  mongoc_client_pool_cache_namespace   (mongoc_client_pool_t   *pool,
+                                                            const char             *ns);
+void                  mongoc_client_pool_invalidate_query_cache
+                                                           (mongoc_client_pool_t   *pool,
+                                                            const char             *ns);
+void                  mongoc_client_pool_set_kill_cursors_interval
+                                                           (mongoc_client_pool_t   *pool,
+                                                            int32_t                 interval_msec);
+void                  mongoc_client_pool_set_write_coalescing
+                                                           (mongoc_client_pool_t   *pool,
+                                                            int32_t                 window_msec,
+                                                            uint32_t                max_documents);
 #ifdef MONGOC_EXPERIMENTAL_FEATURES
 bool                  mongoc_client_pool_set_appname       (mongoc_client_pool_t   *pool,
                                                             const char             *appname);
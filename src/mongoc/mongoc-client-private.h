@@ -31,6 +31,7 @@
 #include "mongoc-host-list.h"
 #include "mongoc-read-prefs.h"
 #include "mongoc-rpc-private.h"
+#include "mongoc-scratch-private.h"
 #include "mongoc-opcode.h"
 #ifdef MONGOC_ENABLE_SSL
 #include "mongoc-ssl.h"
@@ -66,6 +67,17 @@ BSON_BEGIN_DECLS
 #define WIRE_VERSION_CMD_WRITE_CONCERN 5
 
 
+/* the slower of a hedged read's two replies, not yet read */
+typedef struct _mongoc_hedge_loser_t
+{
+   uint32_t                   server_id;     /* 0 if none */
+   uint32_t                   request_id;
+   int64_t                    started;
+   int64_t                    operation_id;
+   char                       command_name[16];
+} mongoc_hedge_loser_t;
+
+
 struct _mongoc_client_t
 {
    mongoc_list_t             *conns;
@@ -73,6 +85,27 @@ struct _mongoc_client_t
    mongoc_cluster_t           cluster;
    bool                       in_exhaust;
 
+   /* command cursor with a pipelined getMore awaiting its reply */
+   mongoc_cursor_t           *in_flight_cursor;
+
+   /* hedged read whose losing reply must be read before the next operation */
+   mongoc_hedge_loser_t       hedge_loser;
+
+   /* chunk maps for shard-aware bulk writes */
+   struct _mongoc_shard_map_t *shard_maps;
+
+   /* the pool's query result cache, NULL for a single client */
+   struct _mongoc_query_cache_t *query_cache;
+
+   /* the pool's deferred killCursors queue, NULL for a single client */
+   struct _mongoc_cursor_reaper_t *cursor_reaper;
+
+   /* the pool's insert group commit, NULL for a single client */
+   struct _mongoc_write_coalescer_t *write_coalescer;
+
+   /* reusable buffers for building and sending commands */
+   mongoc_scratch_t           scratch;
+
    mongoc_stream_initiator_t  initiator;
    void                      *initiator_data;
 
@@ -136,6 +169,16 @@ _mongoc_client_kill_cursor              (mongoc_client_t *client,
                                          const char      *db,
                                          const char      *collection);
 
+void
+_mongoc_client_kill_cursors             (mongoc_client_t *client,
+                                         uint32_t         server_id,
+                                         const int64_t   *cursor_ids,
+                                         uint32_t         n_cursors,
+                                         int64_t          operation_id,
+                                         const char      *db,
+                                         const char      *collection,
+                                         bool             reconnect_ok);
+
 BSON_END_DECLS
 
 
@@ -34,11 +34,13 @@
 #include "mongoc-socket.h"
 #include "mongoc-stream-buffered.h"
 #include "mongoc-stream-socket.h"
+#include "mongoc-stream-uring.h"
 #include "mongoc-thread-private.h"
 #include "mongoc-trace.h"
 #include "mongoc-uri-private.h"
 #include "mongoc-util-private.h"
 #include "mongoc-set-private.h"
+#include "mongoc-shard-map-private.h"
 #include "mongoc-log.h"
 
 #ifdef MONGOC_ENABLE_SSL
@@ -54,7 +56,8 @@
 static void
 _mongoc_client_op_killcursors (mongoc_cluster_t       *cluster,
                                mongoc_server_stream_t *server_stream,
-                               int64_t                 cursor_id,
+                               const int64_t          *cursor_ids,
+                               uint32_t                n_cursors,
                                int64_t                 operation_id,
                                const char             *db,
                                const char             *collection);
@@ -62,12 +65,52 @@ _mongoc_client_op_killcursors (mongoc_cluster_t       *cluster,
 static void
 _mongoc_client_killcursors_command (mongoc_cluster_t       *cluster,
                                     mongoc_server_stream_t *server_stream,
-                                    int64_t                 cursor_id,
+                                    const int64_t          *cursor_ids,
+                                    uint32_t                n_cursors,
                                     const char             *db,
                                     const char             *collection);
 
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_socket_stream_new --
+ *
+ *       Wrap a connected socket in a stream. If the "iouring" URI option
+ *       is set, try an io_uring stream first and fall back to a socket
+ *       stream when io_uring is not compiled in or not supported by the
+ *       running kernel.
+ *
+ * Returns:
+ *       A newly allocated mongoc_stream_t that owns @sock.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static mongoc_stream_t *
+_mongoc_client_socket_stream_new (const mongoc_uri_t *uri,
+                                  mongoc_socket_t    *sock)
+{
+   mongoc_stream_t *stream;
+
+   if (mongoc_uri_get_option_as_bool (uri, "iouring", false)) {
+      stream = mongoc_stream_uring_new (sock);
+
+      if (stream) {
+         return stream;
+      }
+
+      TRACE ("%s", "io_uring unavailable, using a socket stream");
+   }
+
+   return mongoc_stream_socket_new (sock);
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -183,7 +226,7 @@ mongoc_client_connect_tcp (const mongoc_uri_t       *uri,
 
    freeaddrinfo (result);
 
-   return mongoc_stream_socket_new (sock);
+   return _mongoc_client_socket_stream_new (uri, sock);
 }
 
 
@@ -253,7 +296,7 @@ mongoc_client_connect_unix (const mongoc_uri_t       *uri,
       RETURN (NULL);
    }
 
-   ret = mongoc_stream_socket_new (sock);
+   ret = _mongoc_client_socket_stream_new (uri, sock);
 
    RETURN (ret);
 #endif
@@ -287,6 +330,7 @@ mongoc_client_default_stream_initiator (const mongoc_uri_t       *uri,
                                         bson_error_t             *error)
 {
    mongoc_stream_t *base_stream = NULL;
+   mongoc_stream_t *stream;
 #ifdef MONGOC_ENABLE_SSL
    mongoc_client_t *client = (mongoc_client_t *)user_data;
    const char *mechanism;
@@ -353,7 +397,17 @@ mongoc_client_default_stream_initiator (const mongoc_uri_t       *uri,
    }
 #endif
 
-   return base_stream ? mongoc_stream_buffered_new (base_stream, 1024) : NULL;
+   if (!base_stream) {
+      return NULL;
+   }
+
+   stream = mongoc_stream_buffered_new (base_stream, 1024);
+   mongoc_stream_buffered_set_write_buffer_size (
+      stream,
+      (size_t)BSON_MAX (0, mongoc_uri_get_option_as_int32 (
+                              uri, "writebuffersize", 0)));
+
+   return stream;
 }
 
 
@@ -751,6 +805,7 @@ _mongoc_client_new_from_uri (const mongoc_uri_t *uri, mongoc_topology_t *topolog
    client->read_prefs = mongoc_read_prefs_copy (read_prefs);
 
    mongoc_cluster_init (&client->cluster, client->uri, client);
+   _mongoc_scratch_init (&client->scratch);
 
 #ifdef MONGOC_ENABLE_SSL
    client->use_ssl = false;
@@ -794,6 +849,8 @@ mongoc_client_destroy (mongoc_client_t *client)
       mongoc_read_concern_destroy (client->read_concern);
       mongoc_read_prefs_destroy (client->read_prefs);
       mongoc_cluster_destroy (&client->cluster);
+      _mongoc_shard_map_cache_destroy (client->shard_maps);
+      _mongoc_scratch_destroy (&client->scratch);
       mongoc_uri_destroy (client->uri);
 
 #ifdef MONGOC_ENABLE_SSL
@@ -1326,15 +1383,24 @@ mongoc_client_command_simple_with_server_id (mongoc_client_t           *client,
 
 
 static void
-_mongoc_client_prepare_killcursors_command (int64_t     cursor_id,
-                                            const char *collection,
-                                            bson_t     *command)
+_mongoc_client_prepare_killcursors_command (const int64_t *cursor_ids,
+                                            uint32_t       n_cursors,
+                                            const char    *collection,
+                                            bson_t        *command)
 {
    bson_t child;
+   const char *key;
+   char str[16];
+   uint32_t i;
 
    bson_append_utf8 (command, "killCursors", 11, collection, -1);
    bson_append_array_begin (command, "cursors", 7, &child);
-   bson_append_int64 (&child, "0", 1, cursor_id);
+
+   for (i = 0; i < n_cursors; i++) {
+      bson_uint32_to_string (i, &key, str, sizeof str);
+      bson_append_int64 (&child, key, -1, cursor_ids[i]);
+   }
+
    bson_append_array_end (command, &child);
 }
 
@@ -1346,33 +1412,66 @@ _mongoc_client_kill_cursor (mongoc_client_t *client,
                             int64_t          operation_id,
                             const char      *db,
                             const char      *collection)
+{
+   BSON_ASSERT (cursor_id);
+
+   /* don't attempt reconnect if server unavailable */
+   _mongoc_client_kill_cursors (client, server_id, &cursor_id, 1,
+                                operation_id, db, collection,
+                                false /* reconnect_ok */);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_kill_cursors --
+ *
+ *       Kill cursors on one server with a single killCursors command,
+ *       or a single OP_KILL_CURSORS message before MongoDB 3.2.
+ *       The cursors must all belong to db.collection. Errors are
+ *       ignored.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_client_kill_cursors (mongoc_client_t *client,
+                             uint32_t         server_id,
+                             const int64_t   *cursor_ids,
+                             uint32_t         n_cursors,
+                             int64_t          operation_id,
+                             const char      *db,
+                             const char      *collection,
+                             bool             reconnect_ok)
 {
    mongoc_server_stream_t *server_stream;
 
    ENTRY;
 
    BSON_ASSERT (client);
-   BSON_ASSERT (cursor_id);
+   BSON_ASSERT (cursor_ids);
+   BSON_ASSERT (n_cursors);
 
-   /* don't attempt reconnect if server unavailable, and ignore errors */
    server_stream = mongoc_cluster_stream_for_server (&client->cluster,
                                                      server_id,
-                                                     false /* reconnect_ok */,
+                                                     reconnect_ok,
                                                      NULL  /* error */);
 
    if (!server_stream) {
-      return;
+      EXIT;
    }
 
    if (db && collection &&
        server_stream->sd->max_wire_version >=
        WIRE_VERSION_KILLCURSORS_CMD) {
       _mongoc_client_killcursors_command (&client->cluster, server_stream,
-                                          cursor_id, db, collection);
+                                          cursor_ids, n_cursors,
+                                          db, collection);
    } else {
       _mongoc_client_op_killcursors (&client->cluster,
                                      server_stream,
-                                     cursor_id, operation_id,
+                                     cursor_ids, n_cursors, operation_id,
                                      db, collection);
    }
 
@@ -1385,7 +1484,8 @@ _mongoc_client_kill_cursor (mongoc_client_t *client,
 static void
 _mongoc_client_monitor_op_killcursors (mongoc_cluster_t       *cluster,
                                        mongoc_server_stream_t *server_stream,
-                                       int64_t                 cursor_id,
+                                       const int64_t          *cursor_ids,
+                                       uint32_t                n_cursors,
                                        int64_t                 operation_id,
                                        const char             *db,
                                        const char             *collection)
@@ -1403,7 +1503,8 @@ _mongoc_client_monitor_op_killcursors (mongoc_cluster_t       *cluster,
    }
 
    bson_init (&doc);
-   _mongoc_client_prepare_killcursors_command (cursor_id, collection, &doc);
+   _mongoc_client_prepare_killcursors_command (cursor_ids, n_cursors,
+                                               collection, &doc);
    mongoc_apm_command_started_init (&event,
                                     &doc,
                                     db,
@@ -1427,13 +1528,17 @@ _mongoc_client_monitor_op_killcursors_succeeded (
    mongoc_cluster_t       *cluster,
    int64_t                 duration,
    mongoc_server_stream_t *server_stream,
-   int64_t                 cursor_id,
+   const int64_t          *cursor_ids,
+   uint32_t                n_cursors,
    int64_t                 operation_id)
 {
    mongoc_client_t *client;
    bson_t doc;
    bson_t cursors_unknown;
    mongoc_apm_command_succeeded_t event;
+   const char *key;
+   char str[16];
+   uint32_t i;
 
    ENTRY;
 
@@ -1447,7 +1552,12 @@ _mongoc_client_monitor_op_killcursors_succeeded (
    bson_init (&doc);
    bson_append_int32 (&doc, "ok", 2, 1);
    bson_append_array_begin (&doc, "cursorsUnknown", 14, &cursors_unknown);
-   bson_append_int64 (&cursors_unknown, "0", 1, cursor_id);
+
+   for (i = 0; i < n_cursors; i++) {
+      bson_uint32_to_string (i, &key, str, sizeof str);
+      bson_append_int64 (&cursors_unknown, key, -1, cursor_ids[i]);
+   }
+
    bson_append_array_end (&doc, &cursors_unknown);
 
    mongoc_apm_command_succeeded_init (&event,
@@ -1505,7 +1615,8 @@ _mongoc_client_monitor_op_killcursors_failed (
 static void
 _mongoc_client_op_killcursors (mongoc_cluster_t       *cluster,
                                mongoc_server_stream_t *server_stream,
-                               int64_t                 cursor_id,
+                               const int64_t          *cursor_ids,
+                               uint32_t                n_cursors,
                                int64_t                 operation_id,
                                const char             *db,
                                const char             *collection)
@@ -1524,11 +1635,12 @@ _mongoc_client_op_killcursors (mongoc_cluster_t       *cluster,
    rpc.kill_cursors.response_to = 0;
    rpc.kill_cursors.opcode = MONGOC_OPCODE_KILL_CURSORS;
    rpc.kill_cursors.zero = 0;
-   rpc.kill_cursors.cursors = &cursor_id;
-   rpc.kill_cursors.n_cursors = 1;
+   rpc.kill_cursors.cursors = (int64_t *) cursor_ids;
+   rpc.kill_cursors.n_cursors = (int32_t) n_cursors;
 
-   _mongoc_client_monitor_op_killcursors (cluster, server_stream, cursor_id,
-                                          operation_id, db, collection);
+   _mongoc_client_monitor_op_killcursors (cluster, server_stream, cursor_ids,
+                                          n_cursors, operation_id, db,
+                                          collection);
 
    r = mongoc_cluster_sendv_to_server (cluster, &rpc, 1, server_stream,
                                        NULL, &error);
@@ -1538,7 +1650,8 @@ _mongoc_client_op_killcursors (mongoc_cluster_t       *cluster,
          cluster,
          bson_get_monotonic_time () - started,
          server_stream,
-         cursor_id,
+         cursor_ids,
+         n_cursors,
          operation_id);
    } else {
       _mongoc_client_monitor_op_killcursors_failed (
@@ -1554,7 +1667,8 @@ _mongoc_client_op_killcursors (mongoc_cluster_t       *cluster,
 static void
 _mongoc_client_killcursors_command (mongoc_cluster_t       *cluster,
                                     mongoc_server_stream_t *server_stream,
-                                    int64_t                 cursor_id,
+                                    const int64_t          *cursor_ids,
+                                    uint32_t                n_cursors,
                                     const char             *db,
                                     const char             *collection)
 {
@@ -1562,7 +1676,8 @@ _mongoc_client_killcursors_command (mongoc_cluster_t       *cluster,
 
    ENTRY;
 
-   _mongoc_client_prepare_killcursors_command (cursor_id,
+   _mongoc_client_prepare_killcursors_command (cursor_ids,
+                                               n_cursors,
                                                collection,
                                                &command);
 
@@ -1803,6 +1918,107 @@ mongoc_client_set_apm_callbacks (mongoc_client_t        *client,
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_set_idle_monitoring --
+ *
+ *       For a single-threaded client, move server monitoring out of
+ *       operations: the application calls mongoc_client_monitor_work
+ *       when it is idle, and operations no longer check servers whose
+ *       heartbeatFrequencyMS or socketCheckIntervalMS has passed.
+ *
+ * Returns:
+ *       false if @client is from a pool.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_client_set_idle_monitoring (mongoc_client_t *client,
+                                   bool             enabled)
+{
+   BSON_ASSERT (client);
+
+   if (!client->topology->single_threaded) {
+      MONGOC_ERROR ("Cannot set idle monitoring on a pooled client, "
+                    "the pool monitors servers in a background thread");
+      return false;
+   }
+
+   if (!enabled) {
+      _mongoc_topology_finish_idle_scan (client->topology);
+   }
+
+   client->topology->idle_monitoring = enabled;
+
+   return true;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_monitor_work --
+ *
+ *       Do up to @timeout_msec of server monitoring. Starts a scan of all
+ *       servers if one is due, and otherwise advances the scan in
+ *       progress without waiting longer than @timeout_msec.
+ *
+ * Returns:
+ *       0 if a scan is in progress and this should be called again soon,
+ *       the number of milliseconds until the next scan is due, or -1 if
+ *       idle monitoring isn't enabled for @client.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+int64_t
+mongoc_client_monitor_work (mongoc_client_t *client,
+                            int32_t          timeout_msec)
+{
+   BSON_ASSERT (client);
+
+   if (!client->topology->single_threaded ||
+       !client->topology->idle_monitoring) {
+      return -1;
+   }
+
+   /* the scanner shares our connections, read any reply still due first,
+    * such as a prefetched getMore or a hedged read's slower reply */
+   mongoc_cluster_drain_in_flight (&client->cluster);
+
+   return _mongoc_topology_monitor_work (client->topology,
+                                         BSON_MAX (timeout_msec, 0));
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_flush --
+ *
+ *       Send any requests held in the write buffers of @client's
+ *       connections; see the URI option "writeBufferSize". There is no
+ *       timer that does this, so call it after unacknowledged writes if
+ *       the client may then sit idle.
+ *
+ * Returns:
+ *       true if successful, otherwise false and @error is set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_client_flush (mongoc_client_t *client,
+                     bson_error_t    *error)
+{
+   BSON_ASSERT (client);
+
+   return mongoc_cluster_flush (&client->cluster, error);
+}
+
+
 mongoc_server_description_t *
 mongoc_client_get_server_description (mongoc_client_t *client,
                                       uint32_t         server_id)
@@ -1884,6 +2100,8 @@ mongoc_client_select_server (mongoc_client_t           *client,
       return NULL;
    }
 
+   mongoc_cluster_drain_in_flight (&client->cluster);
+
    return mongoc_topology_select (client->topology,
                                   for_writes ? MONGOC_SS_WRITE : MONGOC_SS_READ,
                                   prefs,
@@ -163,6 +163,12 @@ void                           mongoc_client_set_ssl_opts                  (mong
 bool                           mongoc_client_set_apm_callbacks             (mongoc_client_t              *client,
                                                                             mongoc_apm_callbacks_t       *callbacks,
                                                                             void                         *context);
+bool                           mongoc_client_set_idle_monitoring           (mongoc_client_t              *client,
+                                                                            bool                          enabled);
+int64_t                        mongoc_client_monitor_work                  (mongoc_client_t              *client,
+                                                                            int32_t                       timeout_msec);
+bool                           mongoc_client_flush                         (mongoc_client_t              *client,
+                                                                            bson_error_t                 *error);
 mongoc_server_description_t   *mongoc_client_get_server_description        (mongoc_client_t              *client,
                                                                             uint32_t                      server_id);
 mongoc_server_description_t  **mongoc_client_get_server_descriptions       (const mongoc_client_t        *client,
@@ -68,6 +68,9 @@ typedef struct _mongoc_cluster_t
 
    mongoc_set_t    *nodes;
    mongoc_array_t   iov;
+
+   /* monotonic usec the current operation must finish by, or 0 */
+   int64_t          operation_expire_at;
 } mongoc_cluster_t;
 
 void
@@ -82,6 +85,36 @@ void
 mongoc_cluster_disconnect_node (mongoc_cluster_t *cluster,
                                 uint32_t          id);
 
+int64_t
+mongoc_cluster_push_deadline (mongoc_cluster_t *cluster,
+                              int64_t           expire_at);
+
+void
+mongoc_cluster_pop_deadline (mongoc_cluster_t *cluster,
+                             int64_t           saved);
+
+int64_t
+mongoc_cluster_remaining_msec (mongoc_cluster_t *cluster);
+
+bool
+mongoc_cluster_check_deadline (mongoc_cluster_t *cluster,
+                               bson_error_t     *error);
+
+int32_t
+mongoc_cluster_io_timeout_msec (mongoc_cluster_t *cluster);
+
+const bson_t *
+mongoc_cluster_apply_max_time_ms (mongoc_cluster_t *cluster,
+                                  const bson_t     *command,
+                                  bson_t           *copy);
+
+bool
+mongoc_cluster_flush (mongoc_cluster_t *cluster,
+                      bson_error_t     *error);
+
+void
+mongoc_cluster_drain_in_flight (mongoc_cluster_t *cluster);
+
 int32_t
 mongoc_cluster_get_max_bson_obj_size (mongoc_cluster_t *cluster);
 
@@ -27,6 +27,7 @@
 #include "mongoc-client-private.h"
 #include "mongoc-counters-private.h"
 #include "mongoc-config.h"
+#include "mongoc-cursor-cursorid-private.h"
 #include "mongoc-error.h"
 #include "mongoc-host-list-private.h"
 #include "mongoc-log.h"
@@ -45,9 +46,11 @@
 #include "mongoc-stream-private.h"
 #include "mongoc-stream-socket.h"
 #include "mongoc-stream-tls.h"
+#include "mongoc-stream-uring.h"
 #include "mongoc-thread-private.h"
 #include "mongoc-topology-private.h"
 #include "mongoc-trace.h"
+#include "mongoc-trace-private.h"
 #include "mongoc-util-private.h"
 #include "mongoc-write-concern-private.h"
 #include "mongoc-uri-private.h"
@@ -127,6 +130,267 @@ _bson_error_message_printf (bson_error_t *error,
          command_name, db_name, error->message); \
    } while (0)
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_push_deadline --
+ *
+ *       Begin an operation that must finish by @expire_at, a monotonic
+ *       time in microseconds, or 0 for none. An enclosing operation's
+ *       sooner deadline still applies.
+ *
+ *       Server selection, stream checkout, and each send and receive on
+ *       @cluster are bounded by the deadline until it is popped.
+ *
+ * Returns:
+ *       The previous deadline, to pass to mongoc_cluster_pop_deadline.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+int64_t
+mongoc_cluster_push_deadline (mongoc_cluster_t *cluster,
+                              int64_t           expire_at)
+{
+   int64_t saved;
+
+   BSON_ASSERT (cluster);
+
+   saved = cluster->operation_expire_at;
+
+   if (expire_at && (!saved || expire_at < saved)) {
+      cluster->operation_expire_at = expire_at;
+   }
+
+   return saved;
+}
+
+
+void
+mongoc_cluster_pop_deadline (mongoc_cluster_t *cluster,
+                             int64_t           saved)
+{
+   BSON_ASSERT (cluster);
+
+   cluster->operation_expire_at = saved;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_remaining_msec --
+ *
+ *       The time left before the current operation's deadline.
+ *
+ * Returns:
+ *       -1 if there is no deadline, 0 if it has passed, otherwise the
+ *       milliseconds left, rounded up.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+int64_t
+mongoc_cluster_remaining_msec (mongoc_cluster_t *cluster)
+{
+   int64_t remaining_usec;
+
+   if (!cluster->operation_expire_at) {
+      return -1;
+   }
+
+   remaining_usec = cluster->operation_expire_at - bson_get_monotonic_time ();
+
+   if (remaining_usec <= 0) {
+      return 0;
+   }
+
+   return (remaining_usec + 999) / 1000;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_check_deadline --
+ *
+ *       Check whether the current operation's deadline has passed.
+ *
+ * Returns:
+ *       false if it has, and @error is set, replacing any error a timed
+ *       out read or write already set. true otherwise.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_cluster_check_deadline (mongoc_cluster_t *cluster,
+                               bson_error_t     *error)
+{
+   if (mongoc_cluster_remaining_msec (cluster) != 0) {
+      return true;
+   }
+
+   bson_set_error (error,
+                   MONGOC_ERROR_CLIENT,
+                   MONGOC_ERROR_CLIENT_OPERATION_TIMEOUT,
+                   "Operation exceeded its timeout");
+
+   return false;
+}
+
+
+/* the timeout for one read or write: socketTimeoutMS, or less if the
+ * operation's deadline is sooner */
+int32_t
+mongoc_cluster_io_timeout_msec (mongoc_cluster_t *cluster)
+{
+   int64_t remaining;
+
+   remaining = mongoc_cluster_remaining_msec (cluster);
+
+   if (remaining < 0 || remaining >= (int64_t) cluster->sockettimeoutms) {
+      return (int32_t) cluster->sockettimeoutms;
+   }
+
+   /* if the deadline passed, fail without blocking */
+   return (int32_t) remaining;
+}
+
+
+/* copy @src to @dst, with maxTimeMS replaced by @max_time_ms */
+static void
+_mongoc_cluster_copy_max_time_ms (const bson_t *src,
+                                  bson_t       *dst,
+                                  int32_t       max_time_ms)
+{
+   bson_iter_t iter;
+
+   if (bson_iter_init (&iter, src)) {
+      while (bson_iter_next (&iter)) {
+         if (strcmp (bson_iter_key (&iter), "maxTimeMS")) {
+            bson_append_iter (dst, NULL, 0, &iter);
+         }
+      }
+   }
+
+   bson_append_int32 (dst, "maxTimeMS", 9, max_time_ms);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_apply_max_time_ms --
+ *
+ *       Limit the server's execution time for @command to what is left of
+ *       the current operation's deadline, so the server gives up when the
+ *       client does. A smaller maxTimeMS already in @command is kept.
+ *
+ *       getMore, killCursors, and write commands are not changed: the
+ *       server rejects maxTimeMS on them or on getMore for most cursors.
+ *       If @command is wrapped in "$query" for read preferences, the
+ *       wrapped command is changed.
+ *
+ * Returns:
+ *       @command, or @copy if it was initialized with the changed command;
+ *       the caller must then destroy @copy.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+const bson_t *
+mongoc_cluster_apply_max_time_ms (mongoc_cluster_t *cluster,
+                                  const bson_t     *command,
+                                  bson_t           *copy)
+{
+   const char *name;
+   const char *key;
+   const char *wrapper = NULL;
+   const uint8_t *data;
+   uint32_t len;
+   bson_iter_t iter;
+   bson_t wrapped;
+   bson_t child;
+   const bson_t *body;
+   int64_t remaining;
+
+   remaining = mongoc_cluster_remaining_msec (cluster);
+
+   /* without a deadline, or past it, leave the command alone */
+   if (remaining <= 0) {
+      return command;
+   }
+
+   name = _mongoc_get_command_name (command);
+
+   if (!name ||
+       !strcmp (name, "getMore") ||
+       !strcmp (name, "killCursors") ||
+       !strcmp (name, "insert") ||
+       !strcmp (name, "update") ||
+       !strcmp (name, "delete")) {
+      return command;
+   }
+
+   if (!bson_iter_init (&iter, command) || !bson_iter_next (&iter)) {
+      return command;
+   }
+
+   /* same test as _mongoc_get_command_name */
+   key = bson_iter_key (&iter);
+   if (key[0] == '$') {
+      wrapper = "$query";
+   } else if (!strcmp (key, "query")) {
+      wrapper = "query";
+   }
+
+   if (wrapper) {
+      if (!bson_iter_init_find (&iter, command, wrapper) ||
+          !BSON_ITER_HOLDS_DOCUMENT (&iter)) {
+         return command;
+      }
+
+      bson_iter_document (&iter, &len, &data);
+      if (!bson_init_static (&wrapped, data, len)) {
+         return command;
+      }
+
+      body = &wrapped;
+   } else {
+      body = command;
+   }
+
+   remaining = BSON_MIN (remaining, INT32_MAX);
+
+   if (bson_iter_init_find (&iter, body, "maxTimeMS") &&
+       bson_iter_as_int64 (&iter) > 0 &&
+       bson_iter_as_int64 (&iter) <= remaining) {
+      return command;
+   }
+
+   bson_init (copy);
+
+   if (!wrapper) {
+      _mongoc_cluster_copy_max_time_ms (command, copy, (int32_t) remaining);
+      return copy;
+   }
+
+   bson_iter_init (&iter, command);
+   while (bson_iter_next (&iter)) {
+      if (!strcmp (bson_iter_key (&iter), wrapper)) {
+         bson_append_document_begin (copy, wrapper, -1, &child);
+         _mongoc_cluster_copy_max_time_ms (body, &child, (int32_t) remaining);
+         bson_append_document_end (copy, &child);
+      } else {
+         bson_append_iter (copy, NULL, 0, &iter);
+      }
+   }
+
+   return copy;
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -161,7 +425,7 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t         *cluster,
    int64_t started;
    const char *command_name;
    mongoc_apm_callbacks_t *callbacks;
-   mongoc_array_t ar;                /* data to server */
+   mongoc_array_t *ar;               /* data to server */
    const size_t reply_header_size = sizeof (mongoc_rpc_reply_header_t);
    uint8_t reply_header_buf[sizeof (mongoc_rpc_reply_header_t)];
    uint8_t *reply_buf;               /* reply body */
@@ -176,6 +440,7 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t         *cluster,
    mongoc_apm_command_started_t started_event;
    mongoc_apm_command_succeeded_t succeeded_event;
    mongoc_apm_command_failed_t failed_event;
+   int32_t timeout_msec;
    bool ret = false;
 
    ENTRY;
@@ -193,7 +458,7 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t         *cluster,
    command_name = _mongoc_get_command_name (command);
    BSON_ASSERT (command_name);
    callbacks = &cluster->client->apm_callbacks;
-   _mongoc_array_init (&ar, sizeof (mongoc_iovec_t));
+   ar = _mongoc_scratch_iov (&cluster->client->scratch);
 
    if (!error) {
       error = &err_local;
@@ -208,7 +473,7 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t         *cluster,
    request_id = ++cluster->request_id;
    _mongoc_rpc_prep_command (&rpc, cmd_ns, command, flags);
    rpc.query.request_id = request_id;
-   _mongoc_rpc_gather (&rpc, &ar);
+   _mongoc_rpc_gather (&rpc, ar);
    _mongoc_rpc_swab_to_le (&rpc);
 
    if (monitored && callbacks->started) {
@@ -234,12 +499,18 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t         *cluster,
       GOTO (done);
    }
 
+   if (!mongoc_cluster_check_deadline (cluster, error)) {
+      GOTO (done);
+   }
+
    /*
     * send and receive
     */
-   if (!_mongoc_stream_writev_full (stream, (mongoc_iovec_t *)ar.data, ar.len,
-                                    cluster->sockettimeoutms, error)) {
+   if (!_mongoc_stream_writev_full (stream, (mongoc_iovec_t *)ar->data, ar->len,
+                                    mongoc_cluster_io_timeout_msec (cluster),
+                                    error)) {
       mongoc_cluster_disconnect_node (cluster, server_id);
+      mongoc_cluster_check_deadline (cluster, error);
 
       /* add info about the command to writev_full's error message */
       _bson_error_message_printf (
@@ -250,15 +521,21 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t         *cluster,
       GOTO (done);
    }
 
+   timeout_msec = mongoc_cluster_io_timeout_msec (cluster);
    if (reply_header_size != mongoc_stream_read (stream, &reply_header_buf,
                                            reply_header_size, reply_header_size,
-                                           cluster->sockettimeoutms)) {
+                                           timeout_msec)) {
       mongoc_cluster_disconnect_node (cluster, server_id);
       RUN_CMD_ERR_FMT (MONGOC_ERROR_STREAM, MONGOC_ERROR_STREAM_SOCKET,
                        "Failed to read %lu bytes from socket within "
-                       "%" PRIu32 " milliseconds.",
+                       "%" PRId32 " milliseconds.",
                        (unsigned long) reply_header_size,
-                       cluster->sockettimeoutms);
+                       timeout_msec);
+      if (mongoc_cluster_remaining_msec (cluster) == 0) {
+         RUN_CMD_ERR (MONGOC_ERROR_CLIENT,
+                      MONGOC_ERROR_CLIENT_OPERATION_TIMEOUT,
+                      "Operation exceeded its timeout");
+      }
 
       GOTO (done);
    }
@@ -284,13 +561,19 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t         *cluster,
    reply_buf = bson_reserve_buffer (reply_ptr, (uint32_t) doc_len);
    BSON_ASSERT (reply_buf);
 
+   timeout_msec = mongoc_cluster_io_timeout_msec (cluster);
    if (doc_len != mongoc_stream_read (stream, (void *) reply_buf, doc_len,
-                                      doc_len, cluster->sockettimeoutms)) {
+                                      doc_len, timeout_msec)) {
       RUN_CMD_ERR_FMT (MONGOC_ERROR_STREAM, MONGOC_ERROR_STREAM_SOCKET,
                        "Failed to read %lu bytes from socket within"
-                       " %" PRIu32 " milliseconds.",
+                       " %" PRId32 " milliseconds.",
                        (unsigned long) doc_len,
-                       cluster->sockettimeoutms);
+                       timeout_msec);
+      if (mongoc_cluster_remaining_msec (cluster) == 0) {
+         RUN_CMD_ERR (MONGOC_ERROR_CLIENT,
+                      MONGOC_ERROR_CLIENT_OPERATION_TIMEOUT,
+                      "Operation exceeded its timeout");
+      }
    }
 
    if (_mongoc_populate_cmd_error (reply_ptr,
@@ -316,7 +599,7 @@ mongoc_cluster_run_command_internal (mongoc_cluster_t         *cluster,
    }
 
 done:
-   _mongoc_array_destroy (&ar);
+   _mongoc_scratch_iov_release (&cluster->client->scratch, ar);
 
    if (!ret && error->code == 0) {
       /* generic error */
@@ -361,6 +644,8 @@ done:
  * Side effects:
  *       If the client's APM callbacks are set, they are executed.
  *       @reply is set and should ALWAYS be released with bson_destroy().
+ *       If the operation has a deadline, maxTimeMS is set from the time
+ *       left; see mongoc_cluster_apply_max_time_ms.
  *
  *--------------------------------------------------------------------------
  */
@@ -374,9 +659,31 @@ mongoc_cluster_run_command_monitored (mongoc_cluster_t         *cluster,
                                       bson_t                   *reply,
                                       bson_error_t             *error)
 {
-   return mongoc_cluster_run_command_internal (
-      cluster, server_stream->stream, server_stream->sd->id, flags, db_name,
-      command, true, &server_stream->sd->host, reply, error);
+   uint32_t server_id = server_stream->sd->id;
+   int64_t started;
+   const bson_t *cmd;
+   bson_t cmd_with_max_time;
+   bool ret;
+
+   started = bson_get_monotonic_time ();
+
+   cmd = mongoc_cluster_apply_max_time_ms (cluster, command,
+                                           &cmd_with_max_time);
+
+   ret = mongoc_cluster_run_command_internal (
+      cluster, server_stream->stream, server_id, flags, db_name,
+      cmd, true, &server_stream->sd->host, reply, error);
+
+   if (cmd == &cmd_with_max_time) {
+      bson_destroy (&cmd_with_max_time);
+   }
+
+   if (ret) {
+      _mongoc_topology_record_latency (cluster->client->topology, server_id,
+                                       bson_get_monotonic_time () - started);
+   }
+
+   return ret;
 }
 
 
@@ -755,13 +1062,16 @@ _mongoc_cluster_get_canonicalized_name (mongoc_cluster_t      *cluster, /* IN */
 
    if (stream->type == MONGOC_STREAM_SOCKET) {
       sock = mongoc_stream_socket_get_socket ((mongoc_stream_socket_t *)stream);
-      if (sock) {
-         canonicalized = mongoc_socket_getnameinfo (sock);
-         if (canonicalized) {
-            bson_snprintf (name, namelen, "%s", canonicalized);
-            bson_free (canonicalized);
-            RETURN (true);
-         }
+   } else if (stream->type == MONGOC_STREAM_URING) {
+      sock = mongoc_stream_uring_get_socket ((mongoc_stream_uring_t *)stream);
+   }
+
+   if (sock) {
+      canonicalized = mongoc_socket_getnameinfo (sock);
+      if (canonicalized) {
+         bson_snprintf (name, namelen, "%s", canonicalized);
+         bson_free (canonicalized);
+         RETURN (true);
       }
    }
 
@@ -1223,6 +1533,8 @@ _mongoc_cluster_auth_node (mongoc_cluster_t *cluster,
       }
    }
 
+   MONGOC_PROBE2 (auth_start, mechanism, hostname);
+
    if (0 == strcasecmp (mechanism, "MONGODB-CR")) {
       ret = _mongoc_cluster_auth_node_cr (cluster, stream, error);
    } else if (0 == strcasecmp (mechanism, "MONGODB-X509")) {
@@ -1273,6 +1585,8 @@ _mongoc_cluster_auth_node (mongoc_cluster_t *cluster,
       TRACE("%s", "Authentication succeeded");
    }
 
+   MONGOC_PROBE2 (auth_done, mechanism, ret);
+
    RETURN(ret);
 }
 
@@ -1322,6 +1636,123 @@ mongoc_cluster_disconnect_node (mongoc_cluster_t *cluster, uint32_t server_id)
    EXIT;
 }
 
+
+static bool
+_mongoc_cluster_flush_stream (mongoc_stream_t *stream,
+                              uint32_t         server_id,
+                              bson_error_t    *error)
+{
+   if (!stream->flush || mongoc_stream_flush (stream) == 0) {
+      return true;
+   }
+
+   bson_set_error (error,
+                   MONGOC_ERROR_STREAM,
+                   MONGOC_ERROR_STREAM_SOCKET,
+                   "Failed to send buffered requests to server %u",
+                   server_id);
+
+   return false;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_flush --
+ *
+ *       Send the requests that each of @cluster's connections holds in
+ *       its write buffer. Connections that fail are disconnected.
+ *
+ * Returns:
+ *       true if all were sent, otherwise false and @error is set for the
+ *       last connection that failed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_cluster_flush (mongoc_cluster_t *cluster,
+                      bson_error_t     *error)
+{
+   mongoc_topology_t *topology = cluster->client->topology;
+   mongoc_topology_scanner_node_t *scanner_node;
+   mongoc_cluster_node_t *node;
+   mongoc_set_item_t *item;
+   size_t i;
+   bool ret = true;
+
+   ENTRY;
+
+   if (topology->single_threaded) {
+      for (scanner_node = topology->scanner->nodes;
+           scanner_node;
+           scanner_node = scanner_node->next) {
+         if (scanner_node->stream &&
+             !_mongoc_cluster_flush_stream (scanner_node->stream,
+                                            scanner_node->id, error)) {
+            mongoc_topology_scanner_node_disconnect (scanner_node, true);
+            ret = false;
+         }
+      }
+   } else {
+      /* backwards, since removing a node shifts the ones after it */
+      for (i = cluster->nodes->items_len; i > 0; i--) {
+         item = &cluster->nodes->items[i - 1];
+         node = (mongoc_cluster_node_t *)item->item;
+
+         if (!_mongoc_cluster_flush_stream (node->stream, item->id,
+                                            error)) {
+            mongoc_set_rm (cluster->nodes, item->id);
+            ret = false;
+         }
+      }
+   }
+
+   RETURN (ret);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_drain_in_flight --
+ *
+ *       If a cursor derived from this client has a prefetched "getMore"
+ *       in flight, or a hedged read's slower reply is still due, read the
+ *       reply now. Must be called before any other operation selects a
+ *       server or uses a connection, since the reply would otherwise be
+ *       mistaken for the reply to that operation.
+ *
+ * Returns:
+ *       None.
+ *
+ * Side effects:
+ *       A getMore reply, or the error receiving it, is stored in the
+ *       cursor and reported when the cursor is next iterated. A hedged
+ *       read's cursor is killed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_cluster_drain_in_flight (mongoc_cluster_t *cluster)
+{
+   ENTRY;
+
+   BSON_ASSERT (cluster);
+
+   if (cluster->client->in_flight_cursor) {
+      _mongoc_cursor_cursorid_recv_prefetch (cluster->client->in_flight_cursor);
+   }
+
+   if (cluster->client->hedge_loser.server_id) {
+      _mongoc_cursor_drain_hedge_loser (cluster->client);
+   }
+
+   EXIT;
+}
+
 static void
 _mongoc_cluster_node_destroy (mongoc_cluster_node_t *node)
 {
@@ -1340,6 +1771,19 @@ _mongoc_cluster_node_dtor (void *data_,
    _mongoc_cluster_node_destroy (node);
 }
 
+static bool
+_mongoc_cluster_node_flush (void *item,
+                            void *ctx)
+{
+   mongoc_cluster_node_t *node = (mongoc_cluster_node_t *)item;
+
+   if (node->stream->flush) {
+      mongoc_stream_flush (node->stream);
+   }
+
+   return true;
+}
+
 static mongoc_cluster_node_t *
 _mongoc_cluster_node_new (mongoc_stream_t *stream)
 {
@@ -1476,8 +1920,17 @@ _mongoc_cluster_stream_for_server_description (mongoc_cluster_t *cluster,
 
    topology = cluster->client->topology;
 
+   if (!mongoc_cluster_check_deadline (cluster, error)) {
+      RETURN (NULL);
+   }
+
+   MONGOC_PROBE1 (stream_checkout_start, sd->id);
+
    /* in the single-threaded use case we share topology's streams */
    if (topology->single_threaded) {
+      /* the stream may still be awaiting an ismaster reply */
+      _mongoc_topology_finish_idle_check (topology, sd->id);
+
       server_stream = mongoc_cluster_fetch_stream_single (cluster,
                                                           sd,
                                                           reconnect_ok,
@@ -1491,6 +1944,8 @@ _mongoc_cluster_stream_for_server_description (mongoc_cluster_t *cluster,
 
    }
 
+   MONGOC_PROBE2 (stream_checkout_done, sd->id, server_stream != NULL);
+
    if (!server_stream) {
       /* Server Discovery And Monitoring Spec: When an application operation
        * fails because of any network error besides a socket timeout, the
@@ -1543,6 +1998,8 @@ mongoc_cluster_stream_for_server (mongoc_cluster_t *cluster,
    BSON_ASSERT (cluster);
    BSON_ASSERT (server_id);
 
+   mongoc_cluster_drain_in_flight (cluster);
+
    topology = cluster->client->topology;
 
    if (!(sd = mongoc_topology_server_by_id (topology, server_id, error))) {
@@ -1767,6 +2224,8 @@ mongoc_cluster_destroy (mongoc_cluster_t *cluster) /* INOUT */
 
    mongoc_uri_destroy(cluster->uri);
 
+   /* nodes are destroyed as if they failed, send what they buffered */
+   mongoc_set_for_each (cluster->nodes, _mongoc_cluster_node_flush, NULL);
    mongoc_set_destroy(cluster->nodes);
 
    _mongoc_array_destroy(&cluster->iov);
@@ -1807,11 +2266,11 @@ _mongoc_cluster_stream_for_optype (mongoc_cluster_t *cluster,
 
    BSON_ASSERT (cluster);
 
+   mongoc_cluster_drain_in_flight (cluster);
+
    /* this is a new copy of the server description */
-   selected_server = mongoc_topology_select (topology,
-                                            optype,
-                                            read_prefs,
-                                            error);
+   selected_server = mongoc_topology_select_with_deadline (
+      topology, optype, read_prefs, cluster->operation_expire_at, error);
 
    if (!selected_server) {
       RETURN(NULL);
@@ -2163,7 +2622,10 @@ _mongoc_cluster_check_interval (mongoc_cluster_t *cluster,
       }
    }
 
-   if (scanner_node->last_used + (1000 * cluster->socketcheckintervalms) <
+   /* with idle monitoring the application checks servers between
+    * operations, don't add a round trip to this one */
+   if (!topology->idle_monitoring &&
+       scanner_node->last_used + (1000 * cluster->socketcheckintervalms) <
        now) {
       bson_init (&command);
       BSON_APPEND_INT32 (&command, "ismaster", 1);
@@ -2335,11 +2797,25 @@ mongoc_cluster_sendv_to_server (mongoc_cluster_t              *cluster,
 
    BSON_ASSERT (cluster->iov.len);
 
+   MONGOC_PROBE3 (sendv_start, server_id,
+                  (int32_t) BSON_UINT32_FROM_LE (rpcs[0].header.request_id),
+                  rpcs_len);
+
+   if (!mongoc_cluster_check_deadline (cluster, error)) {
+      MONGOC_PROBE2 (sendv_done, server_id, false);
+      RETURN (false);
+   }
+
    if (!_mongoc_stream_writev_full (server_stream->stream, iov, iovcnt,
-                                    cluster->sockettimeoutms, error)) {
+                                    mongoc_cluster_io_timeout_msec (cluster),
+                                    error)) {
+      mongoc_cluster_check_deadline (cluster, error);
+      MONGOC_PROBE2 (sendv_done, server_id, false);
       RETURN (false);
    }
 
+   MONGOC_PROBE2 (sendv_done, server_id, true);
+
    if (cluster->client->topology->single_threaded) {
       scanner_node =
          mongoc_topology_scanner_get_node (cluster->client->topology->scanner,
@@ -2377,12 +2853,12 @@ mongoc_cluster_sendv_to_server (mongoc_cluster_t              *cluster,
  *--------------------------------------------------------------------------
  */
 
-bool
-mongoc_cluster_try_recv (mongoc_cluster_t       *cluster,
-                         mongoc_rpc_t           *rpc,
-                         mongoc_buffer_t        *buffer,
-                         mongoc_server_stream_t *server_stream,
-                         bson_error_t           *error)
+static bool
+_mongoc_cluster_try_recv (mongoc_cluster_t       *cluster,
+                          mongoc_rpc_t           *rpc,
+                          mongoc_buffer_t        *buffer,
+                          mongoc_server_stream_t *server_stream,
+                          bson_error_t           *error)
 {
    uint32_t server_id;
    int32_t msg_len;
@@ -2405,8 +2881,10 @@ mongoc_cluster_try_recv (mongoc_cluster_t       *cluster,
     */
    pos = buffer->len;
    if (!_mongoc_buffer_append_from_stream (buffer, server_stream->stream, 4,
-                                           cluster->sockettimeoutms, error)) {
+                                           mongoc_cluster_io_timeout_msec (
+                                              cluster), error)) {
       MONGOC_DEBUG("Could not read 4 bytes, stream probably closed or timed out");
+      mongoc_cluster_check_deadline (cluster, error);
       mongoc_counter_protocol_ingress_error_inc ();
       mongoc_cluster_disconnect_node(cluster, server_id);
       RETURN (false);
@@ -2433,7 +2911,9 @@ mongoc_cluster_try_recv (mongoc_cluster_t       *cluster,
     */
    if (!_mongoc_buffer_append_from_stream (buffer, server_stream->stream,
                                            msg_len - 4,
-                                           cluster->sockettimeoutms, error)) {
+                                           mongoc_cluster_io_timeout_msec (
+                                              cluster), error)) {
+      mongoc_cluster_check_deadline (cluster, error);
       mongoc_cluster_disconnect_node (cluster, server_id);
       mongoc_counter_protocol_ingress_error_inc ();
       RETURN (false);
@@ -2458,3 +2938,25 @@ mongoc_cluster_try_recv (mongoc_cluster_t       *cluster,
 
    RETURN(true);
 }
+
+
+/* probes around receiving a reply, successful or not */
+bool
+mongoc_cluster_try_recv (mongoc_cluster_t       *cluster,
+                         mongoc_rpc_t           *rpc,
+                         mongoc_buffer_t        *buffer,
+                         mongoc_server_stream_t *server_stream,
+                         bson_error_t           *error)
+{
+   bool ret;
+
+   MONGOC_PROBE1 (recv_start, server_stream->sd->id);
+
+   ret = _mongoc_cluster_try_recv (cluster, rpc, buffer, server_stream, error);
+
+   MONGOC_PROBE3 (recv_done, server_stream->sd->id,
+                  ret ? rpc->header.response_to : 0,
+                  ret ? rpc->header.msg_len : -1);
+
+   return ret;
+}
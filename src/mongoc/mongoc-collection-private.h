@@ -42,6 +42,8 @@ struct _mongoc_collection_t
    mongoc_read_prefs_t    *read_prefs;
    mongoc_read_concern_t  *read_concern;
    mongoc_write_concern_t *write_concern;
+   mongoc_validate_level_t validate_level;
+   uint32_t                operation_timeout_ms;
    bson_t                 *gle;
 };
 
@@ -54,6 +56,7 @@ mongoc_collection_t *_mongoc_collection_new                  (mongoc_client_t
                                                               const mongoc_write_concern_t *write_concern);
 mongoc_cursor_t    *_mongoc_collection_find_indexes_legacy   (mongoc_collection_t          *collection,
                                                               bson_error_t                 *error);
+int64_t             _mongoc_collection_expire_at             (const mongoc_collection_t    *collection);
 
 
 BSON_END_DECLS
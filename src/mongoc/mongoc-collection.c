@@ -31,9 +31,11 @@
 #include "mongoc-error.h"
 #include "mongoc-index.h"
 #include "mongoc-log.h"
+#include "mongoc-query-cache-private.h"
 #include "mongoc-trace.h"
 #include "mongoc-read-concern-private.h"
 #include "mongoc-write-concern-private.h"
+#include "mongoc-write-coalescer-private.h"
 
 
 #undef MONGOC_LOG_DOMAIN
@@ -75,29 +77,46 @@ _mongoc_collection_cursor_new (mongoc_collection_t *collection,
                              NULL);              /* read concern */
 }
 
+/* when an operation on @collection starting now must finish, or 0 */
+int64_t
+_mongoc_collection_expire_at (const mongoc_collection_t *collection)
+{
+   if (!collection->operation_timeout_ms) {
+      return 0;
+   }
+
+   return bson_get_monotonic_time ()
+          + (int64_t) collection->operation_timeout_ms * 1000;
+}
+
 static void
 _mongoc_collection_write_command_execute (mongoc_write_command_t       *command,
                                           const mongoc_collection_t    *collection,
                                           const mongoc_write_concern_t *write_concern,
                                           mongoc_write_result_t        *result)
 {
+   mongoc_cluster_t *cluster = &collection->client->cluster;
    mongoc_server_stream_t *server_stream;
+   int64_t saved_deadline;
 
    ENTRY;
 
-   server_stream = mongoc_cluster_stream_for_writes (&collection->client->cluster,
-                                                     &result->error);
+   saved_deadline = mongoc_cluster_push_deadline (
+      cluster, _mongoc_collection_expire_at (collection));
 
-   if (!server_stream) {
-      /* result->error has been filled out */
-      EXIT;
-   }
+   server_stream = mongoc_cluster_stream_for_writes (cluster, &result->error);
 
-   _mongoc_write_command_execute (command, collection->client, server_stream,
-                                  collection->db, collection->collection,
-                                  write_concern, 0 /* offset */, result);
+   /* if there is no stream, result->error has been filled out */
+   if (server_stream) {
+      _mongoc_write_command_execute (command, collection->client,
+                                     server_stream, collection->db,
+                                     collection->collection, write_concern,
+                                     0 /* offset */, result);
 
-   mongoc_server_stream_cleanup (server_stream);
+      mongoc_server_stream_cleanup (server_stream);
+   }
+
+   mongoc_cluster_pop_deadline (cluster, saved_deadline);
 
    EXIT;
 }
@@ -240,14 +259,21 @@ mongoc_collection_destroy (mongoc_collection_t *collection) /* IN */
 mongoc_collection_t *
 mongoc_collection_copy (mongoc_collection_t *collection) /* IN */
 {
+   mongoc_collection_t *copy;
+
    ENTRY;
 
    BSON_ASSERT (collection);
 
-   RETURN(_mongoc_collection_new(collection->client, collection->db,
-                                 collection->collection, collection->read_prefs,
-                                 collection->read_concern,
-                                 collection->write_concern));
+   copy = _mongoc_collection_new (collection->client, collection->db,
+                                  collection->collection,
+                                  collection->read_prefs,
+                                  collection->read_concern,
+                                  collection->write_concern);
+   copy->validate_level = collection->validate_level;
+   copy->operation_timeout_ms = collection->operation_timeout_ms;
+
+   RETURN (copy);
 }
 
 
@@ -323,14 +349,19 @@ mongoc_collection_aggregate (mongoc_collection_t       *collection, /* IN */
 
    cursor = _mongoc_collection_cursor_new (collection, flags);
 
+   /* the timeout includes selecting a server now */
+   cursor->operation_timeout_ms = collection->operation_timeout_ms;
+   cursor->operation_expire_at = _mongoc_collection_expire_at (collection);
+
    if (!_mongoc_read_prefs_validate (read_prefs, &cursor->error)) {
       GOTO (done); 
    }
 
-   selected_server = mongoc_topology_select(collection->client->topology,
-                                            MONGOC_SS_READ,
-                                            read_prefs,
-                                            &cursor->error);
+   mongoc_cluster_drain_in_flight (&collection->client->cluster);
+
+   selected_server = mongoc_topology_select_with_deadline (
+      collection->client->topology, MONGOC_SS_READ, read_prefs,
+      cursor->operation_expire_at, &cursor->error);
 
    if (!selected_server) {
       GOTO (done);
@@ -494,9 +525,12 @@ mongoc_collection_find (mongoc_collection_t       *collection, /* IN */
    cursor = _mongoc_cursor_new (collection->client, collection->ns, flags, skip,
                                 limit, batch_size, false, query, fields, 
                                 read_prefs, collection->read_concern);
+   cursor->operation_timeout_ms = collection->operation_timeout_ms;
    if (cursor->error.domain == 0) {
       _mongoc_read_prefs_validate (read_prefs, &cursor->error);
    }
+
+   _mongoc_cursor_use_query_cache (cursor, query, fields);
    
    return cursor;   
 }
@@ -542,6 +576,7 @@ mongoc_collection_command (mongoc_collection_t       *collection,
                            const mongoc_read_prefs_t *read_prefs)
 {
    char ns[MONGOC_NAMESPACE_MAX];
+   mongoc_cursor_t *cursor;
 
    BSON_ASSERT (collection);
    BSON_ASSERT (query);
@@ -559,8 +594,11 @@ mongoc_collection_command (mongoc_collection_t       *collection,
                      collection->db, collection->collection);
    }
 
-   return mongoc_client_command (collection->client, ns, flags,
-                                 skip, limit, batch_size, query, fields, read_prefs);
+   cursor = mongoc_client_command (collection->client, ns, flags, skip, limit,
+                                   batch_size, query, fields, read_prefs);
+   cursor->operation_timeout_ms = collection->operation_timeout_ms;
+
+   return cursor;
 }
 
 bool
@@ -570,13 +608,25 @@ mongoc_collection_command_simple (mongoc_collection_t       *collection,
                                   bson_t                    *reply,
                                   bson_error_t              *error)
 {
+   mongoc_cluster_t *cluster;
+   int64_t saved_deadline;
+   bool ret;
+
    BSON_ASSERT (collection);
    BSON_ASSERT (command);
 
    bson_clear (&collection->gle);
 
-   return mongoc_client_command_simple (collection->client, collection->db,
-                                        command, read_prefs, reply, error);
+   cluster = &collection->client->cluster;
+   saved_deadline = mongoc_cluster_push_deadline (
+      cluster, _mongoc_collection_expire_at (collection));
+
+   ret = mongoc_client_command_simple (collection->client, collection->db,
+                                       command, read_prefs, reply, error);
+
+   mongoc_cluster_pop_deadline (cluster, saved_deadline);
+
+   return ret;
 }
 
 /*
@@ -640,16 +690,46 @@ mongoc_collection_count_with_opts (mongoc_collection_t       *collection,  /* IN
    mongoc_server_stream_t *server_stream = NULL;
    mongoc_cluster_t *cluster;
    mongoc_apply_read_prefs_result_t read_prefs_result = READ_PREFS_RESULT_INIT;
+   mongoc_query_cache_t *cache;
+   int64_t cache_generation = 0;
+   bool use_cache = false;
    bson_iter_t iter;
    int64_t ret = -1;
    bool success;
    bson_t reply;
-   bson_t cmd = BSON_INITIALIZER;
+   bson_t *cmd = NULL;
+   bson_t cache_key;
+   bson_t cached;
    bson_t q;
+   int64_t saved_deadline;
 
    ENTRY;
 
    cluster = &collection->client->cluster;
+   saved_deadline = mongoc_cluster_push_deadline (
+      cluster, _mongoc_collection_expire_at (collection));
+
+   cache = collection->client->query_cache;
+
+   if (_mongoc_query_cache_enabled (cache, collection->ns)) {
+      use_cache = true;
+      _mongoc_query_cache_key (&cache_key, "count", collection->ns, query,
+                               NULL, skip, limit, opts, flags, read_prefs,
+                               collection->read_concern->level);
+
+      if (_mongoc_query_cache_get (cache, &cache_key, &cached)) {
+         if (bson_iter_init_find (&iter, &cached, "n")) {
+            ret = bson_iter_as_int64 (&iter);
+         }
+
+         bson_destroy (&cached);
+         GOTO (done);
+      }
+
+      cache_generation = _mongoc_query_cache_generation (cache,
+                                                         collection->ns);
+   }
+
    server_stream = mongoc_cluster_stream_for_writes (cluster, error);
    if (!server_stream) {
       GOTO (done);
@@ -661,20 +741,21 @@ mongoc_collection_count_with_opts (mongoc_collection_t       *collection,  /* IN
 
    BSON_ASSERT (collection);
 
-   bson_append_utf8(&cmd, "count", 5, collection->collection,
+   cmd = _mongoc_scratch_bson (&collection->client->scratch);
+   bson_append_utf8(cmd, "count", 5, collection->collection,
                     collection->collectionlen);
    if (query) {
-      bson_append_document(&cmd, "query", 5, query);
+      bson_append_document(cmd, "query", 5, query);
    } else {
       bson_init(&q);
-      bson_append_document(&cmd, "query", 5, &q);
+      bson_append_document(cmd, "query", 5, &q);
       bson_destroy(&q);
    }
    if (limit) {
-      bson_append_int64(&cmd, "limit", 5, limit);
+      bson_append_int64(cmd, "limit", 5, limit);
    }
    if (skip) {
-      bson_append_int64(&cmd, "skip", 4, skip);
+      bson_append_int64(cmd, "skip", 4, skip);
    }
    if (collection->read_concern->level != NULL) {
       const bson_t *read_concern_bson;
@@ -688,14 +769,14 @@ mongoc_collection_count_with_opts (mongoc_collection_t       *collection,  /* IN
       }
 
       read_concern_bson = _mongoc_read_concern_get_bson (collection->read_concern);
-      BSON_APPEND_DOCUMENT (&cmd, "readConcern", read_concern_bson);
+      BSON_APPEND_DOCUMENT (cmd, "readConcern", read_concern_bson);
    }
    if (opts) {
-       bson_concat(&cmd, opts);
+       bson_concat(cmd, opts);
    }
 
    apply_read_preferences (read_prefs, server_stream,
-                           &cmd, flags, &read_prefs_result);
+                           cmd, flags, &read_prefs_result);
 
    success = mongoc_cluster_run_command_monitored (
       cluster, server_stream, read_prefs_result.flags, collection->db,
@@ -703,6 +784,14 @@ mongoc_collection_count_with_opts (mongoc_collection_t       *collection,  /* IN
 
    if (success && bson_iter_init_find(&iter, &reply, "n")) {
       ret = bson_iter_as_int64(&iter);
+
+      if (use_cache) {
+         bson_init (&cached);
+         BSON_APPEND_INT64 (&cached, "n", ret);
+         _mongoc_query_cache_put (cache, cache_generation, collection->ns,
+                                  &cache_key, &cached);
+         bson_destroy (&cached);
+      }
    }
 
    bson_destroy (&reply);
@@ -710,7 +799,13 @@ mongoc_collection_count_with_opts (mongoc_collection_t       *collection,  /* IN
 done:
    apply_read_prefs_result_cleanup (&read_prefs_result);
    mongoc_server_stream_cleanup (server_stream);
-   bson_destroy (&cmd);
+   _mongoc_scratch_bson_release (&collection->client->scratch, cmd);
+
+   if (use_cache) {
+      bson_destroy (&cache_key);
+   }
+
+   mongoc_cluster_pop_deadline (cluster, saved_deadline);
 
    RETURN (ret);
 }
@@ -747,6 +842,9 @@ mongoc_collection_drop (mongoc_collection_t *collection, /* IN */
    ret = mongoc_collection_command_simple(collection, &cmd, NULL, NULL, error);
    bson_destroy(&cmd);
 
+   _mongoc_query_cache_invalidate (collection->client->query_cache,
+                                   collection->ns);
+
    return ret;
 }
 
@@ -1174,6 +1272,8 @@ mongoc_collection_find_indexes (mongoc_collection_t *collection,
    mongoc_cursor_t *cursor;
    bson_t cmd = BSON_INITIALIZER;
    bson_t child;
+   int64_t saved_deadline;
+   bool primed;
 
    BSON_ASSERT (collection);
 
@@ -1186,7 +1286,15 @@ mongoc_collection_find_indexes (mongoc_collection_t *collection,
    cursor = _mongoc_collection_cursor_new (collection, MONGOC_QUERY_SLAVE_OK);
    _mongoc_cursor_cursorid_init (cursor, &cmd);
 
-   if (_mongoc_cursor_cursorid_prime (cursor)) {
+   /* the first batch is fetched now, within the cursor's timeout */
+   cursor->operation_timeout_ms = collection->operation_timeout_ms;
+   cursor->operation_expire_at = _mongoc_collection_expire_at (collection);
+   saved_deadline = mongoc_cluster_push_deadline (&collection->client->cluster,
+                                                  cursor->operation_expire_at);
+   primed = _mongoc_cursor_cursorid_prime (cursor);
+   mongoc_cluster_pop_deadline (&collection->client->cluster, saved_deadline);
+
+   if (primed) {
        /* intentionally empty */
    } else {
       if (mongoc_cursor_error (cursor, error)) {
@@ -1260,6 +1368,8 @@ mongoc_collection_insert_bulk (mongoc_collection_t           *collection,
    mongoc_bulk_write_flags_t write_flags = MONGOC_BULK_WRITE_FLAGS_INIT;
    uint32_t i;
    bool ret;
+   int vflags = (BSON_VALIDATE_UTF8 | BSON_VALIDATE_UTF8_ALLOW_NULL
+               | BSON_VALIDATE_DOLLAR_KEYS | BSON_VALIDATE_DOT_KEYS);
 
    BSON_ASSERT (collection);
    BSON_ASSERT (documents);
@@ -1269,35 +1379,38 @@ mongoc_collection_insert_bulk (mongoc_collection_t           *collection,
    }
 
    if (!(flags & MONGOC_INSERT_NO_VALIDATE)) {
-      int vflags = (BSON_VALIDATE_UTF8 | BSON_VALIDATE_UTF8_ALLOW_NULL
-                  | BSON_VALIDATE_DOLLAR_KEYS | BSON_VALIDATE_DOT_KEYS);
-
-      for (i = 0; i < n_documents; i++) {
-         if (!bson_validate (documents[i], (bson_validate_flags_t)vflags, NULL)) {
-            bson_set_error (error,
-                            MONGOC_ERROR_BSON,
-                            MONGOC_ERROR_BSON_INVALID,
-                            "A document was corrupt or contained "
-                            "invalid characters . or $");
-            RETURN (false);
-         }
-      }
+      vflags = _mongoc_validate_flags (collection->validate_level, vflags);
+   } else {
+      vflags = 0;
    }
 
    bson_clear (&collection->gle);
 
-   _mongoc_write_result_init (&result);
-
    write_flags.ordered = !(flags & MONGOC_INSERT_CONTINUE_ON_ERROR);
 
    _mongoc_write_command_init_insert (&command, NULL, write_flags,
                                       ++collection->client->cluster.operation_id,
                                       true);
 
+   /* check each document just before copying it into the command, while
+    * it is still in cache, rather than walking all of them twice */
    for (i = 0; i < n_documents; i++) {
+      if (vflags &&
+          !bson_validate (documents[i], (bson_validate_flags_t)vflags, NULL)) {
+         bson_set_error (error,
+                         MONGOC_ERROR_BSON,
+                         MONGOC_ERROR_BSON_INVALID,
+                         "A document was corrupt or contained "
+                         "invalid characters . or $");
+         _mongoc_write_command_destroy (&command);
+         RETURN (false);
+      }
+
       _mongoc_write_command_insert_append (&command, documents[i]);
    }
 
+   _mongoc_write_result_init (&result);
+
    _mongoc_collection_write_command_execute (&command, collection,
                                              write_concern, &result);
 
@@ -1370,7 +1483,10 @@ mongoc_collection_insert (mongoc_collection_t          *collection,
       int vflags = (BSON_VALIDATE_UTF8 | BSON_VALIDATE_UTF8_ALLOW_NULL
                   | BSON_VALIDATE_DOLLAR_KEYS | BSON_VALIDATE_DOT_KEYS);
 
-      if (!bson_validate (document, (bson_validate_flags_t)vflags, NULL)) {
+      vflags = _mongoc_validate_flags (collection->validate_level, vflags);
+
+      if (vflags &&
+          !bson_validate (document, (bson_validate_flags_t)vflags, NULL)) {
          bson_set_error (error,
                          MONGOC_ERROR_BSON,
                          MONGOC_ERROR_BSON_INVALID,
@@ -1380,6 +1496,24 @@ mongoc_collection_insert (mongoc_collection_t          *collection,
       }
    }
 
+   /* with a pool's write coalescing enabled, other threads' inserts may
+    * be sent in the same command */
+   if (collection->client->write_coalescer &&
+       _mongoc_write_coalescer_insert (collection->client->write_coalescer,
+                                       collection, document, write_concern,
+                                       &result)) {
+      collection->gle = bson_new ();
+      ret = _mongoc_write_result_complete (&result,
+                                           collection->client->error_api_version,
+                                           write_concern,
+                                           collection->gle,
+                                           error);
+
+      _mongoc_write_result_destroy (&result);
+
+      RETURN (ret);
+   }
+
    _mongoc_write_result_init (&result);
    _mongoc_write_command_init_insert (&command, document, write_flags,
                                       ++collection->client->cluster.operation_id,
@@ -1457,7 +1591,10 @@ mongoc_collection_update (mongoc_collection_t          *collection,
       write_concern = collection->write_concern;
    }
 
+   vflags = _mongoc_validate_flags (collection->validate_level, vflags);
+
    if (!((uint32_t)flags & MONGOC_UPDATE_NO_VALIDATE) &&
+       vflags &&
        bson_iter_init (&iter, update) &&
        bson_iter_next (&iter) &&
        (bson_iter_key (&iter) [0] != '$') &&
@@ -1823,6 +1960,116 @@ mongoc_collection_set_write_concern (mongoc_collection_t          *collection,
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_collection_get_validate_level --
+ *
+ *       Fetches how thoroughly documents are checked before they are
+ *       inserted or used as replacements.
+ *
+ * Returns:
+ *       A mongoc_validate_level_t.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_validate_level_t
+mongoc_collection_get_validate_level (const mongoc_collection_t *collection)
+{
+   BSON_ASSERT (collection);
+
+   return collection->validate_level;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_collection_set_validate_level --
+ *
+ *       Sets how thoroughly documents are checked before they are
+ *       inserted or used as replacements. The default is
+ *       MONGOC_VALIDATE_FULL.
+ *
+ * Returns:
+ *       None.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_collection_set_validate_level (mongoc_collection_t     *collection,
+                                      mongoc_validate_level_t  level)
+{
+   BSON_ASSERT (collection);
+
+   collection->validate_level = level;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_collection_get_operation_timeout_ms --
+ *
+ *       Fetches the time limit for operations on @collection, in
+ *       milliseconds, or 0 if there is none.
+ *
+ * Returns:
+ *       The timeout.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+uint32_t
+mongoc_collection_get_operation_timeout_ms (const mongoc_collection_t *collection)
+{
+   BSON_ASSERT (collection);
+
+   return collection->operation_timeout_ms;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_collection_set_operation_timeout_ms --
+ *
+ *       Sets a time limit for each operation on @collection, covering
+ *       server selection, connecting, and every round trip. Commands are
+ *       sent with maxTimeMS set to the time left. Cursors and bulk
+ *       operations created afterward inherit the timeout. 0, the
+ *       default, means no limit.
+ *
+ * Returns:
+ *       None.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_collection_set_operation_timeout_ms (mongoc_collection_t *collection,
+                                            uint32_t             timeout_ms)
+{
+   BSON_ASSERT (collection);
+
+   collection->operation_timeout_ms = timeout_ms;
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -2009,6 +2256,10 @@ mongoc_collection_rename (mongoc_collection_t *collection,
    ret = mongoc_client_command_simple (collection->client, "admin",
                                        &cmd, NULL, NULL, error);
 
+   _mongoc_query_cache_invalidate (collection->client->query_cache,
+                                   collection->ns);
+   _mongoc_query_cache_invalidate (collection->client->query_cache, newns);
+
    if (ret) {
       if (new_db) {
          bson_snprintf (collection->db, sizeof collection->db, "%s", new_db);
@@ -2099,6 +2350,8 @@ mongoc_collection_create_bulk_operation (
       const mongoc_write_concern_t *write_concern)
 {
    mongoc_bulk_write_flags_t write_flags = MONGOC_BULK_WRITE_FLAGS_INIT;
+   mongoc_bulk_operation_t *bulk;
+
    BSON_ASSERT (collection);
 
    if (!write_concern) {
@@ -2107,11 +2360,15 @@ mongoc_collection_create_bulk_operation (
 
    write_flags.ordered = ordered;
 
-   return _mongoc_bulk_operation_new (collection->client,
+   bulk = _mongoc_bulk_operation_new (collection->client,
                                       collection->db,
                                       collection->collection,
                                       write_flags,
                                       write_concern);
+   bulk->validate_level = collection->validate_level;
+   bulk->operation_timeout_ms = collection->operation_timeout_ms;
+
+   return bulk;
 }
 
 /*
@@ -2152,6 +2409,8 @@ mongoc_collection_find_and_modify_with_opts (mongoc_collection_t
    bson_t *reply_ptr;
    bool ret;
    bson_t command = BSON_INITIALIZER;
+   int64_t expire_at;
+   int64_t saved_deadline;
 
    ENTRY;
 
@@ -2161,7 +2420,12 @@ mongoc_collection_find_and_modify_with_opts (mongoc_collection_t
    reply_ptr = reply ? reply : &reply_local;
    bson_init (reply_ptr);
    cluster = &collection->client->cluster;
+   expire_at = _mongoc_collection_expire_at (collection);
+
+   saved_deadline = mongoc_cluster_push_deadline (cluster, expire_at);
    server_stream = mongoc_cluster_stream_for_writes (cluster, error);
+   mongoc_cluster_pop_deadline (cluster, saved_deadline);
+
    if (!server_stream) {
       bson_destroy (&command);
       RETURN (false);
@@ -2230,10 +2494,15 @@ mongoc_collection_find_and_modify_with_opts (mongoc_collection_t
       RETURN (false);
    }
 
+   saved_deadline = mongoc_cluster_push_deadline (cluster, expire_at);
    ret = mongoc_cluster_run_command_monitored (cluster, server_stream,
                                                MONGOC_QUERY_NONE,
                                                collection->db, &command,
                                                reply_ptr, error);
+   mongoc_cluster_pop_deadline (cluster, saved_deadline);
+
+   _mongoc_query_cache_invalidate (collection->client->query_cache,
+                                   collection->ns);
 
    if (bson_iter_init_find (&iter, reply_ptr, "writeConcernError") &&
          BSON_ITER_HOLDS_DOCUMENT (&iter)) {
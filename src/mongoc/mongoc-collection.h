@@ -168,6 +168,12 @@ void                          mongoc_collection_set_read_concern     (mongoc_col
 const mongoc_write_concern_t *mongoc_collection_get_write_concern    (const mongoc_collection_t     *collection);
 void                          mongoc_collection_set_write_concern    (mongoc_collection_t           *collection,
                                                                       const mongoc_write_concern_t  *write_concern);
+mongoc_validate_level_t       mongoc_collection_get_validate_level   (const mongoc_collection_t     *collection);
+void                          mongoc_collection_set_validate_level   (mongoc_collection_t           *collection,
+                                                                      mongoc_validate_level_t        level);
+uint32_t                      mongoc_collection_get_operation_timeout_ms (const mongoc_collection_t *collection);
+void                          mongoc_collection_set_operation_timeout_ms (mongoc_collection_t       *collection,
+                                                                          uint32_t                   timeout_ms);
 const char                   *mongoc_collection_get_name             (mongoc_collection_t           *collection);
 const bson_t                 *mongoc_collection_get_last_error       (const mongoc_collection_t     *collection);
 char                         *mongoc_collection_keys_to_index_string (const bson_t                  *keys);
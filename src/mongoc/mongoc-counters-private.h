@@ -160,6 +160,17 @@ mongoc_counter_##ident##_reset (void) \
          COUNTER_##ident%SLOTS_PER_CACHELINE] = 0; \
    } \
    bson_memory_barrier (); \
+} \
+static BSON_INLINE int64_t \
+mongoc_counter_##ident##_count (void) \
+{ \
+   int64_t total = 0; \
+   uint32_t i; \
+   for (i = 0; i < _mongoc_get_cpu_count(); i++) { \
+      total += __mongoc_counter_##ident.cpus [i].slots [\
+         COUNTER_##ident%SLOTS_PER_CACHELINE]; \
+   } \
+   return total; \
 }
 #include "mongoc-counters.defs"
 #undef COUNTER
@@ -35,6 +35,7 @@ typedef struct
    bson_t         array;
    bool           has_array;
    bool           has_synthetic_bson;
+   bool           from_cache;
    bson_iter_t    iter;
    bson_t         bson;   /* current document */
    const char    *field_name;
@@ -150,6 +151,10 @@ _mongoc_cursor_array_clone (const mongoc_cursor_t *cursor)
    clone_ = _mongoc_cursor_clone (cursor);
    _mongoc_cursor_array_init (clone_, &cursor->query, arr->field_name);
 
+   if (arr->from_cache) {
+      _mongoc_cursor_array_set_cached (clone_, &arr->array);
+   }
+
    RETURN (clone_);
 }
 
@@ -241,3 +246,29 @@ _mongoc_cursor_array_set_bson (mongoc_cursor_t *cursor,
 
    EXIT;
 }
+
+
+/* iterate the "field_name" array of @result, a query cache entry */
+void
+_mongoc_cursor_array_set_cached (mongoc_cursor_t *cursor,
+                                 const bson_t    *result)
+{
+   mongoc_cursor_array_t *arr;
+   bson_iter_t iter;
+   bool r;
+
+   ENTRY;
+
+   arr = (mongoc_cursor_array_t *)cursor->iface_data;
+   bson_copy_to (result, &arr->array);
+   arr->has_array = true;
+   arr->from_cache = true;
+
+   r = bson_iter_init_find (&iter, &arr->array, arr->field_name) &&
+       BSON_ITER_HOLDS_ARRAY (&iter) &&
+       bson_iter_recurse (&iter, &arr->iter);
+
+   BSON_ASSERT (r);
+
+   EXIT;
+}
@@ -31,11 +31,19 @@ BSON_BEGIN_DECLS
 
 typedef struct
 {
-   bson_t      array;
-   bool        in_batch;
-   bool        in_reader;
-   bson_iter_t batch_iter;
-   bson_t      current_doc;
+   bson_t       array;
+   bool         in_batch;
+   bool         in_reader;
+   bson_iter_t  batch_iter;
+   bson_t       current_doc;
+
+   /* pipelined getMore, see mongoc_cursor_set_prefetch */
+   bool         in_flight;
+   uint32_t     in_flight_request_id;
+   int64_t      in_flight_started;
+   bool         has_prefetched;
+   bson_t       prefetched;
+   bson_error_t prefetch_error;
 } mongoc_cursor_cursorid_t;
 
 
@@ -50,6 +58,7 @@ bool _mongoc_cursor_prepare_getmore_command (mongoc_cursor_t  *cursor,
 void _mongoc_cursor_cursorid_init_with_reply (mongoc_cursor_t *cursor,
                                               bson_t          *reply,
                                               uint32_t         server_id);
+bool _mongoc_cursor_cursorid_recv_prefetch  (mongoc_cursor_t  *cursor);
 
 BSON_END_DECLS
 
@@ -20,9 +20,12 @@
 #include "mongoc-cursor-cursorid-private.h"
 #include "mongoc-log.h"
 #include "mongoc-trace.h"
+#include "mongoc-trace-private.h"
 #include "mongoc-error.h"
 #include "mongoc-util-private.h"
 #include "mongoc-client-private.h"
+#include "mongoc-apm-private.h"
+#include "mongoc-read-prefs-private.h"
 
 
 #undef MONGOC_LOG_DOMAIN
@@ -38,6 +41,7 @@ _mongoc_cursor_cursorid_new (void)
 
    cid = (mongoc_cursor_cursorid_t *) bson_malloc0 (sizeof *cid);
    bson_init (&cid->array);
+   bson_init (&cid->prefetched);
    cid->in_batch = false;
    cid->in_reader = false;
 
@@ -55,7 +59,21 @@ _mongoc_cursor_cursorid_destroy (mongoc_cursor_t *cursor)
    cid = (mongoc_cursor_cursorid_t *)cursor->iface_data;
    BSON_ASSERT (cid);
 
+   /* read any pending getMore reply so the connection can be reused, and
+    * so we know whether the server-side cursor must still be killed */
+   if (cid->in_flight) {
+      _mongoc_cursor_cursorid_recv_prefetch (cursor);
+   }
+
+   if (cid->has_prefetched) {
+      bson_destroy (&cid->array);
+      bson_steal (&cid->array, &cid->prefetched);
+      bson_init (&cid->prefetched);
+      _mongoc_cursor_cursorid_start_batch (cursor);
+   }
+
    bson_destroy (&cid->array);
+   bson_destroy (&cid->prefetched);
    bson_free (cid);
    _mongoc_cursor_destroy (cursor);
 
@@ -95,6 +113,10 @@ _mongoc_cursor_cursorid_start_batch (mongoc_cursor_t *cursor)
             if (BSON_ITER_HOLDS_ARRAY (&child) &&
                 bson_iter_recurse (&child, &cid->batch_iter)) {
                cid->in_batch = true;
+
+               MONGOC_PROBE3 (cursor_batch, cursor,
+                              cursor->rpc.reply.cursor_id,
+                              BSON_ITER_IS_KEY (&child, "firstBatch"));
             }
          }
       }
@@ -104,6 +126,10 @@ _mongoc_cursor_cursorid_start_batch (mongoc_cursor_t *cursor)
 }
 
 
+static void
+_mongoc_cursor_cursorid_prefetch (mongoc_cursor_t *cursor);
+
+
 static bool
 _mongoc_cursor_cursorid_refresh_from_command (mongoc_cursor_t *cursor,
                                               const bson_t    *command)
@@ -121,6 +147,7 @@ _mongoc_cursor_cursorid_refresh_from_command (mongoc_cursor_t *cursor,
     * to getMore command with {cursor: {id: N, nextBatch: []}}. */
    if (_mongoc_cursor_run_command (cursor, command, &cid->array) &&
        _mongoc_cursor_cursorid_start_batch (cursor)) {
+      _mongoc_cursor_cursorid_prefetch (cursor);
 
       RETURN (true);
    } else {
@@ -137,6 +164,310 @@ _mongoc_cursor_cursorid_refresh_from_command (mongoc_cursor_t *cursor,
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cursor_cursorid_prefetch --
+ *
+ *       If prefetch is enabled, send the next "getMore" command now so the
+ *       server prepares the next batch while the application consumes the
+ *       current one. The reply is read by
+ *       _mongoc_cursor_cursorid_recv_prefetch when the batch is exhausted,
+ *       or sooner if another operation needs the connection.
+ *
+ *       Only one cursor per client may have a getMore in flight; if another
+ *       cursor already does, this cursor falls back to a regular getMore.
+ *
+ * Side effects:
+ *       On success, sets client->in_flight_cursor to @cursor. A failure to
+ *       send is not reported: the connection is closed and the next batch
+ *       is fetched the usual way.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_cursor_cursorid_prefetch (mongoc_cursor_t *cursor)
+{
+   mongoc_cursor_cursorid_t *cid;
+   mongoc_client_t *client;
+   mongoc_cluster_t *cluster;
+   mongoc_server_stream_t *server_stream;
+   mongoc_apply_read_prefs_result_t read_prefs_result = READ_PREFS_RESULT_INIT;
+   mongoc_apm_callbacks_t *callbacks;
+   mongoc_apm_command_started_t started_event;
+   mongoc_apm_command_failed_t failed_event;
+   char db[MONGOC_NAMESPACE_MAX];
+   char cmd_ns[MONGOC_NAMESPACE_MAX];
+   mongoc_rpc_t rpc;
+   uint32_t request_id;
+   bson_error_t error;
+   bool sent;
+   bson_t command;
+
+   ENTRY;
+
+   cid = (mongoc_cursor_cursorid_t *)cursor->iface_data;
+   BSON_ASSERT (cid);
+
+   client = cursor->client;
+   cluster = &client->cluster;
+   callbacks = &client->apm_callbacks;
+
+   if (!cursor->prefetch ||
+       !mongoc_cursor_get_id (cursor) ||
+       cursor->flags & MONGOC_QUERY_TAILABLE_CURSOR ||
+       client->in_flight_cursor ||
+       client->in_exhaust ||
+       !cursor->server_id) {
+      EXIT;
+   }
+
+   server_stream = mongoc_cluster_stream_for_server (cluster,
+                                                     cursor->server_id,
+                                                     false /* reconnect_ok */,
+                                                     &error);
+
+   if (!server_stream) {
+      EXIT;
+   }
+
+   if (!_use_find_command (cursor, server_stream)) {
+      mongoc_server_stream_cleanup (server_stream);
+      EXIT;
+   }
+
+   _mongoc_cursor_prepare_getmore_command (cursor, &command);
+   apply_read_preferences (cursor->read_prefs, server_stream,
+                           &command, cursor->flags, &read_prefs_result);
+
+   bson_strncpy (db, cursor->ns, cursor->dblen + 1);
+   bson_snprintf (cmd_ns, sizeof cmd_ns, "%s.$cmd", db);
+   request_id = ++cluster->request_id;
+   _mongoc_rpc_prep_command (&rpc, cmd_ns,
+                             read_prefs_result.query_with_read_prefs,
+                             read_prefs_result.flags);
+   rpc.query.request_id = request_id;
+
+   cid->in_flight_started = bson_get_monotonic_time ();
+
+   if (callbacks->started) {
+      mongoc_apm_command_started_init (&started_event,
+                                       read_prefs_result.query_with_read_prefs,
+                                       db,
+                                       "getMore",
+                                       request_id,
+                                       cursor->operation_id,
+                                       &server_stream->sd->host,
+                                       server_stream->sd->id,
+                                       client->apm_context);
+
+      callbacks->started (&started_event);
+      mongoc_apm_command_started_cleanup (&started_event);
+   }
+
+   sent = mongoc_cluster_sendv_to_server (cluster, &rpc, 1, server_stream,
+                                          NULL, &error);
+
+   /* with a write buffer the getMore would wait for the next read, and
+    * overlap nothing */
+   if (sent && server_stream->stream->flush &&
+       mongoc_stream_flush (server_stream->stream) != 0) {
+      bson_set_error (&error,
+                      MONGOC_ERROR_STREAM,
+                      MONGOC_ERROR_STREAM_SOCKET,
+                      "Failed to send \"getMore\" to %s",
+                      server_stream->sd->host.host_and_port);
+      sent = false;
+   }
+
+   if (sent) {
+      cid->in_flight = true;
+      cid->in_flight_request_id = request_id;
+      client->in_flight_cursor = cursor;
+   } else {
+      /* a partial message may have been written */
+      mongoc_cluster_disconnect_node (cluster, server_stream->sd->id);
+
+      if (callbacks->failed) {
+         mongoc_apm_command_failed_init (&failed_event,
+                                         bson_get_monotonic_time () -
+                                            cid->in_flight_started,
+                                         "getMore",
+                                         &error,
+                                         request_id,
+                                         cursor->operation_id,
+                                         &server_stream->sd->host,
+                                         server_stream->sd->id,
+                                         client->apm_context);
+
+         callbacks->failed (&failed_event);
+         mongoc_apm_command_failed_cleanup (&failed_event);
+      }
+   }
+
+   apply_read_prefs_result_cleanup (&read_prefs_result);
+   bson_destroy (&command);
+   mongoc_server_stream_cleanup (server_stream);
+
+   EXIT;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cursor_cursorid_recv_prefetch --
+ *
+ *       Read the reply to the "getMore" command sent by
+ *       _mongoc_cursor_cursorid_prefetch.
+ *
+ * Returns:
+ *       true if the reply was received and stored in cid->prefetched;
+ *       otherwise false and cid->prefetch_error is set.
+ *
+ * Side effects:
+ *       Clears client->in_flight_cursor. A network error disconnects
+ *       from the server.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_cursor_cursorid_recv_prefetch (mongoc_cursor_t *cursor)
+{
+   mongoc_cursor_cursorid_t *cid;
+   mongoc_client_t *client;
+   mongoc_cluster_t *cluster;
+   mongoc_server_stream_t *server_stream;
+   mongoc_apm_callbacks_t *callbacks;
+   mongoc_apm_command_succeeded_t succeeded_event;
+   mongoc_apm_command_failed_t failed_event;
+   mongoc_server_description_t *sd;
+   mongoc_host_list_t host;
+   mongoc_buffer_t buffer;
+   mongoc_rpc_t rpc;
+   bson_t b;
+   bool ret = false;
+
+   ENTRY;
+
+   cid = (mongoc_cursor_cursorid_t *)cursor->iface_data;
+   BSON_ASSERT (cid);
+   BSON_ASSERT (cid->in_flight);
+
+   client = cursor->client;
+   cluster = &client->cluster;
+   callbacks = &client->apm_callbacks;
+
+   /* clear first, fetching the stream must not try to drain us again */
+   cid->in_flight = false;
+   client->in_flight_cursor = NULL;
+   memset (&cid->prefetch_error, 0, sizeof cid->prefetch_error);
+
+   server_stream = mongoc_cluster_stream_for_server (cluster,
+                                                     cursor->server_id,
+                                                     false /* reconnect_ok */,
+                                                     &cid->prefetch_error);
+
+   if (!server_stream) {
+      /* the connection was closed or the server removed since the send,
+       * the getMore still failed */
+      if (callbacks->failed) {
+         memset (&host, 0, sizeof host);
+         sd = mongoc_topology_server_by_id (client->topology,
+                                            cursor->server_id, NULL);
+         if (sd) {
+            host = sd->host;
+            mongoc_server_description_destroy (sd);
+         }
+
+         mongoc_apm_command_failed_init (&failed_event,
+                                         bson_get_monotonic_time () -
+                                            cid->in_flight_started,
+                                         "getMore",
+                                         &cid->prefetch_error,
+                                         cid->in_flight_request_id,
+                                         cursor->operation_id,
+                                         &host,
+                                         cursor->server_id,
+                                         client->apm_context);
+
+         callbacks->failed (&failed_event);
+         mongoc_apm_command_failed_cleanup (&failed_event);
+      }
+
+      RETURN (false);
+   }
+
+   _mongoc_buffer_init (&buffer, NULL, 0, NULL, NULL);
+
+   if (!_mongoc_client_recv (client, &rpc, &buffer, server_stream,
+                             &cid->prefetch_error)) {
+      GOTO (done);
+   }
+
+   if (rpc.header.opcode != MONGOC_OPCODE_REPLY ||
+       rpc.header.response_to != cid->in_flight_request_id ||
+       !_mongoc_rpc_reply_get_first (&rpc.reply, &b)) {
+      bson_set_error (&cid->prefetch_error,
+                      MONGOC_ERROR_PROTOCOL,
+                      MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                      "Invalid reply to getMore command.");
+      mongoc_cluster_disconnect_node (cluster, server_stream->sd->id);
+      GOTO (done);
+   }
+
+   if (_mongoc_populate_cmd_error (&b, client->error_api_version,
+                                   &cid->prefetch_error)) {
+      GOTO (done);
+   }
+
+   bson_destroy (&cid->prefetched);
+   bson_copy_to (&b, &cid->prefetched);
+   cid->has_prefetched = true;
+   ret = true;
+
+   if (callbacks->succeeded) {
+      mongoc_apm_command_succeeded_init (&succeeded_event,
+                                         bson_get_monotonic_time () -
+                                            cid->in_flight_started,
+                                         &b,
+                                         "getMore",
+                                         cid->in_flight_request_id,
+                                         cursor->operation_id,
+                                         &server_stream->sd->host,
+                                         server_stream->sd->id,
+                                         client->apm_context);
+
+      callbacks->succeeded (&succeeded_event);
+      mongoc_apm_command_succeeded_cleanup (&succeeded_event);
+   }
+
+done:
+   if (!ret && callbacks->failed) {
+      mongoc_apm_command_failed_init (&failed_event,
+                                      bson_get_monotonic_time () -
+                                         cid->in_flight_started,
+                                      "getMore",
+                                      &cid->prefetch_error,
+                                      cid->in_flight_request_id,
+                                      cursor->operation_id,
+                                      &server_stream->sd->host,
+                                      server_stream->sd->id,
+                                      client->apm_context);
+
+      callbacks->failed (&failed_event);
+      mongoc_apm_command_failed_cleanup (&failed_event);
+   }
+
+   _mongoc_buffer_destroy (&buffer);
+   mongoc_server_stream_cleanup (server_stream);
+
+   RETURN (ret);
+}
+
+
 static void
 _mongoc_cursor_cursorid_read_from_batch (mongoc_cursor_t *cursor,
                                          const bson_t   **bson)
@@ -176,6 +507,8 @@ _mongoc_cursor_prepare_getmore_command (mongoc_cursor_t *cursor,
 {
    const char *collection;
    int collection_len;
+   int64_t max_time_ms;
+   int64_t remaining;
 
    ENTRY;
 
@@ -199,7 +532,15 @@ _mongoc_cursor_prepare_getmore_command (mongoc_cursor_t *cursor,
    if (cursor->flags & MONGOC_QUERY_TAILABLE_CURSOR &&
        cursor->flags & MONGOC_QUERY_AWAIT_DATA &&
        cursor->max_await_time_ms) {
-      bson_append_int32 (command, "maxTimeMS", 9, cursor->max_await_time_ms);
+      max_time_ms = cursor->max_await_time_ms;
+
+      /* don't await data past the operation's deadline */
+      remaining = mongoc_cluster_remaining_msec (&cursor->client->cluster);
+      if (remaining > 0 && remaining < max_time_ms) {
+         max_time_ms = remaining;
+      }
+
+      bson_append_int32 (command, "maxTimeMS", 9, (int32_t) max_time_ms);
    }
 
    RETURN (true);
@@ -219,6 +560,31 @@ _mongoc_cursor_cursorid_get_more (mongoc_cursor_t *cursor)
    cid = (mongoc_cursor_cursorid_t *)cursor->iface_data;
    BSON_ASSERT (cid);
 
+   if (cid->in_flight) {
+      _mongoc_cursor_cursorid_recv_prefetch (cursor);
+   }
+
+   if (cid->has_prefetched) {
+      cid->has_prefetched = false;
+      bson_destroy (&cid->array);
+      bson_steal (&cid->array, &cid->prefetched);
+      bson_init (&cid->prefetched);
+
+      if (!_mongoc_cursor_cursorid_start_batch (cursor)) {
+         bson_set_error (&cursor->error,
+                         MONGOC_ERROR_PROTOCOL,
+                         MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                         "Invalid reply to getMore command.");
+         RETURN (false);
+      }
+
+      _mongoc_cursor_cursorid_prefetch (cursor);
+      RETURN (true);
+   } else if (cid->prefetch_error.domain) {
+      memcpy (&cursor->error, &cid->prefetch_error, sizeof cursor->error);
+      RETURN (false);
+   }
+
    server_stream = _mongoc_cursor_fetch_stream (cursor);
 
    if (!server_stream) {
@@ -303,6 +669,42 @@ done:
 }
 
 
+static size_t
+_mongoc_cursor_cursorid_read_batch (mongoc_cursor_t *cursor,
+                                    size_t           n,
+                                    size_t           max)
+{
+   mongoc_cursor_cursorid_t *cid;
+   const uint8_t *data = NULL;
+   uint32_t data_len = 0;
+
+   cid = (mongoc_cursor_cursorid_t *)cursor->iface_data;
+   BSON_ASSERT (cid);
+
+   if (cid->in_batch) {
+      while (n < max) {
+         if (!bson_iter_next (&cid->batch_iter) ||
+             !BSON_ITER_HOLDS_DOCUMENT (&cid->batch_iter)) {
+            cid->in_batch = false;
+            break;
+         }
+
+         bson_iter_document (&cid->batch_iter, &data_len, &data);
+         _mongoc_cursor_batch_append (cursor, n++, data, data_len);
+      }
+
+      if (data && bson_init_static (&cid->current_doc, data, data_len)) {
+         cursor->current = &cid->current_doc;
+      }
+   } else if (cid->in_reader) {
+      n = _mongoc_read_batch_from_buffer (cursor, n, max);
+      cid->in_reader = !cursor->end_of_event;
+   }
+
+   return n;
+}
+
+
 static mongoc_cursor_t *
 _mongoc_cursor_cursorid_clone (const mongoc_cursor_t *cursor)
 {
@@ -322,6 +724,9 @@ static mongoc_cursor_interface_t gMongocCursorCursorid = {
    _mongoc_cursor_cursorid_destroy,
    NULL,
    _mongoc_cursor_cursorid_next,
+   NULL,
+   NULL,
+   _mongoc_cursor_cursorid_read_batch,
 };
 
 
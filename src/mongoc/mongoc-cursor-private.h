@@ -45,6 +45,11 @@ struct _mongoc_cursor_interface_t
                                  bson_error_t           *error);
    void             (*get_host) (mongoc_cursor_t        *cursor,
                                  mongoc_host_list_t     *host);
+   /* appends the rest of the current batch to cursor->batch from index n,
+    * up to max documents in all, never fetches another; returns the count */
+   size_t           (*read_batch) (mongoc_cursor_t      *cursor,
+                                   size_t                n,
+                                   size_t                max);
 };
 
 
@@ -60,6 +65,7 @@ struct _mongoc_cursor_t
    unsigned                   end_of_event    : 1;
    unsigned                   has_fields      : 1;
    unsigned                   in_exhaust      : 1;
+   unsigned                   prefetch        : 1;
 
    bson_t                     query;
    bson_t                     fields;
@@ -74,6 +80,10 @@ struct _mongoc_cursor_t
    uint32_t                   batch_size;
    uint32_t                   max_await_time_ms;
 
+   /* 0 for none; the deadline is set by the first mongoc_cursor_next */
+   uint32_t                   operation_timeout_ms;
+   int64_t                    operation_expire_at;
+
    char                       ns [140];
    uint32_t                   nslen;
    uint32_t                   dblen;
@@ -89,7 +99,19 @@ struct _mongoc_cursor_t
    mongoc_cursor_interface_t  iface;
    void                      *iface_data;
 
+   /* applied to each document whatever the interface, may be NULL */
+   struct _mongoc_cursor_transform_t *transform;
+
    int64_t                    operation_id;
+
+   /* views returned by mongoc_cursor_next_batch */
+   mongoc_doc_view_t         *batch;
+   size_t                     batch_alloc;
+
+   /* the query's key and documents so far, if its result will be cached */
+   bson_t                    *cache_key;
+   bson_t                    *cache_docs;
+   int64_t                    cache_generation;
 };
 
 
@@ -112,6 +134,14 @@ mongoc_cursor_t         *_mongoc_cursor_clone         (const mongoc_cursor_t
 void                     _mongoc_cursor_destroy       (mongoc_cursor_t              *cursor);
 bool                     _mongoc_read_from_buffer     (mongoc_cursor_t              *cursor,
                                                        const bson_t                **bson);
+size_t                   _mongoc_read_batch_from_buffer
+                                                      (mongoc_cursor_t              *cursor,
+                                                       size_t                        n,
+                                                       size_t                        max);
+void                     _mongoc_cursor_batch_append  (mongoc_cursor_t              *cursor,
+                                                       size_t                        n,
+                                                       const uint8_t                *data,
+                                                       uint32_t                      len);
 bool                     _use_find_command            (const mongoc_cursor_t        *cursor,
                                                        const mongoc_server_stream_t *server_stream);
 mongoc_server_stream_t * _mongoc_cursor_fetch_stream  (mongoc_cursor_t              *cursor);
@@ -123,6 +153,12 @@ bool                     _mongoc_cursor_op_getmore    (mongoc_cursor_t
 bool                     _mongoc_cursor_run_command   (mongoc_cursor_t              *cursor,
                                                        const bson_t                 *command,
                                                        bson_t                       *reply);
+void                     _mongoc_cursor_use_query_cache
+                                                      (mongoc_cursor_t              *cursor,
+                                                       const bson_t                 *query,
+                                                       const bson_t                 *fields);
+void                     _mongoc_cursor_drain_hedge_loser
+                                                      (mongoc_client_t              *client);
 bool                     _mongoc_cursor_more          (mongoc_cursor_t              *cursor);
 bool                     _mongoc_cursor_next          (mongoc_cursor_t              *cursor,
                                                        const bson_t                **bson);
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_CURSOR_REAPER_PRIVATE_H
+#define MONGOC_CURSOR_REAPER_PRIVATE_H
+
+#if !defined (MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-array-private.h"
+#include "mongoc-client.h"
+#include "mongoc-client-pool.h"
+#include "mongoc-thread-private.h"
+
+
+BSON_BEGIN_DECLS
+
+
+/* cursor ids to kill with one killCursors command */
+typedef struct
+{
+   uint32_t       server_id;
+   char           ns[MONGOC_NAMESPACE_MAX];
+   mongoc_array_t cursor_ids;  /* int64_t */
+} mongoc_cursor_reaper_batch_t;
+
+
+/* shared by the clients of a pool, all access is under the mutex */
+typedef struct _mongoc_cursor_reaper_t
+{
+   mongoc_mutex_t        mutex;
+   mongoc_cond_t         cond;
+   mongoc_client_pool_t *pool;
+   int32_t               interval_msec;  /* 0 if disabled */
+   bool                  running;
+   bool                  shutdown_requested;
+   mongoc_thread_t       thread;
+   mongoc_array_t        batches;        /* mongoc_cursor_reaper_batch_t */
+} mongoc_cursor_reaper_t;
+
+
+mongoc_cursor_reaper_t *_mongoc_cursor_reaper_new          (mongoc_client_pool_t   *pool);
+void                    _mongoc_cursor_reaper_destroy      (mongoc_cursor_reaper_t *reaper);
+void                    _mongoc_cursor_reaper_set_interval (mongoc_cursor_reaper_t *reaper,
+                                                            int32_t                 interval_msec);
+bool                    _mongoc_cursor_reaper_add          (mongoc_cursor_reaper_t *reaper,
+                                                            uint32_t                server_id,
+                                                            const char             *ns,
+                                                            int64_t                 cursor_id);
+void                    _mongoc_cursor_reaper_flush        (mongoc_cursor_reaper_t *reaper);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_CURSOR_REAPER_PRIVATE_H */
@@ -0,0 +1,266 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+
+#include "mongoc-client-private.h"
+#include "mongoc-cursor-reaper-private.h"
+#include "mongoc-trace.h"
+
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "cursor-reaper"
+
+
+mongoc_cursor_reaper_t *
+_mongoc_cursor_reaper_new (mongoc_client_pool_t *pool)
+{
+   mongoc_cursor_reaper_t *reaper;
+
+   BSON_ASSERT (pool);
+
+   reaper = (mongoc_cursor_reaper_t *)bson_malloc0 (sizeof *reaper);
+   mongoc_mutex_init (&reaper->mutex);
+   mongoc_cond_init (&reaper->cond);
+   reaper->pool = pool;
+   _mongoc_array_init (&reaper->batches,
+                       sizeof (mongoc_cursor_reaper_batch_t));
+
+   return reaper;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cursor_reaper_run --
+ *
+ *       The reaper thread runs in this loop, killing the queued cursors
+ *       once per interval until the pool is destroyed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void *
+_mongoc_cursor_reaper_run (void *data)
+{
+   mongoc_cursor_reaper_t *reaper = (mongoc_cursor_reaper_t *)data;
+
+   mongoc_mutex_lock (&reaper->mutex);
+
+   while (!reaper->shutdown_requested) {
+      /* once disabled, still drain what was queued before */
+      mongoc_cond_timedwait (&reaper->cond, &reaper->mutex,
+                             reaper->interval_msec ? reaper->interval_msec
+                                                   : 1000);
+
+      if (reaper->shutdown_requested) {
+         break;
+      }
+
+      mongoc_mutex_unlock (&reaper->mutex);
+      _mongoc_cursor_reaper_flush (reaper);
+      mongoc_mutex_lock (&reaper->mutex);
+   }
+
+   mongoc_mutex_unlock (&reaper->mutex);
+
+   return NULL;
+}
+
+
+void
+_mongoc_cursor_reaper_destroy (mongoc_cursor_reaper_t *reaper)
+{
+   if (!reaper) {
+      return;
+   }
+
+   mongoc_mutex_lock (&reaper->mutex);
+   reaper->shutdown_requested = true;
+   mongoc_cond_signal (&reaper->cond);
+   mongoc_mutex_unlock (&reaper->mutex);
+
+   if (reaper->running) {
+      mongoc_thread_join (reaper->thread);
+   }
+
+   /* don't leave cursors open on the server until they time out */
+   _mongoc_cursor_reaper_flush (reaper);
+
+   _mongoc_array_destroy (&reaper->batches);
+   mongoc_cond_destroy (&reaper->cond);
+   mongoc_mutex_destroy (&reaper->mutex);
+   bson_free (reaper);
+}
+
+
+void
+_mongoc_cursor_reaper_set_interval (mongoc_cursor_reaper_t *reaper,
+                                    int32_t                 interval_msec)
+{
+   BSON_ASSERT (reaper);
+
+   mongoc_mutex_lock (&reaper->mutex);
+
+   reaper->interval_msec = BSON_MAX (interval_msec, 0);
+
+   if (reaper->interval_msec && !reaper->running) {
+      reaper->running = true;
+      mongoc_thread_create (&reaper->thread, _mongoc_cursor_reaper_run,
+                            reaper);
+   }
+
+   mongoc_mutex_unlock (&reaper->mutex);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cursor_reaper_add --
+ *
+ *       Queue a cursor to be killed by the reaper thread.
+ *
+ * Returns:
+ *       false if deferred killCursors is disabled, and the caller must
+ *       kill the cursor itself.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_cursor_reaper_add (mongoc_cursor_reaper_t *reaper,
+                           uint32_t                server_id,
+                           const char             *ns,
+                           int64_t                 cursor_id)
+{
+   mongoc_cursor_reaper_batch_t *batch = NULL;
+   mongoc_cursor_reaper_batch_t new_batch;
+   size_t i;
+
+   BSON_ASSERT (reaper);
+   BSON_ASSERT (ns);
+
+   mongoc_mutex_lock (&reaper->mutex);
+
+   if (!reaper->interval_msec) {
+      mongoc_mutex_unlock (&reaper->mutex);
+      return false;
+   }
+
+   for (i = 0; i < reaper->batches.len; i++) {
+      batch = &_mongoc_array_index (&reaper->batches,
+                                    mongoc_cursor_reaper_batch_t, i);
+
+      if (batch->server_id == server_id && !strcmp (batch->ns, ns)) {
+         break;
+      }
+
+      batch = NULL;
+   }
+
+   if (!batch) {
+      new_batch.server_id = server_id;
+      bson_strncpy (new_batch.ns, ns, sizeof new_batch.ns);
+      _mongoc_array_init (&new_batch.cursor_ids, sizeof (int64_t));
+      _mongoc_array_append_val (&reaper->batches, new_batch);
+      batch = &_mongoc_array_index (&reaper->batches,
+                                    mongoc_cursor_reaper_batch_t,
+                                    reaper->batches.len - 1);
+   }
+
+   _mongoc_array_append_val (&batch->cursor_ids, cursor_id);
+
+   mongoc_mutex_unlock (&reaper->mutex);
+
+   return true;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cursor_reaper_flush --
+ *
+ *       Kill the queued cursors, one killCursors per server and
+ *       namespace, on a client borrowed from the pool. If every client
+ *       is in use the cursors stay queued for the next flush.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_cursor_reaper_flush (mongoc_cursor_reaper_t *reaper)
+{
+   mongoc_cursor_reaper_batch_t *batch;
+   mongoc_client_t *client;
+   mongoc_array_t batches;
+   char db[MONGOC_NAMESPACE_MAX];
+   const char *dot;
+   bool empty;
+   size_t i;
+
+   ENTRY;
+
+   mongoc_mutex_lock (&reaper->mutex);
+   empty = !reaper->batches.len;
+   mongoc_mutex_unlock (&reaper->mutex);
+
+   if (empty) {
+      EXIT;
+   }
+
+   client = mongoc_client_pool_try_pop (reaper->pool);
+
+   if (!client) {
+      EXIT;
+   }
+
+   mongoc_mutex_lock (&reaper->mutex);
+   memcpy (&batches, &reaper->batches, sizeof batches);
+   _mongoc_array_init (&reaper->batches,
+                       sizeof (mongoc_cursor_reaper_batch_t));
+   mongoc_mutex_unlock (&reaper->mutex);
+
+   for (i = 0; i < batches.len; i++) {
+      batch = &_mongoc_array_index (&batches, mongoc_cursor_reaper_batch_t, i);
+      dot = strchr (batch->ns, '.');
+
+      if (dot) {
+         bson_strncpy (db, batch->ns, (size_t)(dot - batch->ns) + 1);
+      }
+
+      TRACE ("killing %d cursors on server %u",
+             (int)batch->cursor_ids.len, batch->server_id);
+
+      _mongoc_client_kill_cursors (client, batch->server_id,
+                                   (const int64_t *)batch->cursor_ids.data,
+                                   (uint32_t)batch->cursor_ids.len,
+                                   client->cluster.operation_id,
+                                   dot ? db : NULL,
+                                   dot ? dot + 1 : NULL,
+                                   true /* reconnect_ok */);
+
+      _mongoc_array_destroy (&batch->cursor_ids);
+   }
+
+   _mongoc_array_destroy (&batches);
+   mongoc_client_pool_push (reaper->pool, client);
+
+   EXIT;
+}
@@ -23,34 +23,44 @@
 
 #include <bson.h>
 
-#include "mongoc-cursor-private.h"
+#include "mongoc-cursor.h"
 
 
 BSON_BEGIN_DECLS
 
-typedef enum
+
+/* the context, shared by a cursor and its clones; the last one frees it */
+typedef struct
 {
-   MONGO_CURSOR_TRANSFORM_DROP,
-   MONGO_CURSOR_TRANSFORM_PASS,
-   MONGO_CURSOR_TRANSFORM_MUTATE,
-} mongoc_cursor_transform_mode_t;
+   volatile int32_t                 refs;
+   mongoc_cursor_transform_dtor_t   dtor;
+   void                            *ctx;
+} mongoc_cursor_transform_ctx_t;
 
-typedef mongoc_cursor_transform_mode_t
-(*mongoc_cursor_transform_filter_t)(const bson_t *bson,
-                                    void         *ctx);
 
-typedef void (*mongoc_cursor_transform_mutate_t)(const bson_t *bson,
-                                                 bson_t       *out,
-                                                 void         *ctx);
+typedef struct _mongoc_cursor_transform_t
+{
+   mongoc_cursor_transform_filter_t filter;
+   mongoc_cursor_transform_mutate_t mutate;
+   mongoc_cursor_transform_ctx_t   *shared;
+   bson_t                           tmp;
+} mongoc_cursor_transform_t;
 
-typedef void (*mongoc_cursor_transform_dtor_t)(void *ctx);
 
 void
-_mongoc_cursor_transform_init (mongoc_cursor_t                 *cursor,
-                               mongoc_cursor_transform_filter_t filter,
-                               mongoc_cursor_transform_mutate_t mutate,
-                               mongoc_cursor_transform_dtor_t   dtor,
-                               void                            *ctx);
+_mongoc_cursor_transform_init    (mongoc_cursor_t                 *cursor,
+                                  mongoc_cursor_transform_filter_t filter,
+                                  mongoc_cursor_transform_mutate_t mutate,
+                                  mongoc_cursor_transform_dtor_t   dtor,
+                                  void                            *ctx);
+void
+_mongoc_cursor_transform_clone   (mongoc_cursor_t                 *cursor,
+                                  mongoc_cursor_transform_t       *transform);
+bool
+_mongoc_cursor_transform_apply   (mongoc_cursor_transform_t       *transform,
+                                  const bson_t                   **bson);
+void
+_mongoc_cursor_transform_destroy (mongoc_cursor_transform_t       *transform);
 
 
 BSON_END_DECLS
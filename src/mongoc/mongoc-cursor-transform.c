@@ -18,11 +18,6 @@
 #include "mongoc-cursor.h"
 #include "mongoc-cursor-transform-private.h"
 #include "mongoc-cursor-private.h"
-#include "mongoc-client-private.h"
-#include "mongoc-counters-private.h"
-#include "mongoc-error.h"
-#include "mongoc-log.h"
-#include "mongoc-opcode.h"
 #include "mongoc-trace.h"
 
 
@@ -30,17 +25,7 @@
 #define MONGOC_LOG_DOMAIN "cursor-transform"
 
 
-typedef struct
-{
-   mongoc_cursor_transform_filter_t filter;
-   mongoc_cursor_transform_mutate_t mutate;
-   mongoc_cursor_transform_dtor_t   dtor;
-   void                            *ctx;
-   bson_t                           tmp;
-} mongoc_cursor_transform_t;
-
-
-static void *
+static mongoc_cursor_transform_t *
 _mongoc_cursor_transform_new (mongoc_cursor_transform_filter_t filter,
                               mongoc_cursor_transform_mutate_t mutate,
                               mongoc_cursor_transform_dtor_t   dtor,
@@ -54,99 +39,106 @@ _mongoc_cursor_transform_new (mongoc_cursor_transform_filter_t filter,
 
    transform->filter = filter;
    transform->mutate = mutate;
-   transform->dtor = dtor;
-   transform->ctx = ctx;
+   transform->shared = (mongoc_cursor_transform_ctx_t *)bson_malloc0 (
+      sizeof *transform->shared);
+   transform->shared->refs = 1;
+   transform->shared->dtor = dtor;
+   transform->shared->ctx = ctx;
    bson_init (&transform->tmp);
 
    RETURN (transform);
 }
 
 
-static void
-_mongoc_cursor_transform_destroy (mongoc_cursor_t *cursor)
+void
+_mongoc_cursor_transform_destroy (mongoc_cursor_transform_t *transform)
 {
-   mongoc_cursor_transform_t *transform;
-
    ENTRY;
 
-   transform = (mongoc_cursor_transform_t *)cursor->iface_data;
+   if (!transform) {
+      EXIT;
+   }
+
+   if (bson_atomic_int_add (&transform->shared->refs, -1) == 0) {
+      if (transform->shared->dtor) {
+         transform->shared->dtor (transform->shared->ctx);
+      }
 
-   if (transform->dtor) {
-      transform->dtor (transform->ctx);
+      bson_free (transform->shared);
    }
 
    bson_destroy (&transform->tmp);
-
-   bson_free (cursor->iface_data);
-   _mongoc_cursor_destroy (cursor);
+   bson_free (transform);
 
    EXIT;
 }
 
 
-static bool
-_mongoc_cursor_transform_next (mongoc_cursor_t *cursor,
-                               const bson_t   **bson)
+/* give @cursor, a clone, the same transform, sharing its context */
+void
+_mongoc_cursor_transform_clone (mongoc_cursor_t           *cursor,
+                                mongoc_cursor_transform_t *transform)
 {
-   mongoc_cursor_transform_t *transform;
-
    ENTRY;
 
-   transform = (mongoc_cursor_transform_t *)cursor->iface_data;
+   _mongoc_cursor_transform_destroy (cursor->transform);
+   cursor->transform = (mongoc_cursor_transform_t *)bson_malloc0 (
+      sizeof *cursor->transform);
 
-   for (;; ) {
-      if (!_mongoc_cursor_next (cursor, bson)) {
-         RETURN (false);
-      }
+   cursor->transform->filter = transform->filter;
+   cursor->transform->mutate = transform->mutate;
+   cursor->transform->shared = transform->shared;
+   bson_init (&cursor->transform->tmp);
+   bson_atomic_int_add (&transform->shared->refs, 1);
 
-      switch (transform->filter (*bson, transform->ctx)) {
-      case MONGO_CURSOR_TRANSFORM_DROP:
-         break;
-      case MONGO_CURSOR_TRANSFORM_PASS:
-         RETURN (true);
-         break;
-      case MONGO_CURSOR_TRANSFORM_MUTATE:
-         bson_reinit (&transform->tmp);
-
-         transform->mutate (*bson, &transform->tmp, transform->ctx);
-         *bson = &transform->tmp;
-         RETURN (true);
-
-         break;
-      default:
-         abort ();
-         break;
-      }
-   }
+   EXIT;
 }
 
 
-static mongoc_cursor_t *
-_mongoc_cursor_transform_clone (const mongoc_cursor_t *cursor)
-{
-   mongoc_cursor_transform_t *transform;
-   mongoc_cursor_t *clone_;
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cursor_transform_apply --
+ *
+ *       Run the filter on a document the cursor's interface returned,
+ *       replacing @bson with the mutated document if need be.
+ *
+ * Returns:
+ *       false if the document is dropped, and the cursor must read the
+ *       next one.
+ *
+ *--------------------------------------------------------------------------
+ */
 
+bool
+_mongoc_cursor_transform_apply (mongoc_cursor_transform_t *transform,
+                                const bson_t             **bson)
+{
    ENTRY;
 
-   transform = (mongoc_cursor_transform_t *)cursor->iface_data;
-
-   clone_ = _mongoc_cursor_clone (cursor);
-   _mongoc_cursor_transform_init (clone_, transform->filter, transform->mutate,
-                                  transform->dtor, transform->ctx);
-
-   RETURN (clone_);
+   switch (transform->filter (*bson, transform->shared->ctx)) {
+   case MONGOC_CURSOR_TRANSFORM_DROP:
+      RETURN (false);
+   case MONGOC_CURSOR_TRANSFORM_PASS:
+      RETURN (true);
+   case MONGOC_CURSOR_TRANSFORM_MUTATE:
+      bson_reinit (&transform->tmp);
+
+      transform->mutate (*bson, &transform->tmp, transform->shared->ctx);
+      *bson = &transform->tmp;
+      RETURN (true);
+   default:
+      abort ();
+      break;
+   }
 }
 
 
-static mongoc_cursor_interface_t gMongocCursorArray = {
-   _mongoc_cursor_transform_clone,
-   _mongoc_cursor_transform_destroy,
-   NULL,
-   _mongoc_cursor_transform_next,
-};
-
-
+/*
+ * The transform sits beside the cursor's interface rather than replacing
+ * it, so it also applies to a "find" command cursor, which only installs
+ * its interface once it knows the server's wire version.
+ */
 void
 _mongoc_cursor_transform_init (mongoc_cursor_t                 *cursor,
                                mongoc_cursor_transform_filter_t filter,
@@ -156,10 +148,36 @@ _mongoc_cursor_transform_init (mongoc_cursor_t                 *cursor,
 {
    ENTRY;
 
-   cursor->iface_data = _mongoc_cursor_transform_new (filter, mutate, dtor, ctx);
-
-   memcpy (&cursor->iface, &gMongocCursorArray,
-           sizeof (mongoc_cursor_interface_t));
+   _mongoc_cursor_transform_destroy (cursor->transform);
+   cursor->transform = _mongoc_cursor_transform_new (filter, mutate, dtor, ctx);
 
    EXIT;
 }
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cursor_set_transform --
+ *
+ *       Filter or rewrite the documents the cursor returns. @filter is
+ *       called on each one; @mutate is called only when the filter
+ *       returns MONGOC_CURSOR_TRANSFORM_MUTATE. @dtor, if not NULL, is
+ *       called with @ctx once the cursor and all its clones are destroyed
+ *       or given another transform; clones share @ctx.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_cursor_set_transform (mongoc_cursor_t                 *cursor,
+                             mongoc_cursor_transform_filter_t filter,
+                             mongoc_cursor_transform_mutate_t mutate,
+                             mongoc_cursor_transform_dtor_t   dtor,
+                             void                            *ctx)
+{
+   BSON_ASSERT (cursor);
+   BSON_ASSERT (filter);
+
+   _mongoc_cursor_transform_init (cursor, filter, mutate, dtor, ctx);
+}
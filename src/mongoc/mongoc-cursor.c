@@ -21,8 +21,14 @@
 #include "mongoc-counters-private.h"
 #include "mongoc-error.h"
 #include "mongoc-log.h"
+#include "mongoc-memory-private.h"
 #include "mongoc-trace.h"
+#include "mongoc-trace-private.h"
+#include "mongoc-cursor-array-private.h"
 #include "mongoc-cursor-cursorid-private.h"
+#include "mongoc-cursor-reaper-private.h"
+#include "mongoc-cursor-transform-private.h"
+#include "mongoc-query-cache-private.h"
 #include "mongoc-read-concern-private.h"
 #include "mongoc-util-private.h"
 
@@ -127,7 +133,8 @@ _mongoc_cursor_new (mongoc_client_t           *client,
       read_prefs = client->read_prefs;
    }
 
-   cursor = (mongoc_cursor_t *)bson_malloc0 (sizeof *cursor);
+   cursor = (mongoc_cursor_t *)_mongoc_malloc0 (MONGOC_MEMORY_CURSORS,
+                                                sizeof *cursor);
 
    /*
     * Cursors execute their query lazily. This sadly means that we must copy
@@ -294,14 +301,22 @@ _mongoc_cursor_destroy (mongoc_cursor_t *cursor)
                                          cursor->server_id);
       }
    } else if (cursor->rpc.reply.cursor_id) {
-      bson_strncpy (db, cursor->ns, cursor->dblen + 1);
-
-      _mongoc_client_kill_cursor(cursor->client,
-                                 cursor->server_id,
-                                 cursor->rpc.reply.cursor_id,
-                                 cursor->operation_id,
-                                 db,
-                                 cursor->ns + cursor->dblen + 1);
+      /* with a pool's reaper enabled, killCursors is batched and sent later
+       * from its thread, not on this one */
+      if (!cursor->client->cursor_reaper ||
+          !_mongoc_cursor_reaper_add (cursor->client->cursor_reaper,
+                                      cursor->server_id,
+                                      cursor->ns,
+                                      cursor->rpc.reply.cursor_id)) {
+         bson_strncpy (db, cursor->ns, cursor->dblen + 1);
+
+         _mongoc_client_kill_cursor(cursor->client,
+                                    cursor->server_id,
+                                    cursor->rpc.reply.cursor_id,
+                                    cursor->operation_id,
+                                    db,
+                                    cursor->ns + cursor->dblen + 1);
+      }
    }
 
    if (cursor->reader) {
@@ -309,13 +324,21 @@ _mongoc_cursor_destroy (mongoc_cursor_t *cursor)
       cursor->reader = NULL;
    }
 
+   if (cursor->cache_key) {
+      bson_destroy (cursor->cache_key);
+      bson_destroy (cursor->cache_docs);
+   }
+
+   bson_free (cursor->batch);
+   _mongoc_cursor_transform_destroy (cursor->transform);
+
    bson_destroy(&cursor->query);
    bson_destroy(&cursor->fields);
    _mongoc_buffer_destroy(&cursor->buffer);
    mongoc_read_prefs_destroy(cursor->read_prefs);
    mongoc_read_concern_destroy(cursor->read_concern);
 
-   bson_free(cursor);
+   _mongoc_free (MONGOC_MEMORY_CURSORS, cursor);
 
    mongoc_counter_cursors_active_dec();
    mongoc_counter_cursors_disposed_inc();
@@ -495,6 +518,9 @@ _mongoc_cursor_monitor_succeeded (mongoc_cursor_t        *cursor,
 
    client = cursor->client;
 
+   MONGOC_PROBE3 (cursor_batch, cursor, mongoc_cursor_get_id (cursor),
+                  first_batch);
+
    if (!client->apm_callbacks.succeeded) {
       EXIT;
    }
@@ -727,6 +753,444 @@ failure:
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cursor_hedge_delay --
+ *
+ *       How long to wait for @server_stream's reply to @command before
+ *       sending it to a second server too, if the cursor's read
+ *       preference enables hedged reads.
+ *
+ *       Only the first batch of a "find" or "aggregate" with mode
+ *       secondaryPreferred or nearest is hedged: the command has no side
+ *       effects, and any suitable server may answer it.
+ *
+ * Returns:
+ *       The delay in milliseconds, or -1 not to hedge.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static int32_t
+_mongoc_cursor_hedge_delay (mongoc_cursor_t              *cursor,
+                            const bson_t                 *command,
+                            const mongoc_server_stream_t *server_stream)
+{
+   const mongoc_read_prefs_t *prefs = cursor->read_prefs;
+   const char *command_name;
+   int64_t delay_usec;
+   int64_t latency_usec;
+
+   if (!prefs ||
+       (!prefs->hedge_delay_ms && !prefs->hedge_percentile) ||
+       (prefs->mode != MONGOC_READ_SECONDARY_PREFERRED &&
+        prefs->mode != MONGOC_READ_NEAREST) ||
+       cursor->client->in_exhaust) {
+      return -1;
+   }
+
+   command_name = _mongoc_get_command_name (command);
+
+   if (!command_name ||
+       (strcmp (command_name, "find") && strcmp (command_name, "aggregate"))) {
+      return -1;
+   }
+
+   delay_usec = (int64_t) prefs->hedge_delay_ms * 1000;
+
+   if (prefs->hedge_percentile) {
+      latency_usec = _mongoc_topology_latency_percentile (
+         cursor->client->topology, server_stream->sd->id,
+         prefs->hedge_percentile);
+
+      delay_usec = BSON_MAX (delay_usec, latency_usec);
+   }
+
+   /* percentile only, and no latency known yet */
+   if (delay_usec <= 0) {
+      return -1;
+   }
+
+   return (int32_t) BSON_MIN ((delay_usec + 999) / 1000, INT32_MAX);
+}
+
+
+/* send one server's copy of a hedged read, without waiting for the reply */
+static bool
+_mongoc_cursor_hedge_send (mongoc_cursor_t        *cursor,
+                           mongoc_server_stream_t *server_stream,
+                           const bson_t           *command,
+                           const char             *db,
+                           const char             *command_name,
+                           uint32_t               *request_id,
+                           int64_t                *started,
+                           bson_error_t           *error)
+{
+   mongoc_client_t *client = cursor->client;
+   mongoc_cluster_t *cluster = &client->cluster;
+   mongoc_apply_read_prefs_result_t read_prefs_result = READ_PREFS_RESULT_INIT;
+   mongoc_apm_callbacks_t *callbacks = &client->apm_callbacks;
+   mongoc_apm_command_started_t started_event;
+   mongoc_apm_command_failed_t failed_event;
+   char cmd_ns[MONGOC_NAMESPACE_MAX];
+   mongoc_rpc_t rpc;
+   const bson_t *cmd;
+   bson_t cmd_with_max_time;
+   bool ret;
+
+   /* as for other commands, see mongoc_cluster_run_command_monitored */
+   cmd = mongoc_cluster_apply_max_time_ms (cluster, command,
+                                           &cmd_with_max_time);
+
+   apply_read_preferences (cursor->read_prefs, server_stream,
+                           cmd, cursor->flags, &read_prefs_result);
+
+   bson_snprintf (cmd_ns, sizeof cmd_ns, "%s.$cmd", db);
+   *request_id = ++cluster->request_id;
+   _mongoc_rpc_prep_command (&rpc, cmd_ns,
+                             read_prefs_result.query_with_read_prefs,
+                             read_prefs_result.flags);
+   rpc.query.request_id = *request_id;
+
+   *started = bson_get_monotonic_time ();
+
+   if (callbacks->started) {
+      mongoc_apm_command_started_init (&started_event,
+                                       read_prefs_result.query_with_read_prefs,
+                                       db,
+                                       command_name,
+                                       *request_id,
+                                       cursor->operation_id,
+                                       &server_stream->sd->host,
+                                       server_stream->sd->id,
+                                       client->apm_context);
+
+      callbacks->started (&started_event);
+      mongoc_apm_command_started_cleanup (&started_event);
+   }
+
+   ret = mongoc_cluster_sendv_to_server (cluster, &rpc, 1, server_stream,
+                                         NULL, error);
+
+   if (!ret) {
+      /* a partial message may have been written */
+      mongoc_cluster_disconnect_node (cluster, server_stream->sd->id);
+
+      if (callbacks->failed) {
+         mongoc_apm_command_failed_init (&failed_event,
+                                         bson_get_monotonic_time () - *started,
+                                         command_name,
+                                         error,
+                                         *request_id,
+                                         cursor->operation_id,
+                                         &server_stream->sd->host,
+                                         server_stream->sd->id,
+                                         client->apm_context);
+
+         callbacks->failed (&failed_event);
+         mongoc_apm_command_failed_cleanup (&failed_event);
+      }
+   }
+
+   apply_read_prefs_result_cleanup (&read_prefs_result);
+
+   if (cmd == &cmd_with_max_time) {
+      bson_destroy (&cmd_with_max_time);
+   }
+
+   return ret;
+}
+
+
+/* read one server's reply to a hedged read; @reply is always initialized */
+static bool
+_mongoc_cursor_hedge_recv (mongoc_client_t        *client,
+                           mongoc_server_stream_t *server_stream,
+                           uint32_t                request_id,
+                           int64_t                 started,
+                           int64_t                 operation_id,
+                           const char             *command_name,
+                           bson_t                 *reply,
+                           bson_error_t           *error)
+{
+   mongoc_apm_callbacks_t *callbacks = &client->apm_callbacks;
+   mongoc_apm_command_succeeded_t succeeded_event;
+   mongoc_apm_command_failed_t failed_event;
+   mongoc_buffer_t buffer;
+   mongoc_rpc_t rpc;
+   int64_t duration;
+   bson_t b;
+   bool ret = false;
+
+   bson_init (reply);
+   _mongoc_buffer_init (&buffer, NULL, 0, NULL, NULL);
+
+   if (!_mongoc_client_recv (client, &rpc, &buffer, server_stream, error)) {
+      GOTO (done);
+   }
+
+   if (rpc.header.opcode != MONGOC_OPCODE_REPLY ||
+       rpc.header.response_to != (int32_t) request_id ||
+       !_mongoc_rpc_reply_get_first (&rpc.reply, &b)) {
+      bson_set_error (error,
+                      MONGOC_ERROR_PROTOCOL,
+                      MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                      "Invalid reply to %s command.",
+                      command_name);
+      mongoc_cluster_disconnect_node (&client->cluster, server_stream->sd->id);
+      GOTO (done);
+   }
+
+   bson_concat (reply, &b);
+
+   if (_mongoc_populate_cmd_error (reply, client->error_api_version, error)) {
+      GOTO (done);
+   }
+
+   ret = true;
+   duration = bson_get_monotonic_time () - started;
+   _mongoc_topology_record_latency (client->topology, server_stream->sd->id,
+                                    duration);
+
+   if (callbacks->succeeded) {
+      mongoc_apm_command_succeeded_init (&succeeded_event,
+                                         duration,
+                                         reply,
+                                         command_name,
+                                         request_id,
+                                         operation_id,
+                                         &server_stream->sd->host,
+                                         server_stream->sd->id,
+                                         client->apm_context);
+
+      callbacks->succeeded (&succeeded_event);
+      mongoc_apm_command_succeeded_cleanup (&succeeded_event);
+   }
+
+done:
+   if (!ret && callbacks->failed) {
+      mongoc_apm_command_failed_init (&failed_event,
+                                      bson_get_monotonic_time () - started,
+                                      command_name,
+                                      error,
+                                      request_id,
+                                      operation_id,
+                                      &server_stream->sd->host,
+                                      server_stream->sd->id,
+                                      client->apm_context);
+
+      callbacks->failed (&failed_event);
+      mongoc_apm_command_failed_cleanup (&failed_event);
+   }
+
+   _mongoc_buffer_destroy (&buffer);
+
+   return ret;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cursor_run_command_hedged --
+ *
+ *       Send @command to @server_stream. If no reply arrives within
+ *       @delay_msec, send it to another suitable server too and use
+ *       whichever reply arrives first.
+ *
+ *       The slower server's reply is not awaited: it is recorded in
+ *       client->hedge_loser, and read by _mongoc_cursor_drain_hedge_loser
+ *       before the client's next operation, which also kills the cursor
+ *       it opened.
+ *
+ * Returns:
+ *       true on success, false and cursor->error is set on failure.
+ *       @reply is always initialized.
+ *
+ * Side effects:
+ *       cursor->server_id is set to the server that answered.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_cursor_run_command_hedged (mongoc_cursor_t        *cursor,
+                                   mongoc_server_stream_t *server_stream,
+                                   const bson_t           *command,
+                                   const char             *db,
+                                   int32_t                 delay_msec,
+                                   bson_t                 *reply)
+{
+   mongoc_client_t *client = cursor->client;
+   mongoc_cluster_t *cluster = &client->cluster;
+   mongoc_server_stream_t *streams[2] = { server_stream, NULL };
+   mongoc_stream_poll_t poller[2];
+   mongoc_hedge_loser_t *loser;
+   const char *command_name;
+   uint32_t request_ids[2];
+   int64_t started[2];
+   uint32_t other_id;
+   bson_error_t error;
+   int winner = 0;
+   bool ret = false;
+
+   ENTRY;
+
+   command_name = _mongoc_get_command_name (command);
+
+   if (!_mongoc_cursor_hedge_send (cursor, streams[0], command, db,
+                                   command_name, &request_ids[0], &started[0],
+                                   &cursor->error)) {
+      bson_init (reply);
+      RETURN (false);
+   }
+
+   poller[0].stream = streams[0]->stream;
+   poller[0].events = POLLIN;
+   poller[0].revents = 0;
+
+   if (mongoc_stream_poll (poller, 1, delay_msec) == 0 &&
+       (other_id = _mongoc_topology_select_other (client->topology,
+                                                  cursor->read_prefs,
+                                                  streams[0]->sd->id))) {
+      /* no reply yet, ask another server */
+      streams[1] = mongoc_cluster_stream_for_server (cluster, other_id,
+                                                     true /* reconnect_ok */,
+                                                     &error);
+
+      if (streams[1] &&
+          _mongoc_cursor_hedge_send (cursor, streams[1], command, db,
+                                     command_name, &request_ids[1],
+                                     &started[1], &error)) {
+         poller[1].stream = streams[1]->stream;
+         poller[1].events = POLLIN;
+         poller[1].revents = 0;
+
+         /* on timeout or poll error, wait for the first server as usual */
+         if (mongoc_stream_poll (poller, 2, cluster->sockettimeoutms) > 0 &&
+             !poller[0].revents && poller[1].revents) {
+            winner = 1;
+         }
+      } else if (streams[1]) {
+         mongoc_server_stream_cleanup (streams[1]);
+         streams[1] = NULL;
+      }
+   }
+
+   ret = _mongoc_cursor_hedge_recv (client, streams[winner],
+                                    request_ids[winner], started[winner],
+                                    cursor->operation_id, command_name,
+                                    reply, &cursor->error);
+
+   if (streams[1] && !ret) {
+      /* the first reply was an error, try the other */
+      winner = !winner;
+      bson_destroy (reply);
+      memset (&cursor->error, 0, sizeof cursor->error);
+      ret = _mongoc_cursor_hedge_recv (client, streams[winner],
+                                       request_ids[winner], started[winner],
+                                       cursor->operation_id, command_name,
+                                       reply, &cursor->error);
+   } else if (streams[1]) {
+      loser = &client->hedge_loser;
+      loser->server_id = streams[!winner]->sd->id;
+      loser->request_id = request_ids[!winner];
+      loser->started = started[!winner];
+      loser->operation_id = cursor->operation_id;
+      bson_strncpy (loser->command_name, command_name,
+                    sizeof loser->command_name);
+   }
+
+   cursor->server_id = streams[winner]->sd->id;
+
+   if (streams[1]) {
+      mongoc_server_stream_cleanup (streams[1]);
+   }
+
+   RETURN (ret);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cursor_drain_hedge_loser --
+ *
+ *       Read the reply that lost a hedged read, and kill the cursor it
+ *       opened on the server, if any.
+ *
+ * Side effects:
+ *       Clears client->hedge_loser. Errors are ignored.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_cursor_drain_hedge_loser (mongoc_client_t *client)
+{
+   mongoc_hedge_loser_t loser;
+   mongoc_server_stream_t *server_stream;
+   bson_error_t error;
+   bson_iter_t iter;
+   bson_iter_t child;
+   const char *ns = NULL;
+   const char *dot = NULL;
+   char db[MONGOC_NAMESPACE_MAX];
+   int64_t cursor_id = 0;
+   bson_t reply;
+
+   ENTRY;
+
+   memcpy (&loser, &client->hedge_loser, sizeof loser);
+
+   /* clear first, fetching the stream must not try to drain us again */
+   memset (&client->hedge_loser, 0, sizeof client->hedge_loser);
+
+   server_stream = mongoc_cluster_stream_for_server (&client->cluster,
+                                                     loser.server_id,
+                                                     false /* reconnect_ok */,
+                                                     &error);
+
+   if (!server_stream) {
+      EXIT;
+   }
+
+   if (_mongoc_cursor_hedge_recv (client, server_stream, loser.request_id,
+                                  loser.started, loser.operation_id,
+                                  loser.command_name, &reply, &error) &&
+       bson_iter_init_find (&iter, &reply, "cursor") &&
+       BSON_ITER_HOLDS_DOCUMENT (&iter) &&
+       bson_iter_recurse (&iter, &child)) {
+      while (bson_iter_next (&child)) {
+         if (!strcmp (bson_iter_key (&child), "id")) {
+            cursor_id = bson_iter_as_int64 (&child);
+         } else if (!strcmp (bson_iter_key (&child), "ns") &&
+                    BSON_ITER_HOLDS_UTF8 (&child)) {
+            ns = bson_iter_utf8 (&child, NULL);
+         }
+      }
+   }
+
+   mongoc_server_stream_cleanup (server_stream);
+
+   if (cursor_id) {
+      if (ns && (dot = strchr (ns, '.'))) {
+         bson_strncpy (db, ns, BSON_MIN ((size_t) (dot - ns) + 1, sizeof db));
+      }
+
+      _mongoc_client_kill_cursor (client, loser.server_id, cursor_id,
+                                  loser.operation_id,
+                                  dot ? db : NULL,
+                                  dot ? dot + 1 : NULL);
+   }
+
+   bson_destroy (&reply);
+
+   EXIT;
+}
+
+
 bool
 _mongoc_cursor_run_command (mongoc_cursor_t *cursor,
                             const bson_t    *command,
@@ -736,6 +1200,7 @@ _mongoc_cursor_run_command (mongoc_cursor_t *cursor,
    mongoc_server_stream_t *server_stream;
    char db[MONGOC_NAMESPACE_MAX];
    mongoc_apply_read_prefs_result_t read_prefs_result = READ_PREFS_RESULT_INIT;
+   int32_t delay_msec;
    bool ret = false;
 
    ENTRY;
@@ -749,6 +1214,15 @@ _mongoc_cursor_run_command (mongoc_cursor_t *cursor,
    }
 
    bson_strncpy (db, cursor->ns, cursor->dblen + 1);
+
+   delay_msec = _mongoc_cursor_hedge_delay (cursor, command, server_stream);
+
+   if (delay_msec >= 0) {
+      ret = _mongoc_cursor_run_command_hedged (cursor, server_stream, command,
+                                               db, delay_msec, reply);
+      GOTO (done);
+   }
+
    apply_read_preferences (cursor->read_prefs, server_stream,
                            command, cursor->flags, &read_prefs_result);
 
@@ -962,17 +1436,21 @@ _mongoc_cursor_prepare_find_command (mongoc_cursor_t *cursor,
 static const bson_t *
 _mongoc_cursor_find_command (mongoc_cursor_t *cursor)
 {
-   bson_t command = BSON_INITIALIZER;
+   mongoc_scratch_t *scratch = &cursor->client->scratch;
+   bson_t *command;
    const bson_t *bson = NULL;
 
    ENTRY;
 
-   if (!_mongoc_cursor_prepare_find_command (cursor, &command)) {
+   command = _mongoc_scratch_bson (scratch);
+
+   if (!_mongoc_cursor_prepare_find_command (cursor, command)) {
+      _mongoc_scratch_bson_release (scratch, command);
       RETURN (NULL);
    }
 
-   _mongoc_cursor_cursorid_init (cursor, &command);
-   bson_destroy (&command);
+   _mongoc_cursor_cursorid_init (cursor, command);
+   _mongoc_scratch_bson_release (scratch, command);
 
    BSON_ASSERT (cursor->iface.next);
    _mongoc_cursor_cursorid_next (cursor, &bson);
@@ -1151,6 +1629,10 @@ _mongoc_cursor_op_getmore (mongoc_cursor_t        *cursor,
       cursor->rpc.reply.documents,
       (size_t)cursor->rpc.reply.documents_len);
 
+   _mongoc_topology_record_latency (cursor->client->topology,
+                                    server_stream->sd->id,
+                                    bson_get_monotonic_time () - started);
+
    _mongoc_cursor_monitor_succeeded (cursor,
                                      bson_get_monotonic_time () - started,
                                      false, /* not first batch */
@@ -1209,10 +1691,101 @@ _mongoc_cursor_error (mongoc_cursor_t *cursor,
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cursor_use_query_cache --
+ *
+ *       If the client's query cache holds the result of this query, make
+ *       @cursor an array cursor over the cached documents. Otherwise,
+ *       prepare to collect the documents as the cursor returns them, and
+ *       to cache them if it returns them all.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_cursor_use_query_cache (mongoc_cursor_t *cursor,
+                                const bson_t    *query,
+                                const bson_t    *fields)
+{
+   mongoc_query_cache_t *cache = cursor->client->query_cache;
+   bson_t result;
+   bson_t key;
+
+   ENTRY;
+
+   if (cursor->error.domain ||
+       cursor->is_command ||
+       cursor->flags & (MONGOC_QUERY_TAILABLE_CURSOR | MONGOC_QUERY_EXHAUST) ||
+       !_mongoc_query_cache_enabled (cache, cursor->ns)) {
+      EXIT;
+   }
+
+   _mongoc_query_cache_key (&key, "find", cursor->ns, query, fields,
+                            cursor->skip, cursor->limit, NULL, cursor->flags,
+                            cursor->read_prefs,
+                            cursor->read_concern ?
+                               cursor->read_concern->level : NULL);
+
+   if (_mongoc_query_cache_get (cache, &key, &result)) {
+      _mongoc_cursor_array_init (cursor, NULL, "documents");
+      _mongoc_cursor_array_set_cached (cursor, &result);
+      bson_destroy (&result);
+      bson_destroy (&key);
+   } else {
+      cursor->cache_generation = _mongoc_query_cache_generation (cache,
+                                                                 cursor->ns);
+      cursor->cache_key = bson_copy (&key);
+      cursor->cache_docs = bson_new ();
+      bson_destroy (&key);
+   }
+
+   EXIT;
+}
+
+
+/* collect @doc for the query cache, or when the cursor has returned all
+ * its documents, cache them */
+static void
+_mongoc_cursor_cache_fill (mongoc_cursor_t *cursor,
+                           const bson_t    *doc)
+{
+   mongoc_query_cache_t *cache = cursor->client->query_cache;
+   bson_error_t error;
+   const char *key;
+   char str[16];
+   bson_t result;
+
+   if (doc) {
+      bson_uint32_to_string (cursor->count, &key, str, sizeof str);
+      bson_append_document (cursor->cache_docs, key, -1, doc);
+
+      if (cursor->cache_docs->len <= _mongoc_query_cache_max_result (cache)) {
+         return;
+      }
+
+      /* too large to cache, stop collecting */
+   } else if (!mongoc_cursor_error (cursor, &error)) {
+      bson_init (&result);
+      bson_append_array (&result, "documents", 9, cursor->cache_docs);
+      _mongoc_query_cache_put (cache, cursor->cache_generation, cursor->ns,
+                               cursor->cache_key, &result);
+      bson_destroy (&result);
+   }
+
+   bson_destroy (cursor->cache_key);
+   bson_destroy (cursor->cache_docs);
+   cursor->cache_key = NULL;
+   cursor->cache_docs = NULL;
+}
+
+
 bool
 mongoc_cursor_next (mongoc_cursor_t  *cursor,
                     const bson_t    **bson)
 {
+   int64_t saved_deadline;
    bool ret;
 
    ENTRY;
@@ -1249,12 +1822,39 @@ mongoc_cursor_next (mongoc_cursor_t  *cursor,
       RETURN (false);
    }
 
-   if (cursor->iface.next) {
-      ret = cursor->iface.next(cursor, bson);
-   } else {
-      ret = _mongoc_cursor_next(cursor, bson);
+   /* the timeout covers all of the cursor's round trips, but a tailable
+    * cursor may wait for new data indefinitely so its timeout restarts */
+   if (cursor->operation_timeout_ms &&
+       (!cursor->operation_expire_at ||
+        (cursor->flags & MONGOC_QUERY_TAILABLE_CURSOR))) {
+      cursor->operation_expire_at =
+         bson_get_monotonic_time ()
+         + (int64_t) cursor->operation_timeout_ms * 1000;
+   }
+
+   saved_deadline = mongoc_cluster_push_deadline (&cursor->client->cluster,
+                                                  cursor->operation_expire_at);
+
+   for (;;) {
+      if (cursor->iface.next) {
+         ret = cursor->iface.next(cursor, bson);
+      } else {
+         ret = _mongoc_cursor_next(cursor, bson);
+      }
+
+      /* cache what the server returned, a cache hit is transformed again */
+      if (cursor->cache_key) {
+         _mongoc_cursor_cache_fill (cursor, ret ? *bson : NULL);
+      }
+
+      if (!ret || !cursor->transform ||
+          _mongoc_cursor_transform_apply (cursor->transform, bson)) {
+         break;
+      }
    }
 
+   mongoc_cluster_pop_deadline (&cursor->client->cluster, saved_deadline);
+
    cursor->current = *bson;
 
    cursor->count++;
@@ -1263,6 +1863,104 @@ mongoc_cursor_next (mongoc_cursor_t  *cursor,
 }
 
 
+/* stores a view at index n of cursor->batch, growing it as needed */
+void
+_mongoc_cursor_batch_append (mongoc_cursor_t *cursor,
+                             size_t           n,
+                             const uint8_t   *data,
+                             uint32_t         len)
+{
+   if (n == cursor->batch_alloc) {
+      cursor->batch_alloc = cursor->batch_alloc ? cursor->batch_alloc * 2 : 64;
+      cursor->batch = (mongoc_doc_view_t *)bson_realloc (
+         cursor->batch, cursor->batch_alloc * sizeof *cursor->batch);
+   }
+
+   cursor->batch[n].data = data;
+   cursor->batch[n].len = len;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cursor_next_batch --
+ *
+ *       Like mongoc_cursor_next, but returns all the documents of the
+ *       current reply not returned yet, fetching the next reply first if
+ *       there are none.
+ *
+ *       The views point into the reply and are valid until the next call
+ *       to mongoc_cursor_next, mongoc_cursor_next_batch, or
+ *       mongoc_cursor_destroy.
+ *
+ * Returns:
+ *       true and at least one document, or false if the cursor is
+ *       exhausted or failed; see mongoc_cursor_error.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_cursor_next_batch (mongoc_cursor_t          *cursor,
+                          const mongoc_doc_view_t **docs,
+                          size_t                   *n_docs)
+{
+   const bson_t *doc;
+   size_t n = 0;
+   size_t max;
+   size_t i;
+   bson_t b;
+
+   ENTRY;
+
+   BSON_ASSERT (cursor);
+   BSON_ASSERT (docs);
+   BSON_ASSERT (n_docs);
+
+   *docs = NULL;
+   *n_docs = 0;
+
+   /* the first document may require a round trip, and sets cursor state */
+   if (!mongoc_cursor_next (cursor, &doc)) {
+      RETURN (false);
+   }
+
+   _mongoc_cursor_batch_append (cursor, n++, bson_get_data (doc), doc->len);
+
+   /* a mutated document is only good until the next one is transformed,
+    * and array cursors hand out one document at a time */
+   if (!cursor->transform) {
+      max = SIZE_MAX;
+
+      if (cursor->limit) {
+         max = n + (size_t) (labs (cursor->limit) - cursor->count);
+      }
+
+      if (cursor->iface.read_batch) {
+         n = cursor->iface.read_batch (cursor, n, max);
+      } else if (!cursor->iface.next && cursor->reader &&
+                 !cursor->end_of_event) {
+         n = _mongoc_read_batch_from_buffer (cursor, n, max);
+      }
+   }
+
+   /* cache what the server returned, up to the cache's size limit */
+   for (i = 1; i < n && cursor->cache_key; i++) {
+      bson_init_static (&b, cursor->batch[i].data, cursor->batch[i].len);
+      _mongoc_cursor_cache_fill (cursor, &b);
+      cursor->count++;
+   }
+
+   cursor->count += (uint32_t) (n - i);
+
+   *docs = cursor->batch;
+   *n_docs = n;
+
+   RETURN (true);
+}
+
+
 bool
 _mongoc_read_from_buffer (mongoc_cursor_t *cursor,
                           const bson_t   **bson)
@@ -1278,6 +1976,33 @@ _mongoc_read_from_buffer (mongoc_cursor_t *cursor,
 }
 
 
+/* appends the rest of the current OP_REPLY, up to max documents in all */
+size_t
+_mongoc_read_batch_from_buffer (mongoc_cursor_t *cursor,
+                                size_t           n,
+                                size_t           max)
+{
+   const bson_t *b = NULL;
+   const bson_t *last = NULL;
+   bool eof = false;
+
+   BSON_ASSERT (cursor->reader);
+
+   while (n < max && (b = bson_reader_read (cursor->reader, &eof))) {
+      _mongoc_cursor_batch_append (cursor, n++, bson_get_data (b), b->len);
+      last = b;
+   }
+
+   cursor->end_of_event = eof ? 1 : 0;
+
+   if (last) {
+      cursor->current = last;
+   }
+
+   return n;
+}
+
+
 bool
 _mongoc_cursor_next (mongoc_cursor_t  *cursor,
                      const bson_t    **bson)
@@ -1441,7 +2166,8 @@ _mongoc_cursor_clone (const mongoc_cursor_t *cursor)
 
    BSON_ASSERT (cursor);
 
-   _clone = (mongoc_cursor_t *)bson_malloc0 (sizeof *_clone);
+   _clone = (mongoc_cursor_t *)_mongoc_malloc0 (MONGOC_MEMORY_CURSORS,
+                                                sizeof *_clone);
 
    _clone->client = cursor->client;
    _clone->is_command = cursor->is_command;
@@ -1452,6 +2178,8 @@ _mongoc_cursor_clone (const mongoc_cursor_t *cursor)
    _clone->nslen = cursor->nslen;
    _clone->dblen = cursor->dblen;
    _clone->has_fields = cursor->has_fields;
+   _clone->prefetch = cursor->prefetch;
+   _clone->operation_timeout_ms = cursor->operation_timeout_ms;
 
    if (cursor->read_prefs) {
       _clone->read_prefs = mongoc_read_prefs_copy (cursor->read_prefs);
@@ -1469,6 +2197,10 @@ _mongoc_cursor_clone (const mongoc_cursor_t *cursor)
 
    _mongoc_buffer_init (&_clone->buffer, NULL, 0, NULL, NULL);
 
+   if (cursor->transform) {
+      _mongoc_cursor_transform_clone (_clone, cursor->transform);
+   }
+
    mongoc_counter_cursors_active_inc ();
 
    RETURN (_clone);
@@ -1608,6 +2340,42 @@ mongoc_cursor_get_max_await_time_ms (const mongoc_cursor_t *cursor)
    return cursor->max_await_time_ms;
 }
 
+void
+mongoc_cursor_set_operation_timeout_ms (mongoc_cursor_t *cursor,
+                                        uint32_t         timeout_ms)
+{
+   BSON_ASSERT (cursor);
+
+   if (!cursor->sent) {
+      cursor->operation_timeout_ms = timeout_ms;
+   }
+}
+
+uint32_t
+mongoc_cursor_get_operation_timeout_ms (const mongoc_cursor_t *cursor)
+{
+   BSON_ASSERT (cursor);
+
+   return cursor->operation_timeout_ms;
+}
+
+void
+mongoc_cursor_set_prefetch (mongoc_cursor_t *cursor,
+                            bool             prefetch)
+{
+   BSON_ASSERT (cursor);
+
+   cursor->prefetch = !!prefetch;
+}
+
+bool
+mongoc_cursor_get_prefetch (const mongoc_cursor_t *cursor)
+{
+   BSON_ASSERT (cursor);
+
+   return !!cursor->prefetch;
+}
+
 
 /*
  *--------------------------------------------------------------------------
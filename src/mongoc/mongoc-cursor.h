@@ -31,6 +31,32 @@ BSON_BEGIN_DECLS
 typedef struct _mongoc_cursor_t mongoc_cursor_t;
 
 
+/* a BSON document in a reply batch, see mongoc_cursor_next_batch */
+typedef struct
+{
+   const uint8_t *data;
+   uint32_t       len;
+} mongoc_doc_view_t;
+
+
+typedef enum
+{
+   MONGOC_CURSOR_TRANSFORM_DROP,
+   MONGOC_CURSOR_TRANSFORM_PASS,
+   MONGOC_CURSOR_TRANSFORM_MUTATE,
+} mongoc_cursor_transform_mode_t;
+
+typedef mongoc_cursor_transform_mode_t
+(*mongoc_cursor_transform_filter_t)(const bson_t *bson,
+                                    void         *ctx);
+
+typedef void (*mongoc_cursor_transform_mutate_t)(const bson_t *bson,
+                                                 bson_t       *out,
+                                                 void         *ctx);
+
+typedef void (*mongoc_cursor_transform_dtor_t)(void *ctx);
+
+
 /* forward decl */
 struct _mongoc_client_t;
 
@@ -40,6 +66,9 @@ void             mongoc_cursor_destroy                (mongoc_cursor_t         *
 bool             mongoc_cursor_more                   (mongoc_cursor_t         *cursor);
 bool             mongoc_cursor_next                   (mongoc_cursor_t         *cursor,
                                                        const bson_t           **bson);
+bool             mongoc_cursor_next_batch             (mongoc_cursor_t         *cursor,
+                                                       const mongoc_doc_view_t **docs,
+                                                       size_t                  *n_docs);
 bool             mongoc_cursor_error                  (mongoc_cursor_t         *cursor,
                                                        bson_error_t            *error);
 void             mongoc_cursor_get_host               (mongoc_cursor_t         *cursor,
@@ -61,6 +90,17 @@ int64_t          mongoc_cursor_get_id                 (const mongoc_cursor_t   *
 void             mongoc_cursor_set_max_await_time_ms  (mongoc_cursor_t         *cursor,
                                                        uint32_t                 max_await_time_ms);
 uint32_t         mongoc_cursor_get_max_await_time_ms  (const mongoc_cursor_t   *cursor);
+void             mongoc_cursor_set_operation_timeout_ms (mongoc_cursor_t       *cursor,
+                                                         uint32_t               timeout_ms);
+uint32_t         mongoc_cursor_get_operation_timeout_ms (const mongoc_cursor_t *cursor);
+void             mongoc_cursor_set_prefetch           (mongoc_cursor_t         *cursor,
+                                                       bool                     prefetch);
+bool             mongoc_cursor_get_prefetch           (const mongoc_cursor_t   *cursor);
+void             mongoc_cursor_set_transform          (mongoc_cursor_t         *cursor,
+                                                       mongoc_cursor_transform_filter_t filter,
+                                                       mongoc_cursor_transform_mutate_t mutate,
+                                                       mongoc_cursor_transform_dtor_t   dtor,
+                                                       void                    *ctx);
 mongoc_cursor_t *mongoc_cursor_new_from_command_reply (struct _mongoc_client_t *client,
                                                        bson_t                  *reply,
                                                        uint32_t                 server_id)
@@ -27,6 +27,7 @@
 #include "mongoc-database-private.h"
 #include "mongoc-error.h"
 #include "mongoc-log.h"
+#include "mongoc-query-cache-private.h"
 #include "mongoc-trace.h"
 #include "mongoc-util-private.h"
 
@@ -236,6 +237,9 @@ mongoc_database_drop (mongoc_database_t *database,
    ret = mongoc_database_command_simple(database, &cmd, NULL, NULL, error);
    bson_destroy(&cmd);
 
+   _mongoc_query_cache_invalidate (database->client->query_cache,
+                                   database->name);
+
    return ret;
 }
 
@@ -762,9 +766,9 @@ _mongoc_database_find_collections_legacy_filter (const bson_t *bson,
        && (ctx->name = bson_iter_utf8 (&iter, NULL))
        && !strchr (ctx->name, '$')
        && (0 == strncmp (ctx->name, ctx->dbname, ctx->dbname_len))) {
-      return MONGO_CURSOR_TRANSFORM_MUTATE;
+      return MONGOC_CURSOR_TRANSFORM_MUTATE;
    } else {
-      return MONGO_CURSOR_TRANSFORM_DROP;
+      return MONGOC_CURSOR_TRANSFORM_DROP;
    }
 }
 
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_FIELD_MAP_PRIVATE_H
+#define MONGOC_FIELD_MAP_PRIVATE_H
+
+#if !defined (MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-array-private.h"
+#include "mongoc-field-map.h"
+
+
+BSON_BEGIN_DECLS
+
+
+#define MONGOC_FIELD_MAP_NO_LEVEL (-1)
+
+
+/* a key of one (sub)document: either a field to store or a subdocument
+ * with fields of its own */
+typedef struct
+{
+   char                *key;
+   char                *path;   /* for error messages */
+   mongoc_field_type_t  type;
+   size_t               offset;
+   int32_t              level;  /* index of the subdocument's level, or
+                                 * MONGOC_FIELD_MAP_NO_LEVEL */
+} mongoc_field_map_entry_t;
+
+
+/* the keys wanted from a document or subdocument, sorted for bsearch */
+typedef struct
+{
+   mongoc_array_t entries;  /* mongoc_field_map_entry_t */
+} mongoc_field_map_level_t;
+
+
+struct _mongoc_field_map_t
+{
+   mongoc_array_t levels;   /* mongoc_field_map_level_t, the top is 0 */
+};
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_FIELD_MAP_PRIVATE_H */
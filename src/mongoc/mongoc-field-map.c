@@ -0,0 +1,460 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mongoc-error.h"
+#include "mongoc-field-map-private.h"
+#include "mongoc-trace.h"
+
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "field-map"
+
+
+mongoc_field_map_t *
+mongoc_field_map_new (void)
+{
+   mongoc_field_map_t *map;
+   mongoc_field_map_level_t top;
+
+   map = (mongoc_field_map_t *)bson_malloc0 (sizeof *map);
+   _mongoc_array_init (&map->levels, sizeof (mongoc_field_map_level_t));
+
+   _mongoc_array_init (&top.entries, sizeof (mongoc_field_map_entry_t));
+   _mongoc_array_append_val (&map->levels, top);
+
+   return map;
+}
+
+
+void
+mongoc_field_map_destroy (mongoc_field_map_t *map)
+{
+   mongoc_field_map_level_t *level;
+   mongoc_field_map_entry_t *entry;
+   size_t i;
+   size_t j;
+
+   if (!map) {
+      return;
+   }
+
+   for (i = 0; i < map->levels.len; i++) {
+      level = &_mongoc_array_index (&map->levels, mongoc_field_map_level_t, i);
+
+      for (j = 0; j < level->entries.len; j++) {
+         entry = &_mongoc_array_index (&level->entries,
+                                       mongoc_field_map_entry_t, j);
+         bson_free (entry->key);
+         bson_free (entry->path);
+      }
+
+      _mongoc_array_destroy (&level->entries);
+   }
+
+   _mongoc_array_destroy (&map->levels);
+   bson_free (map);
+}
+
+
+static int
+_mongoc_field_map_entry_cmp (const void *a,
+                             const void *b)
+{
+   return strcmp (((const mongoc_field_map_entry_t *)a)->key,
+                  ((const mongoc_field_map_entry_t *)b)->key);
+}
+
+
+static int
+_mongoc_field_map_key_cmp (const void *key,
+                           const void *entry)
+{
+   return strcmp ((const char *)key,
+                  ((const mongoc_field_map_entry_t *)entry)->key);
+}
+
+
+static mongoc_field_map_entry_t *
+_mongoc_field_map_lookup (const mongoc_field_map_t *map,
+                          int32_t                   level_id,
+                          const char               *key)
+{
+   const mongoc_field_map_level_t *level;
+
+   level = &_mongoc_array_index (&map->levels, mongoc_field_map_level_t,
+                                 level_id);
+
+   if (!level->entries.len) {
+      return NULL;
+   }
+
+   return (mongoc_field_map_entry_t *)bsearch (key,
+                                               level->entries.data,
+                                               level->entries.len,
+                                               sizeof (mongoc_field_map_entry_t),
+                                               _mongoc_field_map_key_cmp);
+}
+
+
+static void
+_mongoc_field_map_insert (mongoc_field_map_t       *map,
+                          int32_t                   level_id,
+                          mongoc_field_map_entry_t *entry)
+{
+   mongoc_field_map_level_t *level;
+
+   level = &_mongoc_array_index (&map->levels, mongoc_field_map_level_t,
+                                 level_id);
+
+   _mongoc_array_append_val (&level->entries, *entry);
+   qsort (level->entries.data, level->entries.len,
+          sizeof (mongoc_field_map_entry_t), _mongoc_field_map_entry_cmp);
+}
+
+
+static bool
+_mongoc_field_map_type_valid (mongoc_field_type_t type)
+{
+   switch (type) {
+   case MONGOC_FIELD_DOUBLE:
+   case MONGOC_FIELD_UTF8:
+   case MONGOC_FIELD_DOCUMENT:
+   case MONGOC_FIELD_ARRAY:
+   case MONGOC_FIELD_OID:
+   case MONGOC_FIELD_BOOL:
+   case MONGOC_FIELD_DATE_TIME:
+   case MONGOC_FIELD_INT32:
+   case MONGOC_FIELD_INT64:
+      return true;
+   default:
+      return false;
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_field_map_add --
+ *
+ *       Store the field at dotted @path of each decoded document at
+ *       @offset of the output struct. The field's BSON type must be
+ *       @type; a document without the field leaves the struct member
+ *       untouched.
+ *
+ * Returns:
+ *       false if @path is invalid, or overlaps a path already added.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_field_map_add (mongoc_field_map_t  *map,
+                      const char          *path,
+                      mongoc_field_type_t  type,
+                      size_t               offset,
+                      bson_error_t        *error)
+{
+   mongoc_field_map_level_t level;
+   mongoc_field_map_entry_t new_entry;
+   mongoc_field_map_entry_t *entry;
+   int32_t level_id = 0;
+   const char *key;
+   const char *dot;
+   char *tmp;
+
+   ENTRY;
+
+   BSON_ASSERT (map);
+   BSON_ASSERT (path);
+
+   if (!_mongoc_field_map_type_valid (type)) {
+      bson_set_error (error,
+                      MONGOC_ERROR_COMMAND,
+                      MONGOC_ERROR_COMMAND_INVALID_ARG,
+                      "Invalid field type %d for \"%s\"", (int)type, path);
+      RETURN (false);
+   }
+
+   for (key = path;; key = dot + 1) {
+      dot = strchr (key, '.');
+      tmp = dot ? bson_strndup (key, (size_t)(dot - key)) : bson_strdup (key);
+
+      if (!*tmp) {
+         bson_set_error (error,
+                         MONGOC_ERROR_COMMAND,
+                         MONGOC_ERROR_COMMAND_INVALID_ARG,
+                         "Invalid field path \"%s\"", path);
+         bson_free (tmp);
+         RETURN (false);
+      }
+
+      entry = _mongoc_field_map_lookup (map, level_id, tmp);
+
+      if (!dot) {
+         break;
+      }
+
+      if (entry && entry->level == MONGOC_FIELD_MAP_NO_LEVEL) {
+         break;
+      }
+
+      if (entry) {
+         level_id = entry->level;
+      } else {
+         /* the first field in this subdocument */
+         _mongoc_array_init (&level.entries,
+                             sizeof (mongoc_field_map_entry_t));
+         _mongoc_array_append_val (&map->levels, level);
+
+         new_entry.key = tmp;
+         new_entry.path = bson_strndup (path, (size_t)(dot - path));
+         new_entry.type = MONGOC_FIELD_DOCUMENT;
+         new_entry.offset = 0;
+         new_entry.level = (int32_t)map->levels.len - 1;
+         _mongoc_field_map_insert (map, level_id, &new_entry);
+
+         level_id = new_entry.level;
+         tmp = NULL;
+      }
+
+      bson_free (tmp);
+   }
+
+   if (entry) {
+      bson_set_error (error,
+                      MONGOC_ERROR_COMMAND,
+                      MONGOC_ERROR_COMMAND_INVALID_ARG,
+                      "Field path \"%s\" overlaps \"%s\"", path, entry->path);
+      bson_free (tmp);
+      RETURN (false);
+   }
+
+   new_entry.key = tmp;
+   new_entry.path = bson_strdup (path);
+   new_entry.type = type;
+   new_entry.offset = offset;
+   new_entry.level = MONGOC_FIELD_MAP_NO_LEVEL;
+   _mongoc_field_map_insert (map, level_id, &new_entry);
+
+   RETURN (true);
+}
+
+
+static void
+_mongoc_field_map_store (const mongoc_field_map_entry_t *entry,
+                         const bson_iter_t              *iter,
+                         uint8_t                        *dst)
+{
+   mongoc_doc_view_t view;
+   const char *str;
+   double d;
+   bool b;
+   int32_t i32;
+   int64_t i64;
+
+   switch (entry->type) {
+   case MONGOC_FIELD_DOUBLE:
+      d = bson_iter_double (iter);
+      memcpy (dst, &d, sizeof d);
+      break;
+   case MONGOC_FIELD_UTF8:
+      str = bson_iter_utf8 (iter, NULL);
+      memcpy (dst, &str, sizeof str);
+      break;
+   case MONGOC_FIELD_DOCUMENT:
+      bson_iter_document (iter, &view.len, &view.data);
+      memcpy (dst, &view, sizeof view);
+      break;
+   case MONGOC_FIELD_ARRAY:
+      bson_iter_array (iter, &view.len, &view.data);
+      memcpy (dst, &view, sizeof view);
+      break;
+   case MONGOC_FIELD_OID:
+      memcpy (dst, bson_iter_oid (iter), sizeof (bson_oid_t));
+      break;
+   case MONGOC_FIELD_BOOL:
+      b = bson_iter_bool (iter);
+      memcpy (dst, &b, sizeof b);
+      break;
+   case MONGOC_FIELD_DATE_TIME:
+      i64 = bson_iter_date_time (iter);
+      memcpy (dst, &i64, sizeof i64);
+      break;
+   case MONGOC_FIELD_INT32:
+      i32 = bson_iter_int32 (iter);
+      memcpy (dst, &i32, sizeof i32);
+      break;
+   case MONGOC_FIELD_INT64:
+      i64 = bson_iter_int64 (iter);
+      memcpy (dst, &i64, sizeof i64);
+      break;
+   default:
+      BSON_ASSERT (false);
+   }
+}
+
+
+/*
+ * Walk the keys of one document once, looking each up in the level's
+ * sorted table, and stop as soon as every wanted key was seen.
+ */
+static bool
+_mongoc_field_map_decode_level (const mongoc_field_map_t *map,
+                                int32_t                   level_id,
+                                bson_iter_t              *iter,
+                                uint8_t                  *out,
+                                bson_error_t             *error)
+{
+   const mongoc_field_map_level_t *level;
+   const mongoc_field_map_entry_t *entry;
+   bson_iter_t child;
+   size_t found = 0;
+
+   level = &_mongoc_array_index (&map->levels, mongoc_field_map_level_t,
+                                 level_id);
+
+   while (found < level->entries.len && bson_iter_next (iter)) {
+      entry = _mongoc_field_map_lookup (map, level_id, bson_iter_key (iter));
+
+      if (!entry) {
+         continue;
+      }
+
+      found++;
+
+      if (entry->level != MONGOC_FIELD_MAP_NO_LEVEL) {
+         if (!(BSON_ITER_HOLDS_DOCUMENT (iter) ||
+               BSON_ITER_HOLDS_ARRAY (iter)) ||
+             !bson_iter_recurse (iter, &child)) {
+            bson_set_error (error,
+                            MONGOC_ERROR_BSON,
+                            MONGOC_ERROR_BSON_INVALID,
+                            "Field \"%s\" is not a document", entry->path);
+            return false;
+         }
+
+         if (!_mongoc_field_map_decode_level (map, entry->level, &child,
+                                              out, error)) {
+            return false;
+         }
+
+         continue;
+      }
+
+      if (bson_iter_type (iter) != (bson_type_t)entry->type) {
+         bson_set_error (error,
+                         MONGOC_ERROR_BSON,
+                         MONGOC_ERROR_BSON_INVALID,
+                         "Field \"%s\" has BSON type 0x%02x, expected 0x%02x",
+                         entry->path, (int)bson_iter_type (iter),
+                         (int)entry->type);
+         return false;
+      }
+
+      _mongoc_field_map_store (entry, iter, out + entry->offset);
+   }
+
+   return true;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_field_map_decode --
+ *
+ *       Fill the struct at @out from @doc in a single pass over its
+ *       keys. Strings and subdocuments point into @doc.
+ *
+ * Returns:
+ *       false if a field has the wrong type, @out may be partly filled.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_field_map_decode (const mongoc_field_map_t *map,
+                         const bson_t             *doc,
+                         void                     *out,
+                         bson_error_t             *error)
+{
+   bson_iter_t iter;
+
+   BSON_ASSERT (map);
+   BSON_ASSERT (doc);
+   BSON_ASSERT (out);
+
+   if (!bson_iter_init (&iter, doc)) {
+      bson_set_error (error,
+                      MONGOC_ERROR_BSON,
+                      MONGOC_ERROR_BSON_INVALID,
+                      "Cannot decode a corrupt document");
+      return false;
+   }
+
+   return _mongoc_field_map_decode_level (map, 0, &iter, (uint8_t *)out,
+                                          error);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_field_map_decode_batch --
+ *
+ *       Decode each of @docs, as from mongoc_cursor_next_batch, into an
+ *       array of structs @stride bytes apart starting at @out.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_field_map_decode_batch (const mongoc_field_map_t *map,
+                               const mongoc_doc_view_t  *docs,
+                               size_t                    n_docs,
+                               void                     *out,
+                               size_t                    stride,
+                               bson_error_t             *error)
+{
+   bson_t doc;
+   size_t i;
+
+   BSON_ASSERT (map);
+   BSON_ASSERT (docs || !n_docs);
+   BSON_ASSERT (out || !n_docs);
+
+   for (i = 0; i < n_docs; i++) {
+      if (!bson_init_static (&doc, docs[i].data, docs[i].len)) {
+         bson_set_error (error,
+                         MONGOC_ERROR_BSON,
+                         MONGOC_ERROR_BSON_INVALID,
+                         "Cannot decode corrupt document %d", (int)i);
+         return false;
+      }
+
+      if (!mongoc_field_map_decode (map, &doc, (uint8_t *)out + i * stride,
+                                    error)) {
+         return false;
+      }
+   }
+
+   return true;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_FIELD_MAP_H
+#define MONGOC_FIELD_MAP_H
+
+#if !defined (MONGOC_INSIDE) && !defined (MONGOC_COMPILATION)
+# error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-cursor.h"
+
+
+BSON_BEGIN_DECLS
+
+
+/* the C type each field is stored as is in the comment */
+typedef enum
+{
+   MONGOC_FIELD_DOUBLE    = BSON_TYPE_DOUBLE,    /* double */
+   MONGOC_FIELD_UTF8      = BSON_TYPE_UTF8,      /* const char *, into the document */
+   MONGOC_FIELD_DOCUMENT  = BSON_TYPE_DOCUMENT,  /* mongoc_doc_view_t */
+   MONGOC_FIELD_ARRAY     = BSON_TYPE_ARRAY,     /* mongoc_doc_view_t */
+   MONGOC_FIELD_OID       = BSON_TYPE_OID,       /* bson_oid_t */
+   MONGOC_FIELD_BOOL      = BSON_TYPE_BOOL,      /* bool */
+   MONGOC_FIELD_DATE_TIME = BSON_TYPE_DATE_TIME, /* int64_t */
+   MONGOC_FIELD_INT32     = BSON_TYPE_INT32,     /* int32_t */
+   MONGOC_FIELD_INT64     = BSON_TYPE_INT64,     /* int64_t */
+} mongoc_field_type_t;
+
+
+typedef struct _mongoc_field_map_t mongoc_field_map_t;
+
+
+mongoc_field_map_t *mongoc_field_map_new          (void);
+void                mongoc_field_map_destroy      (mongoc_field_map_t       *map);
+bool                mongoc_field_map_add          (mongoc_field_map_t       *map,
+                                                   const char               *path,
+                                                   mongoc_field_type_t       type,
+                                                   size_t                    offset,
+                                                   bson_error_t             *error);
+bool                mongoc_field_map_decode       (const mongoc_field_map_t *map,
+                                                   const bson_t             *doc,
+                                                   void                     *out,
+                                                   bson_error_t             *error);
+bool                mongoc_field_map_decode_batch (const mongoc_field_map_t *map,
+                                                   const mongoc_doc_view_t  *docs,
+                                                   size_t                    n_docs,
+                                                   void                     *out,
+                                                   size_t                    stride,
+                                                   bson_error_t             *error);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_FIELD_MAP_H */
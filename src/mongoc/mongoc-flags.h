@@ -78,6 +78,24 @@ typedef enum
 #define MONGOC_INSERT_NO_VALIDATE (1U << 31)
 
 
+/**
+ * mongoc_validate_level_t:
+ * @MONGOC_VALIDATE_NONE: Send documents without checking them.
+ * @MONGOC_VALIDATE_KEYS: Reject keys containing "." or starting with "$",
+ *    but do not check that strings are valid UTF-8.
+ * @MONGOC_VALIDATE_FULL: All checks. This is the default.
+ *
+ * #mongoc_validate_level_t sets how thoroughly documents are checked
+ * before they are inserted, or used to replace a document.
+ */
+typedef enum
+{
+   MONGOC_VALIDATE_FULL = 0,
+   MONGOC_VALIDATE_KEYS,
+   MONGOC_VALIDATE_NONE,
+} mongoc_validate_level_t;
+
+
 /**
  * mongoc_query_flags_t:
  * @MONGOC_QUERY_NONE: No query flags supplied.
@@ -21,6 +21,7 @@
 #include "mongoc-gridfs-file-page.h"
 #include "mongoc-gridfs-file-page-private.h"
 
+#include "mongoc-memory-private.h"
 #include "mongoc-trace.h"
 
 
@@ -40,7 +41,8 @@ _mongoc_gridfs_file_page_new (const uint8_t *data,
    BSON_ASSERT (data);
    BSON_ASSERT (len <= chunk_size);
 
-   page = (mongoc_gridfs_file_page_t *)bson_malloc0 (sizeof *page);
+   page = (mongoc_gridfs_file_page_t *)_mongoc_malloc0 (MONGOC_MEMORY_GRIDFS,
+                                                        sizeof *page);
 
    page->chunk_size = chunk_size;
    page->read_buf = data;
@@ -116,7 +118,8 @@ _mongoc_gridfs_file_page_write (mongoc_gridfs_file_page_t *page,
    bytes_written = BSON_MIN (len, page->chunk_size - page->offset);
 
    if (!page->buf) {
-      page->buf = (uint8_t *) bson_malloc (page->chunk_size);
+      page->buf = (uint8_t *) _mongoc_malloc (MONGOC_MEMORY_GRIDFS,
+                                              page->chunk_size);
       memcpy (page->buf, page->read_buf, BSON_MIN (page->chunk_size, page->len));
    }
 
@@ -158,7 +161,8 @@ _mongoc_gridfs_file_page_memset0 (mongoc_gridfs_file_page_t *page,
    bytes_set = BSON_MIN (page->chunk_size - page->offset, len);
 
    if (!page->buf) {
-      page->buf = (uint8_t *)bson_malloc0 (page->chunk_size);
+      page->buf = (uint8_t *)_mongoc_malloc0 (MONGOC_MEMORY_GRIDFS,
+                                              page->chunk_size);
       memcpy (page->buf, page->read_buf, BSON_MIN (page->chunk_size, page->len));
    }
 
@@ -223,9 +227,8 @@ _mongoc_gridfs_file_page_destroy (mongoc_gridfs_file_page_t *page)
 {
    ENTRY;
 
-   if (page->buf) { bson_free (page->buf); }
-
-   bson_free (page);
+   _mongoc_free (MONGOC_MEMORY_GRIDFS, page->buf);
+   _mongoc_free (MONGOC_MEMORY_GRIDFS, page);
 
    EXIT;
 }
@@ -66,6 +66,9 @@ mongoc_gridfs_file_t *_mongoc_gridfs_file_new_from_bson (mongoc_gridfs_t
                                                          const bson_t             *data);
 mongoc_gridfs_file_t *_mongoc_gridfs_file_new           (mongoc_gridfs_t          *gridfs,
                                                          mongoc_gridfs_file_opt_t *opt);
+bool                  _mongoc_gridfs_file_append_chunk  (mongoc_gridfs_file_t     *file,
+                                                         const uint8_t            *data,
+                                                         uint32_t                  len);
 
 
 BSON_END_DECLS
@@ -32,6 +32,7 @@
 #include "mongoc-gridfs-file-page.h"
 #include "mongoc-gridfs-file-page-private.h"
 #include "mongoc-iovec.h"
+#include "mongoc-stream-private.h"
 #include "mongoc-trace.h"
 #include "mongoc-error.h"
 
@@ -41,6 +42,11 @@ _mongoc_gridfs_file_refresh_page (mongoc_gridfs_file_t *file);
 static bool
 _mongoc_gridfs_file_flush_page (mongoc_gridfs_file_t *file);
 
+static bool
+_mongoc_gridfs_file_write_chunk (mongoc_gridfs_file_t *file,
+                                 const uint8_t        *buf,
+                                 uint32_t              len);
+
 static ssize_t
 _mongoc_gridfs_file_extend (mongoc_gridfs_file_t *file);
 
@@ -610,40 +616,30 @@ _mongoc_gridfs_file_extend (mongoc_gridfs_file_t *file)
 
 
 /**
- * _mongoc_gridfs_file_flush_page:
- *
- *    Unconditionally flushes the file's current page to the database.
- *    The page to flush is determined by page->n.
- *
- * Side Effects:
+ * _mongoc_gridfs_file_write_chunk:
  *
- *    On success, file->page is properly destroyed and set to NULL.
+ *    Upsert chunk number file->n with the @len bytes at @buf.
  *
  * Returns:
  *
- *    True on success; false otherwise.
+ *    True on success; false otherwise, and file->error is set.
  */
 static bool
-_mongoc_gridfs_file_flush_page (mongoc_gridfs_file_t *file)
+_mongoc_gridfs_file_write_chunk (mongoc_gridfs_file_t *file,
+                                 const uint8_t        *buf,
+                                 uint32_t              len)
 {
    bson_t *selector, *update;
    bool r;
-   const uint8_t *buf;
-   uint32_t len;
 
    ENTRY;
-   BSON_ASSERT (file);
-   BSON_ASSERT (file->page);
-
-   buf = _mongoc_gridfs_file_page_get_data (file->page);
-   len = _mongoc_gridfs_file_page_get_len (file->page);
 
    selector = bson_new ();
 
    bson_append_value (selector, "files_id", -1, &file->files_id);
    bson_append_int32 (selector, "n", -1, file->n);
 
-   update = bson_sized_new (file->chunk_size + 100);
+   update = bson_sized_new (len + 100);
 
    bson_append_value (update, "files_id", -1, &file->files_id);
    bson_append_int32 (update, "n", -1, file->n);
@@ -655,6 +651,89 @@ _mongoc_gridfs_file_flush_page (mongoc_gridfs_file_t *file)
    bson_destroy (selector);
    bson_destroy (update);
 
+   RETURN (r);
+}
+
+
+/**
+ * _mongoc_gridfs_file_append_chunk:
+ *
+ *    Append a chunk to the end of a file without going through a page.
+ *    The chunk document is built straight from @data, so a caller holding
+ *    the file's contents in memory, such as a mapped file, avoids copying
+ *    them into a page first.
+ *
+ * Preconditions:
+ *
+ *    The file has no page and is positioned at its end, on a chunk
+ *    boundary. @len is at most file->chunk_size.
+ *
+ * Side Effects:
+ *
+ *    file->pos and file->length advance by @len. The file is marked dirty,
+ *    mongoc_gridfs_file_save() writes its length.
+ *
+ * Returns:
+ *
+ *    True on success; false otherwise, and file->error is set.
+ */
+bool
+_mongoc_gridfs_file_append_chunk (mongoc_gridfs_file_t *file,
+                                  const uint8_t        *data,
+                                  uint32_t              len)
+{
+   ENTRY;
+
+   BSON_ASSERT (file);
+   BSON_ASSERT (!file->page);
+   BSON_ASSERT ((int64_t)file->pos == file->length);
+   BSON_ASSERT (!(file->pos % file->chunk_size));
+   BSON_ASSERT (len <= (uint32_t)file->chunk_size);
+
+   file->n = (int32_t)(file->pos / file->chunk_size);
+
+   if (!_mongoc_gridfs_file_write_chunk (file, data, len)) {
+      RETURN (false);
+   }
+
+   file->pos += len;
+   file->length = (int64_t)file->pos;
+   file->is_dirty = true;
+
+   RETURN (true);
+}
+
+
+/**
+ * _mongoc_gridfs_file_flush_page:
+ *
+ *    Unconditionally flushes the file's current page to the database.
+ *    The page to flush is determined by page->n.
+ *
+ * Side Effects:
+ *
+ *    On success, file->page is properly destroyed and set to NULL.
+ *
+ * Returns:
+ *
+ *    True on success; false otherwise.
+ */
+static bool
+_mongoc_gridfs_file_flush_page (mongoc_gridfs_file_t *file)
+{
+   bool r;
+   const uint8_t *buf;
+   uint32_t len;
+
+   ENTRY;
+   BSON_ASSERT (file);
+   BSON_ASSERT (file->page);
+
+   buf = _mongoc_gridfs_file_page_get_data (file->page);
+   len = _mongoc_gridfs_file_page_get_len (file->page);
+
+   r = _mongoc_gridfs_file_write_chunk (file, buf, len);
+
    if (r) {
       _mongoc_gridfs_file_page_destroy (file->page);
       file->page = NULL;
@@ -934,6 +1013,78 @@ mongoc_gridfs_file_tell (mongoc_gridfs_file_t *file)
    return file->pos;
 }
 
+
+/**
+ * mongoc_gridfs_file_download_to_stream:
+ *
+ *    Write the file from its current position to the end into @stream.
+ *    Each chunk's payload is written straight from the server's reply,
+ *    without copying it into a caller's buffer first. With a stream from
+ *    mongoc_stream_file_new_mapped(), the payload is copied once, into
+ *    the mapped output file.
+ *
+ * Side Effects:
+ *
+ *    The file position is at the end of the file on success. On failure
+ *    file->error is set, see mongoc_gridfs_file_error().
+ *
+ * Returns:
+ *
+ *    True on success; false otherwise.
+ */
+bool
+mongoc_gridfs_file_download_to_stream (mongoc_gridfs_file_t *file,
+                                       mongoc_stream_t      *stream,
+                                       int32_t               timeout_msec)
+{
+   mongoc_iovec_t iov;
+   const uint8_t *data;
+   uint32_t offset;
+   uint32_t len;
+
+   ENTRY;
+
+   BSON_ASSERT (file);
+   BSON_ASSERT (stream);
+
+   while ((int64_t)file->pos < file->length) {
+      if (!file->page ||
+          _mongoc_gridfs_file_page_tell (file->page) ==
+          _mongoc_gridfs_file_page_get_len (file->page)) {
+         if (!_mongoc_gridfs_file_refresh_page (file)) {
+            RETURN (false);
+         }
+      }
+
+      data = _mongoc_gridfs_file_page_get_data (file->page);
+      offset = _mongoc_gridfs_file_page_tell (file->page);
+      len = _mongoc_gridfs_file_page_get_len (file->page) - offset;
+
+      if (!len) {
+         /* a short chunk before the end of the file */
+         bson_set_error (&file->error,
+                         MONGOC_ERROR_GRIDFS,
+                         MONGOC_ERROR_GRIDFS_CHUNK_MISSING,
+                         "missing data in chunk number %" PRId32,
+                         file->n);
+         RETURN (false);
+      }
+
+      iov.iov_base = (void *)(data + offset);
+      iov.iov_len = len;
+
+      if (!_mongoc_stream_writev_full (stream, &iov, 1, timeout_msec,
+                                       &file->error)) {
+         RETURN (false);
+      }
+
+      _mongoc_gridfs_file_page_seek (file->page, offset + len);
+      file->pos += len;
+   }
+
+   RETURN (true);
+}
+
 bool
 mongoc_gridfs_file_error (mongoc_gridfs_file_t *file,
                           bson_error_t         *error)
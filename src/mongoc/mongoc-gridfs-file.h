@@ -24,6 +24,7 @@
 #include <bson.h>
 
 #include "mongoc-socket.h"
+#include "mongoc-stream.h"
 
 BSON_BEGIN_DECLS
 
@@ -97,6 +98,11 @@ mongoc_gridfs_file_seek (mongoc_gridfs_file_t *file,
 uint64_t
 mongoc_gridfs_file_tell (mongoc_gridfs_file_t *file);
 
+bool
+mongoc_gridfs_file_download_to_stream (mongoc_gridfs_file_t *file,
+                                       mongoc_stream_t      *stream,
+                                       int32_t               timeout_msec);
+
 bool 
 mongoc_gridfs_file_set_id (mongoc_gridfs_file_t *file, 
                            const bson_value_t   *id, 
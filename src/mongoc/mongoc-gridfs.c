@@ -30,6 +30,7 @@
 #include "mongoc-gridfs-file-private.h"
 #include "mongoc-gridfs-file-list.h"
 #include "mongoc-gridfs-file-list-private.h"
+#include "mongoc-stream-file-private.h"
 #include "mongoc-client.h"
 #include "mongoc-trace.h"
 
@@ -244,6 +245,8 @@ mongoc_gridfs_create_file_from_stream (mongoc_gridfs_t          *gridfs,
    ssize_t r;
    uint8_t buf[MONGOC_GRIDFS_STREAM_CHUNK];
    mongoc_iovec_t iov;
+   const uint8_t *data;
+   size_t len;
    int timeout;
 
    ENTRY;
@@ -258,6 +261,20 @@ mongoc_gridfs_create_file_from_stream (mongoc_gridfs_t          *gridfs,
    timeout = gridfs->client->cluster.sockettimeoutms;
 
    for (;; ) {
+      if (_mongoc_stream_file_read_mapped (stream, (size_t)file->chunk_size,
+                                           &data, &len)) {
+         /* a mapped file, build each chunk document from the mapping */
+         if (!len) {
+            break;
+         } else if (!_mongoc_gridfs_file_append_chunk (file, data,
+                                                       (uint32_t)len)) {
+            mongoc_gridfs_file_destroy (file);
+            RETURN (NULL);
+         }
+
+         continue;
+      }
+
       r = mongoc_stream_read (stream, iov.iov_base, MONGOC_GRIDFS_STREAM_CHUNK,
                               0, timeout);
 
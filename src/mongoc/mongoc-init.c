@@ -20,6 +20,7 @@
 #include "mongoc-config.h"
 #include "mongoc-counters-private.h"
 #include "mongoc-init.h"
+#include "mongoc-log-private.h"
 
 #ifdef MONGOC_EXPERIMENTAL_FEATURES
 #include "mongoc-metadata-private.h"
@@ -164,6 +165,8 @@ static MONGOC_ONCE_FUN( _mongoc_do_cleanup)
    _mongoc_metadata_cleanup ();
 #endif
 
+   _mongoc_log_cleanup ();
+
    MONGOC_ONCE_RETURN;
 }
 
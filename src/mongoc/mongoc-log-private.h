@@ -22,6 +22,7 @@
 #endif
 
 #include "mongoc-iovec.h"
+#include "mongoc-log.h"
 
 /* just for testing */
 void _mongoc_log_get_handler (mongoc_log_func_t  *log_func,
@@ -29,6 +30,8 @@ void _mongoc_log_get_handler (mongoc_log_func_t  *log_func,
 
 bool _mongoc_log_trace_is_enabled (void);
 
+void _mongoc_log_cleanup (void);
+
 void
 mongoc_log_trace_bytes       (const char *domain,
                               const uint8_t *_b,
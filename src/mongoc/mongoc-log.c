@@ -30,6 +30,16 @@
 #include "mongoc-thread-private.h"
 
 
+#ifndef _WIN32
+# define MONGOC_LOG_ASYNC_SUPPORTED 1
+#endif
+
+#define MONGOC_LOG_ASYNC_RING_SIZE    64   /* messages per thread */
+#define MONGOC_LOG_ASYNC_MESSAGE_MAX  512
+#define MONGOC_LOG_ASYNC_DOMAIN_MAX   32
+#define MONGOC_LOG_ASYNC_MAX_PER_SEC  1000
+
+
 static mongoc_mutex_t     gLogMutex;
 static mongoc_log_func_t  gLogFunc = mongoc_log_default_handler;
 #ifdef MONGOC_TRACE
@@ -37,19 +47,87 @@ static bool               gLogTrace = true;
 #endif
 static void              *gLogData;
 
+#ifdef MONGOC_LOG_ASYNC_SUPPORTED
+/*
+ * Async logging: each thread that logs owns a ring of formatted messages.
+ * Only that thread advances the ring's head and only the writer thread
+ * advances its tail, so logging takes no lock once the thread's ring is
+ * registered. The writer passes messages to the handler, collapsing
+ * repeats and limiting the rate so a storm of warnings can't flood it.
+ *
+ * A ring lives as long as its thread: the thread keeps a pointer to it in
+ * gLogRingKey, so rings are reused when async logging is switched off and
+ * on again, and only freed once their thread has exited.
+ */
+typedef struct
+{
+   mongoc_log_level_t log_level;
+   char               log_domain[MONGOC_LOG_ASYNC_DOMAIN_MAX];
+   char               message[MONGOC_LOG_ASYNC_MESSAGE_MAX];
+} mongoc_log_entry_t;
+
+typedef struct _mongoc_log_ring_t
+{
+   volatile uint32_t          head;
+   volatile uint32_t          tail;
+   volatile int32_t           dropped;
+   volatile int32_t           abandoned;
+   struct _mongoc_log_ring_t *next;
+   mongoc_log_entry_t         entries[MONGOC_LOG_ASYNC_RING_SIZE];
+} mongoc_log_ring_t;
+
+/* state used only by the writer thread */
+typedef struct
+{
+   mongoc_log_entry_t last;
+   bool               has_last;
+   uint32_t           repeats;
+   int64_t            last_time;
+   int64_t            window_start;
+   uint32_t           in_window;
+   uint32_t           suppressed;
+} mongoc_log_writer_t;
+
+static mongoc_mutex_t      gLogAsyncMutex;   /* start and stop */
+static mongoc_mutex_t      gLogRingsMutex;
+static mongoc_mutex_t      gLogWriterMutex;
+static mongoc_cond_t       gLogWriterCond;
+static mongoc_mutex_t      gLogPushersMutex;
+static mongoc_cond_t       gLogPushersCond;  /* the last pusher is done */
+static mongoc_thread_t     gLogWriterThread;
+static mongoc_log_writer_t gLogWriter;
+static mongoc_log_ring_t  *gLogRings;
+static pthread_key_t       gLogRingKey;
+static bool                gLogRingKeyCreated;
+static volatile int32_t    gLogAsync;
+static volatile int32_t    gLogAsyncPushers; /* threads inside a push */
+static bool                gLogWriterRunning;
+#endif
+
 static MONGOC_ONCE_FUN( _mongoc_ensure_mutex_once)
 {
    mongoc_mutex_init(&gLogMutex);
 
+#ifdef MONGOC_LOG_ASYNC_SUPPORTED
+   mongoc_mutex_init (&gLogAsyncMutex);
+   mongoc_mutex_init (&gLogRingsMutex);
+   mongoc_mutex_init (&gLogWriterMutex);
+   mongoc_cond_init (&gLogWriterCond);
+   mongoc_mutex_init (&gLogPushersMutex);
+   mongoc_cond_init (&gLogPushersCond);
+#endif
+
    MONGOC_ONCE_RETURN;
 }
 
+
+static mongoc_once_t gLogOnce = MONGOC_ONCE_INIT;
+
 void
 mongoc_log_set_handler (mongoc_log_func_t  log_func,
                         void              *user_data)
 {
-   static mongoc_once_t once = MONGOC_ONCE_INIT;
-   mongoc_once(&once, &_mongoc_ensure_mutex_once);
+   mongoc_once(&gLogOnce, &_mongoc_ensure_mutex_once);
 
    mongoc_mutex_lock(&gLogMutex);
    gLogFunc = log_func;
@@ -68,6 +146,437 @@ _mongoc_log_get_handler (mongoc_log_func_t  *log_func,
 }
 
 
+#ifdef MONGOC_LOG_ASYNC_SUPPORTED
+/* unlink and free drained rings of exited threads, gLogRingsMutex held */
+static void
+_mongoc_log_rings_reap (void)
+{
+   mongoc_log_ring_t *ring;
+   mongoc_log_ring_t **link = &gLogRings;
+
+   while (*link) {
+      ring = *link;
+
+      if (ring->abandoned && ring->tail == ring->head) {
+         *link = ring->next;
+         bson_free (ring);
+      } else {
+         link = &ring->next;
+      }
+   }
+}
+
+
+static void
+_mongoc_log_ring_abandon (void *data)
+{
+   mongoc_log_ring_t *ring = (mongoc_log_ring_t *)data;
+
+   bson_memory_barrier ();
+   ring->abandoned = 1;
+
+   /* while the writer runs it frees the ring once it is drained, and it
+    * walks the list unlocked, so only free it here if it is stopped */
+   mongoc_mutex_lock (&gLogAsyncMutex);
+
+   if (!gLogAsync) {
+      mongoc_mutex_lock (&gLogRingsMutex);
+      _mongoc_log_rings_reap ();
+      mongoc_mutex_unlock (&gLogRingsMutex);
+   }
+
+   mongoc_mutex_unlock (&gLogAsyncMutex);
+}
+
+
+static mongoc_log_ring_t *
+_mongoc_log_ring_get (void)
+{
+   mongoc_log_ring_t *ring;
+
+   ring = (mongoc_log_ring_t *)pthread_getspecific (gLogRingKey);
+
+   if (!ring) {
+      ring = (mongoc_log_ring_t *)bson_malloc0 (sizeof *ring);
+
+      mongoc_mutex_lock (&gLogRingsMutex);
+      ring->next = gLogRings;
+      bson_memory_barrier ();
+      gLogRings = ring;
+      mongoc_mutex_unlock (&gLogRingsMutex);
+
+      pthread_setspecific (gLogRingKey, ring);
+   }
+
+   return ring;
+}
+
+
+/* leave a push; the last one out wakes mongoc_log_set_async (false) */
+static void
+_mongoc_log_async_push_done (void)
+{
+   if (bson_atomic_int_add (&gLogAsyncPushers, -1) == 0 && !gLogAsync) {
+      mongoc_mutex_lock (&gLogPushersMutex);
+      mongoc_cond_broadcast (&gLogPushersCond);
+      mongoc_mutex_unlock (&gLogPushersMutex);
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_log_async_push --
+ *
+ *       Format a message into the calling thread's ring. If the ring is
+ *       full the message is dropped and counted; the writer reports how
+ *       many were dropped.
+ *
+ * Returns:
+ *       true if the message was consumed, false if the caller should log
+ *       it synchronously.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_log_async_push (mongoc_log_level_t  log_level,
+                        const char         *log_domain,
+                        const char         *format,
+                        va_list             args)
+{
+   mongoc_log_ring_t *ring;
+   mongoc_log_entry_t *entry;
+   uint32_t head;
+
+   /* announce the push before checking gLogAsync, so that once
+    * mongoc_log_set_async (false) has seen no pushers every later message
+    * takes the synchronous path and none is left behind in a ring */
+   bson_atomic_int_add (&gLogAsyncPushers, 1);
+
+   if (!gLogAsync) {
+      _mongoc_log_async_push_done ();
+      return false;
+   }
+
+   ring = _mongoc_log_ring_get ();
+   head = ring->head;
+
+   if (head - ring->tail >= MONGOC_LOG_ASYNC_RING_SIZE) {
+      bson_atomic_int_add (&ring->dropped, 1);
+      _mongoc_log_async_push_done ();
+      return true;
+   }
+
+   entry = &ring->entries[head % MONGOC_LOG_ASYNC_RING_SIZE];
+   entry->log_level = log_level;
+   bson_strncpy (entry->log_domain, log_domain ? log_domain : "",
+                 sizeof entry->log_domain);
+   bson_vsnprintf (entry->message, sizeof entry->message, format, args);
+
+   /* publish the entry before the new head */
+   bson_memory_barrier ();
+   ring->head = head + 1;
+
+   _mongoc_log_async_push_done ();
+
+   return true;
+}
+
+
+static void
+_mongoc_log_call (mongoc_log_level_t  log_level,
+                  const char         *log_domain,
+                  const char         *message)
+{
+   mongoc_mutex_lock (&gLogMutex);
+
+   if (gLogFunc) {
+      gLogFunc (log_level, log_domain, message, gLogData);
+   }
+
+   mongoc_mutex_unlock (&gLogMutex);
+}
+
+
+/* pass a message to the handler unless this second's quota is used up;
+ * errors and critical messages are always passed and don't count */
+static void
+_mongoc_log_async_deliver (mongoc_log_level_t  log_level,
+                           const char         *log_domain,
+                           const char         *message)
+{
+   mongoc_log_writer_t *writer = &gLogWriter;
+   char summary[64];
+   int64_t now;
+
+   if (log_level <= MONGOC_LOG_LEVEL_CRITICAL) {
+      _mongoc_log_call (log_level, log_domain, message);
+      return;
+   }
+
+   now = bson_get_monotonic_time ();
+
+   if (now - writer->window_start >= 1000000) {
+      writer->window_start = now;
+      writer->in_window = 0;
+
+      if (writer->suppressed) {
+         bson_snprintf (summary, sizeof summary,
+                        "%u log messages suppressed", writer->suppressed);
+         writer->suppressed = 0;
+         writer->in_window++;
+         _mongoc_log_call (MONGOC_LOG_LEVEL_WARNING, "mongoc", summary);
+      }
+   }
+
+   if (writer->in_window >= MONGOC_LOG_ASYNC_MAX_PER_SEC) {
+      writer->suppressed++;
+      return;
+   }
+
+   writer->in_window++;
+   _mongoc_log_call (log_level, log_domain, message);
+}
+
+
+static void
+_mongoc_log_async_flush_repeats (void)
+{
+   mongoc_log_writer_t *writer = &gLogWriter;
+   char summary[64];
+
+   if (writer->repeats) {
+      bson_snprintf (summary, sizeof summary,
+                     "last message repeated %u times", writer->repeats);
+      writer->repeats = 0;
+      _mongoc_log_async_deliver (writer->last.log_level,
+                                 writer->last.log_domain, summary);
+   }
+}
+
+
+static void
+_mongoc_log_async_emit (const mongoc_log_entry_t *entry)
+{
+   mongoc_log_writer_t *writer = &gLogWriter;
+
+   writer->last_time = bson_get_monotonic_time ();
+
+   if (writer->has_last &&
+       writer->last.log_level == entry->log_level &&
+       !strcmp (writer->last.log_domain, entry->log_domain) &&
+       !strcmp (writer->last.message, entry->message)) {
+      writer->repeats++;
+      return;
+   }
+
+   _mongoc_log_async_flush_repeats ();
+   memcpy (&writer->last, entry, sizeof writer->last);
+   writer->has_last = true;
+   _mongoc_log_async_deliver (entry->log_level, entry->log_domain,
+                              entry->message);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_log_async_drain --
+ *
+ *       Deliver every message in every ring. Called only by the writer
+ *       thread, or after it has stopped.
+ *
+ * Returns:
+ *       The number of messages taken from the rings.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static uint32_t
+_mongoc_log_async_drain (void)
+{
+   mongoc_log_ring_t *ring;
+   uint32_t head;
+   uint32_t n = 0;
+   int32_t dropped = 0;
+   int32_t d;
+   char summary[64];
+
+   /* new rings are only ever prepended, so no lock to walk the list */
+   mongoc_mutex_lock (&gLogRingsMutex);
+   ring = gLogRings;
+   mongoc_mutex_unlock (&gLogRingsMutex);
+
+   for (; ring; ring = ring->next) {
+      head = ring->head;
+      bson_memory_barrier ();
+
+      while (ring->tail != head) {
+         _mongoc_log_async_emit (
+            &ring->entries[ring->tail % MONGOC_LOG_ASYNC_RING_SIZE]);
+         bson_memory_barrier ();
+         ring->tail++;
+         n++;
+      }
+
+      if ((d = ring->dropped)) {
+         bson_atomic_int_add (&ring->dropped, -d);
+         dropped += d;
+      }
+   }
+
+   if (dropped) {
+      _mongoc_log_async_flush_repeats ();
+      bson_snprintf (summary, sizeof summary,
+                     "%d log messages dropped, log buffer full", dropped);
+      _mongoc_log_async_deliver (MONGOC_LOG_LEVEL_WARNING, "mongoc", summary);
+   }
+
+   if (gLogWriter.repeats &&
+       bson_get_monotonic_time () - gLogWriter.last_time >= 1000000) {
+      _mongoc_log_async_flush_repeats ();
+   }
+
+   /* free the rings of threads that have exited */
+   mongoc_mutex_lock (&gLogRingsMutex);
+   _mongoc_log_rings_reap ();
+   mongoc_mutex_unlock (&gLogRingsMutex);
+
+   return n;
+}
+
+
+static void *
+_mongoc_log_async_writer (void *data)
+{
+   int64_t wait_msec = 1;
+   bool running = true;
+
+   while (running) {
+      if (_mongoc_log_async_drain ()) {
+         wait_msec = 1;
+      } else {
+         /* back off while idle */
+         wait_msec = BSON_MIN (wait_msec * 2, 100);
+      }
+
+      mongoc_mutex_lock (&gLogWriterMutex);
+
+      if (gLogWriterRunning) {
+         mongoc_cond_timedwait (&gLogWriterCond, &gLogWriterMutex, wait_msec);
+      }
+
+      running = gLogWriterRunning;
+      mongoc_mutex_unlock (&gLogWriterMutex);
+   }
+
+   return NULL;
+}
+#endif
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_log_set_async --
+ *
+ *       Start or stop the background log writer. While it runs,
+ *       mongoc_log formats each message into a ring owned by the calling
+ *       thread and returns without taking the log lock.
+ *
+ * Returns:
+ *       true if logging is now in the requested mode, false if async
+ *       logging isn't supported on this platform.
+ *
+ * Side effects:
+ *       Stopping the writer delivers any messages still queued.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_log_set_async (bool async)
+{
+#ifdef MONGOC_LOG_ASYNC_SUPPORTED
+   bool ret = true;
+
+   mongoc_once (&gLogOnce, &_mongoc_ensure_mutex_once);
+   mongoc_mutex_lock (&gLogAsyncMutex);
+
+   if (async && !gLogAsync) {
+      if (!gLogRingKeyCreated) {
+         if (pthread_key_create (&gLogRingKey, _mongoc_log_ring_abandon)) {
+            mongoc_mutex_unlock (&gLogAsyncMutex);
+            return false;
+         }
+
+         gLogRingKeyCreated = true;
+      }
+
+      memset (&gLogWriter, 0, sizeof gLogWriter);
+      gLogWriterRunning = true;
+
+      if (mongoc_thread_create (&gLogWriterThread, _mongoc_log_async_writer,
+                                NULL)) {
+         gLogWriterRunning = false;
+         ret = false;
+      } else {
+         bson_memory_barrier ();
+         gLogAsync = 1;
+      }
+   } else if (!async && gLogAsync) {
+      gLogAsync = 0;
+      bson_memory_barrier ();
+
+      /* wait out threads that saw gLogAsync set and are still pushing */
+      mongoc_mutex_lock (&gLogPushersMutex);
+
+      while (gLogAsyncPushers) {
+         mongoc_cond_wait (&gLogPushersCond, &gLogPushersMutex);
+      }
+
+      mongoc_mutex_unlock (&gLogPushersMutex);
+
+      mongoc_mutex_lock (&gLogWriterMutex);
+      gLogWriterRunning = false;
+      mongoc_cond_signal (&gLogWriterCond);
+      mongoc_mutex_unlock (&gLogWriterMutex);
+      mongoc_thread_join (gLogWriterThread);
+
+      /* whatever was logged while the writer stopped */
+      _mongoc_log_async_drain ();
+      _mongoc_log_async_flush_repeats ();
+   }
+
+   mongoc_mutex_unlock (&gLogAsyncMutex);
+
+   return ret;
+#else
+   return !async;
+#endif
+}
+
+
+void
+_mongoc_log_cleanup (void)
+{
+#ifdef MONGOC_LOG_ASYNC_SUPPORTED
+   mongoc_log_set_async (false);
+
+   /* live threads still hold their rings in gLogRingKey and reuse them if
+    * async logging is enabled again, so keep the key and free only the
+    * rings of threads that have exited */
+   mongoc_mutex_lock (&gLogAsyncMutex);
+   mongoc_mutex_lock (&gLogRingsMutex);
+   _mongoc_log_rings_reap ();
+   mongoc_mutex_unlock (&gLogRingsMutex);
+   mongoc_mutex_unlock (&gLogAsyncMutex);
+#endif
+}
+
+
 void
 mongoc_log (mongoc_log_level_t  log_level,
             const char         *log_domain,
@@ -76,10 +585,9 @@ mongoc_log (mongoc_log_level_t  log_level,
 {
    va_list args;
    char *message;
-   static mongoc_once_t once = MONGOC_ONCE_INIT;
    int stop_logging;
 
-   mongoc_once(&once, &_mongoc_ensure_mutex_once);
+   mongoc_once(&gLogOnce, &_mongoc_ensure_mutex_once);
 
    stop_logging = !gLogFunc;
 #ifdef MONGOC_TRACE
@@ -91,6 +599,19 @@ mongoc_log (mongoc_log_level_t  log_level,
 
    BSON_ASSERT (format);
 
+#ifdef MONGOC_LOG_ASYNC_SUPPORTED
+   if (gLogAsync) {
+      va_start (args, format);
+      stop_logging = _mongoc_log_async_push (log_level, log_domain,
+                                             format, args);
+      va_end (args);
+
+      if (stop_logging) {
+         return;
+      }
+   }
+#endif
+
    va_start(args, format);
    message = bson_strdupv_printf(format, args);
    va_end(args);
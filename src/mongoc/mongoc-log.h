@@ -92,6 +92,8 @@ void mongoc_log_set_handler (mongoc_log_func_t  log_func,
  * logging infrastructure. It is important that your configured log function
  * does not re-enter the logging system or deadlock will occur.
  *
+ * If asynchronous logging is enabled the message is queued instead and
+ * the log function is called later from a background thread.
  */
 void mongoc_log (mongoc_log_level_t  log_level,
                  const char         *log_domain,
@@ -101,6 +103,19 @@ void mongoc_log (mongoc_log_level_t  log_level,
 
 
 
+/**
+ * mongoc_log_set_async:
+ * @async: Whether to log asynchronously.
+ *
+ * Starts or stops a background thread that calls the log function, so
+ * that logging threads never wait for the logging lock. Repeated messages
+ * are collapsed and the message rate is limited.
+ *
+ * Returns: false if asynchronous logging is not supported on this platform.
+ */
+bool mongoc_log_set_async (bool async);
+
+
 void mongoc_log_default_handler (mongoc_log_level_t  log_level,
                                  const char         *log_domain,
                                  const char         *message,
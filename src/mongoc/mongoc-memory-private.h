@@ -0,0 +1,46 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_MEMORY_PRIVATE_H
+#define MONGOC_MEMORY_PRIVATE_H
+
+#if !defined (MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-memory.h"
+
+
+BSON_BEGIN_DECLS
+
+
+void *_mongoc_malloc                (mongoc_memory_subsystem_t  subsystem,
+                                     size_t                     num_bytes);
+void *_mongoc_malloc0               (mongoc_memory_subsystem_t  subsystem,
+                                     size_t                     num_bytes);
+void  _mongoc_free                  (mongoc_memory_subsystem_t  subsystem,
+                                     void                      *mem);
+void *_mongoc_memory_buffer_realloc (void                      *mem,
+                                     size_t                     num_bytes,
+                                     void                      *ctx);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_MEMORY_PRIVATE_H */
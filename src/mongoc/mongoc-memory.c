@@ -0,0 +1,250 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mongoc-counters-private.h"
+#include "mongoc-memory-private.h"
+
+
+/* precedes each allocation. the allocator is recorded so memory is freed
+ * correctly even if the application installs another one meanwhile. */
+typedef struct
+{
+   size_t             size;
+   bson_realloc_func  realloc_func;
+   void              *ctx;
+   int32_t            subsystem;
+} mongoc_memory_header_t;
+
+
+/* keep the caller's memory aligned as malloc's is */
+#define HEADER_SIZE 32
+
+BSON_STATIC_ASSERT (sizeof (mongoc_memory_header_t) <= HEADER_SIZE);
+
+
+static bson_realloc_func gReallocFunc = bson_realloc_ctx;
+static void *gReallocCtx;
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_memory_set_allocator --
+ *
+ *       Allocate the memory of buffers, cursors, topology monitoring, and
+ *       GridFS file pages with @realloc_func instead of libbson's
+ *       allocator. @realloc_func must behave like realloc (): it allocates
+ *       when passed NULL and frees when asked for zero bytes.
+ *
+ *       Pass NULL to restore the default. Memory is always freed by the
+ *       allocator it came from, but this function is not thread-safe:
+ *       call it before starting threads that use the driver.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_memory_set_allocator (bson_realloc_func  realloc_func,
+                             void              *ctx)
+{
+   if (realloc_func) {
+      gReallocFunc = realloc_func;
+      gReallocCtx = ctx;
+   } else {
+      gReallocFunc = bson_realloc_ctx;
+      gReallocCtx = NULL;
+   }
+}
+
+
+static void
+_mongoc_memory_count (int32_t subsystem,
+                      int64_t bytes)
+{
+   switch (subsystem) {
+   case MONGOC_MEMORY_BUFFERS:
+      mongoc_counter_memory_buffers_add (bytes);
+      break;
+   case MONGOC_MEMORY_CURSORS:
+      mongoc_counter_memory_cursors_add (bytes);
+      break;
+   case MONGOC_MEMORY_TOPOLOGY:
+      mongoc_counter_memory_topology_add (bytes);
+      break;
+   case MONGOC_MEMORY_GRIDFS:
+      mongoc_counter_memory_gridfs_add (bytes);
+      break;
+   default:
+      BSON_ASSERT (false);
+   }
+}
+
+
+int64_t
+mongoc_memory_live_bytes (mongoc_memory_subsystem_t subsystem)
+{
+   switch (subsystem) {
+   case MONGOC_MEMORY_BUFFERS:
+      return mongoc_counter_memory_buffers_count ();
+   case MONGOC_MEMORY_CURSORS:
+      return mongoc_counter_memory_cursors_count ();
+   case MONGOC_MEMORY_TOPOLOGY:
+      return mongoc_counter_memory_topology_count ();
+   case MONGOC_MEMORY_GRIDFS:
+      return mongoc_counter_memory_gridfs_count ();
+   default:
+      return 0;
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_memory_stats --
+ *
+ *       Report the bytes currently allocated by each subsystem, like:
+ *
+ *       { "buffers": 16384, "cursors": 1216, "topology": 2048,
+ *         "gridfs": 0, "total": 19648 }
+ *
+ * Side effects:
+ *       @stats is initialized.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_memory_stats (bson_t *stats)
+{
+   int64_t buffers = mongoc_memory_live_bytes (MONGOC_MEMORY_BUFFERS);
+   int64_t cursors = mongoc_memory_live_bytes (MONGOC_MEMORY_CURSORS);
+   int64_t topology = mongoc_memory_live_bytes (MONGOC_MEMORY_TOPOLOGY);
+   int64_t gridfs = mongoc_memory_live_bytes (MONGOC_MEMORY_GRIDFS);
+
+   BSON_ASSERT (stats);
+
+   bson_init (stats);
+   BSON_APPEND_INT64 (stats, "buffers", buffers);
+   BSON_APPEND_INT64 (stats, "cursors", cursors);
+   BSON_APPEND_INT64 (stats, "topology", topology);
+   BSON_APPEND_INT64 (stats, "gridfs", gridfs);
+   BSON_APPEND_INT64 (stats, "total", buffers + cursors + topology + gridfs);
+}
+
+
+static void *
+_mongoc_memory_realloc (int32_t  subsystem,
+                        void    *mem,
+                        size_t   num_bytes)
+{
+   mongoc_memory_header_t *header;
+   bson_realloc_func realloc_func;
+   void *ctx;
+   int64_t old_size = 0;
+
+   if (mem) {
+      header = (mongoc_memory_header_t *)((uint8_t *)mem - HEADER_SIZE);
+      BSON_ASSERT (header->subsystem == subsystem);
+      realloc_func = header->realloc_func;
+      ctx = header->ctx;
+      old_size = (int64_t)(HEADER_SIZE + header->size);
+   } else {
+      header = NULL;
+      realloc_func = gReallocFunc;
+      ctx = gReallocCtx;
+   }
+
+   header = (mongoc_memory_header_t *)realloc_func (header,
+                                                    HEADER_SIZE + num_bytes,
+                                                    ctx);
+
+   if (BSON_UNLIKELY (!header)) {
+      fprintf (stderr,
+               "Failure to allocate memory in _mongoc_memory_realloc(). "
+               "errno: %d.\n", errno);
+      abort ();
+   }
+
+   header->size = num_bytes;
+   header->realloc_func = realloc_func;
+   header->ctx = ctx;
+   header->subsystem = subsystem;
+
+   _mongoc_memory_count (subsystem,
+                         (int64_t)(HEADER_SIZE + num_bytes) - old_size);
+
+   return (uint8_t *)header + HEADER_SIZE;
+}
+
+
+void *
+_mongoc_malloc (mongoc_memory_subsystem_t subsystem,
+                size_t                    num_bytes)
+{
+   return _mongoc_memory_realloc (subsystem, NULL, num_bytes);
+}
+
+
+void *
+_mongoc_malloc0 (mongoc_memory_subsystem_t subsystem,
+                 size_t                    num_bytes)
+{
+   void *mem;
+
+   mem = _mongoc_memory_realloc (subsystem, NULL, num_bytes);
+   memset (mem, 0, num_bytes);
+
+   return mem;
+}
+
+
+void
+_mongoc_free (mongoc_memory_subsystem_t  subsystem,
+              void                      *mem)
+{
+   mongoc_memory_header_t *header;
+
+   if (!mem) {
+      return;
+   }
+
+   header = (mongoc_memory_header_t *)((uint8_t *)mem - HEADER_SIZE);
+   BSON_ASSERT (header->subsystem == (int32_t)subsystem);
+   _mongoc_memory_count (subsystem, -(int64_t)(HEADER_SIZE + header->size));
+   header->realloc_func (header, 0, header->ctx);
+}
+
+
+/* a bson_realloc_func for mongoc_buffer_t's own buffers */
+void *
+_mongoc_memory_buffer_realloc (void   *mem,
+                               size_t  num_bytes,
+                               void   *ctx)
+{
+   if (!num_bytes) {
+      _mongoc_free (MONGOC_MEMORY_BUFFERS, mem);
+      return NULL;
+   }
+
+   return _mongoc_memory_realloc (MONGOC_MEMORY_BUFFERS, mem, num_bytes);
+}
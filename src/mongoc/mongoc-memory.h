@@ -0,0 +1,48 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_MEMORY_H
+#define MONGOC_MEMORY_H
+
+#if !defined (MONGOC_INSIDE) && !defined (MONGOC_COMPILATION)
+# error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+
+BSON_BEGIN_DECLS
+
+
+typedef enum
+{
+   MONGOC_MEMORY_BUFFERS,
+   MONGOC_MEMORY_CURSORS,
+   MONGOC_MEMORY_TOPOLOGY,
+   MONGOC_MEMORY_GRIDFS,
+} mongoc_memory_subsystem_t;
+
+
+void    mongoc_memory_set_allocator (bson_realloc_func          realloc_func,
+                                     void                      *ctx);
+int64_t mongoc_memory_live_bytes    (mongoc_memory_subsystem_t  subsystem);
+void    mongoc_memory_stats         (bson_t                    *stats);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_MEMORY_H */
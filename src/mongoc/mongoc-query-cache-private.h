@@ -0,0 +1,118 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_QUERY_CACHE_PRIVATE_H
+#define MONGOC_QUERY_CACHE_PRIVATE_H
+
+#if !defined (MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-array-private.h"
+#include "mongoc-flags.h"
+#include "mongoc-read-prefs.h"
+#include "mongoc-thread-private.h"
+
+
+BSON_BEGIN_DECLS
+
+
+#define MONGOC_QUERY_CACHE_BUCKETS 1024
+
+
+typedef struct _mongoc_query_cache_entry_t mongoc_query_cache_entry_t;
+
+
+struct _mongoc_query_cache_entry_t
+{
+   uint32_t                    hash;
+   bson_t                      key;
+   size_t                      ns_index;    /* in the cache's namespaces */
+   bson_t                      result;
+   int64_t                     expires_at;  /* 0 if no TTL */
+   size_t                      bytes;
+   mongoc_query_cache_entry_t *bucket_next;
+   mongoc_query_cache_entry_t *prev;        /* least recently used order */
+   mongoc_query_cache_entry_t *next;
+   mongoc_query_cache_entry_t *ns_prev;     /* the namespace's entries */
+   mongoc_query_cache_entry_t *ns_next;
+};
+
+
+typedef struct
+{
+   char                       *ns;
+   int64_t                     generation;  /* incremented on invalidation */
+   mongoc_query_cache_entry_t *entries;
+} mongoc_query_cache_ns_t;
+
+
+/* shared by the clients of a pool, all access is under the mutex except
+ * "enabled", which lets operations skip the cache without locking */
+typedef struct _mongoc_query_cache_t
+{
+   mongoc_mutex_t              mutex;
+   volatile int32_t            enabled;     /* has max_bytes and namespaces */
+   size_t                      max_bytes;   /* 0 if disabled */
+   int64_t                     ttl_usec;    /* 0 if entries don't expire */
+   size_t                      bytes;
+   mongoc_array_t              namespaces;  /* mongoc_query_cache_ns_t */
+   mongoc_query_cache_entry_t *buckets[MONGOC_QUERY_CACHE_BUCKETS];
+   mongoc_query_cache_entry_t *lru;         /* most recently used first */
+} mongoc_query_cache_t;
+
+
+mongoc_query_cache_t *_mongoc_query_cache_new        (void);
+void                  _mongoc_query_cache_destroy    (mongoc_query_cache_t      *cache);
+void                  _mongoc_query_cache_configure  (mongoc_query_cache_t      *cache,
+                                                      size_t                     max_bytes,
+                                                      int64_t                    ttl_msec);
+void                  _mongoc_query_cache_add_ns     (mongoc_query_cache_t      *cache,
+                                                      const char                *ns);
+bool                  _mongoc_query_cache_enabled    (mongoc_query_cache_t      *cache,
+                                                      const char                *ns);
+size_t                _mongoc_query_cache_max_result (mongoc_query_cache_t      *cache);
+int64_t               _mongoc_query_cache_generation (mongoc_query_cache_t      *cache,
+                                                      const char                *ns);
+void                  _mongoc_query_cache_key        (bson_t                    *key,
+                                                      const char                *kind,
+                                                      const char                *ns,
+                                                      const bson_t              *query,
+                                                      const bson_t              *fields,
+                                                      int64_t                    skip,
+                                                      int64_t                    limit,
+                                                      const bson_t              *opts,
+                                                      mongoc_query_flags_t       flags,
+                                                      const mongoc_read_prefs_t *read_prefs,
+                                                      const char                *read_concern_level);
+bool                  _mongoc_query_cache_get        (mongoc_query_cache_t      *cache,
+                                                      const bson_t              *key,
+                                                      bson_t                    *result);
+void                  _mongoc_query_cache_put        (mongoc_query_cache_t      *cache,
+                                                      int64_t                    generation,
+                                                      const char                *ns,
+                                                      const bson_t              *key,
+                                                      const bson_t              *result);
+void                  _mongoc_query_cache_invalidate (mongoc_query_cache_t      *cache,
+                                                      const char                *ns);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_QUERY_CACHE_PRIVATE_H */
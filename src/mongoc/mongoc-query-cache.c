@@ -0,0 +1,589 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mongoc-query-cache-private.h"
+#include "mongoc-read-prefs-private.h"
+#include "mongoc-trace.h"
+
+#include "utlist.h"
+
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "query-cache"
+
+
+/* a result may use at most this fraction of the cache */
+#define MAX_RESULT_FRACTION 4
+
+
+mongoc_query_cache_t *
+_mongoc_query_cache_new (void)
+{
+   mongoc_query_cache_t *cache;
+
+   cache = (mongoc_query_cache_t *)bson_malloc0 (sizeof *cache);
+   mongoc_mutex_init (&cache->mutex);
+   _mongoc_array_init (&cache->namespaces, sizeof (mongoc_query_cache_ns_t));
+
+   return cache;
+}
+
+
+static void
+_entry_destroy (mongoc_query_cache_entry_t *entry)
+{
+   bson_destroy (&entry->key);
+   bson_destroy (&entry->result);
+   bson_free (entry);
+}
+
+
+#define NS_AT(cache, i) \
+   (&_mongoc_array_index (&(cache)->namespaces, mongoc_query_cache_ns_t, (i)))
+
+
+/* call with the mutex locked */
+static mongoc_query_cache_ns_t *
+_find_ns (mongoc_query_cache_t *cache,
+          const char           *ns,
+          size_t               *ns_index)
+{
+   size_t i;
+
+   for (i = 0; i < cache->namespaces.len; i++) {
+      if (!strcmp (ns, NS_AT (cache, i)->ns)) {
+         if (ns_index) {
+            *ns_index = i;
+         }
+
+         return NS_AT (cache, i);
+      }
+   }
+
+   return NULL;
+}
+
+
+/* call with the mutex locked */
+static void
+_update_enabled (mongoc_query_cache_t *cache)
+{
+   bson_memory_barrier ();
+   cache->enabled = cache->max_bytes && cache->namespaces.len;
+}
+
+
+/* call with the mutex locked */
+static void
+_entry_remove (mongoc_query_cache_t       *cache,
+               mongoc_query_cache_entry_t *entry)
+{
+   mongoc_query_cache_entry_t **link;
+
+   link = &cache->buckets[entry->hash % MONGOC_QUERY_CACHE_BUCKETS];
+
+   while (*link != entry) {
+      link = &(*link)->bucket_next;
+   }
+
+   *link = entry->bucket_next;
+   DL_DELETE (cache->lru, entry);
+   DL_DELETE2 (NS_AT (cache, entry->ns_index)->entries, entry,
+               ns_prev, ns_next);
+   cache->bytes -= entry->bytes;
+   _entry_destroy (entry);
+}
+
+
+/* call with the mutex locked */
+static void
+_clear (mongoc_query_cache_t *cache)
+{
+   while (cache->lru) {
+      _entry_remove (cache, cache->lru);
+   }
+}
+
+
+void
+_mongoc_query_cache_destroy (mongoc_query_cache_t *cache)
+{
+   size_t i;
+
+   if (!cache) {
+      return;
+   }
+
+   _clear (cache);
+
+   for (i = 0; i < cache->namespaces.len; i++) {
+      bson_free (NS_AT (cache, i)->ns);
+   }
+
+   _mongoc_array_destroy (&cache->namespaces);
+   mongoc_mutex_destroy (&cache->mutex);
+   bson_free (cache);
+}
+
+
+void
+_mongoc_query_cache_configure (mongoc_query_cache_t *cache,
+                               size_t                max_bytes,
+                               int64_t               ttl_msec)
+{
+   size_t i;
+
+   BSON_ASSERT (cache);
+
+   mongoc_mutex_lock (&cache->mutex);
+   _clear (cache);
+
+   for (i = 0; i < cache->namespaces.len; i++) {
+      NS_AT (cache, i)->generation++;
+   }
+
+   cache->max_bytes = max_bytes;
+   cache->ttl_usec = ttl_msec > 0 ? ttl_msec * 1000 : 0;
+   _update_enabled (cache);
+   mongoc_mutex_unlock (&cache->mutex);
+}
+
+
+void
+_mongoc_query_cache_add_ns (mongoc_query_cache_t *cache,
+                            const char           *ns)
+{
+   mongoc_query_cache_ns_t cache_ns = { 0 };
+
+   BSON_ASSERT (cache);
+   BSON_ASSERT (ns);
+
+   mongoc_mutex_lock (&cache->mutex);
+
+   if (!_find_ns (cache, ns, NULL)) {
+      cache_ns.ns = bson_strdup (ns);
+      _mongoc_array_append_val (&cache->namespaces, cache_ns);
+      _update_enabled (cache);
+   }
+
+   mongoc_mutex_unlock (&cache->mutex);
+}
+
+
+bool
+_mongoc_query_cache_enabled (mongoc_query_cache_t *cache,
+                             const char           *ns)
+{
+   bool ret;
+
+   /* most pools cache nothing, don't make their operations lock */
+   if (!cache || !cache->enabled) {
+      return false;
+   }
+
+   mongoc_mutex_lock (&cache->mutex);
+   ret = cache->max_bytes && _find_ns (cache, ns, NULL);
+   mongoc_mutex_unlock (&cache->mutex);
+
+   return ret;
+}
+
+
+/* results larger than this are not worth evicting everything else for */
+size_t
+_mongoc_query_cache_max_result (mongoc_query_cache_t *cache)
+{
+   size_t ret;
+
+   mongoc_mutex_lock (&cache->mutex);
+   ret = cache->max_bytes / MAX_RESULT_FRACTION;
+   mongoc_mutex_unlock (&cache->mutex);
+
+   return ret;
+}
+
+
+/* a result read across an invalidation of its namespace may be stale, it
+ * is not stored */
+int64_t
+_mongoc_query_cache_generation (mongoc_query_cache_t *cache,
+                                const char           *ns)
+{
+   mongoc_query_cache_ns_t *cache_ns;
+   int64_t ret = -1;
+
+   mongoc_mutex_lock (&cache->mutex);
+
+   if ((cache_ns = _find_ns (cache, ns, NULL))) {
+      ret = cache_ns->generation;
+   }
+
+   mongoc_mutex_unlock (&cache->mutex);
+
+   return ret;
+}
+
+
+static int
+_iter_key_cmp (const void *a,
+               const void *b)
+{
+   return strcmp (bson_iter_key ((const bson_iter_t *)a),
+                  bson_iter_key ((const bson_iter_t *)b));
+}
+
+
+/* a filter's top-level fields are ANDed, so their order doesn't matter:
+ * append them sorted, so {a: 1, b: 1} and {b: 1, a: 1} share an entry */
+static void
+_append_normalized_filter (bson_t       *key,
+                           const bson_t *filter)
+{
+   mongoc_array_t fields;
+   bson_iter_t iter;
+   bson_t child;
+   size_t i;
+
+   _mongoc_array_init (&fields, sizeof (bson_iter_t));
+
+   if (bson_iter_init (&iter, filter)) {
+      while (bson_iter_next (&iter)) {
+         _mongoc_array_append_val (&fields, iter);
+      }
+   }
+
+   if (fields.len > 1) {
+      qsort (fields.data, fields.len, sizeof (bson_iter_t), _iter_key_cmp);
+   }
+
+   bson_append_document_begin (key, "filter", 6, &child);
+
+   for (i = 0; i < fields.len; i++) {
+      bson_append_iter (&child, NULL, 0,
+                        &_mongoc_array_index (&fields, bson_iter_t, i));
+   }
+
+   bson_append_document_end (key, &child);
+   _mongoc_array_destroy (&fields);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_query_cache_key --
+ *
+ *       Build the key for a query: everything that could change its
+ *       result. A query with "$query" and other modifiers is keyed by
+ *       its filter and, separately, its modifiers, so a plain filter and
+ *       the same filter in "$query" share an entry.
+ *
+ * Side effects:
+ *       Initializes @key.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_query_cache_key (bson_t                    *key,
+                         const char                *kind,
+                         const char                *ns,
+                         const bson_t              *query,
+                         const bson_t              *fields,
+                         int64_t                    skip,
+                         int64_t                    limit,
+                         const bson_t              *opts,
+                         mongoc_query_flags_t       flags,
+                         const mongoc_read_prefs_t *read_prefs,
+                         const char                *read_concern_level)
+{
+   bson_iter_t iter;
+   bson_t modifiers;
+   bson_t filter;
+   uint32_t len;
+   const uint8_t *data;
+   bool has_query = false;
+
+   bson_init (key);
+   BSON_APPEND_UTF8 (key, "kind", kind);
+   BSON_APPEND_UTF8 (key, "ns", ns);
+
+   if (query && bson_iter_init_find (&iter, query, "$query") &&
+       BSON_ITER_HOLDS_DOCUMENT (&iter)) {
+      has_query = true;
+      bson_iter_document (&iter, &len, &data);
+      bson_init_static (&filter, data, len);
+      _append_normalized_filter (key, &filter);
+
+      bson_append_document_begin (key, "modifiers", 9, &modifiers);
+      bson_iter_init (&iter, query);
+
+      while (bson_iter_next (&iter)) {
+         if (strcmp (bson_iter_key (&iter), "$query")) {
+            bson_append_iter (&modifiers, NULL, 0, &iter);
+         }
+      }
+
+      bson_append_document_end (key, &modifiers);
+   }
+
+   if (query && !has_query) {
+      _append_normalized_filter (key, query);
+   }
+
+   if (fields && !bson_empty (fields)) {
+      BSON_APPEND_DOCUMENT (key, "fields", fields);
+   }
+
+   BSON_APPEND_INT64 (key, "skip", skip);
+   BSON_APPEND_INT64 (key, "limit", limit);
+
+   if (opts && !bson_empty (opts)) {
+      BSON_APPEND_DOCUMENT (key, "opts", opts);
+   }
+
+   BSON_APPEND_INT32 (key, "flags", (int32_t) flags);
+
+   if (read_prefs) {
+      BSON_APPEND_INT32 (key, "mode", (int32_t) read_prefs->mode);
+
+      if (!bson_empty (&read_prefs->tags)) {
+         BSON_APPEND_ARRAY (key, "tags", &read_prefs->tags);
+      }
+   }
+
+   if (read_concern_level) {
+      BSON_APPEND_UTF8 (key, "readConcern", read_concern_level);
+   }
+}
+
+
+static uint32_t
+_hash (const bson_t *key)
+{
+   const uint8_t *data = bson_get_data (key);
+   uint32_t hash = 5381;
+   uint32_t i;
+
+   for (i = 0; i < key->len; i++) {
+      hash = ((hash << 5) + hash) + data[i];
+   }
+
+   return hash;
+}
+
+
+/* call with the mutex locked */
+static mongoc_query_cache_entry_t *
+_find (mongoc_query_cache_t *cache,
+       const bson_t         *key,
+       uint32_t              hash)
+{
+   mongoc_query_cache_entry_t *entry;
+
+   entry = cache->buckets[hash % MONGOC_QUERY_CACHE_BUCKETS];
+
+   for (; entry; entry = entry->bucket_next) {
+      if (entry->hash == hash &&
+          entry->key.len == key->len &&
+          !memcmp (bson_get_data (&entry->key), bson_get_data (key),
+                   key->len)) {
+         return entry;
+      }
+   }
+
+   return NULL;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_query_cache_get --
+ *
+ *       Look up the result stored for @key.
+ *
+ * Returns:
+ *       true and @result is initialized with a copy of it, or false if
+ *       there is no result or it has expired.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_query_cache_get (mongoc_query_cache_t *cache,
+                         const bson_t         *key,
+                         bson_t               *result)
+{
+   mongoc_query_cache_entry_t *entry;
+   bool ret = false;
+
+   BSON_ASSERT (cache);
+   BSON_ASSERT (key);
+
+   mongoc_mutex_lock (&cache->mutex);
+
+   entry = _find (cache, key, _hash (key));
+
+   if (entry && entry->expires_at &&
+       entry->expires_at <= bson_get_monotonic_time ()) {
+      _entry_remove (cache, entry);
+      entry = NULL;
+   }
+
+   if (entry) {
+      /* move to the front, it's the most recently used */
+      DL_DELETE (cache->lru, entry);
+      DL_PREPEND (cache->lru, entry);
+      bson_copy_to (&entry->result, result);
+      ret = true;
+   }
+
+   mongoc_mutex_unlock (&cache->mutex);
+
+   return ret;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_query_cache_put --
+ *
+ *       Store @result for @key, evicting the least recently used results
+ *       until the cache is within its size bound. Nothing is stored if
+ *       @ns was invalidated since @generation, when the query began.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_query_cache_put (mongoc_query_cache_t *cache,
+                         int64_t               generation,
+                         const char           *ns,
+                         const bson_t         *key,
+                         const bson_t         *result)
+{
+   mongoc_query_cache_entry_t *entry;
+   mongoc_query_cache_ns_t *cache_ns;
+   size_t ns_index;
+   uint32_t hash;
+   size_t bytes;
+
+   BSON_ASSERT (cache);
+
+   hash = _hash (key);
+   bytes = sizeof *entry + key->len + result->len;
+
+   mongoc_mutex_lock (&cache->mutex);
+
+   cache_ns = _find_ns (cache, ns, &ns_index);
+
+   if (!cache->max_bytes ||
+       !cache_ns ||
+       generation != cache_ns->generation ||
+       bytes > cache->max_bytes / MAX_RESULT_FRACTION) {
+      GOTO (done);
+   }
+
+   if ((entry = _find (cache, key, hash))) {
+      _entry_remove (cache, entry);
+   }
+
+   while (cache->lru && cache->bytes + bytes > cache->max_bytes) {
+      /* the list is circular backwards, the head's prev is the tail */
+      _entry_remove (cache, cache->lru->prev);
+   }
+
+   entry = (mongoc_query_cache_entry_t *)bson_malloc0 (sizeof *entry);
+   entry->hash = hash;
+   bson_copy_to (key, &entry->key);
+   bson_copy_to (result, &entry->result);
+   entry->ns_index = ns_index;
+   entry->bytes = bytes;
+
+   if (cache->ttl_usec) {
+      entry->expires_at = bson_get_monotonic_time () + cache->ttl_usec;
+   }
+
+   entry->bucket_next = cache->buckets[hash % MONGOC_QUERY_CACHE_BUCKETS];
+   cache->buckets[hash % MONGOC_QUERY_CACHE_BUCKETS] = entry;
+   DL_PREPEND (cache->lru, entry);
+   DL_PREPEND2 (NS_AT (cache, ns_index)->entries, entry, ns_prev, ns_next);
+   cache->bytes += bytes;
+
+done:
+   mongoc_mutex_unlock (&cache->mutex);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_query_cache_invalidate --
+ *
+ *       Remove the results for namespace @ns. If @ns is a database name,
+ *       or a database's "$cmd" namespace as in oplog entries for commands,
+ *       remove all the database's results. If @ns is NULL, remove all.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_query_cache_invalidate (mongoc_query_cache_t *cache,
+                                const char           *ns)
+{
+   mongoc_query_cache_ns_t *cache_ns;
+   const char *dot = NULL;
+   size_t db_len = 0;
+   bool whole_db = false;
+   size_t i;
+
+   /* nothing can be cached, and a namespace enabled after this check
+    * starts with no results to invalidate */
+   if (!cache || !cache->enabled) {
+      return;
+   }
+
+   if (ns) {
+      dot = strchr (ns, '.');
+      whole_db = !dot || !strcmp (dot, ".$cmd");
+      db_len = dot ? (size_t) (dot - ns) : strlen (ns);
+   }
+
+   mongoc_mutex_lock (&cache->mutex);
+
+   for (i = 0; i < cache->namespaces.len; i++) {
+      cache_ns = NS_AT (cache, i);
+
+      if (!ns ||
+          (whole_db && !strncmp (cache_ns->ns, ns, db_len) &&
+           cache_ns->ns[db_len] == '.') ||
+          (!whole_db && !strcmp (cache_ns->ns, ns))) {
+         cache_ns->generation++;
+
+         while (cache_ns->entries) {
+            _entry_remove (cache, cache_ns->entries);
+         }
+      }
+   }
+
+   mongoc_mutex_unlock (&cache->mutex);
+}
@@ -34,6 +34,8 @@ struct _mongoc_read_prefs_t
    mongoc_read_mode_t mode;
    bson_t             tags;
    int32_t            max_staleness_ms;
+   int32_t            hedge_delay_ms;
+   int32_t            hedge_percentile;
 };
 
 
@@ -30,6 +30,8 @@ mongoc_read_prefs_new (mongoc_read_mode_t mode)
    read_prefs->mode = mode;
    bson_init(&read_prefs->tags);
    read_prefs->max_staleness_ms = 0;  /* no maximum staleness */
+   read_prefs->hedge_delay_ms = 0;    /* no hedged reads */
+   read_prefs->hedge_percentile = 0;
 
    return read_prefs;
 }
@@ -119,6 +121,44 @@ mongoc_read_prefs_set_max_staleness_ms (mongoc_read_prefs_t *read_prefs,
 #endif
 
 
+int32_t
+mongoc_read_prefs_get_hedge_delay_ms (const mongoc_read_prefs_t *read_prefs)
+{
+   BSON_ASSERT (read_prefs);
+
+   return read_prefs->hedge_delay_ms;
+}
+
+
+void
+mongoc_read_prefs_set_hedge_delay_ms (mongoc_read_prefs_t *read_prefs,
+                                      int32_t              hedge_delay_ms)
+{
+   BSON_ASSERT (read_prefs);
+
+   read_prefs->hedge_delay_ms = hedge_delay_ms;
+}
+
+
+int32_t
+mongoc_read_prefs_get_hedge_percentile (const mongoc_read_prefs_t *read_prefs)
+{
+   BSON_ASSERT (read_prefs);
+
+   return read_prefs->hedge_percentile;
+}
+
+
+void
+mongoc_read_prefs_set_hedge_percentile (mongoc_read_prefs_t *read_prefs,
+                                        int32_t              hedge_percentile)
+{
+   BSON_ASSERT (read_prefs);
+
+   read_prefs->hedge_percentile = hedge_percentile;
+}
+
+
 bool
 mongoc_read_prefs_is_valid (const mongoc_read_prefs_t *read_prefs)
 {
@@ -137,6 +177,12 @@ mongoc_read_prefs_is_valid (const mongoc_read_prefs_t *read_prefs)
       return false;
    }
 
+   if (read_prefs->hedge_delay_ms < 0 ||
+       read_prefs->hedge_percentile < 0 ||
+       read_prefs->hedge_percentile > 100) {
+      return false;
+   }
+
    return true;
 }
 
@@ -160,6 +206,8 @@ mongoc_read_prefs_copy (const mongoc_read_prefs_t *read_prefs)
       ret = mongoc_read_prefs_new(read_prefs->mode);
       bson_copy_to(&read_prefs->tags, &ret->tags);
       ret->max_staleness_ms = read_prefs->max_staleness_ms;
+      ret->hedge_delay_ms = read_prefs->hedge_delay_ms;
+      ret->hedge_percentile = read_prefs->hedge_percentile;
    }
 
    return ret;
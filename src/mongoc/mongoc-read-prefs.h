@@ -57,6 +57,12 @@ int32_t              mongoc_read_prefs_get_max_staleness_ms (const mongoc_read_p
 void                 mongoc_read_prefs_set_max_staleness_ms (mongoc_read_prefs_t       *read_prefs,
                                                              int32_t                    max_staleness_ms);
 #endif
+int32_t              mongoc_read_prefs_get_hedge_delay_ms   (const mongoc_read_prefs_t *read_prefs);
+void                 mongoc_read_prefs_set_hedge_delay_ms   (mongoc_read_prefs_t       *read_prefs,
+                                                             int32_t                    hedge_delay_ms);
+int32_t              mongoc_read_prefs_get_hedge_percentile (const mongoc_read_prefs_t *read_prefs);
+void                 mongoc_read_prefs_set_hedge_percentile (mongoc_read_prefs_t       *read_prefs,
+                                                             int32_t                    hedge_percentile);
 bool                 mongoc_read_prefs_is_valid (const mongoc_read_prefs_t *read_prefs);
 
 
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_SCRATCH_PRIVATE_H
+#define MONGOC_SCRATCH_PRIVATE_H
+
+#if !defined (MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-array-private.h"
+
+
+BSON_BEGIN_DECLS
+
+
+/* enough for the commands one operation builds at once */
+#define MONGOC_SCRATCH_DOCS 8
+
+/* a document that grew past this is freed when released, so one huge
+ * write doesn't pin its buffer for the life of the client */
+#define MONGOC_SCRATCH_MAX_RETAIN (1024 * 1024)
+
+
+/*
+ * Per-client buffers for documents and iovecs that live only for the
+ * duration of one operation. Released documents and the iovec array keep
+ * their heap buffers, so once they have grown to fit the application's
+ * commands, building and sending a command allocates nothing.
+ *
+ * Not thread-safe, like the client that owns it.
+ */
+typedef struct _mongoc_scratch_t
+{
+   bson_t         docs[MONGOC_SCRATCH_DOCS];
+   uint32_t       docs_in_use;   /* bitmask */
+   mongoc_array_t iov;
+   bool           iov_in_use;
+} mongoc_scratch_t;
+
+
+void            _mongoc_scratch_init         (mongoc_scratch_t *scratch);
+void            _mongoc_scratch_destroy      (mongoc_scratch_t *scratch);
+bson_t         *_mongoc_scratch_bson         (mongoc_scratch_t *scratch);
+void            _mongoc_scratch_bson_release (mongoc_scratch_t *scratch,
+                                              bson_t           *bson);
+mongoc_array_t *_mongoc_scratch_iov          (mongoc_scratch_t *scratch);
+void            _mongoc_scratch_iov_release  (mongoc_scratch_t *scratch,
+                                              mongoc_array_t   *iov);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_SCRATCH_PRIVATE_H */
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mongoc-iovec.h"
+#include "mongoc-scratch-private.h"
+
+
+void
+_mongoc_scratch_init (mongoc_scratch_t *scratch)
+{
+   int i;
+
+   BSON_ASSERT (scratch);
+
+   for (i = 0; i < MONGOC_SCRATCH_DOCS; i++) {
+      bson_init (&scratch->docs[i]);
+   }
+
+   scratch->docs_in_use = 0;
+   _mongoc_array_init (&scratch->iov, sizeof (mongoc_iovec_t));
+   scratch->iov_in_use = false;
+}
+
+
+void
+_mongoc_scratch_destroy (mongoc_scratch_t *scratch)
+{
+   int i;
+
+   BSON_ASSERT (scratch);
+   BSON_ASSERT (!scratch->docs_in_use);
+   BSON_ASSERT (!scratch->iov_in_use);
+
+   for (i = 0; i < MONGOC_SCRATCH_DOCS; i++) {
+      bson_destroy (&scratch->docs[i]);
+   }
+
+   _mongoc_array_destroy (&scratch->iov);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_scratch_bson --
+ *
+ *       Get an empty document to build a command in. If all the scratch
+ *       documents are in use, e.g. in an operation started from an APM
+ *       callback, a new document is allocated instead.
+ *
+ * Returns:
+ *       A document to release with _mongoc_scratch_bson_release.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bson_t *
+_mongoc_scratch_bson (mongoc_scratch_t *scratch)
+{
+   int i;
+
+   BSON_ASSERT (scratch);
+
+   for (i = 0; i < MONGOC_SCRATCH_DOCS; i++) {
+      if (!(scratch->docs_in_use & (1u << i))) {
+         scratch->docs_in_use |= (1u << i);
+         return &scratch->docs[i];
+      }
+   }
+
+   return bson_new ();
+}
+
+
+void
+_mongoc_scratch_bson_release (mongoc_scratch_t *scratch,
+                              bson_t           *bson)
+{
+   ptrdiff_t i;
+
+   BSON_ASSERT (scratch);
+
+   if (!bson) {
+      return;
+   }
+
+   i = bson - scratch->docs;
+
+   if (i < 0 || i >= MONGOC_SCRATCH_DOCS) {
+      bson_destroy (bson);
+      return;
+   }
+
+   BSON_ASSERT (scratch->docs_in_use & (1u << i));
+   scratch->docs_in_use &= ~(1u << i);
+
+   if (bson->len > MONGOC_SCRATCH_MAX_RETAIN) {
+      bson_destroy (bson);
+      bson_init (bson);
+   } else {
+      /* keeps the buffer */
+      bson_reinit (bson);
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_scratch_iov --
+ *
+ *       Get an empty array of mongoc_iovec_t to gather a message in,
+ *       allocating a new one if the scratch array is in use.
+ *
+ * Returns:
+ *       An array to release with _mongoc_scratch_iov_release.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_array_t *
+_mongoc_scratch_iov (mongoc_scratch_t *scratch)
+{
+   mongoc_array_t *iov;
+
+   BSON_ASSERT (scratch);
+
+   if (!scratch->iov_in_use) {
+      scratch->iov_in_use = true;
+      _mongoc_array_clear (&scratch->iov);
+      return &scratch->iov;
+   }
+
+   iov = (mongoc_array_t *)bson_malloc (sizeof *iov);
+   _mongoc_array_init (iov, sizeof (mongoc_iovec_t));
+
+   return iov;
+}
+
+
+void
+_mongoc_scratch_iov_release (mongoc_scratch_t *scratch,
+                             mongoc_array_t   *iov)
+{
+   BSON_ASSERT (scratch);
+
+   if (iov == &scratch->iov) {
+      scratch->iov_in_use = false;
+   } else if (iov) {
+      _mongoc_array_destroy (iov);
+      bson_free (iov);
+   }
+}
@@ -28,6 +28,17 @@
 /* represent a server or topology with no replica set config version */
 #define MONGOC_NO_SET_VERSION -1
 
+/* how many recent operation latencies are kept per server */
+#define MONGOC_SERVER_LATENCY_WINDOW 32
+
+/* shared by a server description and its copies, so operations using a
+ * copy are counted in the topology's description of the server */
+typedef struct
+{
+   volatile int32_t refs;
+   volatile int32_t in_flight;
+} mongoc_server_load_t;
+
 typedef enum
    {
       MONGOC_SERVER_UNKNOWN,
@@ -53,6 +64,12 @@ struct _mongoc_server_description_t
    const char                      *connection_address;
    const char                      *me;
 
+   /* latencies of recent operations in microseconds, and the operations
+    * in progress. kept when the description is reset */
+   int64_t                          op_latency[MONGOC_SERVER_LATENCY_WINDOW];
+   uint32_t                         op_latency_n;
+   mongoc_server_load_t            *load;
+
    /* The following fields are filled from the last_is_master and are zeroed on
     * parse.  So order matters here.  DON'T move set_name */
    const char                      *set_name;
@@ -110,6 +127,20 @@ void
 mongoc_server_description_update_rtt (mongoc_server_description_t *server,
                                       int64_t                      new_time);
 
+void
+mongoc_server_description_operation_started (mongoc_server_description_t *sd);
+
+void
+mongoc_server_description_operation_finished (mongoc_server_description_t *sd);
+
+void
+mongoc_server_description_record_latency (mongoc_server_description_t *sd,
+                                          int64_t                      usec);
+
+int64_t
+mongoc_server_description_latency_percentile (const mongoc_server_description_t *sd,
+                                              int                                percentile);
+
 void
 mongoc_server_description_handle_ismaster (mongoc_server_description_t   *sd,
                                            const bson_t                  *reply,
@@ -24,6 +24,7 @@
 #include "mongoc-util-private.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #define ALPHA 0.2
 
@@ -39,6 +40,12 @@ mongoc_server_description_cleanup (mongoc_server_description_t *sd)
    BSON_ASSERT(sd);
 
    bson_destroy (&sd->last_is_master);
+
+   if (sd->load && bson_atomic_int_add (&sd->load->refs, -1) == 0) {
+      bson_free (sd->load);
+   }
+
+   sd->load = NULL;
 }
 
 /* Reset fields inside this sd, but keep same id, host information, and RTT,
@@ -98,6 +105,9 @@ mongoc_server_description_init (mongoc_server_description_t *sd,
    sd->type = MONGOC_SERVER_UNKNOWN;
    sd->round_trip_time = -1;
 
+   sd->load = (mongoc_server_load_t *)bson_malloc0 (sizeof *sd->load);
+   sd->load->refs = 1;
+
    sd->set_name = NULL;
    sd->set_version = MONGOC_NO_SET_VERSION;
    sd->current_primary = NULL;
@@ -438,6 +448,127 @@ mongoc_server_description_update_rtt (mongoc_server_description_t *server,
    }
 }
 
+/*
+ *-------------------------------------------------------------------------
+ *
+ * mongoc_server_description_operation_started --
+ *
+ *       Count an operation in progress on this server. Called when a
+ *       stream to the server is checked out, and paired with
+ *       mongoc_server_description_operation_finished when it is
+ *       released. Lock-free, since the count is shared by all copies of
+ *       the description.
+ *
+ *-------------------------------------------------------------------------
+ */
+void
+mongoc_server_description_operation_started (mongoc_server_description_t *sd)
+{
+   if (sd->load) {
+      bson_atomic_int_add (&sd->load->in_flight, 1);
+   }
+}
+
+
+void
+mongoc_server_description_operation_finished (mongoc_server_description_t *sd)
+{
+   if (sd->load) {
+      bson_atomic_int_add (&sd->load->in_flight, -1);
+   }
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * mongoc_server_description_in_flight --
+ *
+ *       The number of operations in progress on this server, from all
+ *       clients sharing the topology. Copies of a server description
+ *       report the current number, not the number when copied.
+ *
+ *-------------------------------------------------------------------------
+ */
+int32_t
+mongoc_server_description_in_flight (const mongoc_server_description_t *description)
+{
+   BSON_ASSERT (description);
+
+   return description->load ? description->load->in_flight : 0;
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * mongoc_server_description_record_latency --
+ *
+ *       Add the latency of an operation on this server, measured from
+ *       sending the request to receiving the reply, to the window of
+ *       recent latencies. Unlike round_trip_time, which is measured only
+ *       by heartbeats, this reflects how long the server takes to do
+ *       real work.
+ *
+ *-------------------------------------------------------------------------
+ */
+void
+mongoc_server_description_record_latency (mongoc_server_description_t *sd,
+                                          int64_t                      usec)
+{
+   sd->op_latency[sd->op_latency_n % MONGOC_SERVER_LATENCY_WINDOW] = usec;
+   sd->op_latency_n++;
+}
+
+
+static int
+_mongoc_latency_cmp (const void *a,
+                     const void *b)
+{
+   int64_t x = *(const int64_t *)a;
+   int64_t y = *(const int64_t *)b;
+
+   return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * mongoc_server_description_latency_percentile --
+ *
+ *       The @percentile (0 to 100) of this server's recent operation
+ *       latencies.
+ *
+ * Returns:
+ *       Microseconds. The heartbeat round trip time if no operations
+ *       have been measured, or -1 if that is unknown too.
+ *
+ *-------------------------------------------------------------------------
+ */
+int64_t
+mongoc_server_description_latency_percentile (const mongoc_server_description_t *sd,
+                                              int                                percentile)
+{
+   int64_t sorted[MONGOC_SERVER_LATENCY_WINDOW];
+   uint32_t n;
+   uint32_t i;
+
+   n = BSON_MIN (sd->op_latency_n, MONGOC_SERVER_LATENCY_WINDOW);
+
+   if (!n) {
+      return sd->round_trip_time < 0 ? -1 : sd->round_trip_time * 1000;
+   }
+
+   memcpy (sorted, sd->op_latency, n * sizeof (int64_t));
+   qsort (sorted, n, sizeof (int64_t), _mongoc_latency_cmp);
+
+   percentile = BSON_MAX (0, BSON_MIN (percentile, 100));
+   i = (uint32_t) ((n - 1) * percentile / 100);
+
+   return sorted[i];
+}
+
 /*
  *-------------------------------------------------------------------------
  *
@@ -620,6 +751,12 @@ mongoc_server_description_new_copy (const mongoc_server_description_t *descripti
    memcpy (&copy->host, &description->host, sizeof (copy->host));
    copy->round_trip_time = -1;
 
+   /* count operations on the copy as operations on the original */
+   copy->load = description->load;
+   if (copy->load) {
+      bson_atomic_int_add (&copy->load->refs, 1);
+   }
+
    copy->connection_address = copy->host.host_and_port;
 
    /* wait for handle_ismaster to fill these in properly */
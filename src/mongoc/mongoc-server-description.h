@@ -45,4 +45,7 @@ mongoc_server_description_type (mongoc_server_description_t *description);
 const bson_t *
 mongoc_server_description_ismaster (mongoc_server_description_t *description);
 
+int32_t
+mongoc_server_description_in_flight (const mongoc_server_description_t *description);
+
 #endif
@@ -38,6 +38,9 @@ mongoc_server_stream_new (mongoc_topology_description_type_t topology_type,
    server_stream->sd = sd;                       /* becomes owned */
    server_stream->stream = stream;               /* merely borrowed */
 
+   /* until the stream is released */
+   mongoc_server_description_operation_started (sd);
+
    return server_stream;
 }
 
@@ -45,6 +48,7 @@ void
 mongoc_server_stream_cleanup (mongoc_server_stream_t *server_stream)
 {
    if (server_stream) {
+      mongoc_server_description_operation_finished (server_stream->sd);
       mongoc_server_description_destroy (server_stream->sd);
       bson_free (server_stream);
    }
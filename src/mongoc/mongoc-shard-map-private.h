@@ -0,0 +1,80 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_SHARD_MAP_PRIVATE_H
+#define MONGOC_SHARD_MAP_PRIVATE_H
+
+#if !defined (MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-array-private.h"
+#include "mongoc-client.h"
+
+
+BSON_BEGIN_DECLS
+
+
+/* reload a cached chunk map after this long; a stale map only makes
+ * grouping less effective, mongos still routes each write correctly */
+#define MONGOC_SHARD_MAP_TTL_MSEC 60000
+
+
+typedef struct _mongoc_shard_map_t mongoc_shard_map_t;
+
+
+typedef struct
+{
+   bson_t *min;
+   bson_t *max;
+   char   *shard;
+} mongoc_shard_chunk_t;
+
+
+struct _mongoc_shard_map_t
+{
+   char               *ns;
+   bson_t              key;       /* shard key pattern, empty if unsharded */
+   mongoc_array_t      chunks;    /* sorted by min */
+   int64_t             loaded_at;
+   mongoc_shard_map_t *next;
+};
+
+
+mongoc_shard_map_t *_mongoc_shard_map_new       (const char               *ns,
+                                                 const bson_t             *key);
+void                _mongoc_shard_map_add_chunk (mongoc_shard_map_t       *map,
+                                                 const bson_t             *min,
+                                                 const bson_t             *max,
+                                                 const char               *shard);
+mongoc_shard_map_t *_mongoc_shard_map_load      (mongoc_client_t          *client,
+                                                 const char               *ns,
+                                                 bson_error_t             *error);
+const char         *_mongoc_shard_map_get_shard (const mongoc_shard_map_t *map,
+                                                 const bson_t             *document);
+void                _mongoc_shard_map_destroy   (mongoc_shard_map_t       *map);
+mongoc_shard_map_t *_mongoc_shard_map_cache_get (mongoc_client_t          *client,
+                                                 const char               *ns,
+                                                 bson_error_t             *error);
+void                _mongoc_shard_map_cache_destroy (mongoc_shard_map_t   *cache);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_SHARD_MAP_PRIVATE_H */
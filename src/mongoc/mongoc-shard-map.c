@@ -0,0 +1,587 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+
+#include "mongoc-client-private.h"
+#include "mongoc-collection.h"
+#include "mongoc-cursor.h"
+#include "mongoc-shard-map-private.h"
+#include "mongoc-trace.h"
+
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "shard-map"
+
+
+/* the server's canonical type order, see BSON comparison order in the
+ * MongoDB manual. numbers compare equal across types. */
+static int
+_canonical_type (bson_type_t type)
+{
+   switch (type) {
+   case BSON_TYPE_MINKEY:
+      return -1;
+   case BSON_TYPE_NULL:
+      return 5;
+   case BSON_TYPE_DOUBLE:
+   case BSON_TYPE_INT32:
+   case BSON_TYPE_INT64:
+      return 10;
+   case BSON_TYPE_UTF8:
+   case BSON_TYPE_SYMBOL:
+      return 15;
+   case BSON_TYPE_DOCUMENT:
+      return 20;
+   case BSON_TYPE_ARRAY:
+      return 25;
+   case BSON_TYPE_BINARY:
+      return 30;
+   case BSON_TYPE_OID:
+      return 35;
+   case BSON_TYPE_BOOL:
+      return 40;
+   case BSON_TYPE_DATE_TIME:
+      return 45;
+   case BSON_TYPE_TIMESTAMP:
+      return 47;
+   case BSON_TYPE_REGEX:
+      return 50;
+   case BSON_TYPE_DBPOINTER:
+      return 55;
+   case BSON_TYPE_CODE:
+      return 60;
+   case BSON_TYPE_CODEWSCOPE:
+      return 65;
+   case BSON_TYPE_MAXKEY:
+      return 127;
+   case BSON_TYPE_EOD:
+   case BSON_TYPE_UNDEFINED:
+   default:
+      return 0;
+   }
+}
+
+
+static double
+_as_double (const bson_iter_t *iter)
+{
+   switch (bson_iter_type (iter)) {
+   case BSON_TYPE_DOUBLE:
+      return bson_iter_double (iter);
+   case BSON_TYPE_INT32:
+      return (double) bson_iter_int32 (iter);
+   case BSON_TYPE_INT64:
+   default:
+      return (double) bson_iter_int64 (iter);
+   }
+}
+
+
+#define CMP(_a, _b) ((_a) < (_b) ? -1 : ((_a) > (_b) ? 1 : 0))
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _value_cmp --
+ *
+ *       Compare two shard key values the way the server does.
+ *
+ * Returns:
+ *       false if the values are of a type we don't compare, such as
+ *       documents or arrays; otherwise true and @cmp is set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_value_cmp (const bson_iter_t *a,
+            const bson_iter_t *b,
+            int               *cmp)
+{
+   bson_type_t ta = bson_iter_type (a);
+   bson_type_t tb = bson_iter_type (b);
+   const char *sa;
+   const char *sb;
+   uint32_t la;
+   uint32_t lb;
+   uint32_t ts_a, inc_a;
+   uint32_t ts_b, inc_b;
+   double da;
+   double db;
+
+   *cmp = CMP (_canonical_type (ta), _canonical_type (tb));
+
+   if (*cmp) {
+      return true;
+   }
+
+   switch (ta) {
+   case BSON_TYPE_MINKEY:
+   case BSON_TYPE_MAXKEY:
+   case BSON_TYPE_NULL:
+      *cmp = 0;
+      return true;
+   case BSON_TYPE_DOUBLE:
+   case BSON_TYPE_INT32:
+   case BSON_TYPE_INT64:
+      if (ta != BSON_TYPE_DOUBLE && tb != BSON_TYPE_DOUBLE) {
+         *cmp = CMP (bson_iter_as_int64 (a), bson_iter_as_int64 (b));
+         return true;
+      }
+
+      da = _as_double (a);
+      db = _as_double (b);
+
+      if (da != da || db != db) {
+         /* NaN */
+         return false;
+      }
+
+      *cmp = CMP (da, db);
+      return true;
+   case BSON_TYPE_UTF8:
+   case BSON_TYPE_SYMBOL:
+      sa = ta == BSON_TYPE_UTF8 ? bson_iter_utf8 (a, &la)
+                                : bson_iter_symbol (a, &la);
+      sb = tb == BSON_TYPE_UTF8 ? bson_iter_utf8 (b, &lb)
+                                : bson_iter_symbol (b, &lb);
+      *cmp = memcmp (sa, sb, BSON_MIN (la, lb));
+
+      if (!*cmp) {
+         *cmp = CMP (la, lb);
+      }
+
+      return true;
+   case BSON_TYPE_OID:
+      *cmp = bson_oid_compare (bson_iter_oid (a), bson_iter_oid (b));
+      return true;
+   case BSON_TYPE_BOOL:
+      *cmp = CMP (bson_iter_bool (a), bson_iter_bool (b));
+      return true;
+   case BSON_TYPE_DATE_TIME:
+      *cmp = CMP (bson_iter_date_time (a), bson_iter_date_time (b));
+      return true;
+   case BSON_TYPE_TIMESTAMP:
+      bson_iter_timestamp (a, &ts_a, &inc_a);
+      bson_iter_timestamp (b, &ts_b, &inc_b);
+      *cmp = ts_a != ts_b ? CMP (ts_a, ts_b) : CMP (inc_a, inc_b);
+      return true;
+   default:
+      return false;
+   }
+}
+
+
+/* compare shard key values extracted from a document to a chunk bound
+ * like {a: 1, b: MinKey}, field by field */
+static bool
+_key_cmp (const bson_t *values,
+          const bson_t *bound,
+          int          *cmp)
+{
+   bson_iter_t a;
+   bson_iter_t b;
+
+   if (!bson_iter_init (&a, values) || !bson_iter_init (&b, bound)) {
+      return false;
+   }
+
+   *cmp = 0;
+
+   while (bson_iter_next (&a)) {
+      if (!bson_iter_next (&b) || !_value_cmp (&a, &b, cmp)) {
+         return false;
+      }
+
+      if (*cmp) {
+         return true;
+      }
+   }
+
+   return true;
+}
+
+
+mongoc_shard_map_t *
+_mongoc_shard_map_new (const char   *ns,
+                       const bson_t *key)
+{
+   mongoc_shard_map_t *map;
+
+   BSON_ASSERT (ns);
+
+   map = (mongoc_shard_map_t *)bson_malloc0 (sizeof *map);
+   map->ns = bson_strdup (ns);
+   map->loaded_at = bson_get_monotonic_time ();
+   _mongoc_array_init (&map->chunks, sizeof (mongoc_shard_chunk_t));
+
+   if (key) {
+      bson_copy_to (key, &map->key);
+   } else {
+      bson_init (&map->key);
+   }
+
+   return map;
+}
+
+
+/* chunks must be added in ascending order of min */
+void
+_mongoc_shard_map_add_chunk (mongoc_shard_map_t *map,
+                             const bson_t       *min,
+                             const bson_t       *max,
+                             const char         *shard)
+{
+   mongoc_shard_chunk_t chunk;
+
+   BSON_ASSERT (map);
+   BSON_ASSERT (min);
+   BSON_ASSERT (max);
+   BSON_ASSERT (shard);
+
+   chunk.min = bson_copy (min);
+   chunk.max = bson_copy (max);
+   chunk.shard = bson_strdup (shard);
+
+   _mongoc_array_append_val (&map->chunks, chunk);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_shard_map_get_shard --
+ *
+ *       Find the shard that owns @document according to @map.
+ *
+ * Returns:
+ *       The shard name, or NULL if the collection is unsharded, the
+ *       document lacks a shard key field, or its shard key has a type
+ *       we cannot compare. Callers treat NULL as "any shard".
+ *
+ *--------------------------------------------------------------------------
+ */
+
+const char *
+_mongoc_shard_map_get_shard (const mongoc_shard_map_t *map,
+                             const bson_t             *document)
+{
+   mongoc_shard_chunk_t *chunk;
+   bson_iter_t key_iter;
+   bson_iter_t iter;
+   bson_iter_t field;
+   const char *ret = NULL;
+   bson_t values;
+   int64_t lo;
+   int64_t hi;
+   int64_t mid;
+   int64_t found = -1;
+   int cmp;
+
+   BSON_ASSERT (map);
+   BSON_ASSERT (document);
+
+   if (!map->chunks.len || !bson_iter_init (&key_iter, &map->key)) {
+      return NULL;
+   }
+
+   bson_init (&values);
+
+   while (bson_iter_next (&key_iter)) {
+      if (!bson_iter_init (&iter, document) ||
+          !bson_iter_find_descendant (&iter, bson_iter_key (&key_iter),
+                                      &field)) {
+         GOTO (done);
+      }
+
+      BSON_APPEND_VALUE (&values, bson_iter_key (&key_iter),
+                         bson_iter_value (&field));
+   }
+
+   /* the last chunk whose min is <= the document's shard key */
+   lo = 0;
+   hi = (int64_t) map->chunks.len - 1;
+
+   while (lo <= hi) {
+      mid = lo + (hi - lo) / 2;
+      chunk = &_mongoc_array_index (&map->chunks, mongoc_shard_chunk_t, mid);
+
+      if (!_key_cmp (&values, chunk->min, &cmp)) {
+         GOTO (done);
+      }
+
+      if (cmp >= 0) {
+         found = mid;
+         lo = mid + 1;
+      } else {
+         hi = mid - 1;
+      }
+   }
+
+   if (found < 0) {
+      GOTO (done);
+   }
+
+   chunk = &_mongoc_array_index (&map->chunks, mongoc_shard_chunk_t, found);
+
+   if (_key_cmp (&values, chunk->max, &cmp) && cmp < 0) {
+      ret = chunk->shard;
+   }
+
+done:
+   bson_destroy (&values);
+
+   return ret;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_shard_map_load --
+ *
+ *       Read the shard key of @ns from config.collections and its chunks
+ *       from config.chunks. The client must be connected to mongos.
+ *
+ * Returns:
+ *       A new map, which has no chunks if the collection is unsharded or
+ *       has a hashed shard key. NULL on error, and @error is set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_shard_map_t *
+_mongoc_shard_map_load (mongoc_client_t *client,
+                        const char      *ns,
+                        bson_error_t    *error)
+{
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursor;
+   mongoc_shard_map_t *map = NULL;
+   const bson_t *doc;
+   bson_iter_t iter;
+   bson_iter_t child;
+   const uint8_t *data;
+   uint32_t len;
+   bson_t key;
+   bson_t min;
+   bson_t max;
+   bson_t query;
+   bson_t child_doc;
+   bool has_key = false;
+   bool hashed = false;
+
+   ENTRY;
+
+   BSON_ASSERT (client);
+   BSON_ASSERT (ns);
+
+   collection = mongoc_client_get_collection (client, "config", "collections");
+
+   bson_init (&query);
+   BSON_APPEND_UTF8 (&query, "_id", ns);
+   cursor = mongoc_collection_find (collection, MONGOC_QUERY_NONE, 0, 1, 0,
+                                    &query, NULL, NULL);
+
+   if (mongoc_cursor_next (cursor, &doc) &&
+       !(bson_iter_init_find (&iter, doc, "dropped") &&
+         bson_iter_as_bool (&iter)) &&
+       bson_iter_init_find (&iter, doc, "key") &&
+       BSON_ITER_HOLDS_DOCUMENT (&iter)) {
+      bson_iter_document (&iter, &len, &data);
+      bson_init_static (&min, data, len);
+      bson_copy_to (&min, &key);
+      has_key = true;
+
+      if (bson_iter_recurse (&iter, &child)) {
+         while (bson_iter_next (&child)) {
+            if (BSON_ITER_HOLDS_UTF8 (&child)) {
+               hashed = true;
+            }
+         }
+      }
+   }
+
+   if (mongoc_cursor_error (cursor, error)) {
+      GOTO (done);
+   }
+
+   mongoc_cursor_destroy (cursor);
+   cursor = NULL;
+   mongoc_collection_destroy (collection);
+   collection = NULL;
+
+   if (!has_key || bson_empty (&key) || hashed) {
+      /* unsharded, or a hashed key we can't compute */
+      map = _mongoc_shard_map_new (ns, NULL);
+      GOTO (done);
+   }
+
+   map = _mongoc_shard_map_new (ns, &key);
+   collection = mongoc_client_get_collection (client, "config", "chunks");
+
+   bson_reinit (&query);
+   BSON_APPEND_DOCUMENT_BEGIN (&query, "$query", &child_doc);
+   BSON_APPEND_UTF8 (&child_doc, "ns", ns);
+   bson_append_document_end (&query, &child_doc);
+   BSON_APPEND_DOCUMENT_BEGIN (&query, "$orderby", &child_doc);
+   BSON_APPEND_INT32 (&child_doc, "min", 1);
+   bson_append_document_end (&query, &child_doc);
+
+   cursor = mongoc_collection_find (collection, MONGOC_QUERY_NONE, 0, 0, 0,
+                                    &query, NULL, NULL);
+
+   while (mongoc_cursor_next (cursor, &doc)) {
+      if (!bson_iter_init_find (&iter, doc, "min") ||
+          !BSON_ITER_HOLDS_DOCUMENT (&iter)) {
+         continue;
+      }
+
+      bson_iter_document (&iter, &len, &data);
+      bson_init_static (&min, data, len);
+
+      if (!bson_iter_init_find (&iter, doc, "max") ||
+          !BSON_ITER_HOLDS_DOCUMENT (&iter)) {
+         continue;
+      }
+
+      bson_iter_document (&iter, &len, &data);
+      bson_init_static (&max, data, len);
+
+      if (!bson_iter_init_find (&iter, doc, "shard") ||
+          !BSON_ITER_HOLDS_UTF8 (&iter)) {
+         continue;
+      }
+
+      _mongoc_shard_map_add_chunk (map, &min, &max,
+                                   bson_iter_utf8 (&iter, NULL));
+   }
+
+   if (mongoc_cursor_error (cursor, error)) {
+      _mongoc_shard_map_destroy (map);
+      map = NULL;
+   }
+
+done:
+   if (cursor) {
+      mongoc_cursor_destroy (cursor);
+   }
+
+   if (collection) {
+      mongoc_collection_destroy (collection);
+   }
+
+   bson_destroy (&query);
+
+   if (has_key) {
+      bson_destroy (&key);
+   }
+
+   RETURN (map);
+}
+
+
+void
+_mongoc_shard_map_destroy (mongoc_shard_map_t *map)
+{
+   mongoc_shard_chunk_t *chunk;
+   size_t i;
+
+   if (map) {
+      for (i = 0; i < map->chunks.len; i++) {
+         chunk = &_mongoc_array_index (&map->chunks, mongoc_shard_chunk_t, i);
+         bson_destroy (chunk->min);
+         bson_destroy (chunk->max);
+         bson_free (chunk->shard);
+      }
+
+      _mongoc_array_destroy (&map->chunks);
+      bson_destroy (&map->key);
+      bson_free (map->ns);
+      bson_free (map);
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_shard_map_cache_get --
+ *
+ *       Get the chunk map for @ns from the client's cache, loading it if
+ *       it is missing or older than MONGOC_SHARD_MAP_TTL_MSEC.
+ *
+ * Returns:
+ *       A map owned by the client, or NULL and @error is set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_shard_map_t *
+_mongoc_shard_map_cache_get (mongoc_client_t *client,
+                             const char      *ns,
+                             bson_error_t    *error)
+{
+   mongoc_shard_map_t **link;
+   mongoc_shard_map_t *map;
+   int64_t now;
+
+   ENTRY;
+
+   BSON_ASSERT (client);
+   BSON_ASSERT (ns);
+
+   now = bson_get_monotonic_time ();
+
+   for (link = &client->shard_maps; *link; link = &(*link)->next) {
+      if (!strcmp ((*link)->ns, ns)) {
+         if ((*link)->loaded_at + MONGOC_SHARD_MAP_TTL_MSEC * 1000 > now) {
+            RETURN (*link);
+         }
+
+         /* expired */
+         map = *link;
+         *link = map->next;
+         _mongoc_shard_map_destroy (map);
+         break;
+      }
+   }
+
+   map = _mongoc_shard_map_load (client, ns, error);
+
+   if (map) {
+      map->next = client->shard_maps;
+      client->shard_maps = map;
+   }
+
+   RETURN (map);
+}
+
+
+void
+_mongoc_shard_map_cache_destroy (mongoc_shard_map_t *cache)
+{
+   mongoc_shard_map_t *next;
+
+   while (cache) {
+      next = cache->next;
+      _mongoc_shard_map_destroy (cache);
+      cache = next;
+   }
+}
@@ -34,6 +34,9 @@ struct _mongoc_socket_t
 #endif
    int errno_;
    int domain;
+   mongoc_iovec_t *send_iov;      /* scratch for coalescing in sendv */
+   size_t          send_iov_len;
+   uint8_t        *send_buf;
 };
 
 mongoc_socket_t *mongoc_socket_accept_ex (mongoc_socket_t *sock,
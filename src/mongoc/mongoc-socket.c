@@ -16,6 +16,7 @@
 
 
 #include <errno.h>
+#include <limits.h>
 #include <string.h>
 
 #include "mongoc-counters-private.h"
@@ -34,6 +35,18 @@
    ((expire_at >= 0) && (expire_at < (bson_get_monotonic_time())))
 
 
+/* sendmsg () fails with EMSGSIZE given more iovecs than this */
+#if defined(IOV_MAX) && IOV_MAX <= 1024
+# define MONGOC_SOCKET_IOV_MAX IOV_MAX
+#else
+# define MONGOC_SOCKET_IOV_MAX 1024
+#endif
+
+/* iovecs shorter than this are copied together before sending */
+#define MONGOC_SOCKET_COALESCE_LEN 512
+#define MONGOC_SOCKET_COALESCE_BUFFER_SIZE 16384
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -649,6 +662,8 @@ mongoc_socket_destroy (mongoc_socket_t *sock) /* IN */
 {
    if (sock) {
       mongoc_socket_close (sock);
+      bson_free (sock->send_iov);
+      bson_free (sock->send_buf);
       bson_free (sock);
    }
 }
@@ -964,6 +979,63 @@ _mongoc_socket_try_sendv_slow (mongoc_socket_t *sock,   /* IN */
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_socket_coalesce --
+ *
+ *       Prepare up to MONGOC_SOCKET_IOV_MAX iovecs from the start of
+ *       @in_iov for one sendmsg () call. Runs of short iovecs, like the
+ *       header fields and small documents _mongoc_rpc_gather produces, are
+ *       copied together into @buf, so more of the message is sent per
+ *       system call and sendmsg () doesn't fail with EMSGSIZE.
+ *
+ *       The prepared iovecs hold the same bytes in the same order as the
+ *       start of @in_iov, so the caller can advance @in_iov by the number
+ *       of bytes sent as usual.
+ *
+ * Returns:
+ *       The number of iovecs in @out.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static size_t
+_mongoc_socket_coalesce (mongoc_iovec_t *in_iov,  /* IN */
+                         size_t          in_cnt,  /* IN */
+                         mongoc_iovec_t *out,     /* OUT */
+                         uint8_t        *buf)     /* OUT */
+{
+   size_t buf_len = 0;
+   size_t n = 0;
+   size_t i;
+   bool in_run = false;
+
+   for (i = 0; i < in_cnt && n < MONGOC_SOCKET_IOV_MAX; i++) {
+      if (in_iov[i].iov_len < MONGOC_SOCKET_COALESCE_LEN &&
+          buf_len + in_iov[i].iov_len <= MONGOC_SOCKET_COALESCE_BUFFER_SIZE) {
+         memcpy (buf + buf_len, in_iov[i].iov_base, in_iov[i].iov_len);
+
+         if (in_run) {
+            out[n - 1].iov_len += in_iov[i].iov_len;
+         } else {
+            out[n].iov_base = (void *)(buf + buf_len);
+            out[n].iov_len = in_iov[i].iov_len;
+            n++;
+            in_run = true;
+         }
+
+         buf_len += in_iov[i].iov_len;
+      } else {
+         out[n++] = in_iov[i];
+         in_run = false;
+      }
+   }
+
+   return n;
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -984,10 +1056,12 @@ _mongoc_socket_try_sendv_slow (mongoc_socket_t *sock,   /* IN */
  */
 
 static ssize_t
-_mongoc_socket_try_sendv (mongoc_socket_t *sock,   /* IN */
-                          mongoc_iovec_t  *iov,    /* IN */
-                          size_t           iovcnt) /* IN */
+_mongoc_socket_try_sendv (mongoc_socket_t *sock,    /* IN */
+                          mongoc_iovec_t  *in_iov,  /* IN */
+                          size_t           in_cnt)  /* IN */
 {
+   mongoc_iovec_t *iov;
+   size_t iovcnt;
 #ifdef _WIN32
    DWORD dwNumberofBytesSent = 0;
    int ret;
@@ -999,11 +1073,35 @@ _mongoc_socket_try_sendv (mongoc_socket_t *sock,   /* IN */
    ENTRY;
 
    BSON_ASSERT (sock);
-   BSON_ASSERT (iov);
-   BSON_ASSERT (iovcnt);
+   BSON_ASSERT (in_iov);
+   BSON_ASSERT (in_cnt);
+
+   if (in_cnt == 1) {
+      iov = in_iov;
+      iovcnt = 1;
+   } else {
+      /* kept with the socket, rather than 32KB of stack per send */
+      iovcnt = BSON_MIN (in_cnt, MONGOC_SOCKET_IOV_MAX);
+
+      if (sock->send_iov_len < iovcnt) {
+         sock->send_iov = (mongoc_iovec_t *)bson_realloc (
+            sock->send_iov, iovcnt * sizeof *iov);
+         sock->send_iov_len = iovcnt;
+      }
+
+      if (!sock->send_buf) {
+         sock->send_buf = (uint8_t *)bson_malloc (
+            MONGOC_SOCKET_COALESCE_BUFFER_SIZE);
+      }
+
+      iov = sock->send_iov;
+      iovcnt = _mongoc_socket_coalesce (in_iov, in_cnt, iov, sock->send_buf);
+   }
 
    DUMP_IOVEC (sendbuf, iov, iovcnt);
 
+   mongoc_counter_streams_egress_calls_inc ();
+
 #ifdef _WIN32
    ret = WSASend (sock->sd, (LPWSABUF)iov, iovcnt, &dwNumberofBytesSent,
                   0, NULL, NULL);
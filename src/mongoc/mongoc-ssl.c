@@ -101,6 +101,7 @@ void _mongoc_ssl_opts_copy_to (const mongoc_ssl_opt_t* src,
    dst->crl_file = bson_strdup (src->crl_file);
    dst->weak_cert_validation = src->weak_cert_validation;
    dst->allow_invalid_hostname = src->allow_invalid_hostname;
+   dst->ktls = src->ktls;
 }
 
 void _mongoc_ssl_opts_cleanup (mongoc_ssl_opt_t* opt)
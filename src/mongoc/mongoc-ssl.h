@@ -39,6 +39,7 @@ struct _mongoc_ssl_opt_t
    const char *crl_file;
    bool        weak_cert_validation;
    bool        allow_invalid_hostname;
+   bool        ktls;
    void       *padding [7];
 };
 
@@ -17,6 +17,7 @@
 
 #include <errno.h>
 
+#include "mongoc-array-private.h"
 #include "mongoc-buffer-private.h"
 #include "mongoc-counters-private.h"
 #include "mongoc-log.h"
@@ -34,16 +35,85 @@ typedef struct
    mongoc_stream_t  stream;
    mongoc_stream_t *base_stream;
    mongoc_buffer_t  buffer;
+   mongoc_array_t   wbuf;                /* bytes written but not yet sent */
+   size_t           wbuf_max;            /* 0 if writes pass through */
+   int32_t          write_timeout_msec;  /* of the last buffered write */
 } mongoc_stream_buffered_t;
 
 
 /*
  *--------------------------------------------------------------------------
  *
- * mongoc_stream_buffered_destroy --
+ * _mongoc_stream_buffered_send --
+ *
+ *       Send the pending writes, followed by @iov, to the base stream
+ *       in a single writev. @iov may be NULL if @iovcnt is 0.
+ *
+ * Returns:
+ *       true if every byte was sent.
+ *
+ * Side effects:
+ *       The pending writes are discarded, even on failure: the stream
+ *       is unusable after a failed or short write anyway.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_stream_buffered_send (mongoc_stream_buffered_t *buffered,     /* IN */
+                              mongoc_iovec_t           *iov,          /* IN */
+                              size_t                    iovcnt,       /* IN */
+                              int32_t                   timeout_msec) /* IN */
+{
+   mongoc_iovec_t *all;
+   size_t total = 0;
+   size_t n = 0;
+   size_t i;
+   ssize_t ret;
+
+   for (i = 0; i < iovcnt; i++) {
+      total += iov[i].iov_len;
+   }
+
+   if (!buffered->wbuf.len) {
+      if (!iovcnt) {
+         return true;
+      }
+
+      ret = mongoc_stream_writev (buffered->base_stream, iov, iovcnt,
+                                  timeout_msec);
+
+      return ret == (ssize_t)total;
+   }
+
+   all = (mongoc_iovec_t *)bson_malloc ((iovcnt + 1) * sizeof *all);
+   all[n].iov_base = (void *)buffered->wbuf.data;
+   all[n].iov_len = buffered->wbuf.len;
+   total += buffered->wbuf.len;
+   n++;
+
+   for (i = 0; i < iovcnt; i++) {
+      all[n++] = iov[i];
+   }
+
+   TRACE ("sending %u buffered bytes", (unsigned)buffered->wbuf.len);
+
+   ret = mongoc_stream_writev (buffered->base_stream, all, n, timeout_msec);
+
+   bson_free (all);
+   _mongoc_array_clear (&buffered->wbuf);
+
+   return ret == (ssize_t)total;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
  *
- *       Clean up after a mongoc_stream_buffered_t. Free all allocated
- *       resources and release the base stream.
+ * _mongoc_stream_buffered_free --
+ *
+ *       Free all allocated resources and release the base stream,
+ *       discarding any pending writes.
  *
  * Returns:
  *       None.
@@ -55,7 +125,7 @@ typedef struct
  */
 
 static void
-mongoc_stream_buffered_destroy (mongoc_stream_t *stream) /* IN */
+_mongoc_stream_buffered_free (mongoc_stream_t *stream) /* IN */
 {
    mongoc_stream_buffered_t *buffered = (mongoc_stream_buffered_t *)stream;
 
@@ -65,6 +135,7 @@ mongoc_stream_buffered_destroy (mongoc_stream_t *stream) /* IN */
    buffered->base_stream = NULL;
 
    _mongoc_buffer_destroy (&buffered->buffer);
+   _mongoc_array_destroy (&buffered->wbuf);
 
    bson_free(stream);
 
@@ -73,14 +144,49 @@ mongoc_stream_buffered_destroy (mongoc_stream_t *stream) /* IN */
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_stream_buffered_destroy --
+ *
+ *       Clean up after a mongoc_stream_buffered_t. Pending writes are
+ *       sent first, then all allocated resources are freed and the base
+ *       stream is released.
+ *
+ * Returns:
+ *       None.
+ *
+ * Side effects:
+ *       Everything.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+mongoc_stream_buffered_destroy (mongoc_stream_t *stream) /* IN */
+{
+   mongoc_stream_buffered_t *buffered = (mongoc_stream_buffered_t *)stream;
+
+   BSON_ASSERT (stream);
+
+   if (buffered->wbuf.len &&
+       !_mongoc_stream_buffered_send (buffered, NULL, 0,
+                                      buffered->write_timeout_msec)) {
+      MONGOC_WARNING ("Failed to send buffered writes before closing");
+   }
+
+   _mongoc_stream_buffered_free (stream);
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
  * mongoc_stream_buffered_failed --
  *
  *       Called when a stream fails. Useful for streams that differnciate
- *       between failure and cleanup.
- *       Calls mongoc_stream_buffered_destroy() on the stream.
+ *       between failure and cleanup. Pending writes are discarded
+ *       rather than sent on a stream that may be broken.
  *
  * Returns:
  *       None.
@@ -94,7 +200,7 @@ mongoc_stream_buffered_destroy (mongoc_stream_t *stream) /* IN */
 static void
 mongoc_stream_buffered_failed (mongoc_stream_t *stream) /* IN */
 {
-	mongoc_stream_buffered_destroy (stream);
+   _mongoc_stream_buffered_free (stream);
 }
 
 
@@ -130,10 +236,11 @@ mongoc_stream_buffered_close (mongoc_stream_t *stream) /* IN */
  *
  * mongoc_stream_buffered_flush --
  *
- *       Flushes the underlying stream.
+ *       Sends pending writes, then flushes the underlying stream.
  *
  * Returns:
- *       The result of flush on the base stream.
+ *       -1 if the pending writes could not be sent, otherwise the result
+ *       of flush on the base stream.
  *
  * Side effects:
  *       None.
@@ -146,6 +253,12 @@ mongoc_stream_buffered_flush (mongoc_stream_t *stream) /* IN */
 {
    mongoc_stream_buffered_t *buffered = (mongoc_stream_buffered_t *)stream;
    BSON_ASSERT (buffered);
+
+   if (!_mongoc_stream_buffered_send (buffered, NULL, 0,
+                                      buffered->write_timeout_msec)) {
+      return -1;
+   }
+
    return mongoc_stream_flush(buffered->base_stream);
 }
 
@@ -155,8 +268,14 @@ mongoc_stream_buffered_flush (mongoc_stream_t *stream) /* IN */
  *
  * mongoc_stream_buffered_writev --
  *
- *       Write an iovec to the underlying stream. This write is not
- *       buffered, it passes through to the base stream directly.
+ *       Write an iovec to the underlying stream.
+ *
+ *       If a write buffer was set with
+ *       mongoc_stream_buffered_set_write_buffer_size(), small writes are
+ *       copied into it and sent together once it would overflow, on
+ *       mongoc_stream_flush(), or before the next read. A write that does
+ *       not fit, or one with a timeout of 0 from a caller that must not
+ *       block, is sent at once along with any pending bytes.
  *
  *       timeout_msec should be the number of milliseconds to wait before
  *       considering the writev as failed.
@@ -177,16 +296,43 @@ mongoc_stream_buffered_writev (mongoc_stream_t *stream,       /* IN */
                                int32_t          timeout_msec) /* IN */
 {
    mongoc_stream_buffered_t *buffered = (mongoc_stream_buffered_t *)stream;
+   size_t total = 0;
+   size_t i;
    ssize_t ret;
 
    ENTRY;
 
    BSON_ASSERT (buffered);
 
-   ret = mongoc_stream_writev(buffered->base_stream, iov, iovcnt,
-                              timeout_msec);
+   if (!buffered->wbuf_max && !buffered->wbuf.len) {
+      ret = mongoc_stream_writev(buffered->base_stream, iov, iovcnt,
+                                 timeout_msec);
+
+      RETURN (ret);
+   }
+
+   for (i = 0; i < iovcnt; i++) {
+      total += iov[i].iov_len;
+   }
+
+   if (timeout_msec == 0 || total > buffered->wbuf_max) {
+      RETURN (_mongoc_stream_buffered_send (buffered, iov, iovcnt,
+                                            timeout_msec) ? total : -1);
+   }
+
+   if (buffered->wbuf.len + total > buffered->wbuf_max &&
+       !_mongoc_stream_buffered_send (buffered, NULL, 0, timeout_msec)) {
+      RETURN (-1);
+   }
+
+   for (i = 0; i < iovcnt; i++) {
+      _mongoc_array_append_vals (&buffered->wbuf, iov[i].iov_base,
+                                 (uint32_t)iov[i].iov_len);
+   }
 
-   RETURN (ret);
+   buffered->write_timeout_msec = timeout_msec;
+
+   RETURN ((ssize_t)total);
 }
 
 
@@ -202,6 +348,9 @@ mongoc_stream_buffered_writev (mongoc_stream_t *stream,       /* IN */
  *       requested number of bytes, but try to also fill the stream to
  *       the size of the underlying buffer.
  *
+ *       Pending writes are sent first, since the caller may be waiting
+ *       for the reply to one of them.
+ *
  * Note:
  *       This isn't actually a huge savings since we never have more than
  *       one reply waiting for us, but perhaps someday that will be
@@ -237,6 +386,14 @@ mongoc_stream_buffered_readv (mongoc_stream_t *stream,       /* IN */
       total_bytes += iov[i].iov_len;
    }
 
+   if (buffered->wbuf.len) {
+      if (!_mongoc_stream_buffered_send (buffered, NULL, 0, timeout_msec) ||
+          mongoc_stream_flush (buffered->base_stream) != 0) {
+         MONGOC_WARNING ("Failure to send buffered writes before reading");
+         RETURN (-1);
+      }
+   }
+
    if (-1 == _mongoc_buffer_fill (&buffered->buffer,
                                   buffered->base_stream,
                                   total_bytes,
@@ -323,8 +480,45 @@ mongoc_stream_buffered_new (mongoc_stream_t *base_stream, /* IN */
    stream->base_stream = base_stream;
 
    _mongoc_buffer_init (&stream->buffer, NULL, buffer_size, NULL, NULL);
+   _mongoc_array_init (&stream->wbuf, 1);
 
    mongoc_counter_streams_active_inc();
 
    return (mongoc_stream_t *)stream;
 }
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_stream_buffered_set_write_buffer_size --
+ *
+ *       Buffer up to @size bytes of writes, so that many small writes
+ *       such as unacknowledged inserts are sent with one system call.
+ *       0, the default, sends each write at once.
+ *
+ *       Buffered writes are sent when the buffer would overflow, on
+ *       mongoc_stream_flush(), before the next read, and when the stream
+ *       is destroyed.
+ *
+ * Returns:
+ *       None.
+ *
+ * Side effects:
+ *       None. Bytes already buffered are kept, and sent on the next
+ *       write or flush.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_stream_buffered_set_write_buffer_size (mongoc_stream_t *stream, /* IN */
+                                              size_t           size)   /* IN */
+{
+   mongoc_stream_buffered_t *buffered = (mongoc_stream_buffered_t *)stream;
+
+   BSON_ASSERT (stream);
+   BSON_ASSERT (stream->type == MONGOC_STREAM_BUFFERED);
+
+   buffered->wbuf_max = size;
+}
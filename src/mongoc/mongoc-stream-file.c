@@ -18,26 +18,98 @@
 #ifdef _WIN32
 # include <io.h>
 # include <share.h>
+#else
+# include <errno.h>
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
 #endif
 
 #include "mongoc-stream-private.h"
 #include "mongoc-stream-file.h"
+#include "mongoc-stream-file-private.h"
+#include "mongoc-log.h"
 #include "mongoc-trace.h"
 
 
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "stream"
+
+
 /*
  * TODO: This does not respect timeouts or set O_NONBLOCK.
  *       But that should be fine until it isn't :-)
  */
 
 
+/* smallest growth of a writable mapping, so that a series of small writes
+ * does not remap the file each time */
+#define MONGOC_STREAM_FILE_MAP_MIN (1024 * 1024)
+
+
 struct _mongoc_stream_file_t
 {
    mongoc_stream_t vtable;
    int             fd;
+   bool            mapped;   /* readv and writev go through map */
+   bool            writable;
+   uint8_t        *map;
+   size_t          map_len;  /* bytes mapped, >= len while writing */
+   size_t          len;      /* the file's length */
+   size_t          pos;
 };
 
 
+#ifndef _WIN32
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_stream_file_remap --
+ *
+ *       Map the first @map_len bytes of the file, growing the file first
+ *       if it is writable. The old mapping is only released once the new
+ *       one exists, so on failure the stream is unchanged.
+ *
+ * Returns:
+ *       true if successful; otherwise false and errno is set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_stream_file_remap (mongoc_stream_file_t *file,
+                           size_t                map_len)
+{
+   void *map;
+
+   if (file->writable && ftruncate (file->fd, (off_t)map_len) == -1) {
+      return false;
+   }
+
+   map = mmap (NULL, map_len,
+               PROT_READ | (file->writable ? PROT_WRITE : 0),
+               MAP_SHARED, file->fd, 0);
+
+   if (map == MAP_FAILED) {
+      return false;
+   }
+
+   if (file->map) {
+      munmap (file->map, file->map_len);
+   }
+
+   /* GridFS reads and writes whole files front to back */
+   posix_madvise (map, map_len, POSIX_MADV_SEQUENTIAL);
+
+   file->map = (uint8_t *)map;
+   file->map_len = map_len;
+
+   return true;
+}
+#endif
+
+
 static int
 _mongoc_stream_file_close (mongoc_stream_t *stream)
 {
@@ -48,6 +120,21 @@ _mongoc_stream_file_close (mongoc_stream_t *stream)
 
    BSON_ASSERT (file);
 
+#ifndef _WIN32
+   if (file->map) {
+      munmap (file->map, file->map_len);
+      file->map = NULL;
+
+      /* drop the slack past the last byte written */
+      if (file->writable && file->map_len != file->len &&
+          ftruncate (file->fd, (off_t)file->len) == -1) {
+         MONGOC_WARNING ("Failed to truncate mapped file: %d", errno);
+      }
+
+      file->map_len = 0;
+   }
+#endif
+
    if (file->fd != -1) {
 #ifdef _WIN32
       ret = _close (file->fd);
@@ -103,6 +190,11 @@ _mongoc_stream_file_flush (mongoc_stream_t *stream) /* IN */
 #ifdef _WIN32
       return _commit (file->fd);
 #else
+      if (file->map && file->writable &&
+          msync (file->map, file->map_len, MS_SYNC) == -1) {
+         return -1;
+      }
+
       return fsync (file->fd);
 #endif
    }
@@ -178,6 +270,80 @@ _mongoc_stream_file_writev (mongoc_stream_t *stream,       /* IN */
 }
 
 
+#ifndef _WIN32
+static ssize_t
+_mongoc_stream_file_mapped_readv (mongoc_stream_t *stream,       /* IN */
+                                  mongoc_iovec_t  *iov,          /* IN */
+                                  size_t           iovcnt,       /* IN */
+                                  size_t           min_bytes,    /* IN */
+                                  int32_t          timeout_msec) /* IN */
+{
+   mongoc_stream_file_t *file = (mongoc_stream_file_t *)stream;
+   ssize_t ret = 0;
+   size_t n;
+   size_t i;
+
+   ENTRY;
+
+   for (i = 0; i < iovcnt && file->pos < file->len; i++) {
+      n = BSON_MIN (iov [i].iov_len, file->len - file->pos);
+      memcpy (iov [i].iov_base, file->map + file->pos, n);
+      file->pos += n;
+      ret += n;
+   }
+
+   RETURN (ret);
+}
+
+
+static ssize_t
+_mongoc_stream_file_mapped_writev (mongoc_stream_t *stream,       /* IN */
+                                   mongoc_iovec_t  *iov,          /* IN */
+                                   size_t           iovcnt,       /* IN */
+                                   int32_t          timeout_msec) /* IN */
+{
+   mongoc_stream_file_t *file = (mongoc_stream_file_t *)stream;
+   size_t total = 0;
+   size_t map_len;
+   size_t i;
+
+   ENTRY;
+
+   if (!file->writable) {
+      errno = EBADF;
+      RETURN (-1);
+   }
+
+   for (i = 0; i < iovcnt; i++) {
+      total += iov [i].iov_len;
+   }
+
+   if (!total) {
+      RETURN (0);
+   }
+
+   if (file->pos + total > file->map_len) {
+      /* grow geometrically, the length is trimmed again on close */
+      map_len = BSON_MAX (file->pos + total, file->map_len * 2);
+      map_len = BSON_MAX (map_len, MONGOC_STREAM_FILE_MAP_MIN);
+
+      if (!_mongoc_stream_file_remap (file, map_len)) {
+         RETURN (-1);
+      }
+   }
+
+   for (i = 0; i < iovcnt; i++) {
+      memcpy (file->map + file->pos, iov [i].iov_base, iov [i].iov_len);
+      file->pos += iov [i].iov_len;
+   }
+
+   file->len = BSON_MAX (file->len, file->pos);
+
+   RETURN ((ssize_t)total);
+}
+#endif
+
+
 static bool
 _mongoc_stream_file_check_closed (mongoc_stream_t *stream) /* IN */
 {
@@ -232,6 +398,99 @@ mongoc_stream_file_new_for_path (const char *path,  /* IN */
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_stream_file_new_mapped --
+ *
+ *       Create a file stream that reads and writes @fd through a shared
+ *       memory mapping instead of read () and write (). Reads start at
+ *       the current file offset; the file's length is taken when the
+ *       stream is created. If @fd was opened read-write, writes extend
+ *       the mapping and the file.
+ *
+ *       If @fd cannot be mapped, because it is write-only, not a regular
+ *       file, or the platform lacks mmap, an ordinary file stream is
+ *       returned instead.
+ *
+ * Returns:
+ *       A newly allocated mongoc_stream_t that owns @fd.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_stream_t *
+mongoc_stream_file_new_mapped (int fd) /* IN */
+{
+   mongoc_stream_file_t *file;
+#ifndef _WIN32
+   struct stat st;
+   off_t offset;
+   int flags;
+#endif
+
+   ENTRY;
+
+   file = (mongoc_stream_file_t *)mongoc_stream_file_new (fd);
+
+#ifndef _WIN32
+   flags = fcntl (fd, F_GETFL);
+
+   /* mmap needs read access, even for a mapping that is only written */
+   if (flags == -1 ||
+       (flags & O_ACCMODE) == O_WRONLY ||
+       fstat (fd, &st) == -1 ||
+       !S_ISREG (st.st_mode)) {
+      RETURN ((mongoc_stream_t *)file);
+   }
+
+   file->writable = ((flags & O_ACCMODE) == O_RDWR);
+   file->len = (size_t)st.st_size;
+
+   if (file->len && !_mongoc_stream_file_remap (file, file->len)) {
+      TRACE ("mmap failed: %d", errno);
+      file->writable = false;
+      RETURN ((mongoc_stream_t *)file);
+   }
+
+   offset = (flags & O_APPEND) ? (off_t)file->len : lseek (fd, 0, SEEK_CUR);
+   file->pos = offset > 0 ? (size_t)offset : 0;
+
+   file->mapped = true;
+   file->vtable.readv = _mongoc_stream_file_mapped_readv;
+   file->vtable.writev = _mongoc_stream_file_mapped_writev;
+#endif
+
+   RETURN ((mongoc_stream_t *)file);
+}
+
+
+mongoc_stream_t *
+mongoc_stream_file_new_mapped_for_path (const char *path,  /* IN */
+                                        int         flags, /* IN */
+                                        int         mode)  /* IN */
+{
+#ifdef _WIN32
+   return mongoc_stream_file_new_for_path (path, flags, mode);
+#else
+   int fd;
+
+   BSON_ASSERT (path);
+
+   fd = open (path, flags, mode);
+
+   if (fd == -1) {
+      return NULL;
+   }
+
+   return mongoc_stream_file_new_mapped (fd);
+#endif
+}
+
+
 int
 mongoc_stream_file_get_fd (mongoc_stream_file_t *stream)
 {
@@ -239,3 +498,47 @@ mongoc_stream_file_get_fd (mongoc_stream_file_t *stream)
 
    return stream->fd;
 }
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_stream_file_read_mapped --
+ *
+ *       Read up to @count bytes from a mapped file stream without copying
+ *       them: @data is pointed at the bytes in the mapping, which stay
+ *       valid until the stream is written, closed or destroyed.
+ *
+ * Returns:
+ *       true if @stream is a mapped file stream, then @len is set to the
+ *       number of bytes read, 0 at the end of the file. false for any
+ *       other stream, which must be read with mongoc_stream_readv ().
+ *
+ * Side effects:
+ *       The stream's position advances by @len.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_stream_file_read_mapped (mongoc_stream_t  *stream, /* IN */
+                                 size_t            count,  /* IN */
+                                 const uint8_t   **data,   /* OUT */
+                                 size_t           *len)    /* OUT */
+{
+   mongoc_stream_file_t *file = (mongoc_stream_file_t *)stream;
+
+   BSON_ASSERT (stream);
+   BSON_ASSERT (data);
+   BSON_ASSERT (len);
+
+   if (stream->type != MONGOC_STREAM_FILE || !file->mapped) {
+      return false;
+   }
+
+   *len = file->pos < file->len ? BSON_MIN (count, file->len - file->pos) : 0;
+   *data = file->map + file->pos;
+   file->pos += *len;
+
+   return true;
+}
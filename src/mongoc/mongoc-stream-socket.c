@@ -28,6 +28,7 @@ struct _mongoc_stream_socket_t
 {
    mongoc_stream_t  vtable;
    mongoc_socket_t *sock;
+   bool             corked;  /* TCP_CORK was set with setsockopt */
 };
 
 
@@ -111,15 +112,57 @@ _mongoc_stream_socket_setsockopt (mongoc_stream_t *stream,
 
    ret = mongoc_socket_setsockopt (ss->sock, level, optname, optval, optlen);
 
+#ifdef TCP_CORK
+   if (ret == 0 && level == IPPROTO_TCP && optname == TCP_CORK &&
+       optlen == sizeof (int)) {
+      ss->corked = (*(int *)optval != 0);
+   }
+#endif
+
    RETURN (ret);
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_stream_socket_flush --
+ *
+ *       Writes are not buffered here, but if the application corked the
+ *       socket with TCP_CORK, a partial segment may be held back by the
+ *       kernel. Uncork and cork it again to send it now.
+ *
+ *--------------------------------------------------------------------------
+ */
+
 static int
 _mongoc_stream_socket_flush (mongoc_stream_t *stream)
 {
+#ifdef TCP_CORK
+   mongoc_stream_socket_t *ss = (mongoc_stream_socket_t *)stream;
+   int optval;
+
+   ENTRY;
+
+   if (ss->sock && ss->corked) {
+      optval = 0;
+      if (mongoc_socket_setsockopt (ss->sock, IPPROTO_TCP, TCP_CORK,
+                                    &optval, sizeof optval) != 0) {
+         RETURN (-1);
+      }
+
+      optval = 1;
+      if (mongoc_socket_setsockopt (ss->sock, IPPROTO_TCP, TCP_CORK,
+                                    &optval, sizeof optval) != 0) {
+         ss->corked = false;
+      }
+   }
+
+   RETURN (0);
+#else
    ENTRY;
    RETURN (0);
+#endif
 }
 
 
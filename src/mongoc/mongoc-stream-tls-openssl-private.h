@@ -24,6 +24,8 @@
 #ifdef MONGOC_ENABLE_SSL_OPENSSL
 #include <bson.h>
 
+#include "mongoc-socket.h"
+
 BSON_BEGIN_DECLS
 
 
@@ -37,6 +39,10 @@ typedef struct
    BIO                *bio;
    BIO_METHOD         *meth;
    SSL_CTX            *ctx;
+   bool                ktls;       /* bio is over the socket, not the shim */
+   bool                ktls_send;  /* the kernel encrypts what we send */
+   mongoc_socket_t    *ktls_sock;  /* the base stream's, if ktls */
+   char               *write_buf;  /* coalesces writev, allocated on use */
 } mongoc_stream_tls_openssl_t;
 
 
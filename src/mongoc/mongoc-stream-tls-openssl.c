@@ -28,6 +28,8 @@
 
 #include "mongoc-counters-private.h"
 #include "mongoc-errno-private.h"
+#include "mongoc-socket-private.h"
+#include "mongoc-stream-socket.h"
 #include "mongoc-stream-tls.h"
 #include "mongoc-stream-private.h"
 #include "mongoc-stream-tls-openssl-bio-private.h"
@@ -41,7 +43,21 @@
 #undef MONGOC_LOG_DOMAIN
 #define MONGOC_LOG_DOMAIN "stream-tls-openssl"
 
-#define MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE 4096
+/* the largest TLS record payload, so each full buffer is sent as one record */
+#define MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE 16384
+
+/* OpenSSL 3 on Linux can hand the record layer to the kernel once the
+ * handshake is done, but only when the SSL BIO sits on a socket BIO */
+#if defined(__linux__) && OPENSSL_VERSION_NUMBER >= 0x30000000L && \
+    !defined(OPENSSL_NO_KTLS) && defined(SSL_OP_ENABLE_KTLS)
+#define MONGOC_OPENSSL_KTLS 1
+#endif
+
+#ifdef MONGOC_OPENSSL_KTLS
+#include <fcntl.h>
+
+#include "mongoc-stream-uring.h"
+#endif
 
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
 static void
@@ -98,6 +114,7 @@ _mongoc_stream_tls_openssl_destroy (mongoc_stream_t *stream)
    SSL_CTX_free (openssl->ctx);
    openssl->ctx = NULL;
 
+   bson_free (openssl->write_buf);
    bson_free (openssl);
    bson_free (stream);
 
@@ -163,6 +180,63 @@ _mongoc_stream_tls_openssl_close (mongoc_stream_t *stream)
 }
 
 
+#ifdef MONGOC_OPENSSL_KTLS
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_stream_tls_openssl_wait --
+ *
+ *       In kTLS mode the SSL BIO reads and writes the non-blocking socket
+ *       itself, instead of through our shim and mongoc_stream_t, so a
+ *       BIO call that would block returns at once. Wait for the socket
+ *       as the shim would have.
+ *
+ *       @expire is a monotonic deadline, or 0 to wait forever.
+ *
+ * Returns:
+ *       true if the BIO call should be retried; false on error or timeout.
+ *
+ * Side effects:
+ *       errno is set on timeout.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_stream_tls_openssl_wait (mongoc_stream_tls_t *tls,
+                                 int64_t              expire)
+{
+   mongoc_stream_tls_openssl_t *openssl = (mongoc_stream_tls_openssl_t *) tls->ctx;
+   mongoc_stream_poll_t poller;
+   int32_t timeout_msec = -1;
+
+   if (!BIO_should_retry (openssl->bio)) {
+      return false;
+   }
+
+   if (expire) {
+      timeout_msec = (int32_t)((expire - bson_get_monotonic_time ()) / 1000L);
+
+      if (timeout_msec <= 0) {
+         mongoc_counter_streams_timeout_inc();
+#ifdef _WIN32
+         errno = WSAETIMEDOUT;
+#else
+         errno = ETIMEDOUT;
+#endif
+         return false;
+      }
+   }
+
+   poller.stream = tls->base_stream;
+   poller.events = BIO_should_read (openssl->bio) ? POLLIN : POLLOUT;
+   poller.revents = 0;
+
+   return mongoc_stream_poll (&poller, 1, timeout_msec) > 0;
+}
+#endif
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -212,10 +286,21 @@ _mongoc_stream_tls_openssl_write (mongoc_stream_tls_t *tls,
 
    ret = BIO_write (openssl->bio, buf, buf_len);
 
+#ifdef MONGOC_OPENSSL_KTLS
+   while (ret <= 0 && openssl->ktls &&
+          _mongoc_stream_tls_openssl_wait (tls, expire)) {
+      ret = BIO_write (openssl->bio, buf, buf_len);
+   }
+#endif
+
    if (ret <= 0) {
       return ret;
    }
 
+   mongoc_counter_streams_tls_records_add (
+      (ret + MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE - 1)
+      / MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE);
+
    if (expire) {
       now = bson_get_monotonic_time ();
 
@@ -260,11 +345,15 @@ _mongoc_stream_tls_openssl_writev (mongoc_stream_t *stream,
                                    int32_t          timeout_msec)
 {
    mongoc_stream_tls_t *tls = (mongoc_stream_tls_t *)stream;
-   char buf[MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE];
+   mongoc_stream_tls_openssl_t *openssl = (mongoc_stream_tls_openssl_t *) tls->ctx;
+   char *buf;
    ssize_t ret = 0;
    ssize_t child_ret;
    size_t i;
    size_t iov_pos = 0;
+#ifdef MONGOC_OPENSSL_KTLS
+   int64_t expire_at;
+#endif
 
    /* There's a bit of a dance to coalesce vectorized writes into
     * MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE'd writes to avoid lots of small tls
@@ -273,12 +362,12 @@ _mongoc_stream_tls_openssl_writev (mongoc_stream_t *stream,
     * The basic idea is that we want to combine writes in the buffer if they're
     * smaller than the buffer, flushing as it gets full.  For larger writes, or
     * the last write in the iovec array, we want to ignore the buffer and just
-    * write immediately.  We take care of doing buffer writes by re-invoking
-    * ourself with a single iovec_t, pointing at our stack buffer.
+    * write immediately.  The buffer is kept with the stream: a single iovec
+    * is never buffered, so it is allocated on the first writev of several.
     */
-   char *buf_head = buf;
-   char *buf_tail = buf;
-   char *buf_end = buf + MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE;
+   char *buf_head;
+   char *buf_tail;
+   char *buf_end;
    size_t bytes;
 
    char *to_write = NULL;
@@ -291,6 +380,48 @@ _mongoc_stream_tls_openssl_writev (mongoc_stream_t *stream,
 
    tls->timeout_msec = timeout_msec;
 
+#ifdef MONGOC_OPENSSL_KTLS
+   if (openssl->ktls_send) {
+      if (timeout_msec < 0) {
+         expire_at = -1;
+      } else if (timeout_msec == 0) {
+         expire_at = 0;
+      } else {
+         expire_at = bson_get_monotonic_time () + (int64_t) timeout_msec * 1000;
+      }
+
+      /* the kernel frames and encrypts, so send the plaintext as is. use the
+       * non-blocking socket as the SSL BIO does, a uring base stream would
+       * fail on EAGAIN instead of waiting */
+      ret = mongoc_socket_sendv (openssl->ktls_sock, iov, iovcnt, expire_at);
+      errno = mongoc_socket_errno (openssl->ktls_sock);
+
+      if (ret > 0) {
+         mongoc_counter_streams_egress_add (ret);
+         mongoc_counter_streams_tls_records_add (
+            (ret + MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE - 1)
+            / MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE);
+      }
+
+      RETURN (ret);
+   }
+#endif
+
+   /* with one iovec nothing is buffered: buf_head == buf_tail and there is
+    * no next iovec, so the NULL pointers below are never used */
+   buf = buf_head = buf_tail = buf_end = NULL;
+
+   if (iovcnt > 1) {
+      if (!openssl->write_buf) {
+         openssl->write_buf = (char *)bson_malloc (
+            MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE);
+      }
+
+      buf = openssl->write_buf;
+      buf_head = buf_tail = buf;
+      buf_end = buf + MONGOC_STREAM_TLS_OPENSSL_BUFFER_SIZE;
+   }
+
    for (i = 0; i < iovcnt; i++) {
       iov_pos = 0;
 
@@ -430,6 +561,13 @@ _mongoc_stream_tls_openssl_readv (mongoc_stream_t *stream,
          read_ret = BIO_read (openssl->bio, (char *)iov[i].iov_base + iov_pos,
                               (int)(iov[i].iov_len - iov_pos));
 
+#ifdef MONGOC_OPENSSL_KTLS
+         if (read_ret <= 0 && openssl->ktls &&
+             _mongoc_stream_tls_openssl_wait (tls, expire)) {
+            continue;
+         }
+#endif
+
          /* https://www.openssl.org/docs/crypto/BIO_should_retry.html:
           *
           * If BIO_should_retry() returns false then the precise "error
@@ -565,6 +703,14 @@ mongoc_stream_tls_openssl_handshake (mongoc_stream_t *stream,
 
       BIO_get_ssl (openssl->bio, &ssl);
       if (_mongoc_openssl_check_cert (ssl, host, tls->ssl_opts.allow_invalid_hostname)) {
+#ifdef MONGOC_OPENSSL_KTLS
+         /* OpenSSL falls back to user space for ciphers or kernels
+          * without kTLS support; reads go through SSL_read either way */
+         if (openssl->ktls) {
+            openssl->ktls_send = BIO_get_ktls_send (SSL_get_wbio (ssl)) == 1;
+            TRACE ("kTLS send %s", openssl->ktls_send ? "enabled" : "unavailable");
+         }
+#endif
          RETURN (true);
       }
 
@@ -596,6 +742,54 @@ mongoc_stream_tls_openssl_handshake (mongoc_stream_t *stream,
 }
 
 
+#ifdef MONGOC_OPENSSL_KTLS
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_stream_tls_openssl_ktls_socket --
+ *
+ *       Get the socket @base_stream sends and receives on, for the SSL
+ *       BIO to use directly.
+ *
+ *       An io_uring stream keeps its socket in blocking mode, but the SSL
+ *       BIO must return when the socket would block, so we can wait with
+ *       a timeout. Switch it back. The SSL BIO then receives, and
+ *       _mongoc_stream_tls_openssl_writev sends, on the socket directly;
+ *       the uring stream only polls, checks, and closes it.
+ *
+ * Returns:
+ *       A mongoc_socket_t, or NULL if kTLS can't be used.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static mongoc_socket_t *
+_mongoc_stream_tls_openssl_ktls_socket (mongoc_stream_t *base_stream)
+{
+   mongoc_socket_t *sock = NULL;
+   int flags;
+
+   if (base_stream->type == MONGOC_STREAM_SOCKET) {
+      sock = mongoc_stream_socket_get_socket (
+         (mongoc_stream_socket_t *)base_stream);
+   } else if (base_stream->type == MONGOC_STREAM_URING) {
+      sock = mongoc_stream_uring_get_socket (
+         (mongoc_stream_uring_t *)base_stream);
+
+      if (sock) {
+         flags = fcntl (sock->sd, F_GETFL);
+         if (flags == -1 ||
+             fcntl (sock->sd, F_SETFL, flags | O_NONBLOCK) == -1) {
+            sock = NULL;
+         }
+      }
+   }
+
+   return sock;
+}
+#endif
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -630,7 +824,11 @@ mongoc_stream_tls_openssl_new (mongoc_stream_t  *base_stream,
    SSL_CTX *ssl_ctx = NULL;
    BIO *bio_ssl = NULL;
    BIO *bio_mongoc_shim = NULL;
-   BIO_METHOD *meth;
+   BIO_METHOD *meth = NULL;
+   bool ktls = false;
+#ifdef MONGOC_OPENSSL_KTLS
+   mongoc_socket_t *ktls_sock = NULL;
+#endif
 
    BSON_ASSERT(base_stream);
    BSON_ASSERT(opt);
@@ -666,13 +864,32 @@ mongoc_stream_tls_openssl_new (mongoc_stream_t  *base_stream,
       SSL_CTX_set_verify (ssl_ctx, SSL_VERIFY_PEER, NULL);
    }
 
+#ifdef MONGOC_OPENSSL_KTLS
+   /* kTLS needs the socket's descriptor, so other streams keep the shim */
+   if (opt->ktls &&
+       (ktls_sock = _mongoc_stream_tls_openssl_ktls_socket (base_stream))) {
+      SSL_CTX_set_options (ssl_ctx, SSL_OP_ENABLE_KTLS);
+      ktls = true;
+   }
+#endif
+
    bio_ssl = BIO_new_ssl (ssl_ctx, client);
    if (!bio_ssl) {
       SSL_CTX_free (ssl_ctx);
       RETURN(NULL);
    }
-   meth = mongoc_stream_tls_openssl_bio_meth_new ();
-   bio_mongoc_shim = BIO_new (meth);
+
+#ifdef MONGOC_OPENSSL_KTLS
+   if (ktls) {
+      /* the base stream still owns and closes the descriptor */
+      bio_mongoc_shim = BIO_new_socket (ktls_sock->sd, BIO_NOCLOSE);
+   } else
+#endif
+   {
+      meth = mongoc_stream_tls_openssl_bio_meth_new ();
+      bio_mongoc_shim = BIO_new (meth);
+   }
+
    if (!bio_mongoc_shim) {
       BIO_free_all (bio_ssl);
       BIO_meth_free (meth);
@@ -686,6 +903,10 @@ mongoc_stream_tls_openssl_new (mongoc_stream_t  *base_stream,
    openssl->bio = bio_ssl;
    openssl->meth = meth;
    openssl->ctx = ssl_ctx;
+   openssl->ktls = ktls;
+#ifdef MONGOC_OPENSSL_KTLS
+   openssl->ktls_sock = ktls_sock;
+#endif
 
    tls = (mongoc_stream_tls_t *)bson_malloc0 (sizeof *tls);
    tls->parent.type = MONGOC_STREAM_TLS;
@@ -703,7 +924,10 @@ mongoc_stream_tls_openssl_new (mongoc_stream_t  *base_stream,
    tls->ctx = (void *)openssl;
    tls->timeout_msec = -1;
    tls->base_stream = base_stream;
-   mongoc_stream_tls_openssl_bio_set_data (bio_mongoc_shim, tls);
+
+   if (!ktls) {
+      mongoc_stream_tls_openssl_bio_set_data (bio_mongoc_shim, tls);
+   }
 
    mongoc_counter_streams_active_inc();
 
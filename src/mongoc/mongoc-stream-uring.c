@@ -0,0 +1,583 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mongoc-config.h"
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef MONGOC_ENABLE_URING
+# include <fcntl.h>
+# include <limits.h>
+# include <liburing.h>
+#endif
+
+#include "mongoc-socket-private.h"
+#include "mongoc-stream-private.h"
+#include "mongoc-stream-uring.h"
+#include "mongoc-trace.h"
+
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "stream"
+
+
+#ifdef MONGOC_ENABLE_URING
+
+
+/* one operation and its linked timeout are in flight at a time */
+#define MONGOC_STREAM_URING_ENTRIES   8
+#define MONGOC_STREAM_URING_RECV_SIZE (16 * 1024)
+
+#define MONGOC_STREAM_URING_OP        1
+#define MONGOC_STREAM_URING_TIMEOUT   2
+
+
+struct _mongoc_stream_uring_t
+{
+   mongoc_stream_t  vtable;
+   mongoc_socket_t *sock;
+   struct io_uring  ring;
+   bool             fixed;     /* recv_buf is registered with the ring */
+   uint8_t         *recv_buf;
+   size_t           recv_off;  /* unread bytes in recv_buf start here */
+   size_t           recv_len;  /* number of unread bytes */
+};
+
+
+static BSON_INLINE int64_t
+get_expiration (int32_t timeout_msec)
+{
+   if (timeout_msec < 0) {
+      return -1;
+   } else if (timeout_msec == 0) {
+      return 0;
+   } else {
+      return (bson_get_monotonic_time () + ((int64_t)timeout_msec * 1000L));
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_stream_uring_run --
+ *
+ *       Submit @sqe, linked to a timeout unless @expire_at is -1, and
+ *       wait for it with a single io_uring_enter ().
+ *
+ * Returns:
+ *       The operation's result: a byte count, or a negative errno.
+ *       -ETIMEDOUT if @expire_at passed first.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static int
+_mongoc_stream_uring_run (mongoc_stream_uring_t *us,
+                          struct io_uring_sqe   *sqe,
+                          int64_t                expire_at)
+{
+   struct __kernel_timespec ts;
+   struct io_uring_sqe *timeout_sqe;
+   struct io_uring_cqe *cqe;
+   unsigned wait_nr = 1;
+   int64_t remaining;
+   bool timed_out = false;
+   int res = -ECANCELED;
+   int ret;
+
+   sqe->user_data = MONGOC_STREAM_URING_OP;
+
+   if (expire_at >= 0) {
+      remaining = expire_at ? expire_at - bson_get_monotonic_time () : 0;
+      remaining = BSON_MAX (remaining, 0);
+      ts.tv_sec = remaining / 1000000;
+      ts.tv_nsec = (remaining % 1000000) * 1000;
+
+      /* not armed at all if the operation completes inline */
+      sqe->flags |= IOSQE_IO_LINK;
+      timeout_sqe = io_uring_get_sqe (&us->ring);
+      io_uring_prep_link_timeout (timeout_sqe, &ts, 0);
+      timeout_sqe->user_data = MONGOC_STREAM_URING_TIMEOUT;
+      wait_nr = 2;
+   }
+
+   do {
+      ret = io_uring_submit_and_wait (&us->ring, wait_nr);
+   } while (ret == -EINTR);
+
+   if (ret < 0) {
+      return ret;
+   }
+
+   while (wait_nr) {
+      ret = io_uring_wait_cqe (&us->ring, &cqe);
+      if (ret == -EINTR) {
+         continue;
+      } else if (ret < 0) {
+         return ret;
+      }
+
+      if (cqe->user_data == MONGOC_STREAM_URING_OP) {
+         res = cqe->res;
+      } else if (cqe->res == -ETIME) {
+         timed_out = true;
+      }
+
+      io_uring_cqe_seen (&us->ring, cqe);
+      wait_nr--;
+   }
+
+   if (res == -ECANCELED && timed_out) {
+      res = -ETIMEDOUT;
+   }
+
+   return res;
+}
+
+
+static int
+_mongoc_stream_uring_close (mongoc_stream_t *stream)
+{
+   mongoc_stream_uring_t *us = (mongoc_stream_uring_t *)stream;
+   int ret;
+
+   ENTRY;
+
+   BSON_ASSERT (us);
+
+   if (us->sock) {
+      ret = mongoc_socket_close (us->sock);
+      RETURN (ret);
+   }
+
+   RETURN (0);
+}
+
+
+static void
+_mongoc_stream_uring_destroy (mongoc_stream_t *stream)
+{
+   mongoc_stream_uring_t *us = (mongoc_stream_uring_t *)stream;
+
+   ENTRY;
+
+   BSON_ASSERT (us);
+
+   /* also unregisters recv_buf */
+   io_uring_queue_exit (&us->ring);
+   bson_free (us->recv_buf);
+
+   if (us->sock) {
+      mongoc_socket_destroy (us->sock);
+      us->sock = NULL;
+   }
+
+   bson_free (us);
+
+   EXIT;
+}
+
+
+static void
+_mongoc_stream_uring_failed (mongoc_stream_t *stream)
+{
+   ENTRY;
+
+   _mongoc_stream_uring_destroy (stream);
+
+   EXIT;
+}
+
+
+static int
+_mongoc_stream_uring_setsockopt (mongoc_stream_t *stream,
+                                 int              level,
+                                 int              optname,
+                                 void            *optval,
+                                 socklen_t        optlen)
+{
+   mongoc_stream_uring_t *us = (mongoc_stream_uring_t *)stream;
+   int ret;
+
+   ENTRY;
+
+   BSON_ASSERT (us);
+   BSON_ASSERT (us->sock);
+
+   ret = mongoc_socket_setsockopt (us->sock, level, optname, optval, optlen);
+
+   RETURN (ret);
+}
+
+
+static int
+_mongoc_stream_uring_flush (mongoc_stream_t *stream)
+{
+   ENTRY;
+   RETURN (0);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_stream_uring_readv --
+ *
+ *       Small reads, like the 4-byte message length that
+ *       mongoc_cluster_try_recv () reads first, are served from a receive
+ *       buffer registered with the ring, filled with IORING_OP_READ_FIXED.
+ *       Reads at least as large as that buffer go straight into the
+ *       caller's iovec.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static ssize_t
+_mongoc_stream_uring_readv (mongoc_stream_t *stream,
+                            mongoc_iovec_t  *iov,
+                            size_t           iovcnt,
+                            size_t           min_bytes,
+                            int32_t          timeout_msec)
+{
+   mongoc_stream_uring_t *us = (mongoc_stream_uring_t *)stream;
+   struct io_uring_sqe *sqe;
+   int64_t expire_at;
+   ssize_t ret = 0;
+   size_t cur = 0;  /* bytes already copied into iov [i] */
+   size_t i = 0;
+   size_t n;
+   bool direct;
+   int res;
+
+   ENTRY;
+
+   BSON_ASSERT (us);
+   BSON_ASSERT (us->sock);
+
+   expire_at = get_expiration (timeout_msec);
+
+   for (;;) {
+      while (i < iovcnt && us->recv_len) {
+         n = BSON_MIN (us->recv_len, iov [i].iov_len - cur);
+         memcpy ((char *)iov [i].iov_base + cur,
+                 us->recv_buf + us->recv_off,
+                 n);
+         us->recv_off += n;
+         us->recv_len -= n;
+         cur += n;
+         ret += n;
+
+         if (cur == iov [i].iov_len) {
+            i++;
+            cur = 0;
+         }
+      }
+
+      if (i == iovcnt || (ret && ret >= (ssize_t)min_bytes)) {
+         RETURN (ret);
+      }
+
+      us->recv_off = 0;
+      sqe = io_uring_get_sqe (&us->ring);
+      direct = (iov [i].iov_len - cur >= MONGOC_STREAM_URING_RECV_SIZE);
+
+      if (direct) {
+         io_uring_prep_recv (sqe, us->sock->sd,
+                             (char *)iov [i].iov_base + cur,
+                             iov [i].iov_len - cur, 0);
+      } else if (us->fixed) {
+         io_uring_prep_read_fixed (sqe, us->sock->sd, us->recv_buf,
+                                   MONGOC_STREAM_URING_RECV_SIZE, 0, 0);
+      } else {
+         io_uring_prep_recv (sqe, us->sock->sd, us->recv_buf,
+                             MONGOC_STREAM_URING_RECV_SIZE, 0);
+      }
+
+      res = _mongoc_stream_uring_run (us, sqe, expire_at);
+
+      if (res <= 0) {
+         if (ret && ret >= (ssize_t)min_bytes) {
+            RETURN (ret);
+         }
+
+         us->sock->errno_ = res < 0 ? -res : ECONNRESET;
+         errno = us->sock->errno_;
+         RETURN (-1);
+      }
+
+      if (direct) {
+         cur += res;
+         ret += res;
+
+         if (cur == iov [i].iov_len) {
+            i++;
+            cur = 0;
+         }
+      } else {
+         us->recv_len = (size_t)res;
+      }
+   }
+}
+
+
+static ssize_t
+_mongoc_stream_uring_writev (mongoc_stream_t *stream,
+                             mongoc_iovec_t  *iov,
+                             size_t           iovcnt,
+                             int32_t          timeout_msec)
+{
+   mongoc_stream_uring_t *us = (mongoc_stream_uring_t *)stream;
+   struct io_uring_sqe *sqe;
+   struct msghdr msg;
+   int64_t expire_at;
+   ssize_t ret = 0;
+   size_t sent;
+   int res;
+
+   ENTRY;
+
+   BSON_ASSERT (us);
+
+   if (!us->sock) {
+      RETURN (-1);
+   }
+
+   expire_at = get_expiration (timeout_msec);
+
+   while (iovcnt) {
+      memset (&msg, 0, sizeof msg);
+      msg.msg_iov = (struct iovec *)iov;
+      msg.msg_iovlen = BSON_MIN (iovcnt, IOV_MAX);
+
+      sqe = io_uring_get_sqe (&us->ring);
+      io_uring_prep_sendmsg (sqe, us->sock->sd, &msg, MSG_NOSIGNAL);
+      res = _mongoc_stream_uring_run (us, sqe, expire_at);
+
+      if (res <= 0) {
+         us->sock->errno_ = res < 0 ? -res : EPIPE;
+         errno = us->sock->errno_;
+         RETURN (ret ? ret : -1);
+      }
+
+      ret += res;
+      sent = (size_t)res;
+
+      while (iovcnt && sent >= iov->iov_len) {
+         sent -= iov->iov_len;
+         iov++;
+         iovcnt--;
+      }
+
+      if (sent) {
+         iov->iov_base = (char *)iov->iov_base + sent;
+         iov->iov_len -= sent;
+      }
+   }
+
+   RETURN (ret);
+}
+
+
+static ssize_t
+_mongoc_stream_uring_poll (mongoc_stream_poll_t *streams,
+                           size_t                nstreams,
+                           int32_t               timeout_msec)
+{
+   mongoc_socket_poll_t *sds;
+   mongoc_stream_uring_t *us;
+   bool buffered = false;
+   ssize_t ret;
+   size_t i;
+
+   ENTRY;
+
+   sds = (mongoc_socket_poll_t *)bson_malloc (sizeof (*sds) * nstreams);
+
+   for (i = 0; i < nstreams; i++) {
+      us = (mongoc_stream_uring_t *)streams[i].stream;
+
+      if (!us->sock) {
+         bson_free (sds);
+         RETURN (-1);
+      }
+
+      sds[i].socket = us->sock;
+      sds[i].events = streams[i].events;
+      sds[i].revents = 0;
+
+      if ((streams[i].events & POLLIN) && us->recv_len) {
+         buffered = true;
+      }
+   }
+
+   /* bytes we already received are readable without waiting */
+   ret = mongoc_socket_poll (sds, nstreams, buffered ? 0 : timeout_msec);
+
+   if (ret >= 0) {
+      ret = 0;
+
+      for (i = 0; i < nstreams; i++) {
+         us = (mongoc_stream_uring_t *)streams[i].stream;
+         streams[i].revents = sds[i].revents;
+
+         if ((streams[i].events & POLLIN) && us->recv_len) {
+            streams[i].revents |= POLLIN;
+         }
+
+         if (streams[i].revents) {
+            ret++;
+         }
+      }
+   }
+
+   bson_free (sds);
+
+   RETURN (ret);
+}
+
+
+static bool
+_mongoc_stream_uring_check_closed (mongoc_stream_t *stream) /* IN */
+{
+   mongoc_stream_uring_t *us = (mongoc_stream_uring_t *)stream;
+
+   ENTRY;
+
+   BSON_ASSERT (stream);
+
+   if (us->recv_len) {
+      RETURN (false);
+   }
+
+   if (us->sock) {
+      RETURN (mongoc_socket_check_closed (us->sock));
+   }
+
+   RETURN (true);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_stream_uring_new --
+ *
+ *       Create a new mongoc_stream_t that sends and receives on @sock
+ *       with io_uring. Each operation, with its timeout, costs one
+ *       system call, where the socket stream polls and then calls
+ *       sendmsg () or recv ().
+ *
+ *       The stream takes ownership of @sock. @sock is switched to
+ *       blocking mode, so io_uring waits for it to be ready instead of
+ *       returning EAGAIN.
+ *
+ * Returns:
+ *       A newly allocated mongoc_stream_t, or NULL if the kernel does
+ *       not support io_uring. Then @sock is unchanged and still owned by
+ *       the caller.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_stream_t *
+mongoc_stream_uring_new (mongoc_socket_t *sock) /* IN */
+{
+   mongoc_stream_uring_t *stream;
+   struct iovec iov;
+   int flags;
+
+   ENTRY;
+
+   BSON_ASSERT (sock);
+
+   stream = (mongoc_stream_uring_t *)bson_malloc0 (sizeof *stream);
+
+   /* an old kernel, or io_uring disabled by sysctl or a seccomp filter */
+   if (io_uring_queue_init (MONGOC_STREAM_URING_ENTRIES, &stream->ring, 0)) {
+      TRACE ("%s", "io_uring is not available");
+      bson_free (stream);
+      RETURN (NULL);
+   }
+
+   flags = fcntl (sock->sd, F_GETFL);
+   if (flags == -1 || fcntl (sock->sd, F_SETFL, flags & ~O_NONBLOCK) == -1) {
+      io_uring_queue_exit (&stream->ring);
+      bson_free (stream);
+      RETURN (NULL);
+   }
+
+   stream->recv_buf = (uint8_t *)bson_malloc (MONGOC_STREAM_URING_RECV_SIZE);
+   iov.iov_base = stream->recv_buf;
+   iov.iov_len = MONGOC_STREAM_URING_RECV_SIZE;
+
+   /* may fail under a low RLIMIT_MEMLOCK, then we use plain recv */
+   stream->fixed = (0 == io_uring_register_buffers (&stream->ring, &iov, 1));
+
+   stream->vtable.type = MONGOC_STREAM_URING;
+   stream->vtable.close = _mongoc_stream_uring_close;
+   stream->vtable.destroy = _mongoc_stream_uring_destroy;
+   stream->vtable.failed = _mongoc_stream_uring_failed;
+   stream->vtable.flush = _mongoc_stream_uring_flush;
+   stream->vtable.readv = _mongoc_stream_uring_readv;
+   stream->vtable.writev = _mongoc_stream_uring_writev;
+   stream->vtable.setsockopt = _mongoc_stream_uring_setsockopt;
+   stream->vtable.check_closed = _mongoc_stream_uring_check_closed;
+   stream->vtable.poll = _mongoc_stream_uring_poll;
+   stream->sock = sock;
+
+   RETURN ((mongoc_stream_t *)stream);
+}
+
+
+mongoc_socket_t *
+mongoc_stream_uring_get_socket (mongoc_stream_uring_t *stream) /* IN */
+{
+   BSON_ASSERT (stream);
+
+   return stream->sock;
+}
+
+
+#else /* !MONGOC_ENABLE_URING */
+
+
+mongoc_stream_t *
+mongoc_stream_uring_new (mongoc_socket_t *sock) /* IN */
+{
+   BSON_ASSERT (sock);
+
+   /* not built with liburing, the caller uses a socket stream instead */
+   return NULL;
+}
+
+
+mongoc_socket_t *
+mongoc_stream_uring_get_socket (mongoc_stream_uring_t *stream) /* IN */
+{
+   BSON_ASSERT (stream);
+
+   /* no uring stream can exist without liburing */
+   return NULL;
+}
+
+
+#endif /* MONGOC_ENABLE_URING */
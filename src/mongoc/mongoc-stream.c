@@ -350,6 +350,12 @@ mongoc_stream_poll (mongoc_stream_poll_t *streams,
    errno = 0;
 
    for (i = 0; i < nstreams; i++) {
+      /* a reply can't arrive while its request sits in a write buffer */
+      if ((streams[i].events & POLLIN) && streams[i].stream->flush &&
+          mongoc_stream_flush (streams[i].stream) != 0) {
+         goto CLEANUP;
+      }
+
       poller[i].stream = mongoc_stream_get_root_stream(streams[i].stream);
       poller[i].events = streams[i].events;
       poller[i].revents = 0;
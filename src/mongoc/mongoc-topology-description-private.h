@@ -32,6 +32,14 @@ typedef enum
       MONGOC_TOPOLOGY_DESCRIPTION_TYPES
    } mongoc_topology_description_type_t;
 
+/* how to choose among the servers suitable for an operation */
+typedef enum
+   {
+      MONGOC_SS_POLICY_RANDOM,
+      MONGOC_SS_POLICY_POWER_OF_TWO,
+      MONGOC_SS_POLICY_LEAST_LOADED,
+   } mongoc_ss_policy_t;
+
 typedef struct _mongoc_topology_description_t
 {
    mongoc_topology_description_type_t type;
@@ -43,6 +51,7 @@ typedef struct _mongoc_topology_description_t
    char                              *compatibility_error;
    uint32_t                           max_server_id;
    bool                               stale;
+   mongoc_ss_policy_t                 policy;
 } mongoc_topology_description_t;
 
 typedef enum
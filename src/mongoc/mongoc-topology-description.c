@@ -577,6 +577,100 @@ DONE:
 }
 
 
+/* expected wait for a new operation: recent latency times queue length */
+static int64_t
+_mongoc_topology_description_server_cost (mongoc_server_description_t *sd)
+{
+   int64_t latency;
+
+   latency = mongoc_server_description_latency_percentile (sd, 90);
+
+   return BSON_MAX (latency, 1) *
+          (BSON_MAX (mongoc_server_description_in_flight (sd), 0) + 1);
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * _mongoc_topology_description_power_of_two --
+ *
+ *      Choose two of the suitable servers at random and return the one
+ *      with the lower cost. Unlike always choosing the cheapest server,
+ *      this doesn't send every operation to one server until the costs
+ *      are next updated, yet a server that slows down quickly gets a
+ *      smaller share of operations.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static mongoc_server_description_t *
+_mongoc_topology_description_power_of_two (mongoc_array_t *suitable_servers)
+{
+   mongoc_server_description_t *a;
+   mongoc_server_description_t *b;
+   size_t i;
+   size_t j;
+
+   BSON_ASSERT (suitable_servers->len > 1);
+
+   i = (size_t) rand () % suitable_servers->len;
+   j = (size_t) rand () % (suitable_servers->len - 1);
+
+   if (j >= i) {
+      j++;
+   }
+
+   a = _mongoc_array_index (suitable_servers, mongoc_server_description_t *, i);
+   b = _mongoc_array_index (suitable_servers, mongoc_server_description_t *, j);
+
+   if (_mongoc_topology_description_server_cost (b) <
+       _mongoc_topology_description_server_cost (a)) {
+      return b;
+   }
+
+   return a;
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * _mongoc_topology_description_least_loaded --
+ *
+ *      Return the suitable server with the fewest operations in
+ *      progress, breaking ties at random.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static mongoc_server_description_t *
+_mongoc_topology_description_least_loaded (mongoc_array_t *suitable_servers)
+{
+   mongoc_server_description_t *sd;
+   mongoc_server_description_t *best = NULL;
+   int32_t best_load = 0;
+   int32_t load;
+   size_t offset;
+   size_t i;
+
+   offset = (size_t) rand ();
+
+   for (i = 0; i < suitable_servers->len; i++) {
+      sd = _mongoc_array_index (suitable_servers, mongoc_server_description_t *,
+                                (offset + i) % suitable_servers->len);
+      load = mongoc_server_description_in_flight (sd);
+
+      if (!best || load < best_load) {
+         best = sd;
+         best_load = load;
+      }
+   }
+
+   return best;
+}
+
+
 /*
  *-------------------------------------------------------------------------
  *
@@ -633,7 +727,13 @@ mongoc_topology_description_select (mongoc_topology_description_t *topology,
                                                  topology, read_pref,
                                                  local_threshold_ms,
                                                  heartbeat_frequency_ms);
-   if (suitable_servers.len != 0) {
+   if (suitable_servers.len > 1 &&
+       topology->policy == MONGOC_SS_POLICY_POWER_OF_TWO) {
+      sd = _mongoc_topology_description_power_of_two (&suitable_servers);
+   } else if (suitable_servers.len > 1 &&
+              topology->policy == MONGOC_SS_POLICY_LEAST_LOADED) {
+      sd = _mongoc_topology_description_least_loaded (&suitable_servers);
+   } else if (suitable_servers.len != 0) {
       sd = _mongoc_array_index(&suitable_servers, mongoc_server_description_t*,
                                rand() % suitable_servers.len);
    }
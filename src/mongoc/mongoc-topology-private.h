@@ -64,6 +64,8 @@ typedef struct _mongoc_topology_t
    bool                               shutdown_requested;
    bool                               single_threaded;
    bool                               stale;
+   bool                               idle_monitoring;
+   bool                               idle_scanning;
 } mongoc_topology_t;
 
 mongoc_topology_t *
@@ -85,6 +87,13 @@ mongoc_topology_select (mongoc_topology_t         *topology,
                         const mongoc_read_prefs_t *read_prefs,
                         bson_error_t              *error);
 
+mongoc_server_description_t *
+mongoc_topology_select_with_deadline (mongoc_topology_t         *topology,
+                                      mongoc_ss_optype_t         optype,
+                                      const mongoc_read_prefs_t *read_prefs,
+                                      int64_t                    expire_at,
+                                      bson_error_t              *error);
+
 mongoc_server_description_t *
 mongoc_topology_server_by_id (mongoc_topology_t *topology,
                               uint32_t           id,
@@ -99,9 +108,35 @@ int64_t
 mongoc_topology_server_timestamp (mongoc_topology_t *topology,
                                   uint32_t           id);
 
+void
+_mongoc_topology_record_latency (mongoc_topology_t *topology,
+                                 uint32_t           id,
+                                 int64_t            duration_usec);
+
+int64_t
+_mongoc_topology_latency_percentile (mongoc_topology_t *topology,
+                                     uint32_t           id,
+                                     int                percentile);
+
+uint32_t
+_mongoc_topology_select_other (mongoc_topology_t         *topology,
+                               const mongoc_read_prefs_t *read_prefs,
+                               uint32_t                   exclude_id);
+
 bool
 _mongoc_topology_start_background_scanner (mongoc_topology_t *topology);
 
+int64_t
+_mongoc_topology_monitor_work (mongoc_topology_t *topology,
+                               int32_t            timeout_msec);
+
+void
+_mongoc_topology_finish_idle_scan (mongoc_topology_t *topology);
+
+void
+_mongoc_topology_finish_idle_check (mongoc_topology_t *topology,
+                                    uint32_t           server_id);
+
 bool
 _mongoc_topology_set_appname (mongoc_topology_t *topology,
                               const char        *appname);
@@ -19,7 +19,9 @@
 
 #include "mongoc-config.h"
 #include "mongoc-error.h"
+#include "mongoc-memory-private.h"
 #include "mongoc-trace.h"
+#include "mongoc-trace-private.h"
 #include "mongoc-topology-scanner-private.h"
 #include "mongoc-stream-socket.h"
 
@@ -111,6 +113,8 @@ _begin_ismaster_cmd (mongoc_topology_scanner_t      *ts,
 {
    const bson_t *ismaster_cmd_to_send = _get_ismaster_doc (ts, node);
 
+   MONGOC_PROBE2 (ismaster_start, node->id, node->host.host_and_port);
+
    node->cmd = mongoc_async_cmd (
       ts->async, node->stream, ts->setup,
       node->host.host, "admin",
@@ -125,7 +129,8 @@ mongoc_topology_scanner_new (const mongoc_uri_t          *uri,
                              mongoc_topology_scanner_cb_t cb,
                              void                        *data)
 {
-   mongoc_topology_scanner_t *ts = (mongoc_topology_scanner_t *)bson_malloc0 (sizeof (*ts));
+   mongoc_topology_scanner_t *ts = (mongoc_topology_scanner_t *)_mongoc_malloc0 (
+      MONGOC_MEMORY_TOPOLOGY, sizeof (*ts));
 
    ts->async = mongoc_async_new ();
 
@@ -176,7 +181,7 @@ mongoc_topology_scanner_destroy (mongoc_topology_scanner_t *ts)
    /* This field can be set by a mongoc_client */
    bson_free ((char *) ts->appname);
 
-   bson_free (ts);
+   _mongoc_free (MONGOC_MEMORY_TOPOLOGY, ts);
 }
 
 mongoc_topology_scanner_node_t *
@@ -186,7 +191,8 @@ mongoc_topology_scanner_add (mongoc_topology_scanner_t *ts,
 {
    mongoc_topology_scanner_node_t *node;
 
-   node = (mongoc_topology_scanner_node_t *) bson_malloc0 (sizeof (*node));
+   node = (mongoc_topology_scanner_node_t *) _mongoc_malloc0 (
+      MONGOC_MEMORY_TOPOLOGY, sizeof (*node));
 
    memcpy (&node->host, host, sizeof (*host));
 
@@ -262,7 +268,7 @@ mongoc_topology_scanner_node_destroy (mongoc_topology_scanner_node_t *node, bool
 {
    DL_DELETE (node->ts->nodes, node);
    mongoc_topology_scanner_node_disconnect (node, failed);
-   bson_free (node);
+   _mongoc_free (MONGOC_MEMORY_TOPOLOGY, node);
 }
 
 /*
@@ -346,6 +352,8 @@ mongoc_topology_scanner_ismaster_handler (mongoc_async_cmd_result_t async_status
    node = (mongoc_topology_scanner_node_t *)data;
    node->cmd = NULL;
 
+   MONGOC_PROBE3 (ismaster_done, node->id, rtt_msec, (int) async_status);
+
    if (node->retired) {
       return;
    }
@@ -22,9 +22,12 @@
 #endif
 
 #include "mongoc-error.h"
+#include "mongoc-log.h"
+#include "mongoc-memory-private.h"
 #include "mongoc-topology-private.h"
 #include "mongoc-client-private.h"
 #include "mongoc-util-private.h"
+#include "mongoc-trace-private.h"
 
 #include "utlist.h"
 
@@ -155,10 +158,12 @@ mongoc_topology_new (const mongoc_uri_t *uri,
    mongoc_topology_description_type_t init_type;
    uint32_t id;
    const mongoc_host_list_t *hl;
+   const char *policy;
 
    BSON_ASSERT (uri);
 
-   topology = (mongoc_topology_t *)bson_malloc0(sizeof *topology);
+   topology = (mongoc_topology_t *)_mongoc_malloc0 (MONGOC_MEMORY_TOPOLOGY,
+                                                    sizeof *topology);
 
    /*
     * Not ideal, but there's no great way to do this.
@@ -213,6 +218,18 @@ mongoc_topology_new (const mongoc_uri_t *uri,
       topology->uri, "localthresholdms",
       MONGOC_TOPOLOGY_LOCAL_THRESHOLD_MS);
 
+   policy = mongoc_uri_get_option_as_utf8 (topology->uri,
+                                           "serverselectionpolicy", "random");
+
+   if (!strcasecmp (policy, "powerOfTwoChoices")) {
+      topology->description.policy = MONGOC_SS_POLICY_POWER_OF_TWO;
+   } else if (!strcasecmp (policy, "leastLoaded")) {
+      topology->description.policy = MONGOC_SS_POLICY_LEAST_LOADED;
+   } else if (strcasecmp (policy, "random")) {
+      MONGOC_WARNING ("Unsupported serverSelectionPolicy \"%s\", "
+                      "using \"random\"", policy);
+   }
+
    /* Total time allowed to check a server is connectTimeoutMS.
     * Server Discovery And Monitoring Spec:
     *
@@ -275,7 +292,7 @@ mongoc_topology_destroy (mongoc_topology_t *topology)
    mongoc_cond_destroy (&topology->cond_server);
    mongoc_mutex_destroy (&topology->mutex);
 
-   bson_free(topology);
+   _mongoc_free (MONGOC_MEMORY_TOPOLOGY, topology);
 }
 
 /*
@@ -327,31 +344,150 @@ _mongoc_topology_run_scanner (mongoc_topology_t *topology,
  *--------------------------------------------------------------------------
  */
 static void
-_mongoc_topology_do_blocking_scan (mongoc_topology_t *topology,
-                                   bson_error_t      *error)
+_mongoc_topology_start_scan_single_threaded (mongoc_topology_t *topology)
 {
-   mongoc_topology_scanner_t *scanner;
-
    topology->scanner_state = MONGOC_TOPOLOGY_SCANNER_SINGLE_THREADED;
 
 #ifdef MONGOC_EXPERIMENTAL_FEATURES
    _mongoc_metadata_freeze ();
 #endif
 
-   scanner = topology->scanner;
-   mongoc_topology_scanner_start (scanner,
+   mongoc_topology_scanner_start (topology->scanner,
                                   (int32_t) topology->connect_timeout_msec,
                                   true);
+}
 
-   while (_mongoc_topology_run_scanner (topology,
-                                        topology->connect_timeout_msec)) {}
-
-   mongoc_topology_scanner_get_error (scanner, error);
 
+static void
+_mongoc_topology_scan_done (mongoc_topology_t *topology)
+{
    /* "retired" nodes can be checked again in the next scan */
-   mongoc_topology_scanner_reset (scanner);
+   mongoc_topology_scanner_reset (topology->scanner);
    topology->last_scan = bson_get_monotonic_time ();
    topology->stale = false;
+   topology->idle_scanning = false;
+}
+
+
+static void
+_mongoc_topology_do_blocking_scan (mongoc_topology_t *topology,
+                                   bson_error_t      *error)
+{
+   /* complete a scan begun by _mongoc_topology_monitor_work, if any */
+   if (!topology->idle_scanning) {
+      _mongoc_topology_start_scan_single_threaded (topology);
+   }
+
+   while (_mongoc_topology_run_scanner (topology,
+                                        topology->connect_timeout_msec)) {}
+
+   mongoc_topology_scanner_get_error (topology->scanner, error);
+   _mongoc_topology_scan_done (topology);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_topology_finish_idle_scan --
+ *
+ *       Block until a scan begun by _mongoc_topology_monitor_work is
+ *       complete. The scanner shares its streams with the client, so
+ *       this must be called before a stream is used for an operation.
+ *
+ *--------------------------------------------------------------------------
+ */
+void
+_mongoc_topology_finish_idle_scan (mongoc_topology_t *topology)
+{
+   bson_error_t error;
+
+   if (topology->idle_scanning) {
+      _mongoc_topology_do_blocking_scan (topology, &error);
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_topology_finish_idle_check --
+ *
+ *       Complete the check of @server_id if a scan begun by
+ *       _mongoc_topology_monitor_work is still awaiting its ismaster
+ *       reply, so the client can use the stream it shares with the
+ *       scanner. Checks of other servers continue in later calls to
+ *       _mongoc_topology_monitor_work.
+ *
+ *--------------------------------------------------------------------------
+ */
+void
+_mongoc_topology_finish_idle_check (mongoc_topology_t *topology,
+                                    uint32_t           server_id)
+{
+   mongoc_topology_scanner_node_t *node;
+
+   if (!topology->idle_scanning) {
+      return;
+   }
+
+   node = mongoc_topology_scanner_get_node (topology->scanner, server_id);
+
+   if (node && node->cmd) {
+      mongoc_async_run_cmd (node->cmd);
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_topology_monitor_work --
+ *
+ *       Monitoring entry for a single-threaded client with idle
+ *       monitoring. Starts a scan if heartbeatFrequencyMS has passed and
+ *       advances the scan for up to @timeout_msec.
+ *
+ * Returns:
+ *       0 while a scan is in progress, otherwise the number of
+ *       milliseconds until the next scan is due.
+ *
+ *--------------------------------------------------------------------------
+ */
+int64_t
+_mongoc_topology_monitor_work (mongoc_topology_t *topology,
+                               int32_t            timeout_msec)
+{
+   int64_t now;
+   int64_t scan_at;
+
+   BSON_ASSERT (topology->single_threaded);
+
+   if (!topology->idle_scanning) {
+      now = bson_get_monotonic_time ();
+
+      if (topology->stale) {
+         scan_at = topology->last_scan
+                   + MONGOC_TOPOLOGY_MIN_HEARTBEAT_FREQUENCY_MS * 1000;
+      } else {
+         scan_at = topology->last_scan + topology->heartbeat_msec * 1000;
+      }
+
+      if (scan_at > now) {
+         return BSON_MAX ((scan_at - now) / 1000, 1);
+      }
+
+      _mongoc_topology_start_scan_single_threaded (topology);
+      topology->idle_scanning = true;
+   }
+
+   if (_mongoc_topology_run_scanner (topology, timeout_msec)) {
+      return 0;
+   }
+
+   _mongoc_topology_scan_done (topology);
+
+   return topology->heartbeat_msec;
 }
 
 
@@ -426,6 +562,24 @@ _mongoc_server_selection_error (const char         *msg,
    }
 }
 
+/* when the operation's deadline, not serverSelectionTimeoutMS, ran out,
+ * report it like any other operation timeout */
+static void
+_mongoc_server_selection_timeout_error (bool                op_timeout,
+                                        const char         *msg,
+                                        const bson_error_t *scanner_error,
+                                        bson_error_t       *error)
+{
+   if (op_timeout) {
+      bson_set_error (error,
+                      MONGOC_ERROR_CLIENT,
+                      MONGOC_ERROR_CLIENT_OPERATION_TIMEOUT,
+                      "Operation exceeded its timeout during server selection");
+   } else {
+      _mongoc_server_selection_error (msg, scanner_error, error);
+   }
+}
+
 /*
  *-------------------------------------------------------------------------
  *
@@ -454,11 +608,12 @@ _mongoc_server_selection_error (const char         *msg,
  *
  *-------------------------------------------------------------------------
  */
-mongoc_server_description_t *
-mongoc_topology_select (mongoc_topology_t         *topology,
-                        mongoc_ss_optype_t         optype,
-                        const mongoc_read_prefs_t *read_prefs,
-                        bson_error_t              *error)
+static mongoc_server_description_t *
+_mongoc_topology_select (mongoc_topology_t         *topology,
+                         mongoc_ss_optype_t         optype,
+                         const mongoc_read_prefs_t *read_prefs,
+                         int64_t                    op_expire_at,
+                         bson_error_t              *error)
 {
    static const char *timeout_msg =
       "No suitable servers found: `serverSelectionTimeoutMS` expired";
@@ -476,6 +631,7 @@ mongoc_topology_select (mongoc_topology_t         *topology,
    int64_t scan_ready;  /* the soonest we can do a blocking scan */
    int64_t next_update; /* the latest we must do a blocking scan */
    int64_t expire_at;   /* when server selection timeout expires */
+   bool op_timeout = false;  /* whether expire_at is the operation's */
 
    BSON_ASSERT (topology);
 
@@ -485,11 +641,19 @@ mongoc_topology_select (mongoc_topology_t         *topology,
    expire_at = loop_start
                + ((int64_t) topology->server_selection_timeout_msec * 1000);
 
+   /* the operation's own deadline may be sooner */
+   if (op_expire_at && op_expire_at < expire_at) {
+      expire_at = op_expire_at;
+      op_timeout = true;
+   }
+
    if (topology->single_threaded) {
       tried_once = false;
       next_update = topology->last_scan + topology->heartbeat_msec * 1000;
-      if (next_update < loop_start) {
-         /* we must scan now */
+      if (next_update < loop_start && !topology->idle_monitoring) {
+         /* we must scan now. with idle monitoring the application scans
+          * between operations instead, we block only if no server is
+          * suitable */
          topology->stale = true;
       }
 
@@ -502,7 +666,8 @@ mongoc_topology_select (mongoc_topology_t         *topology,
 
             if (scan_ready > expire_at && !try_once) {
                /* selection timeout will expire before min heartbeat passes */
-               _mongoc_server_selection_error (
+               _mongoc_server_selection_timeout_error (
+                  op_timeout,
                   "No suitable servers found: "
                   "`serverselectiontimeoutms` timed out",
                   &scanner_error, error);
@@ -556,8 +721,9 @@ mongoc_topology_select (mongoc_topology_t         *topology,
 
             if (loop_end > expire_at) {
                /* no time left in server_selection_timeout_msec */
-               _mongoc_server_selection_error (timeout_msg,
-                                               &scanner_error, error);
+               _mongoc_server_selection_timeout_error (op_timeout,
+                                                       timeout_msg,
+                                                       &scanner_error, error);
 
                topology->stale = true;
                return NULL;
@@ -601,8 +767,9 @@ mongoc_topology_select (mongoc_topology_t         *topology,
          if (r == ETIMEDOUT) {
 #endif
             /* handle timeouts */
-            _mongoc_server_selection_error (timeout_msg,
-                                            &scanner_error, error);
+            _mongoc_server_selection_timeout_error (op_timeout,
+                                                    timeout_msg,
+                                                    &scanner_error, error);
 
             return NULL;
          } else if (r) {
@@ -617,8 +784,9 @@ mongoc_topology_select (mongoc_topology_t         *topology,
          loop_start = bson_get_monotonic_time ();
 
          if (loop_start > expire_at) {
-            _mongoc_server_selection_error (timeout_msg,
-                                            &scanner_error, error);
+            _mongoc_server_selection_timeout_error (op_timeout,
+                                                    timeout_msg,
+                                                    &scanner_error, error);
 
             return NULL;
          }
@@ -630,6 +798,49 @@ mongoc_topology_select (mongoc_topology_t         *topology,
    }
 }
 
+
+/* probes around the whole of server selection, including any scans */
+mongoc_server_description_t *
+mongoc_topology_select (mongoc_topology_t         *topology,
+                        mongoc_ss_optype_t         optype,
+                        const mongoc_read_prefs_t *read_prefs,
+                        bson_error_t              *error)
+{
+   return mongoc_topology_select_with_deadline (topology, optype, read_prefs,
+                                                0, error);
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * mongoc_topology_select_with_deadline --
+ *
+ *       Like mongoc_topology_select, but give up at @expire_at, a
+ *       monotonic time in microseconds, if that comes before
+ *       serverSelectionTimeoutMS expires. Pass 0 for no deadline.
+ *
+ *-------------------------------------------------------------------------
+ */
+mongoc_server_description_t *
+mongoc_topology_select_with_deadline (mongoc_topology_t         *topology,
+                                      mongoc_ss_optype_t         optype,
+                                      const mongoc_read_prefs_t *read_prefs,
+                                      int64_t                    expire_at,
+                                      bson_error_t              *error)
+{
+   mongoc_server_description_t *sd;
+
+   MONGOC_PROBE1 (server_select_start, (int) optype);
+
+   sd = _mongoc_topology_select (topology, optype, read_prefs, expire_at,
+                                 error);
+
+   MONGOC_PROBE2 (server_select_done, (int) optype, sd ? sd->id : 0);
+
+   return sd;
+}
+
 /*
  *-------------------------------------------------------------------------
  *
@@ -713,6 +924,141 @@ mongoc_topology_invalidate_server (mongoc_topology_t  *topology,
    mongoc_mutex_unlock (&topology->mutex);
 }
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_topology_record_latency --
+ *
+ *      Record how long a successful operation on server @id took, for
+ *      latency-aware server selection.
+ *
+ *      NOTE: this method uses @topology's mutex.
+ *
+ *--------------------------------------------------------------------------
+ */
+void
+_mongoc_topology_record_latency (mongoc_topology_t *topology,
+                                 uint32_t           id,
+                                 int64_t            duration_usec)
+{
+   mongoc_server_description_t *sd;
+
+   mongoc_mutex_lock (&topology->mutex);
+
+   sd = mongoc_topology_description_server_by_id (&topology->description,
+                                                  id, NULL);
+   if (sd) {
+      mongoc_server_description_record_latency (sd, duration_usec);
+   }
+
+   mongoc_mutex_unlock (&topology->mutex);
+}
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_topology_latency_percentile --
+ *
+ *      The @percentile operation latency of server @id, in microseconds.
+ *
+ *      NOTE: this method uses @topology's mutex.
+ *
+ * Returns:
+ *      The latency, or -1 if the server is unknown or has no samples.
+ *
+ *--------------------------------------------------------------------------
+ */
+int64_t
+_mongoc_topology_latency_percentile (mongoc_topology_t *topology,
+                                     uint32_t           id,
+                                     int                percentile)
+{
+   mongoc_server_description_t *sd;
+   int64_t ret = -1;
+
+   mongoc_mutex_lock (&topology->mutex);
+
+   sd = mongoc_topology_description_server_by_id (&topology->description,
+                                                  id, NULL);
+   if (sd) {
+      ret = mongoc_server_description_latency_percentile (sd, percentile);
+   }
+
+   mongoc_mutex_unlock (&topology->mutex);
+
+   return ret;
+}
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_topology_select_other --
+ *
+ *      Choose at random a server suitable for reads with @read_prefs,
+ *      other than server @exclude_id. Does not block or scan: the
+ *      choice is made from the current topology description.
+ *
+ *      NOTE: this method uses @topology's mutex.
+ *
+ * Returns:
+ *      A server id, or 0 if no other server is suitable.
+ *
+ *--------------------------------------------------------------------------
+ */
+uint32_t
+_mongoc_topology_select_other (mongoc_topology_t         *topology,
+                               const mongoc_read_prefs_t *read_prefs,
+                               uint32_t                   exclude_id)
+{
+   mongoc_array_t suitable_servers;
+   mongoc_server_description_t *sd;
+   size_t n_others;
+   size_t skip;
+   size_t i;
+   uint32_t id = 0;
+
+   _mongoc_array_init (&suitable_servers,
+                       sizeof (mongoc_server_description_t *));
+
+   mongoc_mutex_lock (&topology->mutex);
+
+   mongoc_topology_description_suitable_servers (
+      &suitable_servers, MONGOC_SS_READ, &topology->description, read_prefs,
+      topology->local_threshold_msec, topology->heartbeat_msec);
+
+   n_others = 0;
+   for (i = 0; i < suitable_servers.len; i++) {
+      sd = _mongoc_array_index (&suitable_servers,
+                                mongoc_server_description_t *, i);
+      if (sd->id != exclude_id) {
+         n_others++;
+      }
+   }
+
+   if (n_others) {
+      skip = (size_t) rand () % n_others;
+
+      for (i = 0; i < suitable_servers.len; i++) {
+         sd = _mongoc_array_index (&suitable_servers,
+                                   mongoc_server_description_t *, i);
+         if (sd->id == exclude_id) {
+            continue;
+         }
+
+         if (!skip--) {
+            id = sd->id;
+            break;
+         }
+      }
+   }
+
+   mongoc_mutex_unlock (&topology->mutex);
+
+   _mongoc_array_destroy (&suitable_servers);
+
+   return id;
+}
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -22,9 +22,14 @@
 
 #include <bson.h>
 
+#include "mongoc-config.h"
 #include "mongoc-log.h"
 #include "mongoc-log-private.h"
 
+#ifdef MONGOC_ENABLE_USDT
+# include <sys/sdt.h>
+#endif
+
 
 BSON_BEGIN_DECLS
 
@@ -48,6 +53,35 @@ BSON_BEGIN_DECLS
 #endif
 
 
+/*
+ * Static probes, for bpftrace, perf and SystemTap to attach to a running
+ * process, e.g.:
+ *
+ *    bpftrace -e 'usdt:/usr/lib/libmongoc-1.0.so:mongoc:sendv_start { ... }'
+ *
+ * Unlike TRACE they are compiled into release builds: each is a single nop
+ * until a tracer attaches. Arguments must be integers or pointers.
+ */
+#ifdef MONGOC_ENABLE_USDT
+#define MONGOC_PROBE(_name) \
+   DTRACE_PROBE (mongoc, _name)
+#define MONGOC_PROBE1(_name, _a1) \
+   DTRACE_PROBE1 (mongoc, _name, _a1)
+#define MONGOC_PROBE2(_name, _a1, _a2) \
+   DTRACE_PROBE2 (mongoc, _name, _a1, _a2)
+#define MONGOC_PROBE3(_name, _a1, _a2, _a3) \
+   DTRACE_PROBE3 (mongoc, _name, _a1, _a2, _a3)
+#define MONGOC_PROBE4(_name, _a1, _a2, _a3, _a4) \
+   DTRACE_PROBE4 (mongoc, _name, _a1, _a2, _a3, _a4)
+#else
+#define MONGOC_PROBE(_name)
+#define MONGOC_PROBE1(_name, _a1)
+#define MONGOC_PROBE2(_name, _a1, _a2)
+#define MONGOC_PROBE3(_name, _a1, _a2, _a3)
+#define MONGOC_PROBE4(_name, _a1, _a2, _a3, _a4)
+#endif
+
+
 BSON_END_DECLS
 
 
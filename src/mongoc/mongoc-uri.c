@@ -553,6 +553,7 @@ mongoc_uri_option_is_int32 (const char *key)
        !strcasecmp(key, "maxidletimems") ||
        !strcasecmp(key, "waitqueuemultiple") ||
        !strcasecmp(key, "waitqueuetimeoutms") ||
+       !strcasecmp(key, "writebuffersize") ||
        !strcasecmp(key, "wtimeoutms");
 }
 
@@ -560,6 +561,7 @@ bool
 mongoc_uri_option_is_bool (const char *key)
 {
    return !strcasecmp(key, "canonicalizeHostname") ||
+              !strcasecmp(key, "iouring") ||
               !strcasecmp(key, "journal") ||
               !strcasecmp(key, "safe") ||
               !strcasecmp(key, "serverSelectionTryOnce") ||
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_WRITE_COALESCER_PRIVATE_H
+#define MONGOC_WRITE_COALESCER_PRIVATE_H
+
+#if !defined (MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-array-private.h"
+#include "mongoc-collection.h"
+#include "mongoc-thread-private.h"
+#include "mongoc-write-command-private.h"
+
+
+BSON_BEGIN_DECLS
+
+
+#define MONGOC_WRITE_COALESCER_MAX_DOCUMENTS 1000
+
+
+/* single-document inserts sent together as one "insert" command */
+typedef struct
+{
+   char                    ns[MONGOC_NAMESPACE_MAX];
+   mongoc_write_concern_t *write_concern;
+   mongoc_cond_t           cond;
+   mongoc_write_command_t  command;    /* documents are copied as they join */
+   int64_t                 deadline;   /* when the leader sends it */
+   int64_t                 expire_at;  /* soonest of the callers' operation
+                                        * deadlines, or 0 */
+   bool                    closed;     /* no more documents may join */
+   bool                    done;       /* result is set */
+   mongoc_write_result_t   result;
+   uint32_t                refs;       /* callers not yet returned */
+} mongoc_write_coalescer_group_t;
+
+
+/* shared by the clients of a pool, all access is under the mutex */
+typedef struct _mongoc_write_coalescer_t
+{
+   mongoc_mutex_t  mutex;
+   int32_t         window_msec;    /* 0 if disabled */
+   uint32_t        max_documents;
+   uint32_t        callers;        /* threads in an insert, in any group */
+   uint32_t        joined;         /* of them, those in open groups */
+   mongoc_array_t  open_groups;    /* mongoc_write_coalescer_group_t * */
+} mongoc_write_coalescer_t;
+
+
+mongoc_write_coalescer_t *_mongoc_write_coalescer_new        (void);
+void                      _mongoc_write_coalescer_destroy    (mongoc_write_coalescer_t     *coalescer);
+void                      _mongoc_write_coalescer_configure  (mongoc_write_coalescer_t     *coalescer,
+                                                              int32_t                       window_msec,
+                                                              uint32_t                      max_documents);
+bool                      _mongoc_write_coalescer_insert     (mongoc_write_coalescer_t     *coalescer,
+                                                              mongoc_collection_t          *collection,
+                                                              const bson_t                 *document,
+                                                              const mongoc_write_concern_t *write_concern,
+                                                              mongoc_write_result_t        *result);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_WRITE_COALESCER_PRIVATE_H */
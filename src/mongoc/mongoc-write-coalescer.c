@@ -0,0 +1,423 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+
+#include "mongoc-client-private.h"
+#include "mongoc-collection-private.h"
+#include "mongoc-error.h"
+#include "mongoc-trace.h"
+#include "mongoc-write-coalescer-private.h"
+#include "mongoc-write-concern-private.h"
+
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "write-coalescer"
+
+
+mongoc_write_coalescer_t *
+_mongoc_write_coalescer_new (void)
+{
+   mongoc_write_coalescer_t *coalescer;
+
+   coalescer = (mongoc_write_coalescer_t *)bson_malloc0 (sizeof *coalescer);
+   mongoc_mutex_init (&coalescer->mutex);
+   coalescer->max_documents = MONGOC_WRITE_COALESCER_MAX_DOCUMENTS;
+   _mongoc_array_init (&coalescer->open_groups,
+                       sizeof (mongoc_write_coalescer_group_t *));
+
+   return coalescer;
+}
+
+
+/* the pool is destroyed after all its clients are pushed, so no caller is
+ * still waiting on a group */
+void
+_mongoc_write_coalescer_destroy (mongoc_write_coalescer_t *coalescer)
+{
+   if (!coalescer) {
+      return;
+   }
+
+   BSON_ASSERT (!coalescer->open_groups.len);
+
+   _mongoc_array_destroy (&coalescer->open_groups);
+   mongoc_mutex_destroy (&coalescer->mutex);
+   bson_free (coalescer);
+}
+
+
+void
+_mongoc_write_coalescer_configure (mongoc_write_coalescer_t *coalescer,
+                                   int32_t                   window_msec,
+                                   uint32_t                  max_documents)
+{
+   BSON_ASSERT (coalescer);
+
+   mongoc_mutex_lock (&coalescer->mutex);
+   coalescer->window_msec = BSON_MAX (window_msec, 0);
+   coalescer->max_documents = max_documents
+                              ? max_documents
+                              : MONGOC_WRITE_COALESCER_MAX_DOCUMENTS;
+   mongoc_mutex_unlock (&coalescer->mutex);
+}
+
+
+static bool
+_mongoc_write_concern_equal (const mongoc_write_concern_t *a,
+                             const mongoc_write_concern_t *b)
+{
+   return a->fsync_ == b->fsync_ &&
+          a->journal == b->journal &&
+          a->w == b->w &&
+          a->wtimeout == b->wtimeout &&
+          !strcmp (a->wtag ? a->wtag : "", b->wtag ? b->wtag : "");
+}
+
+
+static mongoc_write_coalescer_group_t *
+_mongoc_write_coalescer_group_new (mongoc_collection_t          *collection,
+                                   const mongoc_write_concern_t *write_concern,
+                                   int32_t                       window_msec)
+{
+   mongoc_bulk_write_flags_t write_flags = MONGOC_BULK_WRITE_FLAGS_INIT;
+   mongoc_write_coalescer_group_t *group;
+
+   /* one document's error must not fail the others */
+   write_flags.ordered = false;
+
+   group = (mongoc_write_coalescer_group_t *)bson_malloc0 (sizeof *group);
+   bson_strncpy (group->ns, collection->ns, sizeof group->ns);
+   group->write_concern = mongoc_write_concern_copy (write_concern);
+   mongoc_cond_init (&group->cond);
+   _mongoc_write_command_init_insert (&group->command, NULL, write_flags,
+                                      ++collection->client->cluster.operation_id,
+                                      false);
+   group->deadline = bson_get_monotonic_time () + window_msec * 1000;
+   _mongoc_write_result_init (&group->result);
+
+   return group;
+}
+
+
+static void
+_mongoc_write_coalescer_group_destroy (mongoc_write_coalescer_group_t *group)
+{
+   mongoc_write_concern_destroy (group->write_concern);
+   mongoc_cond_destroy (&group->cond);
+   _mongoc_write_command_destroy (&group->command);
+   _mongoc_write_result_destroy (&group->result);
+   bson_free (group);
+}
+
+
+/* stop other callers joining @group, called with the mutex held */
+static void
+_mongoc_write_coalescer_close (mongoc_write_coalescer_t       *coalescer,
+                               mongoc_write_coalescer_group_t *group)
+{
+   mongoc_write_coalescer_group_t **groups;
+   size_t i;
+
+   if (group->closed) {
+      return;
+   }
+
+   groups = (mongoc_write_coalescer_group_t **)coalescer->open_groups.data;
+
+   for (i = 0; i < coalescer->open_groups.len; i++) {
+      if (groups[i] == group) {
+         groups[i] = groups[coalescer->open_groups.len - 1];
+         coalescer->open_groups.len--;
+         break;
+      }
+   }
+
+   coalescer->joined -= group->refs;
+   group->closed = true;
+   mongoc_cond_broadcast (&group->cond);
+}
+
+
+/* send the group's documents as one unordered insert on the leader's
+ * client, by the soonest of the callers' deadlines, called without the
+ * mutex */
+static void
+_mongoc_write_coalescer_send (mongoc_write_coalescer_group_t *group,
+                              mongoc_collection_t            *collection)
+{
+   mongoc_cluster_t *cluster = &collection->client->cluster;
+   mongoc_server_stream_t *server_stream;
+   int64_t saved_deadline;
+
+   ENTRY;
+
+   TRACE ("inserting %d coalesced documents",
+          (int)group->command.n_documents);
+
+   saved_deadline = mongoc_cluster_push_deadline (cluster, group->expire_at);
+
+   server_stream = mongoc_cluster_stream_for_writes (cluster,
+                                                     &group->result.error);
+
+   if (server_stream) {
+      _mongoc_write_command_execute (&group->command, collection->client,
+                                     server_stream, collection->db,
+                                     collection->collection,
+                                     group->write_concern, 0 /* offset */,
+                                     &group->result);
+      mongoc_server_stream_cleanup (server_stream);
+   } else {
+      group->result.failed = true;
+   }
+
+   mongoc_cluster_pop_deadline (cluster, saved_deadline);
+
+   EXIT;
+}
+
+
+/* the part of the group's result that is the document at @index's */
+static void
+_mongoc_write_coalescer_result (const mongoc_write_result_t *all,
+                                uint32_t                     index,
+                                mongoc_write_result_t       *result)
+{
+   bson_iter_t iter;
+   bson_iter_t citer;
+   const uint8_t *data;
+   uint32_t len;
+   bson_t write_error;
+   bson_t tmp;
+
+   if (all->error.code) {
+      /* the command failed, e.g. with a network error */
+      result->failed = true;
+      memcpy (&result->error, &all->error, sizeof result->error);
+      return;
+   }
+
+   if (bson_iter_init (&iter, &all->writeErrors)) {
+      while (bson_iter_next (&iter)) {
+         if (!BSON_ITER_HOLDS_DOCUMENT (&iter) ||
+             !bson_iter_recurse (&iter, &citer) ||
+             !bson_iter_find (&citer, "index") ||
+             bson_iter_as_int64 (&citer) != (int64_t)index) {
+            continue;
+         }
+
+         /* renumber it as the caller's only document */
+         bson_iter_document (&iter, &len, &data);
+         bson_init_static (&write_error, data, len);
+         bson_append_document_begin (&result->writeErrors, "0", 1, &tmp);
+         bson_copy_to_excluding_noinit (&write_error, &tmp, "index", NULL);
+         BSON_APPEND_INT32 (&tmp, "index", 0);
+         bson_append_document_end (&result->writeErrors, &tmp);
+         result->failed = true;
+         break;
+      }
+   }
+
+   if (!result->failed) {
+      result->nInserted = 1;
+   }
+
+   if (all->n_writeConcernErrors) {
+      bson_destroy (&result->writeConcernErrors);
+      bson_copy_to (&all->writeConcernErrors, &result->writeConcernErrors);
+      result->n_writeConcernErrors = all->n_writeConcernErrors;
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_write_coalescer_insert --
+ *
+ *       Insert @document together with other threads' single-document
+ *       inserts to the same namespace, with the same write concern.
+ *
+ *       The first caller to join a group is its leader: it waits up to
+ *       the window for others, or until the group is full, then sends
+ *       the group with one "insert" command. The others wait for the
+ *       reply and return their own document's result.
+ *
+ *       The leader stops waiting once no caller is awaiting the reply to
+ *       a group already sent: those may join when the reply comes, but
+ *       with none, nothing is gained by waiting. So a lone inserting
+ *       thread sends at once.
+ *
+ *       With operation timeouts, the group is sent by the soonest of its
+ *       callers' deadlines, and each caller waits no longer than its own.
+ *       A caller that gives up first gets a timeout error, though its
+ *       document may still be inserted with the group.
+ *
+ * Returns:
+ *       false if coalescing is disabled or does not apply, and the caller
+ *       must insert the document itself. Otherwise true and @result is
+ *       initialized, the caller completes and destroys it.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_write_coalescer_insert (mongoc_write_coalescer_t     *coalescer,
+                                mongoc_collection_t          *collection,
+                                const bson_t                 *document,
+                                const mongoc_write_concern_t *write_concern,
+                                mongoc_write_result_t        *result)
+{
+   mongoc_write_coalescer_group_t *group = NULL;
+   mongoc_write_coalescer_group_t **groups;
+   bool leader = false;
+   uint32_t index;
+   int64_t expire_at;
+   int64_t wait_until;
+   int64_t remaining;
+   size_t i;
+
+   ENTRY;
+
+   BSON_ASSERT (coalescer);
+
+   /* an unacknowledged insert doesn't wait for a reply anyway */
+   if (!mongoc_write_concern_is_acknowledged (write_concern)) {
+      RETURN (false);
+   }
+
+   expire_at = _mongoc_collection_expire_at (collection);
+
+   mongoc_mutex_lock (&coalescer->mutex);
+
+   if (!coalescer->window_msec) {
+      mongoc_mutex_unlock (&coalescer->mutex);
+      RETURN (false);
+   }
+
+   coalescer->callers++;
+   groups = (mongoc_write_coalescer_group_t **)coalescer->open_groups.data;
+
+   for (i = 0; i < coalescer->open_groups.len; i++) {
+      if (!strcmp (groups[i]->ns, collection->ns) &&
+          _mongoc_write_concern_equal (groups[i]->write_concern,
+                                       write_concern)) {
+         group = groups[i];
+         break;
+      }
+   }
+
+   if (!group) {
+      group = _mongoc_write_coalescer_group_new (collection,
+                                                 write_concern,
+                                                 coalescer->window_msec);
+      _mongoc_array_append_val (&coalescer->open_groups, group);
+      leader = true;
+   }
+
+   /* copy it now, we may return before the leader sends the group */
+   index = group->command.n_documents;
+   _mongoc_write_command_insert_append (&group->command, document);
+   group->refs++;
+   coalescer->joined++;
+
+   if (expire_at && (!group->expire_at || expire_at < group->expire_at)) {
+      group->expire_at = expire_at;
+   }
+
+   if (group->command.n_documents >= coalescer->max_documents) {
+      _mongoc_write_coalescer_close (coalescer, group);
+   }
+
+   if (leader) {
+      /* while callers awaiting other groups' replies may still join */
+      while (!group->closed && coalescer->callers > coalescer->joined) {
+         wait_until = group->deadline;
+
+         if (group->expire_at && group->expire_at < wait_until) {
+            wait_until = group->expire_at;
+         }
+
+         remaining = wait_until - bson_get_monotonic_time ();
+
+         if (remaining <= 0) {
+            break;
+         }
+
+         mongoc_cond_timedwait (&group->cond, &coalescer->mutex,
+                                BSON_MAX (remaining / 1000, 1));
+      }
+
+      _mongoc_write_coalescer_close (coalescer, group);
+      mongoc_mutex_unlock (&coalescer->mutex);
+
+      _mongoc_write_coalescer_send (group, collection);
+
+      mongoc_mutex_lock (&coalescer->mutex);
+      group->done = true;
+      mongoc_cond_broadcast (&group->cond);
+   } else {
+      while (!group->done) {
+         if (!expire_at) {
+            mongoc_cond_wait (&group->cond, &coalescer->mutex);
+            continue;
+         }
+
+         remaining = expire_at - bson_get_monotonic_time ();
+
+         if (remaining <= 0) {
+            break;
+         }
+
+         mongoc_cond_timedwait (&group->cond, &coalescer->mutex,
+                                BSON_MAX (remaining / 1000, 1));
+      }
+   }
+
+   _mongoc_write_result_init (result);
+
+   if (group->done) {
+      _mongoc_write_coalescer_result (&group->result, index, result);
+   } else {
+      /* our deadline passed first, the leader may still send our document */
+      if (!group->closed) {
+         coalescer->joined--;
+      }
+
+      result->failed = true;
+      bson_set_error (&result->error,
+                      MONGOC_ERROR_CLIENT,
+                      MONGOC_ERROR_CLIENT_OPERATION_TIMEOUT,
+                      "Operation exceeded its timeout");
+   }
+
+   if (!--group->refs) {
+      _mongoc_write_coalescer_group_destroy (group);
+   }
+
+   /* leaders waiting for this caller to join need not wait any more */
+   coalescer->callers--;
+   groups = (mongoc_write_coalescer_group_t **)coalescer->open_groups.data;
+
+   for (i = 0; i < coalescer->open_groups.len; i++) {
+      mongoc_cond_broadcast (&groups[i]->cond);
+   }
+
+   mongoc_mutex_unlock (&coalescer->mutex);
+
+   RETURN (true);
+}
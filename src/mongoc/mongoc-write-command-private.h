@@ -25,6 +25,7 @@
 
 #include "mongoc-client.h"
 #include "mongoc-error.h"
+#include "mongoc-flags.h"
 #include "mongoc-write-concern.h"
 #include "mongoc-server-stream-private.h"
 
@@ -121,6 +122,9 @@ void _mongoc_write_command_update_append (mongoc_write_command_t      *command,
 void _mongoc_write_command_delete_append (mongoc_write_command_t *command,
                                           const bson_t           *selector);
 
+int  _mongoc_validate_flags            (mongoc_validate_level_t        level,
+                                        int                            flags);
+
 void _mongoc_write_command_execute     (mongoc_write_command_t        *command,
                                         mongoc_client_t               *client,
                                         mongoc_server_stream_t        *server_stream,
@@ -140,6 +144,11 @@ void _mongoc_write_result_merge_legacy (mongoc_write_result_t         *result,
                                         int32_t                        error_api_version,
                                         mongoc_error_code_t            default_code,
                                         uint32_t                       offset);
+void _mongoc_write_result_merge_result (mongoc_write_result_t        *result,
+                                        const mongoc_write_result_t  *src);
+void _mongoc_write_result_remap_indexes  (mongoc_write_result_t        *result,
+                                          const uint32_t               *indexes,
+                                          uint32_t                      n_indexes);
 bool _mongoc_write_result_complete     (mongoc_write_result_t         *result,
                                         int32_t                        error_api_version,
                                         const mongoc_write_concern_t  *wc,
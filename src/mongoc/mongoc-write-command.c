@@ -18,6 +18,7 @@
 
 #include "mongoc-client-private.h"
 #include "mongoc-error.h"
+#include "mongoc-query-cache-private.h"
 #include "mongoc-trace.h"
 #include "mongoc-write-command-private.h"
 #include "mongoc-write-concern-private.h"
@@ -84,15 +85,14 @@ _mongoc_write_command_insert_append (mongoc_write_command_t *command,
 
    /*
     * If the document does not contain an "_id" field, we need to generate
-    * a new oid for "_id".
+    * a new oid for "_id". Build it in place, not in a temporary we copy.
     */
    if (!bson_iter_init_find (&iter, document, "_id")) {
-      bson_init (&tmp);
+      bson_append_document_begin (command->documents, key, -1, &tmp);
       bson_oid_init (&oid, NULL);
       BSON_APPEND_OID (&tmp, "_id", &oid);
       bson_concat (&tmp, document);
-      BSON_APPEND_DOCUMENT (command->documents, key, &tmp);
-      bson_destroy (&tmp);
+      bson_append_document_end (command->documents, &tmp);
    } else {
       BSON_APPEND_DOCUMENT (command->documents, key, document);
    }
@@ -102,6 +102,32 @@ _mongoc_write_command_insert_append (mongoc_write_command_t *command,
    EXIT;
 }
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_validate_flags --
+ *
+ *       The bson_validate flags for a document the caller would check
+ *       with @flags, at validation level @level.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+int
+_mongoc_validate_flags (mongoc_validate_level_t level,
+                        int                     flags)
+{
+   switch (level) {
+   case MONGOC_VALIDATE_NONE:
+      return 0;
+   case MONGOC_VALIDATE_KEYS:
+      return flags & (BSON_VALIDATE_DOLLAR_KEYS | BSON_VALIDATE_DOT_KEYS);
+   case MONGOC_VALIDATE_FULL:
+   default:
+      return flags;
+   }
+}
+
 void
 _mongoc_write_command_update_append (mongoc_write_command_t *command,
                                      const bson_t           *selector,
@@ -1181,7 +1207,7 @@ _mongoc_write_command(mongoc_write_command_t       *command,
    uint32_t len = 0;
    bson_t tmp;
    bson_t ar;
-   bson_t cmd;
+   bson_t *cmd;
    bson_t reply;
    char str [16];
    bool has_more;
@@ -1201,8 +1227,6 @@ _mongoc_write_command(mongoc_write_command_t       *command,
    BSON_ASSERT (server_stream);
    BSON_ASSERT (collection);
 
-   bson_init (&cmd);
-
    max_bson_obj_size = mongoc_server_stream_max_bson_obj_size (server_stream);
    max_write_batch_size = mongoc_server_stream_max_write_batch_size (server_stream);
 
@@ -1236,14 +1260,16 @@ _mongoc_write_command(mongoc_write_command_t       *command,
       EXIT;
    }
 
+   cmd = _mongoc_scratch_bson (&client->scratch);
+
 again:
    has_more = false;
    i = 0;
 
-   _mongoc_write_command_init (&cmd, command, collection, write_concern);
+   _mongoc_write_command_init (cmd, command, collection, write_concern);
 
    /* 1 byte to specify array type, 1 byte for field name's null terminator */
-   overhead = cmd.len + 2 + gCommandFieldLens[command->type];
+   overhead = cmd->len + 2 + gCommandFieldLens[command->type];
 
    if (!_mongoc_write_command_will_overflow (overhead,
                                              command->documents->len,
@@ -1251,13 +1277,13 @@ again:
                                              max_bson_obj_size,
                                              max_write_batch_size)) {
       /* copy the whole documents buffer as e.g. "updates": [...] */
-      bson_append_array (&cmd,
+      bson_append_array (cmd,
                          gCommandFields[command->type],
                          gCommandFieldLens[command->type],
                          command->documents);
       i = command->n_documents;
    } else {
-      bson_append_array_begin (&cmd,
+      bson_append_array_begin (cmd,
                                gCommandFields[command->type],
                                gCommandFieldLens[command->type],
                                &ar);
@@ -1293,7 +1319,7 @@ again:
          i++;
       } while (bson_iter_next (&iter));
 
-      bson_append_array_end (&cmd, &ar);
+      bson_append_array_end (cmd, &ar);
    }
 
    if (!i) {
@@ -1304,7 +1330,7 @@ again:
       ret = mongoc_cluster_run_command_monitored (&client->cluster,
                                                   server_stream,
                                                   MONGOC_QUERY_NONE, database,
-                                                  &cmd, &reply, error);
+                                                  cmd, &reply, error);
 
       if (!ret) {
          result->failed = true;
@@ -1316,11 +1342,11 @@ again:
    }
 
    if (has_more && (ret || !command->flags.ordered)) {
-      bson_reinit (&cmd);
+      bson_reinit (cmd);
       GOTO (again);
    }
 
-   bson_destroy (&cmd);
+   _mongoc_scratch_bson_release (&client->scratch, cmd);
    EXIT;
 }
 
@@ -1335,6 +1361,8 @@ _mongoc_write_command_execute (mongoc_write_command_t       *command,       /* I
                                uint32_t                      offset,        /* IN */
                                mongoc_write_result_t        *result)        /* OUT */
 {
+   char ns[MONGOC_NAMESPACE_MAX];
+
    ENTRY;
 
    BSON_ASSERT (command);
@@ -1373,6 +1401,12 @@ _mongoc_write_command_execute (mongoc_write_command_t       *command,       /* I
                                       result, &result->error);
    }
 
+   if (client->query_cache && client->query_cache->enabled) {
+      /* cached results for the collection may be stale now */
+      bson_snprintf (ns, sizeof ns, "%s.%s", database, collection);
+      _mongoc_query_cache_invalidate (client->query_cache, ns);
+   }
+
    EXIT;
 }
 
@@ -1803,6 +1837,154 @@ _mongoc_write_result_merge (mongoc_write_result_t  *result,  /* IN */
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_write_result_merge_result --
+ *
+ *       Fold @src, the result of one write command executed separately,
+ *       into @result. Indexes in @src must already include the command's
+ *       offset into the bulk operation.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_write_result_merge_result (mongoc_write_result_t       *result, /* IN */
+                                   const mongoc_write_result_t *src)    /* IN */
+{
+   bson_iter_t iter;
+   bson_t ar;
+
+   ENTRY;
+
+   BSON_ASSERT (result);
+   BSON_ASSERT (src);
+
+   result->omit_nModified |= src->omit_nModified;
+   result->nInserted += src->nInserted;
+   result->nMatched += src->nMatched;
+   result->nModified += src->nModified;
+   result->nRemoved += src->nRemoved;
+   result->nUpserted += src->nUpserted;
+
+   /* merge_arrays expects an iterator on an array field */
+   bson_init (&ar);
+
+   BSON_APPEND_ARRAY (&ar, "writeErrors", &src->writeErrors);
+   BSON_APPEND_ARRAY (&ar, "upserted", &src->upserted);
+   BSON_APPEND_ARRAY (&ar, "writeConcernErrors", &src->writeConcernErrors);
+
+   if (bson_iter_init_find (&iter, &ar, "writeErrors")) {
+      _mongoc_write_result_merge_arrays (0, result, &result->writeErrors,
+                                         &iter);
+   }
+
+   if (bson_iter_init_find (&iter, &ar, "upserted")) {
+      result->upsert_append_count += _mongoc_write_result_merge_arrays (
+         0, result, &result->upserted, &iter);
+   }
+
+   if (bson_iter_init_find (&iter, &ar, "writeConcernErrors")) {
+      result->n_writeConcernErrors += _mongoc_write_result_merge_arrays (
+         0, result, &result->writeConcernErrors, &iter);
+   }
+
+   bson_destroy (&ar);
+
+   if (src->failed) {
+      result->failed = true;
+   }
+
+   /* keep the first error, as a sequential run would stop there */
+   if (src->error.domain && !result->error.domain) {
+      memcpy (&result->error, &src->error, sizeof result->error);
+   }
+
+   EXIT;
+}
+
+
+static void
+_mongoc_write_result_remap_array (bson_t         *array,   /* INOUT */
+                                  const uint32_t *indexes, /* IN */
+                                  uint32_t        n_indexes)
+{
+   bson_iter_t iter;
+   bson_iter_t citer;
+   bson_t remapped;
+   bson_t child;
+   bson_t doc;
+   const uint8_t *data;
+   uint32_t len;
+   int32_t idx;
+
+   bson_init (&remapped);
+
+   if (bson_iter_init (&iter, array)) {
+      while (bson_iter_next (&iter)) {
+         if (!BSON_ITER_HOLDS_DOCUMENT (&iter)) {
+            continue;
+         }
+
+         bson_iter_document (&iter, &len, &data);
+         bson_init_static (&doc, data, len);
+         bson_append_document_begin (&remapped, bson_iter_key (&iter), -1,
+                                     &child);
+
+         if (bson_iter_init (&citer, &doc)) {
+            while (bson_iter_next (&citer)) {
+               if (!strcmp (bson_iter_key (&citer), "index") &&
+                   BSON_ITER_HOLDS_INT32 (&citer) &&
+                   (idx = bson_iter_int32 (&citer)) >= 0 &&
+                   (uint32_t) idx < n_indexes) {
+                  BSON_APPEND_INT32 (&child, "index",
+                                     (int32_t) indexes[idx]);
+               } else {
+                  BSON_APPEND_VALUE (&child, bson_iter_key (&citer),
+                                     bson_iter_value (&citer));
+               }
+            }
+         }
+
+         bson_append_document_end (&remapped, &child);
+      }
+   }
+
+   bson_destroy (array);
+   bson_steal (array, &remapped);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_write_result_remap_indexes --
+ *
+ *       Rewrite the "index" of each write error and upsert in @result,
+ *       replacing index i with @indexes[i]. Used when a bulk operation's
+ *       writes were reordered before execution.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_write_result_remap_indexes (mongoc_write_result_t *result,    /* IN */
+                                    const uint32_t        *indexes,   /* IN */
+                                    uint32_t               n_indexes) /* IN */
+{
+   ENTRY;
+
+   BSON_ASSERT (result);
+
+   _mongoc_write_result_remap_array (&result->writeErrors, indexes,
+                                     n_indexes);
+   _mongoc_write_result_remap_array (&result->upserted, indexes, n_indexes);
+
+   EXIT;
+}
+
+
 /*
  * If error is not set, set code from first document in array like
  * [{"code": 64, "errmsg": "duplicate"}, ...]. Format the error message
@@ -32,6 +32,7 @@
 #include "mongoc-database.h"
 #include "mongoc-index.h"
 #include "mongoc-error.h"
+#include "mongoc-field-map.h"
 #include "mongoc-flags.h"
 #include "mongoc-gridfs.h"
 #include "mongoc-gridfs-file.h"
@@ -40,6 +41,7 @@
 #include "mongoc-host-list.h"
 #include "mongoc-init.h"
 #include "mongoc-matcher.h"
+#include "mongoc-memory.h"
 #ifdef MONGOC_EXPERIMENTAL_FEATURES
 #include "mongoc-metadata.h"
 #endif
@@ -51,6 +53,7 @@
 #include "mongoc-stream-file.h"
 #include "mongoc-stream-gridfs.h"
 #include "mongoc-stream-socket.h"
+#include "mongoc-stream-uring.h"
 #include "mongoc-trace.h"
 #include "mongoc-uri.h"
 #include "mongoc-write-concern.h"
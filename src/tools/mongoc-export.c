@@ -0,0 +1,385 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * mongoc-export writes a collection to a file as a sequence of BSON
+ * documents, the format of mongodump's .bson files.
+ *
+ * The collection is read by up to THREADS cursors at once: the server is
+ * asked for a parallelCollectionScan, and each cursor it returns is
+ * iterated by its own thread on its own pooled connection. Threads pass
+ * batches of raw documents to the main thread, which writes them to the
+ * file while the next batches are fetched.
+ */
+
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mongoc-tools-common.h"
+
+
+typedef struct
+{
+   mongoc_client_pool_t *pool;
+   const char           *database;
+   const char           *collection;
+   uint32_t              batch_size;
+   uint32_t              server_id;
+   mongoc_tools_queue_t  queue;
+   mongoc_tools_stats_t  stats;
+   pthread_mutex_t       mutex;
+   bson_error_t          error;
+   bool                  failed;
+} export_t;
+
+
+typedef struct
+{
+   export_t  *export;
+   bson_t     reply;       /* parallelCollectionScan cursor, or empty */
+   pthread_t  thread;
+} export_worker_t;
+
+
+static void
+export_fail (export_t           *export,
+             const bson_error_t *error)
+{
+   pthread_mutex_lock (&export->mutex);
+
+   if (!export->failed) {
+      export->failed = true;
+      memcpy (&export->error, error, sizeof export->error);
+   }
+
+   pthread_mutex_unlock (&export->mutex);
+}
+
+
+static void *
+export_worker (void *data)
+{
+   export_worker_t *worker = (export_worker_t *)data;
+   export_t *export = worker->export;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection = NULL;
+   mongoc_cursor_t *cursor;
+   mongoc_tools_batch_t *batch = NULL;
+   const bson_t *doc;
+   bson_error_t error;
+   bson_t query = BSON_INITIALIZER;
+
+   client = mongoc_client_pool_pop (export->pool);
+
+   if (bson_empty (&worker->reply)) {
+      collection = mongoc_client_get_collection (client, export->database,
+                                                 export->collection);
+      cursor = mongoc_collection_find (collection, MONGOC_QUERY_NONE, 0, 0,
+                                       export->batch_size, &query, NULL,
+                                       NULL);
+   } else {
+      /* takes ownership of the reply */
+      cursor = mongoc_cursor_new_from_command_reply (client, &worker->reply,
+                                                     export->server_id);
+      bson_init (&worker->reply);
+      mongoc_cursor_set_batch_size (cursor, export->batch_size);
+   }
+
+   /* ask for the next batch while this one is being passed along */
+   mongoc_cursor_set_prefetch (cursor, true);
+
+   while (mongoc_cursor_next (cursor, &doc)) {
+      if (!batch) {
+         batch = mongoc_tools_batch_new ((size_t)doc->len * export->batch_size);
+      }
+
+      mongoc_tools_batch_append (batch, bson_get_data (doc), doc->len);
+
+      if (batch->n_docs >= export->batch_size) {
+         mongoc_tools_queue_push (&export->queue, batch);
+         batch = NULL;
+      }
+   }
+
+   if (batch) {
+      mongoc_tools_queue_push (&export->queue, batch);
+   }
+
+   if (mongoc_cursor_error (cursor, &error)) {
+      export_fail (export, &error);
+   }
+
+   mongoc_cursor_destroy (cursor);
+
+   if (collection) {
+      mongoc_collection_destroy (collection);
+   }
+
+   mongoc_client_pool_push (export->pool, client);
+   bson_destroy (&query);
+   mongoc_tools_queue_producer_done (&export->queue);
+
+   return NULL;
+}
+
+
+/*
+ * Ask for up to n_workers cursors that together return the collection.
+ * Fills in one reply per cursor and returns how many there are, or 0 if
+ * the server can't scan in parallel (mongos, older servers, or a single
+ * thread was requested), in which case one thread runs a plain query.
+ */
+static uint32_t
+export_parallel_scan (export_t        *export,
+                      mongoc_client_t *client,
+                      export_worker_t *workers,
+                      uint32_t         n_workers)
+{
+   mongoc_server_description_t *sd;
+   bson_error_t error;
+   bson_iter_t iter;
+   bson_iter_t child;
+   bson_iter_t cursor;
+   bson_t cmd = BSON_INITIALIZER;
+   bson_t reply;
+   bson_t doc;
+   const uint8_t *data;
+   uint32_t len;
+   uint32_t n = 0;
+
+   if (n_workers < 2) {
+      return 0;
+   }
+
+   sd = mongoc_client_select_server (client, false, NULL, &error);
+
+   if (!sd) {
+      return 0;
+   }
+
+   export->server_id = mongoc_server_description_id (sd);
+   mongoc_server_description_destroy (sd);
+
+   BSON_APPEND_UTF8 (&cmd, "parallelCollectionScan", export->collection);
+   BSON_APPEND_INT32 (&cmd, "numCursors", (int32_t)n_workers);
+
+   if (mongoc_client_command_simple_with_server_id (client, export->database,
+                                                    &cmd, NULL,
+                                                    export->server_id,
+                                                    &reply, &error) &&
+       bson_iter_init_find (&iter, &reply, "cursors") &&
+       BSON_ITER_HOLDS_ARRAY (&iter) &&
+       bson_iter_recurse (&iter, &child)) {
+      while (n < n_workers && bson_iter_next (&child)) {
+         if (!BSON_ITER_HOLDS_DOCUMENT (&child) ||
+             !bson_iter_recurse (&child, &cursor) ||
+             !bson_iter_find (&cursor, "cursor") ||
+             !BSON_ITER_HOLDS_DOCUMENT (&cursor)) {
+            continue;
+         }
+
+         bson_iter_document (&cursor, &len, &data);
+         bson_init_static (&doc, data, len);
+         bson_init (&workers[n].reply);
+         BSON_APPEND_DOCUMENT (&workers[n].reply, "cursor", &doc);
+         n++;
+      }
+   }
+
+   bson_destroy (&reply);
+   bson_destroy (&cmd);
+
+   return n;
+}
+
+
+static bool
+export_write (mongoc_stream_t      *stream,
+              mongoc_tools_batch_t *batch)
+{
+   size_t written = 0;
+   ssize_t r;
+
+   while (written < batch->len) {
+      r = mongoc_stream_write (stream, batch->data + written,
+                               batch->len - written, -1);
+
+      if (r <= 0) {
+         return false;
+      }
+
+      written += (size_t)r;
+   }
+
+   return true;
+}
+
+
+static void
+usage (FILE *stream)
+{
+   fprintf (stream,
+"Usage: mongoc-export [OPTIONS] URI DATABASE COLLECTION FILE\n"
+"\n"
+"Write COLLECTION to FILE as a sequence of BSON documents.\n"
+"\n"
+"Options:\n"
+"\n"
+"  -j THREADS     Number of cursors read in parallel [%d].\n"
+"  -b BATCH_SIZE  Documents per batch [%d].\n"
+"  -q             Do not report progress.\n"
+"\n",
+            MONGOC_TOOLS_DEFAULT_THREADS, MONGOC_TOOLS_DEFAULT_BATCH_SIZE);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+   export_t export = { 0 };
+   export_worker_t *workers;
+   mongoc_client_t *client;
+   mongoc_stream_t *stream;
+   mongoc_uri_t *uri;
+   mongoc_tools_batch_t *batch;
+   uint32_t n_threads = MONGOC_TOOLS_DEFAULT_THREADS;
+   uint32_t n_workers;
+   uint32_t i;
+   bool quiet = false;
+   bool write_failed = false;
+   int ret = EXIT_SUCCESS;
+   int opt;
+
+   export.batch_size = MONGOC_TOOLS_DEFAULT_BATCH_SIZE;
+
+   while ((opt = getopt (argc, argv, "j:b:q")) != -1) {
+      switch (opt) {
+      case 'j':
+         n_threads = (uint32_t)strtoul (optarg, NULL, 10);
+         break;
+      case 'b':
+         export.batch_size = (uint32_t)strtoul (optarg, NULL, 10);
+         break;
+      case 'q':
+         quiet = true;
+         break;
+      default:
+         usage (stderr);
+         return EXIT_FAILURE;
+      }
+   }
+
+   if (argc - optind != 4 || !n_threads || !export.batch_size) {
+      usage (stderr);
+      return EXIT_FAILURE;
+   }
+
+   mongoc_init ();
+
+   if (!(uri = mongoc_uri_new (argv[optind]))) {
+      fprintf (stderr, "Invalid URI: \"%s\"\n", argv[optind]);
+      ret = EXIT_FAILURE;
+      goto done;
+   }
+
+   export.pool = mongoc_client_pool_new (uri);
+   mongoc_uri_destroy (uri);
+
+   export.database = argv[optind + 1];
+   export.collection = argv[optind + 2];
+
+   stream = mongoc_stream_file_new_for_path (argv[optind + 3],
+                                             O_WRONLY | O_CREAT | O_TRUNC,
+                                             0644);
+
+   if (!stream) {
+      perror ("Failed to open output file");
+      ret = EXIT_FAILURE;
+      goto done;
+   }
+
+   mongoc_client_pool_max_size (export.pool, n_threads + 1);
+   pthread_mutex_init (&export.mutex, NULL);
+   mongoc_tools_stats_init (&export.stats, quiet);
+
+   workers = (export_worker_t *)bson_malloc0 (n_threads * sizeof *workers);
+   client = mongoc_client_pool_pop (export.pool);
+   n_workers = export_parallel_scan (&export, client, workers, n_threads);
+   mongoc_client_pool_push (export.pool, client);
+
+   if (!n_workers) {
+      n_workers = 1;
+      bson_init (&workers[0].reply);
+   }
+
+   /* keep a couple of batches per thread in flight */
+   mongoc_tools_queue_init (&export.queue, 2 * n_workers, (int)n_workers);
+
+   for (i = 0; i < n_workers; i++) {
+      workers[i].export = &export;
+      pthread_create (&workers[i].thread, NULL, export_worker, &workers[i]);
+   }
+
+   while ((batch = mongoc_tools_queue_pop (&export.queue))) {
+      if (!write_failed && !export_write (stream, batch)) {
+         perror ("Failed to write output file");
+         write_failed = true;
+      }
+
+      if (!write_failed) {
+         mongoc_tools_stats_add (&export.stats, "exported", batch->n_docs,
+                                 batch->len);
+      }
+
+      /* keep draining so that workers finish */
+      mongoc_tools_batch_destroy (batch);
+   }
+
+   for (i = 0; i < n_workers; i++) {
+      pthread_join (workers[i].thread, NULL);
+      bson_destroy (&workers[i].reply);
+   }
+
+   if (export.failed) {
+      fprintf (stderr, "Export failed: %s\n", export.error.message);
+      ret = EXIT_FAILURE;
+   } else if (write_failed || mongoc_stream_flush (stream) != 0) {
+      ret = EXIT_FAILURE;
+   } else {
+      mongoc_tools_stats_report (&export.stats, "exported");
+   }
+
+   mongoc_stream_destroy (stream);
+   mongoc_tools_queue_destroy (&export.queue);
+   mongoc_tools_stats_destroy (&export.stats);
+   pthread_mutex_destroy (&export.mutex);
+   bson_free (workers);
+
+done:
+   if (export.pool) {
+      mongoc_client_pool_destroy (export.pool);
+   }
+
+   mongoc_cleanup ();
+
+   return ret;
+}
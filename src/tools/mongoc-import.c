@@ -0,0 +1,372 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * mongoc-import inserts the documents of a BSON-sequence file, such as
+ * one written by mongoc-export or mongodump, into a collection.
+ *
+ * The main thread reads the file in large blocks and cuts it into batches
+ * of documents; THREADS threads each take batches from a queue and insert
+ * them with an unordered bulk operation on their own pooled connection.
+ */
+
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mongoc-tools-common.h"
+
+
+#define IMPORT_READ_SIZE (4 * 1024 * 1024)
+
+
+typedef struct
+{
+   mongoc_client_pool_t *pool;
+   const char           *database;
+   const char           *collection;
+   mongoc_tools_queue_t  queue;
+   mongoc_tools_stats_t  stats;
+   pthread_mutex_t       mutex;
+   bson_error_t          error;
+   bool                  failed;
+} import_t;
+
+
+static void
+import_fail (import_t           *import,
+             const bson_error_t *error)
+{
+   pthread_mutex_lock (&import->mutex);
+
+   if (!import->failed) {
+      import->failed = true;
+      memcpy (&import->error, error, sizeof import->error);
+   }
+
+   pthread_mutex_unlock (&import->mutex);
+}
+
+
+static void *
+import_worker (void *data)
+{
+   import_t *import = (import_t *)data;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   mongoc_tools_batch_t *batch;
+   bson_error_t error;
+   bson_t reply;
+   bson_t doc;
+   uint32_t len;
+   size_t pos;
+
+   client = mongoc_client_pool_pop (import->pool);
+   collection = mongoc_client_get_collection (client, import->database,
+                                              import->collection);
+
+   while ((batch = mongoc_tools_queue_pop (&import->queue))) {
+      bulk = mongoc_collection_create_bulk_operation (collection, false, NULL);
+
+      for (pos = 0; pos < batch->len; pos += len) {
+         memcpy (&len, batch->data + pos, sizeof len);
+         len = BSON_UINT32_FROM_LE (len);
+         bson_init_static (&doc, batch->data + pos, len);
+         mongoc_bulk_operation_insert (bulk, &doc);
+      }
+
+      if (mongoc_bulk_operation_execute (bulk, &reply, &error)) {
+         mongoc_tools_stats_add (&import->stats, "imported", batch->n_docs,
+                                 batch->len);
+      } else {
+         import_fail (import, &error);
+      }
+
+      bson_destroy (&reply);
+      mongoc_bulk_operation_destroy (bulk);
+      mongoc_tools_batch_destroy (batch);
+   }
+
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (import->pool, client);
+
+   return NULL;
+}
+
+
+/* drop the collection before importing; it's fine if it doesn't exist */
+static bool
+import_drop (import_t     *import,
+             bson_error_t *error)
+{
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   bool ret;
+
+   client = mongoc_client_pool_pop (import->pool);
+   collection = mongoc_client_get_collection (client, import->database,
+                                              import->collection);
+
+   ret = mongoc_collection_drop (collection, error) ||
+         strstr (error->message, "ns not found");
+
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (import->pool, client);
+
+   return ret;
+}
+
+
+/*
+ * Read @stream in large blocks and queue batches of @batch_size whole
+ * documents. Returns false if the file can't be read or isn't a sequence
+ * of BSON documents.
+ */
+static bool
+import_read (import_t        *import,
+             mongoc_stream_t *stream,
+             uint32_t         batch_size)
+{
+   mongoc_tools_batch_t *batch = NULL;
+   uint8_t *buf;
+   size_t buf_alloc = IMPORT_READ_SIZE;
+   size_t buf_len = 0;
+   size_t pos;
+   ssize_t r;
+   uint32_t len;
+   bool ret = true;
+
+   buf = (uint8_t *)bson_malloc (buf_alloc);
+
+   for (;;) {
+      r = mongoc_stream_read (stream, buf + buf_len, buf_alloc - buf_len, 0,
+                              -1);
+
+      if (r < 0) {
+         perror ("Failed to read input file");
+         ret = false;
+         break;
+      }
+
+      buf_len += (size_t)r;
+      pos = 0;
+
+      while (buf_len - pos >= 4) {
+         memcpy (&len, buf + pos, sizeof len);
+         len = BSON_UINT32_FROM_LE (len);
+
+         if (len < 5) {
+            fprintf (stderr, "Corrupt BSON document in input file.\n");
+            ret = false;
+            goto done;
+         }
+
+         if (buf_len - pos < len) {
+            break;
+         }
+
+         if (!batch) {
+            batch = mongoc_tools_batch_new ((size_t)len * batch_size);
+         }
+
+         mongoc_tools_batch_append (batch, buf + pos, len);
+         pos += len;
+
+         if (batch->n_docs >= batch_size) {
+            mongoc_tools_queue_push (&import->queue, batch);
+            batch = NULL;
+         }
+      }
+
+      /* keep the partial document at the front of the buffer */
+      memmove (buf, buf + pos, buf_len - pos);
+      buf_len -= pos;
+
+      if (r == 0) {
+         if (buf_len) {
+            fprintf (stderr, "Truncated BSON document in input file.\n");
+            ret = false;
+         }
+
+         break;
+      }
+
+      if (buf_len >= 4) {
+         memcpy (&len, buf, sizeof len);
+         len = BSON_UINT32_FROM_LE (len);
+
+         while (buf_alloc < len) {
+            buf_alloc *= 2;
+            buf = (uint8_t *)bson_realloc (buf, buf_alloc);
+         }
+      }
+   }
+
+done:
+   if (batch) {
+      if (ret) {
+         mongoc_tools_queue_push (&import->queue, batch);
+      } else {
+         mongoc_tools_batch_destroy (batch);
+      }
+   }
+
+   bson_free (buf);
+
+   return ret;
+}
+
+
+static void
+usage (FILE *stream)
+{
+   fprintf (stream,
+"Usage: mongoc-import [OPTIONS] URI DATABASE COLLECTION FILE\n"
+"\n"
+"Insert the sequence of BSON documents in FILE into COLLECTION.\n"
+"\n"
+"Options:\n"
+"\n"
+"  -j THREADS     Number of concurrent bulk inserts [%d].\n"
+"  -b BATCH_SIZE  Documents per bulk insert [%d].\n"
+"  -d             Drop COLLECTION before importing.\n"
+"  -q             Do not report progress.\n"
+"\n",
+            MONGOC_TOOLS_DEFAULT_THREADS, MONGOC_TOOLS_DEFAULT_BATCH_SIZE);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+   import_t import = { 0 };
+   mongoc_stream_t *stream;
+   mongoc_uri_t *uri;
+   pthread_t *threads;
+   uint32_t n_threads = MONGOC_TOOLS_DEFAULT_THREADS;
+   uint32_t batch_size = MONGOC_TOOLS_DEFAULT_BATCH_SIZE;
+   uint32_t i;
+   bool quiet = false;
+   bool drop = false;
+   bool read_ok;
+   bson_error_t error;
+   int ret = EXIT_SUCCESS;
+   int opt;
+
+   while ((opt = getopt (argc, argv, "j:b:dq")) != -1) {
+      switch (opt) {
+      case 'j':
+         n_threads = (uint32_t)strtoul (optarg, NULL, 10);
+         break;
+      case 'b':
+         batch_size = (uint32_t)strtoul (optarg, NULL, 10);
+         break;
+      case 'd':
+         drop = true;
+         break;
+      case 'q':
+         quiet = true;
+         break;
+      default:
+         usage (stderr);
+         return EXIT_FAILURE;
+      }
+   }
+
+   if (argc - optind != 4 || !n_threads || !batch_size) {
+      usage (stderr);
+      return EXIT_FAILURE;
+   }
+
+   mongoc_init ();
+
+   if (!(uri = mongoc_uri_new (argv[optind]))) {
+      fprintf (stderr, "Invalid URI: \"%s\"\n", argv[optind]);
+      ret = EXIT_FAILURE;
+      goto done;
+   }
+
+   stream = mongoc_stream_file_new_for_path (argv[optind + 3], O_RDONLY, 0);
+
+   if (!stream) {
+      perror ("Failed to open input file");
+      ret = EXIT_FAILURE;
+      goto done;
+   }
+
+   import.pool = mongoc_client_pool_new (uri);
+   import.database = argv[optind + 1];
+   import.collection = argv[optind + 2];
+   mongoc_client_pool_max_size (import.pool, n_threads);
+
+   if (drop && !import_drop (&import, &error)) {
+      fprintf (stderr, "Failed to drop collection: %s\n", error.message);
+      mongoc_stream_destroy (stream);
+      mongoc_client_pool_destroy (import.pool);
+      ret = EXIT_FAILURE;
+      goto done;
+   }
+
+   pthread_mutex_init (&import.mutex, NULL);
+   mongoc_tools_stats_init (&import.stats, quiet);
+
+   /* the reader is the only producer; it stays a couple of batches ahead */
+   mongoc_tools_queue_init (&import.queue, 2 * n_threads, 1);
+
+   threads = (pthread_t *)bson_malloc (n_threads * sizeof *threads);
+
+   for (i = 0; i < n_threads; i++) {
+      pthread_create (&threads[i], NULL, import_worker, &import);
+   }
+
+   read_ok = import_read (&import, stream, batch_size);
+   mongoc_tools_queue_producer_done (&import.queue);
+
+   for (i = 0; i < n_threads; i++) {
+      pthread_join (threads[i], NULL);
+   }
+
+   if (import.failed) {
+      fprintf (stderr, "Import failed: %s\n", import.error.message);
+      ret = EXIT_FAILURE;
+   } else if (!read_ok) {
+      ret = EXIT_FAILURE;
+   } else {
+      mongoc_tools_stats_report (&import.stats, "imported");
+   }
+
+   mongoc_stream_destroy (stream);
+   mongoc_tools_queue_destroy (&import.queue);
+   mongoc_tools_stats_destroy (&import.stats);
+   pthread_mutex_destroy (&import.mutex);
+   bson_free (threads);
+   mongoc_client_pool_destroy (import.pool);
+
+done:
+   if (uri) {
+      mongoc_uri_destroy (uri);
+   }
+
+   mongoc_cleanup ();
+
+   return ret;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mongoc-tools-common.h"
+
+
+mongoc_tools_batch_t *
+mongoc_tools_batch_new (size_t alloc)
+{
+   mongoc_tools_batch_t *batch;
+
+   /* a size hint; the batch grows as needed */
+   alloc = BSON_MAX (alloc, 4096);
+   alloc = BSON_MIN (alloc, 16 * 1024 * 1024);
+
+   batch = (mongoc_tools_batch_t *)bson_malloc0 (sizeof *batch);
+   batch->alloc = alloc;
+   batch->data = (uint8_t *)bson_malloc (batch->alloc);
+
+   return batch;
+}
+
+
+void
+mongoc_tools_batch_append (mongoc_tools_batch_t *batch,
+                           const uint8_t        *data,
+                           uint32_t              len)
+{
+   if (batch->len + len > batch->alloc) {
+      while (batch->len + len > batch->alloc) {
+         batch->alloc *= 2;
+      }
+
+      batch->data = (uint8_t *)bson_realloc (batch->data, batch->alloc);
+   }
+
+   memcpy (batch->data + batch->len, data, len);
+   batch->len += len;
+   batch->n_docs++;
+}
+
+
+void
+mongoc_tools_batch_destroy (mongoc_tools_batch_t *batch)
+{
+   if (batch) {
+      bson_free (batch->data);
+      bson_free (batch);
+   }
+}
+
+
+void
+mongoc_tools_queue_init (mongoc_tools_queue_t *queue,
+                         size_t                capacity,
+                         int                   n_producers)
+{
+   BSON_ASSERT (capacity);
+
+   pthread_mutex_init (&queue->mutex, NULL);
+   pthread_cond_init (&queue->cond, NULL);
+   queue->items = (mongoc_tools_batch_t **)bson_malloc0 (
+      capacity * sizeof *queue->items);
+   queue->capacity = capacity;
+   queue->head = 0;
+   queue->len = 0;
+   queue->n_producers = n_producers;
+}
+
+
+/* blocks while the queue is full, so a slow consumer throttles producers */
+void
+mongoc_tools_queue_push (mongoc_tools_queue_t *queue,
+                         mongoc_tools_batch_t *batch)
+{
+   pthread_mutex_lock (&queue->mutex);
+
+   while (queue->len == queue->capacity) {
+      pthread_cond_wait (&queue->cond, &queue->mutex);
+   }
+
+   queue->items[(queue->head + queue->len) % queue->capacity] = batch;
+   queue->len++;
+   pthread_cond_broadcast (&queue->cond);
+   pthread_mutex_unlock (&queue->mutex);
+}
+
+
+mongoc_tools_batch_t *
+mongoc_tools_queue_pop (mongoc_tools_queue_t *queue)
+{
+   mongoc_tools_batch_t *batch = NULL;
+
+   pthread_mutex_lock (&queue->mutex);
+
+   while (!queue->len && queue->n_producers > 0) {
+      pthread_cond_wait (&queue->cond, &queue->mutex);
+   }
+
+   if (queue->len) {
+      batch = queue->items[queue->head];
+      queue->head = (queue->head + 1) % queue->capacity;
+      queue->len--;
+      pthread_cond_broadcast (&queue->cond);
+   }
+
+   pthread_mutex_unlock (&queue->mutex);
+
+   return batch;
+}
+
+
+void
+mongoc_tools_queue_producer_done (mongoc_tools_queue_t *queue)
+{
+   pthread_mutex_lock (&queue->mutex);
+   queue->n_producers--;
+   pthread_cond_broadcast (&queue->cond);
+   pthread_mutex_unlock (&queue->mutex);
+}
+
+
+void
+mongoc_tools_queue_destroy (mongoc_tools_queue_t *queue)
+{
+   mongoc_tools_batch_t *batch;
+
+   while (queue->len) {
+      batch = queue->items[queue->head];
+      queue->head = (queue->head + 1) % queue->capacity;
+      queue->len--;
+      mongoc_tools_batch_destroy (batch);
+   }
+
+   bson_free (queue->items);
+   pthread_cond_destroy (&queue->cond);
+   pthread_mutex_destroy (&queue->mutex);
+}
+
+
+void
+mongoc_tools_stats_init (mongoc_tools_stats_t *stats,
+                         bool                  quiet)
+{
+   pthread_mutex_init (&stats->mutex, NULL);
+   stats->started = bson_get_monotonic_time ();
+   stats->last_report = stats->started;
+   stats->n_docs = 0;
+   stats->n_bytes = 0;
+   stats->quiet = quiet;
+}
+
+
+static void
+mongoc_tools_stats_print (mongoc_tools_stats_t *stats,
+                          const char           *verb,
+                          int64_t               now)
+{
+   double secs;
+
+   secs = (double)(now - stats->started) / 1000000.0;
+
+   if (secs <= 0) {
+      secs = 1e-6;
+   }
+
+   fprintf (stderr,
+            "%s %" PRId64 " documents, %.1f MB in %.2f s "
+            "(%.0f docs/s, %.1f MB/s)\n",
+            verb,
+            stats->n_docs,
+            (double)stats->n_bytes / (1024.0 * 1024.0),
+            secs,
+            (double)stats->n_docs / secs,
+            (double)stats->n_bytes / (1024.0 * 1024.0) / secs);
+}
+
+
+/* thread-safe; prints progress at most once a second unless quiet */
+void
+mongoc_tools_stats_add (mongoc_tools_stats_t *stats,
+                        const char           *verb,
+                        uint32_t              n_docs,
+                        size_t                n_bytes)
+{
+   int64_t now;
+
+   pthread_mutex_lock (&stats->mutex);
+
+   stats->n_docs += n_docs;
+   stats->n_bytes += (int64_t)n_bytes;
+
+   if (!stats->quiet) {
+      now = bson_get_monotonic_time ();
+
+      if (now - stats->last_report >= 1000000) {
+         stats->last_report = now;
+         mongoc_tools_stats_print (stats, verb, now);
+      }
+   }
+
+   pthread_mutex_unlock (&stats->mutex);
+}
+
+
+void
+mongoc_tools_stats_report (mongoc_tools_stats_t *stats,
+                           const char           *verb)
+{
+   pthread_mutex_lock (&stats->mutex);
+   mongoc_tools_stats_print (stats, verb, bson_get_monotonic_time ());
+   pthread_mutex_unlock (&stats->mutex);
+}
+
+
+void
+mongoc_tools_stats_destroy (mongoc_tools_stats_t *stats)
+{
+   pthread_mutex_destroy (&stats->mutex);
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2016 MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_TOOLS_COMMON_H
+#define MONGOC_TOOLS_COMMON_H
+
+#include <bson.h>
+#include <mongoc.h>
+#include <pthread.h>
+
+
+#define MONGOC_TOOLS_DEFAULT_THREADS    4
+#define MONGOC_TOOLS_DEFAULT_BATCH_SIZE 1000
+
+
+/*
+ * A batch of BSON documents stored back to back, exactly as they appear
+ * in a BSON-sequence file.
+ */
+typedef struct
+{
+   uint8_t  *data;
+   size_t    len;
+   size_t    alloc;
+   uint32_t  n_docs;
+} mongoc_tools_batch_t;
+
+
+/*
+ * A bounded FIFO of batches between producer and consumer threads. Pop
+ * returns NULL once every producer has called producer_done and the
+ * queue is drained.
+ */
+typedef struct
+{
+   pthread_mutex_t        mutex;
+   pthread_cond_t         cond;
+   mongoc_tools_batch_t **items;
+   size_t                 capacity;
+   size_t                 head;
+   size_t                 len;
+   int                    n_producers;
+} mongoc_tools_queue_t;
+
+
+typedef struct
+{
+   pthread_mutex_t mutex;
+   int64_t         started;
+   int64_t         last_report;
+   int64_t         n_docs;
+   int64_t         n_bytes;
+   bool            quiet;
+} mongoc_tools_stats_t;
+
+
+mongoc_tools_batch_t *mongoc_tools_batch_new            (size_t                alloc);
+void                  mongoc_tools_batch_append         (mongoc_tools_batch_t *batch,
+                                                         const uint8_t        *data,
+                                                         uint32_t              len);
+void                  mongoc_tools_batch_destroy        (mongoc_tools_batch_t *batch);
+void                  mongoc_tools_queue_init           (mongoc_tools_queue_t *queue,
+                                                         size_t                capacity,
+                                                         int                   n_producers);
+void                  mongoc_tools_queue_push           (mongoc_tools_queue_t *queue,
+                                                         mongoc_tools_batch_t *batch);
+mongoc_tools_batch_t *mongoc_tools_queue_pop            (mongoc_tools_queue_t *queue);
+void                  mongoc_tools_queue_producer_done  (mongoc_tools_queue_t *queue);
+void                  mongoc_tools_queue_destroy        (mongoc_tools_queue_t *queue);
+void                  mongoc_tools_stats_init           (mongoc_tools_stats_t *stats,
+                                                         bool                  quiet);
+void                  mongoc_tools_stats_add            (mongoc_tools_stats_t *stats,
+                                                         const char           *verb,
+                                                         uint32_t              n_docs,
+                                                         size_t                n_bytes);
+void                  mongoc_tools_stats_report         (mongoc_tools_stats_t *stats,
+                                                         const char           *verb);
+void                  mongoc_tools_stats_destroy        (mongoc_tools_stats_t *stats);
+
+
+#endif /* MONGOC_TOOLS_COMMON_H */
@@ -317,6 +317,27 @@ background_mongoc_cursor_next (void *data)
    return NULL;
 }
 
+static void *
+background_mongoc_cursor_next_batch (void *data)
+{
+   future_t *future = (future_t *) data;
+   future_value_t return_value;
+
+   return_value.type = future_value_bool_type;
+
+   future_value_set_bool (
+      &return_value,
+      mongoc_cursor_next_batch (
+         future_value_get_mongoc_cursor_ptr (future_get_param (future, 0)),
+         future_value_get_const_mongoc_doc_view_ptr_ptr (future_get_param (future, 1)),
+         future_value_get_size_t_ptr (future_get_param (future, 2))
+      ));
+
+   future_resolve (future, return_value);
+
+   return NULL;
+}
+
 static void *
 background_mongoc_client_get_database_names (void *data)
 {
@@ -360,6 +381,26 @@ background_mongoc_database_command_simple (void *data)
    return NULL;
 }
 
+static void *
+background_mongoc_database_drop (void *data)
+{
+   future_t *future = (future_t *) data;
+   future_value_t return_value;
+
+   return_value.type = future_value_bool_type;
+
+   future_value_set_bool (
+      &return_value,
+      mongoc_database_drop (
+         future_value_get_mongoc_database_ptr (future_get_param (future, 0)),
+         future_value_get_bson_error_ptr (future_get_param (future, 1))
+      ));
+
+   future_resolve (future, return_value);
+
+   return NULL;
+}
+
 static void *
 background_mongoc_database_get_collection_names (void *data)
 {
@@ -919,6 +960,28 @@ future_cursor_next (
    return future;
 }
 
+future_t *
+future_cursor_next_batch (
+   mongoc_cursor_ptr cursor,
+   const_mongoc_doc_view_ptr_ptr docs,
+   size_t_ptr n_docs)
+{
+   future_t *future = future_new (future_value_bool_type,
+                                  3);
+   
+   future_value_set_mongoc_cursor_ptr (
+      future_get_param (future, 0), cursor);
+   
+   future_value_set_const_mongoc_doc_view_ptr_ptr (
+      future_get_param (future, 1), docs);
+   
+   future_value_set_size_t_ptr (
+      future_get_param (future, 2), n_docs);
+   
+   future_start (future, background_mongoc_cursor_next_batch);
+   return future;
+}
+
 future_t *
 future_client_get_database_names (
    mongoc_client_ptr client,
@@ -967,6 +1030,24 @@ future_database_command_simple (
    return future;
 }
 
+future_t *
+future_database_drop (
+   mongoc_database_ptr database,
+   bson_error_ptr error)
+{
+   future_t *future = future_new (future_value_bool_type,
+                                  2);
+   
+   future_value_set_mongoc_database_ptr (
+      future_get_param (future, 0), database);
+   
+   future_value_set_bson_error_ptr (
+      future_get_param (future, 1), error);
+   
+   future_start (future, background_mongoc_database_drop);
+   return future;
+}
+
 future_t *
 future_database_get_collection_names (
    mongoc_database_ptr database,
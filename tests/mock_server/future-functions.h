@@ -156,6 +156,15 @@ future_cursor_next (
 );
 
 
+future_t *
+future_cursor_next_batch (
+
+   mongoc_cursor_ptr cursor,
+   const_mongoc_doc_view_ptr_ptr docs,
+   size_t_ptr n_docs
+);
+
+
 future_t *
 future_client_get_database_names (
 
@@ -175,6 +184,14 @@ future_database_command_simple (
 );
 
 
+future_t *
+future_database_drop (
+
+   mongoc_database_ptr database,
+   bson_error_ptr error
+);
+
+
 future_t *
 future_database_get_collection_names (
 
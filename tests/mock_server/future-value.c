@@ -111,6 +111,20 @@ future_value_get_size_t (future_value_t *future_value)
   return future_value->size_t_value;
 }
 
+void
+future_value_set_size_t_ptr(future_value_t *future_value, size_t_ptr value)
+{
+  future_value->type = future_value_size_t_ptr_type;
+  future_value->size_t_ptr_value = value;
+}
+
+size_t_ptr
+future_value_get_size_t_ptr (future_value_t *future_value)
+{
+  assert (future_value->type == future_value_size_t_ptr_type);
+  return future_value->size_t_ptr_value;
+}
+
 void
 future_value_set_ssize_t(future_value_t *future_value, ssize_t value)
 {
@@ -391,6 +405,20 @@ future_value_get_mongoc_topology_ptr (future_value_t *future_value)
   return future_value->mongoc_topology_ptr_value;
 }
 
+void
+future_value_set_const_mongoc_doc_view_ptr_ptr(future_value_t *future_value, const_mongoc_doc_view_ptr_ptr value)
+{
+  future_value->type = future_value_const_mongoc_doc_view_ptr_ptr_type;
+  future_value->const_mongoc_doc_view_ptr_ptr_value = value;
+}
+
+const_mongoc_doc_view_ptr_ptr
+future_value_get_const_mongoc_doc_view_ptr_ptr (future_value_t *future_value)
+{
+  assert (future_value->type == future_value_const_mongoc_doc_view_ptr_ptr_type);
+  return future_value->const_mongoc_doc_view_ptr_ptr_value;
+}
+
 void
 future_value_set_const_mongoc_find_and_modify_opts_ptr(future_value_t *future_value, const_mongoc_find_and_modify_opts_ptr value)
 {
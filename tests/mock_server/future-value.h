@@ -20,6 +20,7 @@
 
 typedef char * char_ptr;
 typedef char ** char_ptr_ptr;
+typedef size_t * size_t_ptr;
 typedef const char * const_char_ptr;
 typedef bson_error_t * bson_error_ptr;
 typedef bson_t * bson_ptr;
@@ -35,6 +36,7 @@ typedef mongoc_gridfs_t * mongoc_gridfs_ptr;
 typedef mongoc_iovec_t * mongoc_iovec_ptr;
 typedef mongoc_server_description_t * mongoc_server_description_ptr;
 typedef mongoc_topology_t * mongoc_topology_ptr;
+typedef const mongoc_doc_view_t ** const_mongoc_doc_view_ptr_ptr;
 typedef const mongoc_find_and_modify_opts_t * const_mongoc_find_and_modify_opts_ptr;
 typedef const mongoc_read_prefs_t * const_mongoc_read_prefs_ptr;
 typedef const mongoc_write_concern_t * const_mongoc_write_concern_ptr;
@@ -47,6 +49,7 @@ typedef enum {
    future_value_int_type,
    future_value_int64_t_type,
    future_value_size_t_type,
+   future_value_size_t_ptr_type,
    future_value_ssize_t_type,
    future_value_uint32_t_type,
    future_value_const_char_ptr_type,
@@ -67,6 +70,7 @@ typedef enum {
    future_value_mongoc_server_description_ptr_type,
    future_value_mongoc_ss_optype_t_type,
    future_value_mongoc_topology_ptr_type,
+   future_value_const_mongoc_doc_view_ptr_ptr_type,
    future_value_const_mongoc_find_and_modify_opts_ptr_type,
    future_value_const_mongoc_read_prefs_ptr_type,
    future_value_const_mongoc_write_concern_ptr_type,
@@ -84,6 +88,7 @@ typedef struct _future_value_t
       int int_value;
       int64_t int64_t_value;
       size_t size_t_value;
+      size_t_ptr size_t_ptr_value;
       ssize_t ssize_t_value;
       uint32_t uint32_t_value;
       const_char_ptr const_char_ptr_value;
@@ -104,6 +109,7 @@ typedef struct _future_value_t
       mongoc_server_description_ptr mongoc_server_description_ptr_value;
       mongoc_ss_optype_t mongoc_ss_optype_t_value;
       mongoc_topology_ptr mongoc_topology_ptr_value;
+      const_mongoc_doc_view_ptr_ptr const_mongoc_doc_view_ptr_ptr_value;
       const_mongoc_find_and_modify_opts_ptr const_mongoc_find_and_modify_opts_ptr_value;
       const_mongoc_read_prefs_ptr const_mongoc_read_prefs_ptr_value;
       const_mongoc_write_concern_ptr const_mongoc_write_concern_ptr_value;
@@ -177,6 +183,15 @@ size_t
 future_value_get_size_t (
    future_value_t *future_value);
 
+void
+future_value_set_size_t_ptr(
+   future_value_t *future_value,
+   size_t_ptr value);
+
+size_t_ptr
+future_value_get_size_t_ptr (
+   future_value_t *future_value);
+
 void
 future_value_set_ssize_t(
    future_value_t *future_value,
@@ -357,6 +372,15 @@ mongoc_topology_ptr
 future_value_get_mongoc_topology_ptr (
    future_value_t *future_value);
 
+void
+future_value_set_const_mongoc_doc_view_ptr_ptr(
+   future_value_t *future_value,
+   const_mongoc_doc_view_ptr_ptr value);
+
+const_mongoc_doc_view_ptr_ptr
+future_value_get_const_mongoc_doc_view_ptr_ptr (
+   future_value_t *future_value);
+
 void
 future_value_set_const_mongoc_find_and_modify_opts_ptr(
    future_value_t *future_value,
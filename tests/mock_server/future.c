@@ -89,6 +89,17 @@ future_get_size_t (future_t *future)
    abort ();
 }
 
+size_t_ptr
+future_get_size_t_ptr (future_t *future)
+{
+   if (future_wait (future)) {
+      return future_value_get_size_t_ptr (&future->return_value);
+   }
+
+   fprintf (stderr, "%s timed out\n", BSON_FUNC);
+   abort ();
+}
+
 ssize_t
 future_get_ssize_t (future_t *future)
 {
@@ -309,6 +320,17 @@ future_get_mongoc_topology_ptr (future_t *future)
    abort ();
 }
 
+const_mongoc_doc_view_ptr_ptr
+future_get_const_mongoc_doc_view_ptr_ptr (future_t *future)
+{
+   if (future_wait (future)) {
+      return future_value_get_const_mongoc_doc_view_ptr_ptr (&future->return_value);
+   }
+
+   fprintf (stderr, "%s timed out\n", BSON_FUNC);
+   abort ();
+}
+
 const_mongoc_find_and_modify_opts_ptr
 future_get_const_mongoc_find_and_modify_opts_ptr (future_t *future)
 {
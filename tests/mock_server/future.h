@@ -58,6 +58,9 @@ future_get_int64_t (future_t *future);
 size_t
 future_get_size_t (future_t *future);
 
+size_t_ptr
+future_get_size_t_ptr (future_t *future);
+
 ssize_t
 future_get_ssize_t (future_t *future);
 
@@ -118,6 +121,9 @@ future_get_mongoc_ss_optype_t (future_t *future);
 mongoc_topology_ptr
 future_get_mongoc_topology_ptr (future_t *future);
 
+const_mongoc_doc_view_ptr_ptr
+future_get_const_mongoc_doc_view_ptr_ptr (future_t *future);
+
 const_mongoc_find_and_modify_opts_ptr
 future_get_const_mongoc_find_and_modify_opts_ptr (future_t *future);
 
@@ -3065,6 +3065,354 @@ test_bulk_reply_w0 (void)
 }
 
 
+static void
+test_bulk_parallel (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   bson_t doc;
+   bson_t reply;
+   bson_error_t error;
+   future_t *future;
+   request_t *requests[2];
+   int i;
+
+   server = mock_server_with_autoismaster (2);
+   mock_server_run (server);
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   client = mongoc_client_pool_pop (pool);
+   collection = mongoc_client_get_collection (client, "test", "test");
+   bulk = mongoc_collection_create_bulk_operation (collection, false, NULL);
+   mongoc_bulk_operation_set_parallel (bulk, pool, 2);
+
+   /* two batches of 1000 */
+   for (i = 0; i < 2000; i++) {
+      bson_init (&doc);
+      BSON_APPEND_INT32 (&doc, "_id", i);
+      mongoc_bulk_operation_insert (bulk, &doc);
+      bson_destroy (&doc);
+   }
+
+   future = future_bulk_operation_execute (bulk, &reply, &error);
+
+   /* both batches are sent before either is answered */
+   for (i = 0; i < 2; i++) {
+      requests[i] = mock_server_receives_command (
+         server, "test", MONGOC_QUERY_NONE,
+         "{'insert': 'test', 'ordered': false}");
+   }
+
+   ASSERT_CMPINT (request_get_client_port (requests[0]), !=,
+                  request_get_client_port (requests[1]));
+
+   for (i = 0; i < 2; i++) {
+      mock_server_replies_simple (requests[i], "{'ok': 1, 'n': 1000}");
+      request_destroy (requests[i]);
+   }
+
+   ASSERT_OR_PRINT (future_get_uint32_t (future), error);
+   ASSERT_MATCH (&reply, "{'nInserted': 2000}");
+
+   future_destroy (future);
+   bson_destroy (&reply);
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_bulk_shard_routing (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   bson_t doc;
+   bson_t reply;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+   bson_t chunks[2];
+   int32_t xs[] = { 1, 20, 2, 30 };
+   int i;
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1,"
+                              " 'ismaster': true,"
+                              " 'msg': 'isdbgrid',"
+                              " 'maxWireVersion': 2}");
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "test", "test");
+   bulk = mongoc_collection_create_bulk_operation (collection, false, NULL);
+   mongoc_bulk_operation_set_shard_routing (bulk, true);
+
+   for (i = 0; i < 4; i++) {
+      bson_init (&doc);
+      BSON_APPEND_INT32 (&doc, "_id", i);
+      BSON_APPEND_INT32 (&doc, "x", xs[i]);
+      mongoc_bulk_operation_insert (bulk, &doc);
+      bson_destroy (&doc);
+   }
+
+   future = future_bulk_operation_execute (bulk, &reply, &error);
+
+   request = mock_server_receives_query (server, "config.collections",
+                                         MONGOC_QUERY_NONE, 0, 1,
+                                         "{'_id': 'test.test'}", NULL);
+   mock_server_replies_simple (request,
+                               "{'_id': 'test.test', 'key': {'x': 1}}");
+   request_destroy (request);
+
+   request = mock_server_receives_query (
+      server, "config.chunks", MONGOC_QUERY_NONE, 0, 0,
+      "{'$query': {'ns': 'test.test'}, '$orderby': {'min': 1}}", NULL);
+   bson_copy_to (tmp_bson ("{'min': {'x': {'$minKey': 1}}, 'max': {'x': 10},"
+                           " 'shard': 'a'}"), &chunks[0]);
+   bson_copy_to (tmp_bson ("{'min': {'x': 10}, 'max': {'x': {'$maxKey': 1}},"
+                           " 'shard': 'b'}"), &chunks[1]);
+   mock_server_reply_multi (request, MONGOC_REPLY_NONE, chunks, 2,
+                            0 /* cursor_id */);
+   bson_destroy (&chunks[0]);
+   bson_destroy (&chunks[1]);
+   request_destroy (request);
+
+   /* inserts are grouped by shard */
+   request = mock_server_receives_command (
+      server, "test", MONGOC_QUERY_NONE,
+      "{'insert': 'test', 'ordered': false,"
+      " 'documents': [{'_id': 0, 'x': 1}, {'_id': 2, 'x': 2}]}");
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 2}");
+   request_destroy (request);
+
+   request = mock_server_receives_command (
+      server, "test", MONGOC_QUERY_NONE,
+      "{'insert': 'test', 'ordered': false,"
+      " 'documents': [{'_id': 1, 'x': 20}, {'_id': 3, 'x': 30}]}");
+   mock_server_replies_simple (request,
+                               "{'ok': 1, 'n': 1,"
+                               " 'writeErrors': [{'index': 1,"
+                               "                  'code': 11000,"
+                               "                  'errmsg': 'dupe'}]}");
+   request_destroy (request);
+
+   ASSERT_CMPUINT32 (0, ==, future_get_uint32_t (future));
+
+   /* the error's index is the operation's position in the bulk op */
+   ASSERT_MATCH (&reply, "{'nInserted': 3,"
+                         " 'writeErrors': [{'index': 3, 'code': 11000}]}");
+
+   future_destroy (future);
+   bson_destroy (&reply);
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+/* reply to the queries for test.test's shard key and chunks */
+static void
+_receive_shard_map (mock_server_t *server)
+{
+   request_t *request;
+   bson_t chunks[2];
+
+   request = mock_server_receives_query (server, "config.collections",
+                                         MONGOC_QUERY_NONE, 0, 1,
+                                         "{'_id': 'test.test'}", NULL);
+   mock_server_replies_simple (request,
+                               "{'_id': 'test.test', 'key': {'x': 1}}");
+   request_destroy (request);
+
+   request = mock_server_receives_query (
+      server, "config.chunks", MONGOC_QUERY_NONE, 0, 0,
+      "{'$query': {'ns': 'test.test'}, '$orderby': {'min': 1}}", NULL);
+   bson_copy_to (tmp_bson ("{'min': {'x': {'$minKey': 1}}, 'max': {'x': 10},"
+                           " 'shard': 'a'}"), &chunks[0]);
+   bson_copy_to (tmp_bson ("{'min': {'x': 10}, 'max': {'x': {'$maxKey': 1}},"
+                           " 'shard': 'b'}"), &chunks[1]);
+   mock_server_reply_multi (request, MONGOC_REPLY_NONE, chunks, 2,
+                            0 /* cursor_id */);
+   bson_destroy (&chunks[0]);
+   bson_destroy (&chunks[1]);
+   request_destroy (request);
+}
+
+
+static void
+test_bulk_shard_routing_across_commands (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   bson_t doc;
+   bson_t reply;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+   int32_t xs[] = { 1, 20, 2, 30 };
+   int i;
+
+   server = mock_mongos_new (2);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "test", "test");
+   bulk = mongoc_collection_create_bulk_operation (collection, false, NULL);
+   mongoc_bulk_operation_set_shard_routing (bulk, true);
+
+   /* an update splits the inserts into two commands */
+   for (i = 0; i < 4; i++) {
+      if (i == 2) {
+         mongoc_bulk_operation_update (bulk, tmp_bson ("{'_id': 0}"),
+                                       tmp_bson ("{'$set': {'y': 1}}"),
+                                       false);
+      }
+
+      bson_init (&doc);
+      BSON_APPEND_INT32 (&doc, "_id", i);
+      BSON_APPEND_INT32 (&doc, "x", xs[i]);
+      mongoc_bulk_operation_insert (bulk, &doc);
+      bson_destroy (&doc);
+   }
+
+   future = future_bulk_operation_execute (bulk, &reply, &error);
+   _receive_shard_map (server);
+
+   request = mock_server_receives_command (
+      server, "test", MONGOC_QUERY_NONE,
+      "{'update': 'test', 'updates': [{'q': {'_id': 0}}]}");
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 1, 'nModified': 1}");
+   request_destroy (request);
+
+   /* one command per shard, not per shard and original command */
+   request = mock_server_receives_command (
+      server, "test", MONGOC_QUERY_NONE,
+      "{'insert': 'test',"
+      " 'documents': [{'_id': 0, 'x': 1}, {'_id': 2, 'x': 2}]}");
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 2}");
+   request_destroy (request);
+
+   request = mock_server_receives_command (
+      server, "test", MONGOC_QUERY_NONE,
+      "{'insert': 'test',"
+      " 'documents': [{'_id': 1, 'x': 20}, {'_id': 3, 'x': 30}]}");
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 2}");
+   request_destroy (request);
+
+   ASSERT_OR_PRINT (future_get_uint32_t (future), error);
+   ASSERT_MATCH (&reply, "{'nInserted': 4, 'nMatched': 1}");
+
+   future_destroy (future);
+   bson_destroy (&reply);
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_bulk_shard_routing_no_map (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   bson_t reply;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+
+   server = mock_mongos_new (2);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "test", "test");
+   bulk = mongoc_collection_create_bulk_operation (collection, false, NULL);
+   mongoc_bulk_operation_set_shard_routing (bulk, true);
+   mongoc_bulk_operation_insert (bulk, tmp_bson ("{'_id': 0, 'x': 1}"));
+   mongoc_bulk_operation_insert (bulk, tmp_bson ("{'_id': 1, 'x': 20}"));
+
+   future = future_bulk_operation_execute (bulk, &reply, &error);
+
+   /* e.g., the user can't read the config database */
+   request = mock_server_receives_query (server, "config.collections",
+                                         MONGOC_QUERY_NONE, 0, 1,
+                                         "{'_id': 'test.test'}", NULL);
+   mock_server_replies (request, MONGOC_REPLY_QUERY_FAILURE, 0, 0, 1,
+                        "{'$err': 'not authorized', 'code': 13}");
+   request_destroy (request);
+
+   /* the bulk operation is batched as usual */
+   request = mock_server_receives_command (
+      server, "test", MONGOC_QUERY_NONE,
+      "{'insert': 'test',"
+      " 'documents': [{'_id': 0, 'x': 1}, {'_id': 1, 'x': 20}]}");
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 2}");
+   request_destroy (request);
+
+   ASSERT_OR_PRINT (future_get_uint32_t (future), error);
+   ASSERT_MATCH (&reply, "{'nInserted': 2}");
+
+   future_destroy (future);
+   bson_destroy (&reply);
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+static void
+test_bulk_operation_timeout (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   bson_t reply;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+
+   server = mock_server_with_autoismaster (3);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "test", "test");
+   bulk = mongoc_collection_create_bulk_operation (collection, true, NULL);
+   mongoc_bulk_operation_set_operation_timeout_ms (bulk, 100);
+   mongoc_bulk_operation_insert (bulk, tmp_bson ("{'_id': 1}"));
+
+   future = future_bulk_operation_execute (bulk, &reply, &error);
+
+   /* the server never replies */
+   request = mock_server_receives_command (server, "test", MONGOC_QUERY_NONE,
+                                           "{'insert': 'test',"
+                                           " 'documents': [{'_id': 1}]}");
+
+   assert (request);
+   assert (!future_get_uint32_t (future));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_CLIENT,
+                          MONGOC_ERROR_CLIENT_OPERATION_TIMEOUT,
+                          "exceeded its timeout");
+
+   bson_destroy (&reply);
+   future_destroy (future);
+   request_destroy (request);
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
 void
 test_bulk_install (TestSuite *suite)
 {
@@ -3221,4 +3569,13 @@ test_bulk_install (TestSuite *suite)
                   test_hint_pooled_command_primary);
    TestSuite_AddLive (suite, "/BulkOperation/reply_w0",
                       test_bulk_reply_w0);
+   TestSuite_Add (suite, "/BulkOperation/parallel", test_bulk_parallel);
+   TestSuite_Add (suite, "/BulkOperation/shard_routing",
+                  test_bulk_shard_routing);
+   TestSuite_Add (suite, "/BulkOperation/shard_routing/across_commands",
+                  test_bulk_shard_routing_across_commands);
+   TestSuite_Add (suite, "/BulkOperation/shard_routing/no_map",
+                  test_bulk_shard_routing_no_map);
+   TestSuite_Add (suite, "/BulkOperation/operation_timeout",
+                  test_bulk_operation_timeout);
 }
@@ -51,12 +51,14 @@ extern void test_cursor_install                  (TestSuite *suite);
 extern void test_database_install                (TestSuite *suite);
 extern void test_error_install                   (TestSuite *suite);
 extern void test_exhaust_install                 (TestSuite *suite);
+extern void test_field_map_install               (TestSuite *suite);
 extern void test_find_and_modify_install         (TestSuite *suite);
 extern void test_gridfs_file_page_install        (TestSuite *suite);
 extern void test_gridfs_install                  (TestSuite *suite);
 extern void test_list_install                    (TestSuite *suite);
 extern void test_log_install                     (TestSuite *suite);
 extern void test_matcher_install                 (TestSuite *suite);
+extern void test_memory_install                  (TestSuite *suite);
 #ifdef MONGOC_EXPERIMENTAL_FEATURES
 extern void test_metadata_install                (TestSuite *suite);
 #endif
@@ -1729,12 +1731,14 @@ main (int   argc,
    test_database_install (&suite);
    test_error_install (&suite);
    test_exhaust_install (&suite);
+   test_field_map_install (&suite);
    test_find_and_modify_install (&suite);
    test_gridfs_install (&suite);
    test_gridfs_file_page_install (&suite);
    test_list_install (&suite);
    test_log_install (&suite);
    test_matcher_install (&suite);
+   test_memory_install (&suite);
 #ifdef MONGOC_EXPERIMENTAL_FEATURES
    test_metadata_install (&suite);
 #endif
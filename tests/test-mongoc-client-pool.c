@@ -1,10 +1,16 @@
 #include <mongoc.h>
 #include "mongoc-client-pool-private.h"
+#include "mongoc-client-private.h"
 #include "mongoc-array-private.h"
+#include "mongoc-query-cache-private.h"
+#include "mongoc-util-private.h"
 
 
 #include "TestSuite.h"
 #include "test-libmongoc.h"
+#include "test-conveniences.h"
+#include "mock_server/future-functions.h"
+#include "mock_server/mock-server.h"
 
 
 static void
@@ -246,6 +252,421 @@ test_mongoc_client_pool_metadata (void)
 }
 #endif
 
+
+/* runs a find and reads its first document, {'b': 1}. If expect_request
+ * is false the result must come from the query cache */
+static mongoc_cursor_t *
+_find_first (mongoc_collection_t *collection,
+             const char          *query,
+             mock_server_t       *server,
+             const char          *cursor_id,
+             bool                 expect_request)
+{
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   future_t *future;
+   request_t *request;
+   char *reply;
+
+   cursor = mongoc_collection_find (collection, MONGOC_QUERY_NONE, 0, 0, 0,
+                                    tmp_bson (query), NULL, NULL);
+
+   future = future_cursor_next (cursor, &doc);
+
+   if (expect_request) {
+      request = mock_server_receives_command (server, "db",
+                                              MONGOC_QUERY_SLAVE_OK,
+                                              "{'find': 'collection'}");
+
+      reply = bson_strdup_printf ("{'ok': 1,"
+                                  " 'cursor': {"
+                                  "    'id': {'$numberLong': '%s'},"
+                                  "    'ns': 'db.collection',"
+                                  "    'firstBatch': [{'b': 1}]}}",
+                                  cursor_id);
+
+      mock_server_replies_simple (request, reply);
+      bson_free (reply);
+      request_destroy (request);
+   }
+
+   ASSERT (future_get_bool (future));
+   ASSERT_MATCH (doc, "{'b': 1}");
+   future_destroy (future);
+
+   return cursor;
+}
+
+
+static void
+_query_cache_find (mongoc_collection_t *collection,
+                   const char          *query,
+                   mock_server_t       *server,
+                   bool                 expect_request)
+{
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+
+   cursor = _find_first (collection, query, server, "0", expect_request);
+
+   ASSERT (!mongoc_cursor_next (cursor, &doc));
+   ASSERT (!mongoc_cursor_error (cursor, NULL));
+
+   mongoc_cursor_destroy (cursor);
+}
+
+
+static void
+test_mongoc_client_pool_query_cache (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+
+   server = mock_server_with_autoismaster (4);
+   mock_server_run (server);
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   mongoc_client_pool_set_query_cache (pool, 1024 * 1024, 0);
+   mongoc_client_pool_cache_namespace (pool, "db.collection");
+
+   client = mongoc_client_pool_pop (pool);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+
+   _query_cache_find (collection, "{'a': 1, 'c': 2}", server, true);
+
+   /* the order of the filter's fields doesn't matter */
+   _query_cache_find (collection, "{'c': 2, 'a': 1}", server, false);
+
+   mongoc_client_pool_invalidate_query_cache (pool, "db");
+   _query_cache_find (collection, "{'a': 1, 'c': 2}", server, true);
+   _query_cache_find (collection, "{'a': 1, 'c': 2}", server, false);
+
+   /* other namespaces are invalidated separately */
+   mongoc_client_pool_invalidate_query_cache (pool, "db.other");
+   mongoc_client_pool_invalidate_query_cache (pool, "other");
+   _query_cache_find (collection, "{'a': 1, 'c': 2}", server, false);
+
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
+static void
+_query_cache_count (mongoc_collection_t *collection,
+                    mock_server_t       *server,
+                    bool                 expect_request)
+{
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+
+   future = future_collection_count (collection, MONGOC_QUERY_NONE,
+                                     tmp_bson ("{'a': 1}"), 0, 0, NULL,
+                                     &error);
+
+   if (expect_request) {
+      request = mock_server_receives_command (server, "db",
+                                              MONGOC_QUERY_SLAVE_OK,
+                                              "{'count': 'collection'}");
+
+      mock_server_replies_simple (request, "{'ok': 1, 'n': 5}");
+      request_destroy (request);
+   }
+
+   ASSERT_CMPINT64 ((int64_t) 5, ==, future_get_int64_t (future));
+   future_destroy (future);
+}
+
+
+static void
+test_mongoc_client_pool_query_cache_writes (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_database_t *database;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+
+   server = mock_server_with_autoismaster (4);
+   mock_server_run (server);
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   mongoc_client_pool_set_query_cache (pool, 1024 * 1024, 0);
+   mongoc_client_pool_cache_namespace (pool, "db.collection");
+
+   client = mongoc_client_pool_pop (pool);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   database = mongoc_client_get_database (client, "db");
+
+   _query_cache_find (collection, "{'a': 1}", server, true);
+   _query_cache_find (collection, "{'a': 1}", server, false);
+   _query_cache_count (collection, server, true);
+   _query_cache_count (collection, server, false);
+
+   /* an insert invalidates finds and counts on its namespace */
+   future = future_collection_insert (collection, MONGOC_INSERT_NONE,
+                                      tmp_bson ("{'_id': 1}"), NULL, &error);
+   request = mock_server_receives_command (server, "db", MONGOC_QUERY_NONE,
+                                           "{'insert': 'collection'}");
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 1}");
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+   future_destroy (future);
+   request_destroy (request);
+
+   _query_cache_find (collection, "{'a': 1}", server, true);
+   _query_cache_count (collection, server, true);
+   _query_cache_find (collection, "{'a': 1}", server, false);
+
+   /* so does dropping the database */
+   future = future_database_drop (database, &error);
+   request = mock_server_receives_command (server, "db", MONGOC_QUERY_SLAVE_OK,
+                                           "{'dropDatabase': 1}");
+   mock_server_replies_simple (request, "{'ok': 1}");
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+   future_destroy (future);
+   request_destroy (request);
+
+   _query_cache_find (collection, "{'a': 1}", server, true);
+   _query_cache_count (collection, server, true);
+
+   mongoc_database_destroy (database);
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_mongoc_client_pool_query_cache_ttl (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+
+   server = mock_server_with_autoismaster (4);
+   mock_server_run (server);
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   mongoc_client_pool_set_query_cache (pool, 1024 * 1024, 100);
+   mongoc_client_pool_cache_namespace (pool, "db.collection");
+
+   client = mongoc_client_pool_pop (pool);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+
+   _query_cache_find (collection, "{'a': 1}", server, true);
+   _query_cache_find (collection, "{'a': 1}", server, false);
+
+   _mongoc_usleep (200 * 1000);
+   _query_cache_find (collection, "{'a': 1}", server, true);
+
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_mongoc_client_pool_query_cache_lru (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   size_t entry_bytes;
+   char query[16];
+   int i;
+
+   server = mock_server_with_autoismaster (4);
+   mock_server_run (server);
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   mongoc_client_pool_set_query_cache (pool, 1024 * 1024, 0);
+   mongoc_client_pool_cache_namespace (pool, "db.collection");
+
+   client = mongoc_client_pool_pop (pool);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+
+   /* measure one result, the others are the same size */
+   _query_cache_find (collection, "{'a': 0}", server, true);
+   entry_bytes = client->query_cache->bytes;
+   ASSERT (entry_bytes > 0);
+
+   /* room for four results */
+   mongoc_client_pool_set_query_cache (pool, 4 * entry_bytes + 1, 0);
+
+   for (i = 1; i <= 4; i++) {
+      bson_snprintf (query, sizeof query, "{'a': %d}", i);
+      _query_cache_find (collection, query, server, true);
+   }
+
+   /* use the oldest, then a fifth result evicts the next oldest */
+   _query_cache_find (collection, "{'a': 1}", server, false);
+   _query_cache_find (collection, "{'a': 5}", server, true);
+   ASSERT_CMPSIZE_T (client->query_cache->bytes, <=, 4 * entry_bytes + 1);
+
+   _query_cache_find (collection, "{'a': 1}", server, false);
+   _query_cache_find (collection, "{'a': 3}", server, false);
+   _query_cache_find (collection, "{'a': 2}", server, true);
+
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_mongoc_client_pool_kill_cursors_interval (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursor_a;
+   mongoc_cursor_t *cursor_b;
+   request_t *request;
+
+   server = mock_server_with_autoismaster (4);
+   mock_server_run (server);
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   mongoc_client_pool_set_kill_cursors_interval (pool, 200);
+
+   client = mongoc_client_pool_pop (pool);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   cursor_a = _find_first (collection, "{}", server, "123", true);
+   cursor_b = _find_first (collection, "{}", server, "456", true);
+
+   /* returns at once, no killCursors round trip on this thread */
+   mongoc_cursor_destroy (cursor_a);
+   mongoc_cursor_destroy (cursor_b);
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (pool, client);
+
+   /* the reaper thread kills both with one command */
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK,
+      "{'killCursors': 'collection',"
+      " 'cursors': [{'$numberLong': '123'}, {'$numberLong': '456'}]}");
+
+   mock_server_replies_simple (request, "{'ok': 1}");
+   request_destroy (request);
+
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_mongoc_client_pool_write_coalescing (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *clients[4];
+   mongoc_collection_t *collections[4];
+   bson_t *docs[4];
+   bson_error_t errors[4];
+   future_t *futures[4];
+   request_t *lone;
+   request_t *request;
+   const bson_t *cmd;
+   bson_t documents;
+   char path[32];
+   char *reply;
+   int dup_index = -1;
+   int i;
+
+   server = mock_server_with_autoismaster (4);
+   mock_server_run (server);
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+
+   /* a long window, the group is sent when it is full */
+   mongoc_client_pool_set_write_coalescing (pool, 10000, 3);
+
+   for (i = 0; i < 4; i++) {
+      clients[i] = mongoc_client_pool_pop (pool);
+      collections[i] = mongoc_client_get_collection (clients[i], "db",
+                                                     "collection");
+      docs[i] = BCON_NEW ("_id", BCON_INT32 (i));
+   }
+
+   /* nothing to wait for, a lone insert is sent at once */
+   futures[0] = future_collection_insert (collections[0], MONGOC_INSERT_NONE,
+                                          docs[0], NULL, &errors[0]);
+   lone = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_NONE,
+      "{'insert': 'collection', 'ordered': false, 'documents': [{'_id': 0}]}");
+
+   /* the next group waits while the first insert's thread may join */
+   for (i = 1; i < 4; i++) {
+      futures[i] = future_collection_insert (collections[i],
+                                             MONGOC_INSERT_NONE, docs[i],
+                                             NULL, &errors[i]);
+   }
+
+   /* one command for the other three threads */
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_NONE,
+      "{'insert': 'collection', 'ordered': false}");
+
+   mock_server_replies_simple (lone, "{'ok': 1, 'n': 1}");
+   ASSERT_OR_PRINT (future_get_bool (futures[0]), errors[0]);
+
+   cmd = request_get_doc (request, 0);
+   bson_lookup_doc (cmd, "documents", &documents);
+   ASSERT_CMPINT (bson_count_keys (&documents), ==, 3);
+
+   for (i = 0; i < 3; i++) {
+      bson_snprintf (path, sizeof path, "documents.%d._id", i);
+      if (bson_lookup_int32 (cmd, path) == 1) {
+         dup_index = i;
+      }
+   }
+
+   ASSERT_CMPINT (dup_index, !=, -1);
+
+   /* only {_id: 1} fails */
+   reply = bson_strdup_printf ("{'ok': 1, 'n': 2, 'writeErrors': [{"
+                               "    'index': %d, 'code': 11000,"
+                               "    'errmsg': 'duplicate key'}]}",
+                               dup_index);
+   mock_server_replies_simple (request, reply);
+
+   for (i = 0; i < 4; i++) {
+      if (i == 1) {
+         ASSERT (!future_get_bool (futures[i]));
+         ASSERT_ERROR_CONTAINS (errors[i], MONGOC_ERROR_COMMAND, 11000,
+                                "duplicate key");
+         ASSERT_MATCH (mongoc_collection_get_last_error (collections[i]),
+                       "{'nInserted': 0, 'writeErrors': [{'index': 0}]}");
+      } else {
+         if (i) {
+            ASSERT_OR_PRINT (future_get_bool (futures[i]), errors[i]);
+         }
+
+         ASSERT_MATCH (mongoc_collection_get_last_error (collections[i]),
+                       "{'nInserted': 1, 'writeErrors': []}");
+      }
+
+      future_destroy (futures[i]);
+      bson_destroy (docs[i]);
+      mongoc_collection_destroy (collections[i]);
+      mongoc_client_pool_push (pool, clients[i]);
+   }
+
+   bson_free (reply);
+   request_destroy (lone);
+   request_destroy (request);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
 void
 test_client_pool_install (TestSuite *suite)
 {
@@ -255,6 +676,12 @@ test_client_pool_install (TestSuite *suite)
    TestSuite_Add (suite, "/ClientPool/min_size_dispose", test_mongoc_client_pool_min_size_dispose);
    TestSuite_Add (suite, "/ClientPool/set_max_size", test_mongoc_client_pool_set_max_size);
    TestSuite_Add (suite, "/ClientPool/set_min_size", test_mongoc_client_pool_set_min_size);
+   TestSuite_Add (suite, "/ClientPool/query_cache", test_mongoc_client_pool_query_cache);
+   TestSuite_Add (suite, "/ClientPool/query_cache/writes", test_mongoc_client_pool_query_cache_writes);
+   TestSuite_Add (suite, "/ClientPool/query_cache/ttl", test_mongoc_client_pool_query_cache_ttl);
+   TestSuite_Add (suite, "/ClientPool/query_cache/lru", test_mongoc_client_pool_query_cache_lru);
+   TestSuite_Add (suite, "/ClientPool/kill_cursors_interval", test_mongoc_client_pool_kill_cursors_interval);
+   TestSuite_Add (suite, "/ClientPool/write_coalescing", test_mongoc_client_pool_write_coalescing);
 
 #ifdef MONGOC_EXPERIMENTAL_FEATURES
    TestSuite_Add (suite, "/ClientPool/metadata", test_mongoc_client_pool_metadata);
@@ -1212,6 +1212,51 @@ test_mongoc_client_mismatched_me (void)
 }
 
 
+static void
+test_mongoc_client_flush (void)
+{
+   mock_server_t *server;
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_write_concern_t *wc;
+   bson_error_t error;
+   request_t *request;
+   int64_t request_timeout_msec;
+
+   server = mock_server_with_autoismaster (0);
+   mock_server_run (server);
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   mongoc_uri_set_option_as_int32 (uri, "writeBufferSize", 1024);
+   client = mongoc_client_new_from_uri (uri);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   wc = mongoc_write_concern_new ();
+   mongoc_write_concern_set_w (wc, MONGOC_WRITE_CONCERN_W_UNACKNOWLEDGED);
+
+   ASSERT_OR_PRINT (mongoc_collection_insert (collection, MONGOC_INSERT_NONE,
+                                              tmp_bson ("{'_id': 1}"), wc,
+                                              &error), error);
+
+   /* the unacknowledged insert waits in the write buffer */
+   request_timeout_msec = mock_server_get_request_timeout_msec (server);
+   mock_server_set_request_timeout_msec (server, 100);
+   assert (!mock_server_receives_request (server));
+   mock_server_set_request_timeout_msec (server, request_timeout_msec);
+
+   ASSERT_OR_PRINT (mongoc_client_flush (client, &error), error);
+   request = mock_server_receives_insert (server, "db.collection",
+                                          MONGOC_INSERT_NONE, "{'_id': 1}");
+   assert (request);
+
+   request_destroy (request);
+   mongoc_write_concern_destroy (wc);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
 #ifdef MONGOC_ENABLE_SSL
 static void
 _test_mongoc_client_ssl_opts (bool pooled)
@@ -1983,6 +2028,62 @@ test_client_sends_metadata_pooled (void)
 }
 #endif
 
+static void
+test_client_scratch (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   bson_t *docs[MONGOC_SCRATCH_DOCS + 1];
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+   int i;
+
+   server = mock_server_with_autoismaster (4);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "db", "collection");
+
+   future = future_collection_count (collection, MONGOC_QUERY_NONE, NULL, 0,
+                                     0, NULL, &error);
+   request = mock_server_receives_command (server, "db", MONGOC_QUERY_SLAVE_OK,
+                                           "{'count': 'collection'}");
+
+   /* the command was built in a scratch document */
+   ASSERT (client->scratch.docs_in_use);
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 3}");
+   ASSERT_CMPINT64 ((int64_t) 3, ==, future_get_int64_t (future));
+
+   /* everything was released when the operation finished */
+   ASSERT (!client->scratch.docs_in_use);
+   ASSERT (!client->scratch.iov_in_use);
+
+   /* when all documents are in use, fall back to the heap */
+   for (i = 0; i < MONGOC_SCRATCH_DOCS + 1; i++) {
+      docs[i] = _mongoc_scratch_bson (&client->scratch);
+      ASSERT (bson_empty (docs[i]));
+      BSON_APPEND_INT32 (docs[i], "i", i);
+   }
+
+   ASSERT (docs[0] == &client->scratch.docs[0]);
+   ASSERT (client->scratch.docs_in_use == (1u << MONGOC_SCRATCH_DOCS) - 1);
+
+   for (i = 0; i < MONGOC_SCRATCH_DOCS + 1; i++) {
+      _mongoc_scratch_bson_release (&client->scratch, docs[i]);
+   }
+
+   ASSERT (!client->scratch.docs_in_use);
+   ASSERT (bson_empty (&client->scratch.docs[0]));
+
+   future_destroy (future);
+   request_destroy (request);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
 void
 test_client_install (TestSuite *suite)
 {
@@ -2031,6 +2132,7 @@ test_client_install (TestSuite *suite)
    TestSuite_Add (suite, "/Client/database_names", test_get_database_names);
    TestSuite_AddFull (suite, "/Client/connect/uds", test_mongoc_client_unix_domain_socket, NULL, NULL, test_framework_skip_if_no_uds);
    TestSuite_Add (suite, "/Client/mismatched_me", test_mongoc_client_mismatched_me);
+   TestSuite_Add (suite, "/Client/flush", test_mongoc_client_flush);
 
 #ifdef MONGOC_EXPERIMENTAL_FEATURES
    TestSuite_Add (suite, "/Client/application_metadata", test_mongoc_client_application_metadata);
@@ -2066,6 +2168,7 @@ test_client_install (TestSuite *suite)
 
    TestSuite_AddLive (suite, "/Client/get_description/single", test_mongoc_client_get_description_single);
    TestSuite_AddLive (suite, "/Client/get_description/pooled", test_mongoc_client_get_description_pooled);
+   TestSuite_Add (suite, "/Client/scratch", test_client_scratch);
    TestSuite_AddLive (suite, "/Client/descriptions", test_mongoc_client_descriptions);
    TestSuite_AddLive (suite, "/Client/select_server/single", test_mongoc_client_select_server_single);
    TestSuite_AddLive (suite, "/Client/select_server/pooled", test_mongoc_client_select_server_pooled);
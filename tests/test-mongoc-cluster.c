@@ -469,6 +469,159 @@ test_legacy_write_socket_check (void)
 }
 
 
+static void
+test_cluster_idle_monitoring (void *ctx)
+{
+   mock_server_t *server;
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+   mongoc_server_description_t *sd;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+   int64_t next;
+   int64_t expire_at;
+   int ismaster_id;
+
+   server = mock_server_new ();
+   mock_server_run (server);
+   ismaster_id = mock_server_auto_ismaster (server,
+                                            "{'ok': 1.0,"
+                                            " 'ismaster': true,"
+                                            " 'minWireVersion': 0,"
+                                            " 'maxWireVersion': 3}");
+
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   mongoc_uri_set_option_as_int32 (uri, "socketCheckIntervalMS", 1);
+   mongoc_uri_set_option_as_int32 (uri, "heartbeatFrequencyMS", 500);
+   client = mongoc_client_new_from_uri (uri);
+
+   ASSERT_CMPINT64 (mongoc_client_monitor_work (client, 0), ==, (int64_t) -1);
+   ASSERT (mongoc_client_set_idle_monitoring (client, true));
+
+   /* the first scan is due at once */
+   expire_at = bson_get_monotonic_time () + 10 * 1000 * 1000;
+
+   while (!(next = mongoc_client_monitor_work (client, 10))) {
+      ASSERT_CMPINT64 (bson_get_monotonic_time (), <, expire_at);
+   }
+
+   ASSERT_CMPINT64 (next, >, (int64_t) 0);
+   ASSERT_CMPINT64 (next, <=, (int64_t) 500);
+
+   sd = mongoc_client_get_server_description (client, 1);
+   ASSERT (sd);
+   ASSERT_CMPSTR (mongoc_server_description_type (sd), "Standalone");
+   mongoc_server_description_destroy (sd);
+
+   /* from now on any ismaster reaches the test, and fails it */
+   mock_server_remove_autoresponder (server, ismaster_id);
+
+   /* heartbeatFrequencyMS and socketCheckIntervalMS have passed */
+   _mongoc_usleep (600 * 1000);
+
+   future = future_client_command_simple (client, "db", tmp_bson ("{'ping': 1}"),
+                                          NULL, NULL, &error);
+   request = mock_server_receives_command (server, "db", MONGOC_QUERY_SLAVE_OK,
+                                           "{'ping': 1}");
+   mock_server_replies_simple (request, "{'ok': 1}");
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+
+   request_destroy (request);
+   future_destroy (future);
+   mongoc_client_destroy (client);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
+static bool
+auto_ping (request_t *request,
+           void *data)
+{
+   if (request->is_command && !strcmp (request->command_name, "ping")) {
+      mock_server_replies_simple (request, "{'ok': 1}");
+      request_destroy (request);
+      return true;
+   }
+
+   return false;
+}
+
+
+static void
+test_cluster_idle_monitoring_finish_one (void *ctx)
+{
+   mock_server_t *a;
+   mock_server_t *b;
+   char *uri_str;
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+   mongoc_topology_scanner_node_t *node;
+   bson_error_t error;
+   request_t *request;
+   int64_t expire_at;
+   int ismaster_id;
+
+   a = mock_mongos_new (3);
+   mock_server_autoresponds (a, auto_ping, NULL, NULL);
+   mock_server_run (a);
+   b = mock_server_new ();
+   mock_server_run (b);
+   ismaster_id = mock_server_auto_ismaster (b,
+                                            "{'ok': 1.0,"
+                                            " 'ismaster': true,"
+                                            " 'msg': 'isdbgrid',"
+                                            " 'minWireVersion': 0,"
+                                            " 'maxWireVersion': 3}");
+
+   uri_str = bson_strdup_printf ("mongodb://%s,%s/?heartbeatFrequencyMS=500",
+                                 mock_server_get_host_and_port (a),
+                                 mock_server_get_host_and_port (b));
+   uri = mongoc_uri_new (uri_str);
+   client = mongoc_client_new_from_uri (uri);
+   ASSERT (mongoc_client_set_idle_monitoring (client, true));
+
+   expire_at = bson_get_monotonic_time () + 10 * 1000 * 1000;
+
+   while (!mongoc_client_monitor_work (client, 10)) {
+      ASSERT_CMPINT64 (bson_get_monotonic_time (), <, expire_at);
+   }
+
+   /* the next check of b hangs */
+   mock_server_remove_autoresponder (b, ismaster_id);
+   _mongoc_usleep (600 * 1000);
+   ASSERT_CMPINT64 (mongoc_client_monitor_work (client, 100), ==, (int64_t) 0);
+   request = mock_server_receives_ismaster (b);
+   ASSERT (request);
+
+   /* a's check is completed if need be, b's is left pending */
+   ASSERT_OR_PRINT (mongoc_client_command_simple_with_server_id (
+                       client, "db", tmp_bson ("{'ping': 1}"), NULL, 1, NULL,
+                       &error), error);
+
+   node = mongoc_topology_scanner_get_node (client->topology->scanner, 2);
+   ASSERT (node && node->cmd);
+
+   mock_server_replies_simple (request, "{'ok': 1.0,"
+                                        " 'ismaster': true,"
+                                        " 'msg': 'isdbgrid',"
+                                        " 'minWireVersion': 0,"
+                                        " 'maxWireVersion': 3}");
+
+   while (!mongoc_client_monitor_work (client, 10)) {
+      ASSERT_CMPINT64 (bson_get_monotonic_time (), <, expire_at);
+   }
+
+   request_destroy (request);
+   mongoc_client_destroy (client);
+   mongoc_uri_destroy (uri);
+   bson_free (uri_str);
+   mock_server_destroy (b);
+   mock_server_destroy (a);
+}
+
+
 void
 test_cluster_install (TestSuite *suite)
 {
@@ -482,4 +635,6 @@ test_cluster_install (TestSuite *suite)
    TestSuite_AddFull  (suite, "/Cluster/legacy_write/disconnect", test_legacy_write_disconnect, NULL, NULL, test_framework_skip_if_slow);
    TestSuite_Add (suite, "/Cluster/write_command/socket_check", test_write_command_socket_check);
    TestSuite_Add (suite, "/Cluster/legacy_write/socket_check", test_legacy_write_socket_check);
+   TestSuite_AddFull (suite, "/Cluster/idle_monitoring", test_cluster_idle_monitoring, NULL, NULL, test_framework_skip_if_slow);
+   TestSuite_AddFull (suite, "/Cluster/idle_monitoring/finish_one", test_cluster_idle_monitoring_finish_one, NULL, NULL, test_framework_skip_if_slow);
 }
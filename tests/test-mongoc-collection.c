@@ -616,6 +616,136 @@ test_insert_command_keys (void)
 }
 
 
+static void
+test_insert_validate_level (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_collection_t *copy;
+   mongoc_client_t *unreachable;
+   mongoc_collection_t *unreachable_collection;
+   mongoc_bulk_operation_t *bulk;
+   bson_t *dotted;
+   bson_t *dollar;
+   bson_t *bad_utf8;
+   const bson_t *docs[3];
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+
+   server = mock_server_with_autoismaster (3);
+   mock_server_run (server);
+
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "test", "test");
+   dotted = BCON_NEW ("a.b", BCON_INT32 (1));
+   dollar = BCON_NEW ("$a", BCON_INT32 (1));
+
+   ASSERT_CMPINT (MONGOC_VALIDATE_FULL, ==,
+                  mongoc_collection_get_validate_level (collection));
+
+   /* rejected before anything is sent */
+   mongoc_collection_set_validate_level (collection, MONGOC_VALIDATE_KEYS);
+   ASSERT (!mongoc_collection_insert (collection, MONGOC_INSERT_NONE, dollar,
+                                      NULL, &error));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_BSON, MONGOC_ERROR_BSON_INVALID,
+                          "invalid characters");
+
+   copy = mongoc_collection_copy (collection);
+   ASSERT_CMPINT (MONGOC_VALIDATE_KEYS, ==,
+                  mongoc_collection_get_validate_level (copy));
+   mongoc_collection_destroy (copy);
+
+   /* unchecked, so the server gets it */
+   mongoc_collection_set_validate_level (collection, MONGOC_VALIDATE_NONE);
+   future = future_collection_insert (collection, MONGOC_INSERT_NONE, dotted,
+                                      NULL, &error);
+   request = mock_server_receives_command (
+      server, "test", MONGOC_QUERY_NONE,
+      "{'insert': 'test', 'documents': [{'a.b': 1}]}");
+
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 1}");
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+   future_destroy (future);
+   request_destroy (request);
+
+   /* the bulk operation's own level applies to replacements */
+   bulk = mongoc_collection_create_bulk_operation (collection, true, NULL);
+   mongoc_bulk_operation_set_validate_level (bulk, MONGOC_VALIDATE_KEYS);
+   capture_logs (true);
+   mongoc_bulk_operation_replace_one (bulk, tmp_bson ("{}"), dotted, false);
+   ASSERT_CAPTURED_LOG ("replace_one", MONGOC_LOG_LEVEL_WARNING,
+                        "may not contain $ or . in keys");
+   capture_logs (false);
+   ASSERT (!mongoc_bulk_operation_execute (bulk, NULL, &error));
+   ASSERT_CONTAINS (error.message, "empty bulk write");
+   mongoc_bulk_operation_destroy (bulk);
+
+   bulk = mongoc_collection_create_bulk_operation (collection, true, NULL);
+   mongoc_bulk_operation_set_validate_level (bulk, MONGOC_VALIDATE_NONE);
+   mongoc_bulk_operation_replace_one (bulk, tmp_bson ("{}"), dotted, false);
+   future = future_bulk_operation_execute (bulk, NULL, &error);
+   request = mock_server_receives_command (
+      server, "test", MONGOC_QUERY_NONE,
+      "{'update': 'test', 'updates': [{'q': {}, 'u': {'a.b': 1}}]}");
+
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 1}");
+   ASSERT_OR_PRINT (future_get_uint32_t (future), error);
+   future_destroy (future);
+   request_destroy (request);
+   mongoc_bulk_operation_destroy (bulk);
+
+   /* a bad document in the middle of a batch: nothing is sent, and the
+    * partly built command is freed, which the leak checker verifies */
+   mongoc_collection_set_validate_level (collection, MONGOC_VALIDATE_FULL);
+   docs[0] = tmp_bson ("{'a': 1}");
+   docs[1] = dollar;
+   docs[2] = tmp_bson ("{'a': 3}");
+   BEGIN_IGNORE_DEPRECATIONS;
+   ASSERT (!mongoc_collection_insert_bulk (collection, MONGOC_INSERT_NONE,
+                                           docs, 3, NULL, &error));
+   END_IGNORE_DEPRECATIONS;
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_BSON, MONGOC_ERROR_BSON_INVALID,
+                          "invalid characters");
+
+   mock_server_set_request_timeout_msec (server, 100);
+   request = mock_server_receives_request (server);
+   ASSERT (!request);
+
+   /* invalid UTF-8 fails only full validation. The mock server can't print
+    * it, so with KEYS show that the insert gets past validation to server
+    * selection, against a server that isn't there */
+   bad_utf8 = bson_new ();
+   bson_append_utf8 (bad_utf8, "s", 1, "\xff", 1);
+
+   ASSERT (!mongoc_collection_insert (collection, MONGOC_INSERT_NONE, bad_utf8,
+                                      NULL, &error));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_BSON, MONGOC_ERROR_BSON_INVALID,
+                          "invalid characters");
+
+   unreachable = mongoc_client_new (
+      "mongodb://localhost:1/?serverSelectionTimeoutMS=100");
+   unreachable_collection = mongoc_client_get_collection (unreachable,
+                                                          "test", "test");
+   mongoc_collection_set_validate_level (unreachable_collection,
+                                         MONGOC_VALIDATE_KEYS);
+   ASSERT (!mongoc_collection_insert (unreachable_collection,
+                                      MONGOC_INSERT_NONE, bad_utf8,
+                                      NULL, &error));
+   ASSERT_CMPINT (error.domain, ==, MONGOC_ERROR_SERVER_SELECTION);
+
+   mongoc_collection_destroy (unreachable_collection);
+   mongoc_client_destroy (unreachable);
+   bson_destroy (bad_utf8);
+   bson_destroy (dotted);
+   bson_destroy (dollar);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
 /* number of docs that should go in a batch that starts at "offset" */
 int
 expected_batch_size (const bson_t **bsons,
@@ -1919,6 +2049,74 @@ test_count_with_opts (void)
 }
 
 
+
+static void
+test_count_operation_timeout (void)
+{
+   mock_server_t *server;
+   mongoc_collection_t *collection;
+   mongoc_client_t *client;
+   future_t *future;
+   request_t *request;
+   bson_error_t error;
+
+   server = mock_mongos_new (0);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "db", "collection");
+
+   ASSERT_CMPINT (0, ==, mongoc_collection_get_operation_timeout_ms (collection));
+   mongoc_collection_set_operation_timeout_ms (collection, 10 * 1000);
+   ASSERT_CMPINT (10 * 1000, ==,
+                  mongoc_collection_get_operation_timeout_ms (collection));
+
+   /* maxTimeMS is set from the time left */
+   future = future_collection_count_with_opts (
+      collection, MONGOC_QUERY_SLAVE_OK, NULL, 0, 0, NULL, NULL, &error);
+
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK,
+      "{'count': 'collection', 'maxTimeMS': {'$exists': true}}");
+
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 1}");
+   ASSERT_OR_PRINT (1 == future_get_int64_t (future), error);
+   request_destroy (request);
+   future_destroy (future);
+
+   /* a smaller maxTimeMS is kept */
+   future = future_collection_count_with_opts (
+      collection, MONGOC_QUERY_SLAVE_OK, NULL, 0, 0,
+      tmp_bson ("{'maxTimeMS': 5}"), NULL, &error);
+
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK,
+      "{'count': 'collection', 'maxTimeMS': 5}");
+
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 2}");
+   ASSERT_OR_PRINT (2 == future_get_int64_t (future), error);
+   request_destroy (request);
+   future_destroy (future);
+
+   /* the driver stops waiting for a reply when the timeout expires */
+   mongoc_collection_set_operation_timeout_ms (collection, 100);
+   future = future_collection_count_with_opts (
+      collection, MONGOC_QUERY_SLAVE_OK, NULL, 0, 0, NULL, NULL, &error);
+
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'count': 'collection'}");
+
+   ASSERT_CMPINT64 ((int64_t) -1, ==, future_get_int64_t (future));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_CLIENT,
+                          MONGOC_ERROR_CLIENT_OPERATION_TIMEOUT,
+                          "exceeded its timeout");
+
+   request_destroy (request);
+   future_destroy (future);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
 static void
 test_drop (void)
 {
@@ -3443,6 +3641,7 @@ test_collection_install (TestSuite *suite)
    TestSuite_AddLive (suite, "/Collection/insert", test_insert);
    TestSuite_Add (suite, "/Collection/insert/oversize", test_legacy_insert_oversize_mongos);
    TestSuite_Add (suite, "/Collection/insert/keys", test_insert_command_keys);
+   TestSuite_Add (suite, "/Collection/insert/validate_level", test_insert_validate_level);
    TestSuite_AddLive (suite, "/Collection/save", test_save);
    TestSuite_AddLive (suite, "/Collection/insert/w0", test_insert_w0);
    TestSuite_AddLive (suite, "/Collection/update/w0", test_update_w0);
@@ -3460,6 +3659,8 @@ test_collection_install (TestSuite *suite)
    TestSuite_AddLive (suite, "/Collection/remove", test_remove);
    TestSuite_AddLive (suite, "/Collection/count", test_count);
    TestSuite_Add (suite, "/Collection/count_with_opts", test_count_with_opts);
+   TestSuite_Add (suite, "/Collection/count/operation_timeout",
+                  test_count_operation_timeout);
    TestSuite_Add (suite, "/Collection/count/read_pref", test_count_read_pref);
    TestSuite_Add (suite, "/Collection/count/read_concern", test_count_read_concern);
    TestSuite_AddFull (suite, "/Collection/count/read_concern_live", test_count_read_concern_live, NULL, NULL, mongod_supports_majority_read_concern);
@@ -913,6 +913,665 @@ test_tailable_alive (void)
 }
 
 
+static void
+test_prefetch (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   future_t *future;
+   request_t *request;
+   request_t *get_more;
+   bson_error_t error;
+
+   server = mock_server_with_autoismaster (4);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   cursor = mongoc_collection_find (collection, MONGOC_QUERY_NONE, 0, 0, 0,
+                                    tmp_bson ("{}"), NULL, NULL);
+
+   ASSERT (!mongoc_cursor_get_prefetch (cursor));
+   mongoc_cursor_set_prefetch (cursor, true);
+   ASSERT (mongoc_cursor_get_prefetch (cursor));
+
+   future = future_cursor_next (cursor, &doc);
+   request = mock_server_receives_command (server, "db",
+                                           MONGOC_QUERY_SLAVE_OK,
+                                           "{'find': 'collection'}");
+
+   mock_server_replies_simple (request, "{'ok': 1,"
+                                        " 'cursor': {"
+                                        "    'id': {'$numberLong': '123'},"
+                                        "    'ns': 'db.collection',"
+                                        "    'firstBatch': [{'b': 1}]}}");
+
+   /* getMore is sent before the first batch is consumed */
+   get_more = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK,
+      "{'getMore': {'$numberLong': '123'}, 'collection': 'collection'}");
+
+   ASSERT (future_get_bool (future));
+   ASSERT_MATCH (doc, "{'b': 1}");
+   ASSERT (client->in_flight_cursor == cursor);
+
+   future_destroy (future);
+   request_destroy (request);
+
+   /* another operation reads the pending reply before using the connection */
+   future = future_client_command_simple (client, "admin",
+                                          tmp_bson ("{'ping': 1}"),
+                                          NULL, NULL, &error);
+
+   mock_server_replies_simple (get_more, "{'ok': 1,"
+                                         " 'cursor': {"
+                                         "    'id': 0,"
+                                         "    'ns': 'db.collection',"
+                                         "    'nextBatch': [{'b': 2}]}}");
+
+   request = mock_server_receives_command (server, "admin",
+                                           MONGOC_QUERY_SLAVE_OK,
+                                           "{'ping': 1}");
+
+   mock_server_replies_simple (request, "{'ok': 1}");
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+   ASSERT (!client->in_flight_cursor);
+
+   future_destroy (future);
+   request_destroy (request);
+   request_destroy (get_more);
+
+   /* no more requests, the next batch was already received */
+   ASSERT (mongoc_cursor_next (cursor, &doc));
+   ASSERT_MATCH (doc, "{'b': 2}");
+   ASSERT (!mongoc_cursor_next (cursor, &doc));
+   ASSERT_OR_PRINT (!mongoc_cursor_error (cursor, &error), error);
+
+   mongoc_cursor_destroy (cursor);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_prefetch_destroy (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   future_t *future;
+   request_t *request;
+   request_t *get_more;
+   request_t *kill_cursors;
+   int64_t cursor_id_out;
+
+   server = mock_server_with_autoismaster (4);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   cursor = mongoc_collection_find (collection, MONGOC_QUERY_NONE, 0, 0, 0,
+                                    tmp_bson ("{}"), NULL, NULL);
+
+   mongoc_cursor_set_prefetch (cursor, true);
+
+   future = future_cursor_next (cursor, &doc);
+   request = mock_server_receives_command (server, "db",
+                                           MONGOC_QUERY_SLAVE_OK,
+                                           "{'find': 'collection'}");
+
+   mock_server_replies_simple (request, "{'ok': 1,"
+                                        " 'cursor': {"
+                                        "    'id': {'$numberLong': '123'},"
+                                        "    'ns': 'db.collection',"
+                                        "    'firstBatch': [{'b': 1}]}}");
+
+   get_more = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK,
+      "{'getMore': {'$numberLong': '123'}, 'collection': 'collection'}");
+
+   ASSERT (future_get_bool (future));
+   future_destroy (future);
+   request_destroy (request);
+
+   /* destroying the cursor reads the pending reply, then kills the cursor */
+   future = future_cursor_destroy (cursor);
+   mock_server_replies_simple (get_more, "{'ok': 1,"
+                                         " 'cursor': {"
+                                         "    'id': {'$numberLong': '123'},"
+                                         "    'ns': 'db.collection',"
+                                         "    'nextBatch': [{'b': 2}]}}");
+
+   kill_cursors = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'killCursors': 'collection'}");
+
+   ASSERT (BCON_EXTRACT ((bson_t *) request_get_doc (kill_cursors, 0),
+                         "cursors", "[", BCONE_INT64 (cursor_id_out), "]"));
+   ASSERT_CMPINT64 ((int64_t) 123, ==, cursor_id_out);
+
+   mock_server_replies_simple (kill_cursors, "{'ok': 1}");
+   future_wait (future);
+   ASSERT (!client->in_flight_cursor);
+
+   future_destroy (future);
+   request_destroy (kill_cursors);
+   request_destroy (get_more);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+static void
+_next_batch_reply (request_t *request,
+                   int32_t    first,
+                   int64_t    cursor_id)
+{
+   bson_t docs[3];
+   int i;
+
+   for (i = 0; i < 3; i++) {
+      bson_init (&docs[i]);
+      BSON_APPEND_INT32 (&docs[i], "i", first + i);
+   }
+
+   mock_server_reply_multi (request, MONGOC_REPLY_NONE, docs, 3, cursor_id);
+
+   for (i = 0; i < 3; i++) {
+      bson_destroy (&docs[i]);
+   }
+}
+
+
+static void
+_assert_batch (const mongoc_doc_view_t *docs,
+               size_t                   n_docs,
+               size_t                   expected,
+               int32_t                  first)
+{
+   bson_t b;
+   size_t i;
+
+   ASSERT_CMPSIZE_T (n_docs, ==, expected);
+
+   for (i = 0; i < n_docs; i++) {
+      ASSERT (bson_init_static (&b, docs[i].data, docs[i].len));
+      ASSERT_MATCH (&b, "{'i': %d}", first + (int) i);
+   }
+}
+
+
+static void
+_test_next_batch (bool find_command)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursor;
+   const mongoc_doc_view_t *docs;
+   size_t n_docs;
+   const bson_t *doc;
+   future_t *future;
+   request_t *request;
+
+   server = mock_server_with_autoismaster (find_command ? 4 : 0);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   cursor = mongoc_collection_find (collection, MONGOC_QUERY_NONE, 0, 0, 0,
+                                    tmp_bson ("{}"), NULL, NULL);
+
+   future = future_cursor_next (cursor, &doc);
+
+   if (find_command) {
+      request = mock_server_receives_command (
+         server, "db", MONGOC_QUERY_SLAVE_OK, "{'find': 'collection'}");
+      mock_server_replies_simple (request, "{'ok': 1,"
+                                           " 'cursor': {"
+                                           "    'id': {'$numberLong': '123'},"
+                                           "    'ns': 'db.collection',"
+                                           "    'firstBatch': [{'i': 0},"
+                                           "                   {'i': 1},"
+                                           "                   {'i': 2}]}}");
+   } else {
+      request = mock_server_receives_query (server, "db.collection",
+                                            MONGOC_QUERY_SLAVE_OK, 0, 0,
+                                            "{}", NULL);
+      _next_batch_reply (request, 0, 123);
+   }
+
+   ASSERT (future_get_bool (future));
+   ASSERT_MATCH (doc, "{'i': 0}");
+   future_destroy (future);
+   request_destroy (request);
+
+   /* the rest of the reply, without a round trip */
+   ASSERT (mongoc_cursor_next_batch (cursor, &docs, &n_docs));
+   _assert_batch (docs, n_docs, 2, 1);
+
+   future = future_cursor_next (cursor, &doc);
+
+   if (find_command) {
+      request = mock_server_receives_command (
+         server, "db", MONGOC_QUERY_SLAVE_OK,
+         "{'getMore': {'$numberLong': '123'}, 'collection': 'collection'}");
+      mock_server_replies_simple (request, "{'ok': 1,"
+                                           " 'cursor': {"
+                                           "    'id': 0,"
+                                           "    'ns': 'db.collection',"
+                                           "    'nextBatch': [{'i': 3},"
+                                           "                  {'i': 4},"
+                                           "                  {'i': 5}]}}");
+   } else {
+      request = mock_server_receives_getmore (server, "db.collection", 0, 123);
+      _next_batch_reply (request, 3, 0);
+   }
+
+   ASSERT (future_get_bool (future));
+   ASSERT_MATCH (doc, "{'i': 3}");
+   future_destroy (future);
+   request_destroy (request);
+
+   ASSERT (mongoc_cursor_next_batch (cursor, &docs, &n_docs));
+   _assert_batch (docs, n_docs, 2, 4);
+
+   /* the server cursor is exhausted */
+   ASSERT (!mongoc_cursor_next_batch (cursor, &docs, &n_docs));
+   ASSERT_CMPINT ((int) n_docs, ==, 0);
+   ASSERT (!mongoc_cursor_error (cursor, NULL));
+
+   mongoc_cursor_destroy (cursor);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_next_batch_cmd (void)
+{
+   _test_next_batch (true);
+}
+
+
+static void
+test_next_batch_legacy (void)
+{
+   _test_next_batch (false);
+}
+
+
+/* next_batch sends the find and the getMore itself, and stops at the limit
+ * even if the server returns more */
+static void
+_test_next_batch_fetch (bool find_command)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursor;
+   const mongoc_doc_view_t *docs;
+   size_t n_docs;
+   future_t *future;
+   request_t *request;
+
+   server = mock_server_with_autoismaster (find_command ? 4 : 0);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   cursor = mongoc_collection_find (collection, MONGOC_QUERY_NONE, 0, 5, 0,
+                                    tmp_bson ("{}"), NULL, NULL);
+
+   future = future_cursor_next_batch (cursor, &docs, &n_docs);
+
+   if (find_command) {
+      request = mock_server_receives_command (
+         server, "db", MONGOC_QUERY_SLAVE_OK,
+         "{'find': 'collection', 'limit': {'$numberLong': '5'}}");
+      mock_server_replies_simple (request, "{'ok': 1,"
+                                           " 'cursor': {"
+                                           "    'id': {'$numberLong': '123'},"
+                                           "    'ns': 'db.collection',"
+                                           "    'firstBatch': [{'i': 0},"
+                                           "                   {'i': 1},"
+                                           "                   {'i': 2}]}}");
+   } else {
+      request = mock_server_receives_query (server, "db.collection",
+                                            MONGOC_QUERY_SLAVE_OK, 0, 5,
+                                            "{}", NULL);
+      _next_batch_reply (request, 0, 123);
+   }
+
+   ASSERT (future_get_bool (future));
+   _assert_batch (docs, n_docs, 3, 0);
+   future_destroy (future);
+   request_destroy (request);
+
+   future = future_cursor_next_batch (cursor, &docs, &n_docs);
+
+   if (find_command) {
+      request = mock_server_receives_command (
+         server, "db", MONGOC_QUERY_SLAVE_OK,
+         "{'getMore': {'$numberLong': '123'}, 'collection': 'collection'}");
+      mock_server_replies_simple (request, "{'ok': 1,"
+                                           " 'cursor': {"
+                                           "    'id': 0,"
+                                           "    'ns': 'db.collection',"
+                                           "    'nextBatch': [{'i': 3},"
+                                           "                  {'i': 4},"
+                                           "                  {'i': 5}]}}");
+   } else {
+      request = mock_server_receives_getmore (server, "db.collection", 2, 123);
+      _next_batch_reply (request, 3, 0);
+   }
+
+   /* only the two documents left under the limit */
+   ASSERT (future_get_bool (future));
+   _assert_batch (docs, n_docs, 2, 3);
+   future_destroy (future);
+   request_destroy (request);
+
+   ASSERT (!mongoc_cursor_next_batch (cursor, &docs, &n_docs));
+   ASSERT_CMPSIZE_T (n_docs, ==, (size_t) 0);
+   ASSERT (!mongoc_cursor_error (cursor, NULL));
+
+   mongoc_cursor_destroy (cursor);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_next_batch_fetch_cmd (void)
+{
+   _test_next_batch_fetch (true);
+}
+
+
+static void
+test_next_batch_fetch_legacy (void)
+{
+   _test_next_batch_fetch (false);
+}
+
+
+static mongoc_cursor_transform_mode_t
+_transform_filter (const bson_t *doc,
+                   void         *ctx)
+{
+   bson_iter_t iter;
+
+   ASSERT (bson_iter_init_find (&iter, doc, "i"));
+
+   switch (bson_iter_int32 (&iter)) {
+   case 1:
+      return MONGOC_CURSOR_TRANSFORM_DROP;
+   case 2:
+      return MONGOC_CURSOR_TRANSFORM_MUTATE;
+   default:
+      return MONGOC_CURSOR_TRANSFORM_PASS;
+   }
+}
+
+
+static void
+_transform_mutate (const bson_t *doc,
+                   bson_t       *out,
+                   void         *ctx)
+{
+   BSON_APPEND_INT32 (out, "j", 2);
+}
+
+
+static void
+_transform_dtor (void *ctx)
+{
+   (*(int *)ctx)++;
+}
+
+
+/* a transform set before a "find" command cursor installs its interface */
+static void
+test_transform_cmd (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursor;
+   mongoc_cursor_t *clone;
+   const mongoc_doc_view_t *docs;
+   size_t n_docs;
+   const bson_t *doc;
+   future_t *future;
+   request_t *request;
+   int n_dtor = 0;
+
+   server = mock_server_with_autoismaster (4);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   cursor = mongoc_collection_find (collection, MONGOC_QUERY_NONE, 0, 0, 0,
+                                    tmp_bson ("{}"), NULL, NULL);
+
+   mongoc_cursor_set_transform (cursor, _transform_filter, _transform_mutate,
+                                _transform_dtor, &n_dtor);
+
+   future = future_cursor_next (cursor, &doc);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'find': 'collection'}");
+   mock_server_replies_simple (request, "{'ok': 1,"
+                                        " 'cursor': {"
+                                        "    'id': 0,"
+                                        "    'ns': 'db.collection',"
+                                        "    'firstBatch': [{'i': 0},"
+                                        "                   {'i': 1},"
+                                        "                   {'i': 2},"
+                                        "                   {'i': 3}]}}");
+
+   ASSERT (future_get_bool (future));
+   ASSERT_MATCH (doc, "{'i': 0}");
+   future_destroy (future);
+   request_destroy (request);
+
+   /* {i: 1} is dropped */
+   ASSERT (mongoc_cursor_next (cursor, &doc));
+   ASSERT_MATCH (doc, "{'j': 2, 'i': {'$exists': false}}");
+
+   /* transformed cursors return batches of one */
+   ASSERT (mongoc_cursor_next_batch (cursor, &docs, &n_docs));
+   ASSERT_CMPINT ((int) n_docs, ==, 1);
+   ASSERT (!mongoc_cursor_next (cursor, &doc));
+   ASSERT (!mongoc_cursor_error (cursor, NULL));
+
+   /* the clone shares the context and may outlive the original */
+   clone = mongoc_cursor_clone (cursor);
+   mongoc_cursor_destroy (cursor);
+   ASSERT_CMPINT (n_dtor, ==, 0);
+
+   future = future_cursor_next (clone, &doc);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK, "{'find': 'collection'}");
+   mock_server_replies_simple (request, "{'ok': 1,"
+                                        " 'cursor': {"
+                                        "    'id': 0,"
+                                        "    'ns': 'db.collection',"
+                                        "    'firstBatch': [{'i': 1},"
+                                        "                   {'i': 2}]}}");
+
+   ASSERT (future_get_bool (future));
+   ASSERT_MATCH (doc, "{'j': 2}");
+   future_destroy (future);
+   request_destroy (request);
+
+   mongoc_cursor_destroy (clone);
+   ASSERT_CMPINT (n_dtor, ==, 1);
+
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_hedged_read (void)
+{
+   mock_rs_t *rs;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_read_prefs_t *prefs;
+   mongoc_cursor_t *cursor;
+   mongoc_host_list_t host;
+   const bson_t *doc;
+   future_t *future;
+   request_t *slow;
+   request_t *fast;
+   request_t *kill_cursors;
+   request_t *ping;
+   int64_t cursor_id_out;
+
+   rs = mock_rs_with_autoismaster (4, true, 2, 0);
+   mock_rs_run (rs);
+   client = mongoc_client_new_from_uri (mock_rs_get_uri (rs));
+   collection = mongoc_client_get_collection (client, "db", "collection");
+
+   prefs = mongoc_read_prefs_new (MONGOC_READ_SECONDARY_PREFERRED);
+   mongoc_read_prefs_set_hedge_delay_ms (prefs, 10);
+   cursor = mongoc_collection_find (collection, MONGOC_QUERY_NONE, 0, 0, 0,
+                                    tmp_bson ("{}"), NULL, prefs);
+
+   future = future_cursor_next (cursor, &doc);
+   slow = mock_rs_receives_command (rs, "db", MONGOC_QUERY_SLAVE_OK,
+                                    "{'find': 'collection'}");
+
+   /* no reply from the first secondary, the driver asks the other */
+   fast = mock_rs_receives_command (rs, "db", MONGOC_QUERY_SLAVE_OK,
+                                    "{'find': 'collection'}");
+
+   ASSERT (mock_rs_request_is_to_secondary (rs, slow));
+   ASSERT (mock_rs_request_is_to_secondary (rs, fast));
+   ASSERT_CMPINT (request_get_server_port (slow), !=,
+                  request_get_server_port (fast));
+
+   mock_rs_replies_simple (fast, "{'ok': 1,"
+                                 " 'cursor': {"
+                                 "    'id': 0,"
+                                 "    'ns': 'db.collection',"
+                                 "    'firstBatch': [{'b': 2}]}}");
+
+   ASSERT (future_get_bool (future));
+   ASSERT_MATCH (doc, "{'b': 2}");
+   ASSERT (client->hedge_loser.server_id);
+
+   /* the cursor continues on the server that answered */
+   mongoc_cursor_get_host (cursor, &host);
+   ASSERT_CMPINT (host.port, ==, request_get_server_port (fast));
+
+   future_destroy (future);
+   mongoc_cursor_destroy (cursor);
+
+   /* the next operation reads the late reply and kills its cursor */
+   future = future_client_command_simple (client, "admin",
+                                          tmp_bson ("{'ping': 1}"),
+                                          NULL, NULL, NULL);
+
+   mock_rs_replies_simple (slow, "{'ok': 1,"
+                                 " 'cursor': {"
+                                 "    'id': {'$numberLong': '123'},"
+                                 "    'ns': 'db.collection',"
+                                 "    'firstBatch': [{'b': 1}]}}");
+
+   kill_cursors = mock_rs_receives_command (
+      rs, "db", MONGOC_QUERY_SLAVE_OK, "{'killCursors': 'collection'}");
+
+   ASSERT (BCON_EXTRACT ((bson_t *) request_get_doc (kill_cursors, 0),
+                         "cursors", "[", BCONE_INT64 (cursor_id_out), "]"));
+   ASSERT_CMPINT64 ((int64_t) 123, ==, cursor_id_out);
+   ASSERT_CMPINT (request_get_server_port (kill_cursors), ==,
+                  request_get_server_port (slow));
+
+   mock_rs_replies_simple (kill_cursors, "{'ok': 1}");
+
+   ping = mock_rs_receives_command (rs, "admin", MONGOC_QUERY_NONE,
+                                    "{'ping': 1}");
+   mock_rs_replies_simple (ping, "{'ok': 1}");
+   ASSERT (future_get_bool (future));
+   ASSERT (!client->hedge_loser.server_id);
+
+   future_destroy (future);
+   request_destroy (ping);
+   request_destroy (kill_cursors);
+   request_destroy (fast);
+   request_destroy (slow);
+   mongoc_read_prefs_destroy (prefs);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_rs_destroy (rs);
+}
+
+
+static void
+test_getmore_operation_timeout (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   future_t *future;
+   request_t *request;
+   bson_error_t error;
+
+   server = mock_server_with_autoismaster (4);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   cursor = mongoc_collection_find (collection, MONGOC_QUERY_NONE, 0, 0, 0,
+                                    tmp_bson ("{}"), NULL, NULL);
+
+   mongoc_cursor_set_operation_timeout_ms (cursor, 100);
+
+   future = future_cursor_next (cursor, &doc);
+   request = mock_server_receives_command (server, "db",
+                                           MONGOC_QUERY_SLAVE_OK,
+                                           "{'find': 'collection'}");
+
+   mock_server_replies_simple (request, "{'ok': 1,"
+                                        " 'cursor': {"
+                                        "    'id': {'$numberLong': '123'},"
+                                        "    'ns': 'db.collection',"
+                                        "    'firstBatch': [{'b': 1}]}}");
+
+   ASSERT (future_get_bool (future));
+   ASSERT_MATCH (doc, "{'b': 1}");
+   future_destroy (future);
+   request_destroy (request);
+
+   /* the timeout covers the getMore too, and the server never replies */
+   future = future_cursor_next (cursor, &doc);
+   request = mock_server_receives_command (
+      server, "db", MONGOC_QUERY_SLAVE_OK,
+      "{'getMore': {'$numberLong': '123'}, 'collection': 'collection'}");
+
+   ASSERT (!future_get_bool (future));
+   ASSERT (mongoc_cursor_error (cursor, &error));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_CLIENT,
+                          MONGOC_ERROR_CLIENT_OPERATION_TIMEOUT,
+                          "exceeded its timeout");
+
+   future_destroy (future);
+   request_destroy (request);
+   mongoc_cursor_destroy (cursor);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
 void
 test_cursor_install (TestSuite *suite)
 {
@@ -962,4 +1621,16 @@ test_cursor_install (TestSuite *suite)
    TestSuite_Add (suite, "/Cursor/hint/pooled/secondary", test_hint_pooled_secondary);
    TestSuite_Add (suite, "/Cursor/hint/pooled/primary", test_hint_pooled_primary);
    TestSuite_AddLive (suite, "/Cursor/tailable/alive", test_tailable_alive);
+   TestSuite_Add (suite, "/Cursor/prefetch", test_prefetch);
+   TestSuite_Add (suite, "/Cursor/prefetch/destroy", test_prefetch_destroy);
+   TestSuite_Add (suite, "/Cursor/next_batch/cmd", test_next_batch_cmd);
+   TestSuite_Add (suite, "/Cursor/next_batch/legacy", test_next_batch_legacy);
+   TestSuite_Add (suite, "/Cursor/next_batch/fetch/cmd",
+                  test_next_batch_fetch_cmd);
+   TestSuite_Add (suite, "/Cursor/next_batch/fetch/legacy",
+                  test_next_batch_fetch_legacy);
+   TestSuite_Add (suite, "/Cursor/transform/cmd", test_transform_cmd);
+   TestSuite_Add (suite, "/Cursor/hedged_read", test_hedged_read);
+   TestSuite_Add (suite, "/Cursor/getmore/operation_timeout",
+                  test_getmore_operation_timeout);
 }
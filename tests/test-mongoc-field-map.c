@@ -0,0 +1,195 @@
+#include <bcon.h>
+#include <mongoc.h>
+
+#include "TestSuite.h"
+#include "test-conveniences.h"
+
+
+typedef struct
+{
+   int32_t           i;
+   int64_t           n;
+   double            d;
+   bool              b;
+   const char       *name;
+   bson_oid_t        oid;
+   int64_t           when;
+   int32_t           nested;
+   mongoc_doc_view_t tags;
+} decoded_t;
+
+
+static mongoc_field_map_t *
+_decoded_map (void)
+{
+   mongoc_field_map_t *map;
+   bson_error_t error;
+
+   map = mongoc_field_map_new ();
+
+#define ADD(_path, _type, _member) \
+   ASSERT_OR_PRINT (mongoc_field_map_add (map, _path, _type, \
+                                          offsetof (decoded_t, _member), \
+                                          &error), error)
+
+   ADD ("i", MONGOC_FIELD_INT32, i);
+   ADD ("n", MONGOC_FIELD_INT64, n);
+   ADD ("d", MONGOC_FIELD_DOUBLE, d);
+   ADD ("b", MONGOC_FIELD_BOOL, b);
+   ADD ("name", MONGOC_FIELD_UTF8, name);
+   ADD ("_id", MONGOC_FIELD_OID, oid);
+   ADD ("when", MONGOC_FIELD_DATE_TIME, when);
+   ADD ("a.b.c", MONGOC_FIELD_INT32, nested);
+   ADD ("tags", MONGOC_FIELD_ARRAY, tags);
+
+#undef ADD
+
+   return map;
+}
+
+
+static void
+test_field_map_decode (void)
+{
+   mongoc_field_map_t *map;
+   decoded_t out;
+   bson_oid_t oid;
+   bson_error_t error;
+   bson_t *doc;
+   bson_t tags;
+
+   map = _decoded_map ();
+   bson_oid_init_from_string (&oid, "000000000000000000001234");
+   doc = tmp_bson ("{'name': 'x', 'skip': 1, 'i': 1,"
+                   " 'n': {'$numberLong': '2'}, 'd': 3.5, 'b': true,"
+                   " '_id': {'$oid': '000000000000000000001234'},"
+                   " 'when': {'$date': 5}, 'a': {'x': 1, 'b': {'c': 6}},"
+                   " 'tags': ['t']}");
+
+   memset (&out, 0, sizeof out);
+   ASSERT_OR_PRINT (mongoc_field_map_decode (map, doc, &out, &error), error);
+
+   ASSERT_CMPINT32 (out.i, ==, 1);
+   ASSERT_CMPINT64 (out.n, ==, (int64_t) 2);
+   ASSERT (out.d == 3.5);
+   ASSERT (out.b);
+   ASSERT_CMPSTR (out.name, "x");
+   ASSERT (bson_oid_equal (&out.oid, &oid));
+   ASSERT_CMPINT64 (out.when, ==, (int64_t) 5);
+   ASSERT_CMPINT32 (out.nested, ==, 6);
+
+   /* strings and subdocuments point into the document */
+   ASSERT (out.name > (const char *) bson_get_data (doc));
+   ASSERT (out.name < (const char *) bson_get_data (doc) + doc->len);
+   ASSERT (bson_init_static (&tags, out.tags.data, out.tags.len));
+   ASSERT_MATCH (&tags, "{'0': 't'}");
+
+   /* missing fields are left alone */
+   out.i = 42;
+   ASSERT_OR_PRINT (mongoc_field_map_decode (map, tmp_bson ("{'b': false}"),
+                                             &out, &error), error);
+   ASSERT_CMPINT32 (out.i, ==, 42);
+   ASSERT (!out.b);
+
+   mongoc_field_map_destroy (map);
+}
+
+
+static void
+test_field_map_type_mismatch (void)
+{
+   mongoc_field_map_t *map;
+   decoded_t out;
+   bson_error_t error;
+
+   map = _decoded_map ();
+
+   ASSERT (!mongoc_field_map_decode (map, tmp_bson ("{'i': 'one'}"),
+                                     &out, &error));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_BSON, MONGOC_ERROR_BSON_INVALID,
+                          "Field \"i\" has BSON type 0x02, expected 0x10");
+
+   ASSERT (!mongoc_field_map_decode (map, tmp_bson ("{'a': {'b': 1}}"),
+                                     &out, &error));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_BSON, MONGOC_ERROR_BSON_INVALID,
+                          "Field \"a.b\" is not a document");
+
+   mongoc_field_map_destroy (map);
+}
+
+
+static void
+test_field_map_bad_path (void)
+{
+   mongoc_field_map_t *map;
+   bson_error_t error;
+
+   map = _decoded_map ();
+
+   ASSERT (!mongoc_field_map_add (map, "i", MONGOC_FIELD_INT32, 0, &error));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_COMMAND,
+                          MONGOC_ERROR_COMMAND_INVALID_ARG,
+                          "Field path \"i\" overlaps \"i\"");
+
+   ASSERT (!mongoc_field_map_add (map, "i.j", MONGOC_FIELD_INT32, 0, &error));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_COMMAND,
+                          MONGOC_ERROR_COMMAND_INVALID_ARG,
+                          "Field path \"i.j\" overlaps \"i\"");
+
+   ASSERT (!mongoc_field_map_add (map, "a.b", MONGOC_FIELD_INT32, 0, &error));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_COMMAND,
+                          MONGOC_ERROR_COMMAND_INVALID_ARG,
+                          "Field path \"a.b\" overlaps \"a.b\"");
+
+   ASSERT (!mongoc_field_map_add (map, "x..y", MONGOC_FIELD_INT32, 0, &error));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_COMMAND,
+                          MONGOC_ERROR_COMMAND_INVALID_ARG,
+                          "Invalid field path \"x..y\"");
+
+   mongoc_field_map_destroy (map);
+}
+
+
+static void
+test_field_map_decode_batch (void)
+{
+   mongoc_field_map_t *map;
+   mongoc_doc_view_t views[3];
+   bson_t *docs[3];
+   decoded_t out[3];
+   bson_error_t error;
+   int i;
+
+   map = _decoded_map ();
+
+   for (i = 0; i < 3; i++) {
+      docs[i] = BCON_NEW ("i", BCON_INT32 (i), "a", "{", "b", "{",
+                          "c", BCON_INT32 (10 * i), "}", "}");
+      views[i].data = bson_get_data (docs[i]);
+      views[i].len = docs[i]->len;
+   }
+
+   ASSERT_OR_PRINT (mongoc_field_map_decode_batch (map, views, 3, out,
+                                                   sizeof out[0], &error),
+                    error);
+
+   for (i = 0; i < 3; i++) {
+      ASSERT_CMPINT32 (out[i].i, ==, i);
+      ASSERT_CMPINT32 (out[i].nested, ==, 10 * i);
+      bson_destroy (docs[i]);
+   }
+
+   mongoc_field_map_destroy (map);
+}
+
+
+void
+test_field_map_install (TestSuite *suite)
+{
+   TestSuite_Add (suite, "/FieldMap/decode", test_field_map_decode);
+   TestSuite_Add (suite, "/FieldMap/type_mismatch",
+                  test_field_map_type_mismatch);
+   TestSuite_Add (suite, "/FieldMap/bad_path", test_field_map_bad_path);
+   TestSuite_Add (suite, "/FieldMap/decode_batch",
+                  test_field_map_decode_batch);
+}
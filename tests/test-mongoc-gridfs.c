@@ -618,6 +618,96 @@ test_stream (void)
    ASSERT_CMPUINT64 (mongoc_gridfs_file_tell (file_), ==, position_)
 
 
+static ssize_t
+read_whole_file (const char *path,
+                 char       *buf,
+                 size_t      buflen)
+{
+   mongoc_stream_t *stream;
+   ssize_t len = 0;
+   ssize_t r;
+
+   stream = mongoc_stream_file_new_for_path (path, O_RDONLY, 0);
+   ASSERT_OR_PRINT_ERRNO (stream, errno);
+
+   while ((r = mongoc_stream_read (stream, buf + len, buflen - len, 0, 0)) > 0) {
+      len += r;
+   }
+
+   mongoc_stream_destroy (stream);
+
+   return len;
+}
+
+
+/* upload from a mapped file and download into one, more than one chunk */
+static void
+test_mapped_stream (void)
+{
+   const char *path = "gridfs-mapped.out";
+   mongoc_gridfs_t *gridfs;
+   mongoc_gridfs_file_t *file;
+   mongoc_stream_t *stream;
+   mongoc_client_t *client;
+   bson_error_t error;
+   char *expected;
+   char *actual;
+   ssize_t expected_len;
+   ssize_t actual_len;
+
+   expected = (char *)bson_malloc (512 * 1024);
+   actual = (char *)bson_malloc (512 * 1024);
+   expected_len = read_whole_file (BINARY_DIR"/gridfs-large.dat",
+                                   expected, 512 * 1024);
+
+   client = test_framework_client_new ();
+
+   ASSERT_OR_PRINT (gridfs = get_test_gridfs (client, "mapped", &error), error);
+
+   mongoc_gridfs_drop (gridfs, &error);
+
+   stream = mongoc_stream_file_new_mapped_for_path (
+      BINARY_DIR"/gridfs-large.dat", O_RDONLY, 0);
+   ASSERT_OR_PRINT_ERRNO (stream, errno);
+
+   file = mongoc_gridfs_create_file_from_stream (gridfs, stream, NULL);
+   ASSERT (file);
+   ASSERT (mongoc_gridfs_file_save (file));
+   ASSERT_CMPINT64 (mongoc_gridfs_file_get_length (file), ==,
+                    (int64_t)expected_len);
+   ASSERT_CMPINT64 (mongoc_gridfs_file_get_length (file), >,
+                    (int64_t)mongoc_gridfs_file_get_chunk_size (file));
+
+   stream = mongoc_stream_file_new_mapped_for_path (
+      path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+   ASSERT_OR_PRINT_ERRNO (stream, errno);
+
+   ASSERT_CMPINT (mongoc_gridfs_file_seek (file, 0, SEEK_SET), ==, 0);
+   if (!mongoc_gridfs_file_download_to_stream (file, stream, 0)) {
+      mongoc_gridfs_file_error (file, &error);
+      ASSERT_OR_PRINT (false, error);
+   }
+
+   ASSERT_TELL (file, (uint64_t)expected_len);
+
+   /* trims the mapped file to the bytes written */
+   mongoc_stream_destroy (stream);
+
+   actual_len = read_whole_file (path, actual, 512 * 1024);
+   ASSERT_CMPSSIZE_T (actual_len, ==, expected_len);
+   assert (!memcmp (expected, actual, (size_t)expected_len));
+
+   remove (path);
+   bson_free (expected);
+   bson_free (actual);
+   mongoc_gridfs_file_destroy (file);
+
+   drop_collections (gridfs, &error);
+   mongoc_gridfs_destroy (gridfs);
+   mongoc_client_destroy (client);
+}
+
+
 static void
 test_long_seek (void *ctx)
 {
@@ -982,6 +1072,7 @@ test_gridfs_install (TestSuite *suite)
    TestSuite_AddLive (suite, "/GridFS/read", test_read);
    TestSuite_AddLive (suite, "/GridFS/seek", test_seek);
    TestSuite_AddLive (suite, "/GridFS/stream", test_stream);
+   TestSuite_AddLive (suite, "/GridFS/stream/mapped", test_mapped_stream);
    TestSuite_AddLive (suite, "/GridFS/remove", test_remove);
    TestSuite_AddLive (suite, "/GridFS/write", test_write);
    TestSuite_AddFull (suite, "/GridFS/test_long_seek", test_long_seek, NULL, NULL, test_framework_skip_if_slow);
@@ -112,6 +112,76 @@ test_mongoc_log_null (void)
    restore_state (&old_state);
 }
 
+struct log_async_data {
+   int   n;
+   char *messages[8];
+};
+
+
+static void
+log_async_func (mongoc_log_level_t  log_level,
+                const char         *log_domain,
+                const char         *message,
+                void               *user_data)
+{
+   struct log_async_data *data = (struct log_async_data *)user_data;
+
+   if (data->n < 8) {
+      data->messages[data->n++] = bson_strdup (message);
+   }
+}
+
+
+static void
+test_mongoc_log_async (void)
+{
+   struct log_state old_state;
+   struct log_async_data data = { 0 };
+   int i;
+
+   save_state (&old_state);
+   mongoc_log_set_handler (log_async_func, &data);
+
+#ifdef _WIN32
+   ASSERT (!mongoc_log_set_async (true));
+#else
+   ASSERT (mongoc_log_set_async (true));
+
+   for (i = 0; i < 5; i++) {
+      MONGOC_WARNING ("server %d is down", 1);
+   }
+
+   MONGOC_WARNING ("server %d is up", 1);
+
+   /* stops the writer after delivering everything queued */
+   ASSERT (mongoc_log_set_async (false));
+
+   ASSERT_CMPINT (data.n, ==, 3);
+   ASSERT_CMPSTR (data.messages[0], "server 1 is down");
+   ASSERT_CMPSTR (data.messages[1], "last message repeated 4 times");
+   ASSERT_CMPSTR (data.messages[2], "server 1 is up");
+
+   /* synchronous again */
+   MONGOC_WARNING ("server %d is down", 2);
+   ASSERT_CMPINT (data.n, ==, 4);
+   ASSERT_CMPSTR (data.messages[3], "server 2 is down");
+
+   /* this thread's ring is reused when async logging is enabled again */
+   ASSERT (mongoc_log_set_async (true));
+   MONGOC_ERROR ("server %d is gone", 2);
+   ASSERT (mongoc_log_set_async (false));
+   ASSERT_CMPINT (data.n, ==, 5);
+   ASSERT_CMPSTR (data.messages[4], "server 2 is gone");
+#endif
+
+   restore_state (&old_state);
+
+   for (i = 0; i < data.n; i++) {
+      bson_free (data.messages[i]);
+   }
+}
+
+
 static int should_run_trace_tests (void)
 {
 #ifdef MONGOC_TRACE
@@ -186,4 +256,5 @@ test_log_install (TestSuite *suite)
    TestSuite_AddFull (suite, "/Log/trace/enabled", test_mongoc_log_trace_enabled, NULL, NULL, should_run_trace_tests);
    TestSuite_AddFull (suite, "/Log/trace/disabled", test_mongoc_log_trace_disabled, NULL, NULL, should_not_run_trace_tests);
    TestSuite_Add (suite, "/Log/null", test_mongoc_log_null);
+   TestSuite_Add (suite, "/Log/async", test_mongoc_log_async);
 }
@@ -0,0 +1,101 @@
+#include <mongoc.h>
+#include <mongoc-buffer-private.h>
+#include <mongoc-gridfs-file-page-private.h>
+
+#include "TestSuite.h"
+#include "test-conveniences.h"
+
+
+typedef struct
+{
+   int n_allocs;
+   int n_frees;
+} allocator_stats_t;
+
+
+static void *
+test_realloc (void   *mem,
+              size_t  num_bytes,
+              void   *ctx)
+{
+   allocator_stats_t *stats = (allocator_stats_t *)ctx;
+
+   if (!mem) {
+      stats->n_allocs++;
+   } else if (!num_bytes) {
+      stats->n_frees++;
+   }
+
+   return bson_realloc (mem, num_bytes);
+}
+
+
+static void
+test_memory_live_bytes (void)
+{
+   mongoc_buffer_t buffer;
+   mongoc_gridfs_file_page_t *page;
+   const uint8_t data[] = "abc";
+   int64_t buffers;
+   int64_t gridfs;
+   bson_t stats;
+
+   buffers = mongoc_memory_live_bytes (MONGOC_MEMORY_BUFFERS);
+   gridfs = mongoc_memory_live_bytes (MONGOC_MEMORY_GRIDFS);
+
+   /* the buffer allocates its default 1024 bytes, plus a header */
+   _mongoc_buffer_init (&buffer, NULL, 0, NULL, NULL);
+   ASSERT_CMPINT64 (mongoc_memory_live_bytes (MONGOC_MEMORY_BUFFERS), ==,
+                    buffers + 1024 + 32);
+
+   /* writing to a page copies it into a buffer of chunk_size */
+   page = _mongoc_gridfs_file_page_new (data, 3, 100);
+   ASSERT (_mongoc_gridfs_file_page_write (page, "d", 1));
+   ASSERT_CMPINT64 (mongoc_memory_live_bytes (MONGOC_MEMORY_GRIDFS), >=,
+                    gridfs + 100);
+
+   mongoc_memory_stats (&stats);
+   ASSERT_CMPINT64 (bson_lookup_int64 (&stats, "buffers"), ==,
+                    mongoc_memory_live_bytes (MONGOC_MEMORY_BUFFERS));
+   ASSERT_HAS_FIELD (&stats, "cursors");
+   ASSERT_HAS_FIELD (&stats, "topology");
+   ASSERT_HAS_FIELD (&stats, "total");
+   bson_destroy (&stats);
+
+   _mongoc_gridfs_file_page_destroy (page);
+   _mongoc_buffer_destroy (&buffer);
+
+   ASSERT_CMPINT64 (mongoc_memory_live_bytes (MONGOC_MEMORY_BUFFERS), ==,
+                    buffers);
+   ASSERT_CMPINT64 (mongoc_memory_live_bytes (MONGOC_MEMORY_GRIDFS), ==,
+                    gridfs);
+}
+
+
+static void
+test_memory_set_allocator (void)
+{
+   allocator_stats_t stats = { 0 };
+   mongoc_buffer_t buffer;
+   mongoc_buffer_t other;
+
+   mongoc_memory_set_allocator (test_realloc, &stats);
+   _mongoc_buffer_init (&buffer, NULL, 0, NULL, NULL);
+   mongoc_memory_set_allocator (NULL, NULL);
+   _mongoc_buffer_init (&other, NULL, 0, NULL, NULL);
+
+   ASSERT_CMPINT (stats.n_allocs, ==, 1);
+
+   /* freed by the allocator it came from */
+   _mongoc_buffer_destroy (&buffer);
+   _mongoc_buffer_destroy (&other);
+   ASSERT_CMPINT (stats.n_frees, ==, 1);
+}
+
+
+void
+test_memory_install (TestSuite *suite)
+{
+   TestSuite_Add (suite, "/Memory/live_bytes", test_memory_live_bytes);
+   TestSuite_Add (suite, "/Memory/set_allocator", test_memory_set_allocator);
+}
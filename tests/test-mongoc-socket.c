@@ -381,9 +381,151 @@ test_mongoc_socket_sendv (void *ctx)
    mongoc_cond_destroy (&data.cond);
 }
 
+
+#ifndef _WIN32
+/* many iovecs of various sizes, more than sendmsg () accepts at once */
+static void
+test_mongoc_socket_sendv_coalesce (void)
+{
+   int sv[2];
+   mongoc_socket_t sock = { 0 };
+   mongoc_iovec_t iov[3000];
+   uint8_t *data;
+   uint8_t *received;
+   size_t total = 0;
+   size_t len;
+   size_t i;
+   ssize_t r;
+
+   r = socketpair (AF_UNIX, SOCK_STREAM, 0, sv);
+   assert (r == 0);
+
+   sock.sd = sv[0];
+   sock.domain = AF_UNIX;
+
+   for (i = 0; i < 3000; i++) {
+      /* mostly tiny fields, with a few larger documents between them */
+      total += (i % 100 == 99) ? 2000 : (i % 7) + 1;
+   }
+
+   data = (uint8_t *)bson_malloc (total);
+   received = (uint8_t *)bson_malloc (total);
+
+   for (i = 0; i < total; i++) {
+      data[i] = (uint8_t)(i % 251);
+   }
+
+   len = 0;
+   for (i = 0; i < 3000; i++) {
+      iov[i].iov_base = (void *)(data + len);
+      iov[i].iov_len = (i % 100 == 99) ? 2000 : (i % 7) + 1;
+      len += iov[i].iov_len;
+   }
+
+   r = mongoc_socket_sendv (&sock, iov, 3000, -1);
+   ASSERT_CMPINT64 ((int64_t)r, ==, (int64_t)total);
+
+   len = 0;
+   while (len < total) {
+      r = recv (sv[1], received + len, total - len, 0);
+      assert (r > 0);
+      len += (size_t)r;
+   }
+
+   assert (!memcmp (data, received, total));
+
+   close (sv[0]);
+   close (sv[1]);
+   bson_free (sock.send_iov);
+   bson_free (sock.send_buf);
+   bson_free (data);
+   bson_free (received);
+}
+
+
+/* small reads through the registered buffer, large ones straight into the
+ * caller's iovec, and a read timeout */
+static void
+test_mongoc_socket_uring (void)
+{
+   int sv[2];
+   mongoc_socket_t *sock;
+   mongoc_stream_t *stream;
+   mongoc_iovec_t iov;
+   uint8_t *data;
+   uint8_t *received;
+   size_t total = 100000;
+   size_t len;
+   size_t i;
+   ssize_t r;
+
+   r = socketpair (AF_UNIX, SOCK_STREAM, 0, sv);
+   assert (r == 0);
+
+   sock = (mongoc_socket_t *)bson_malloc0 (sizeof *sock);
+   sock->sd = sv[0];
+   sock->domain = AF_UNIX;
+
+   stream = mongoc_stream_uring_new (sock);
+   if (!stream) {
+      /* built without liburing, or the kernel lacks io_uring */
+      mongoc_socket_destroy (sock);
+      close (sv[1]);
+      return;
+   }
+
+   data = (uint8_t *)bson_malloc (total);
+   received = (uint8_t *)bson_malloc (total);
+
+   for (i = 0; i < total; i++) {
+      data[i] = (uint8_t)(i % 251);
+   }
+
+   iov.iov_base = (void *)data;
+   iov.iov_len = 100;
+   r = mongoc_stream_writev (stream, &iov, 1, TIMEOUT);
+   ASSERT_CMPINT64 ((int64_t)r, ==, (int64_t)100);
+
+   len = 0;
+   while (len < 100) {
+      r = recv (sv[1], received + len, 100 - len, 0);
+      assert (r > 0);
+      len += (size_t)r;
+   }
+
+   assert (!memcmp (data, received, 100));
+
+   r = send (sv[1], data, total, 0);
+   ASSERT_CMPINT64 ((int64_t)r, ==, (int64_t)total);
+
+   /* a message header-sized read, then the rest in one large read */
+   r = mongoc_stream_read (stream, received, 16, 16, TIMEOUT);
+   ASSERT_CMPINT64 ((int64_t)r, ==, (int64_t)16);
+
+   r = mongoc_stream_read (stream, received + 16, total - 16, total - 16,
+                           TIMEOUT);
+   ASSERT_CMPINT64 ((int64_t)r, ==, (int64_t)(total - 16));
+
+   assert (!memcmp (data, received, total));
+
+   r = mongoc_stream_read (stream, received, 1, 1, 100);
+   ASSERT_CMPINT64 ((int64_t)r, ==, (int64_t)-1);
+   ASSERT_CMPINT (errno, ==, ETIMEDOUT);
+
+   mongoc_stream_destroy (stream);
+   close (sv[1]);
+   bson_free (data);
+   bson_free (received);
+}
+#endif
+
 void
 test_socket_install (TestSuite *suite)
 {
    TestSuite_Add (suite, "/Socket/check_closed", test_mongoc_socket_check_closed);
    TestSuite_AddFull (suite, "/Socket/sendv", test_mongoc_socket_sendv, NULL, NULL, test_framework_skip_if_slow);
+#ifndef _WIN32
+   TestSuite_Add (suite, "/Socket/sendv/coalesce", test_mongoc_socket_sendv_coalesce);
+   TestSuite_Add (suite, "/Socket/uring", test_mongoc_socket_uring);
+#endif
 }
@@ -240,6 +240,37 @@ test_mongoc_tls_crl (void)
    ASSERT_CMPINT (cr.result, ==, SSL_TEST_SUCCESS);
    ASSERT_CMPINT (sr.result, ==, SSL_TEST_SUCCESS);
 }
+
+
+/* the echo works whether or not this kernel and OpenSSL can offload TLS */
+static void
+test_mongoc_tls_ktls (void)
+{
+   mongoc_ssl_opt_t sopt = { 0 };
+   mongoc_ssl_opt_t copt = { 0 };
+   ssl_test_result_t sr;
+   ssl_test_result_t cr;
+
+   sopt.ca_file = CERT_CA;
+   sopt.pem_file = CERT_SERVER;
+   sopt.ktls = true;
+
+   copt.ca_file = CERT_CA;
+   copt.pem_file = CERT_CLIENT;
+   copt.ktls = true;
+
+   ssl_test (&copt, &sopt, "localhost", &cr, &sr);
+
+   ASSERT_CMPINT (cr.result, ==, SSL_TEST_SUCCESS);
+   ASSERT_CMPINT (sr.result, ==, SSL_TEST_SUCCESS);
+
+   /* one side offloaded, the other in user space */
+   sopt.ktls = false;
+   ssl_test (&copt, &sopt, "localhost", &cr, &sr);
+
+   ASSERT_CMPINT (cr.result, ==, SSL_TEST_SUCCESS);
+   ASSERT_CMPINT (sr.result, ==, SSL_TEST_SUCCESS);
+}
 #endif
 
 
@@ -399,6 +430,7 @@ test_stream_tls_install (TestSuite *suite)
    TestSuite_Add (suite, "/TLS/bad_password", test_mongoc_tls_bad_password);
    TestSuite_Add (suite, "/TLS/weak_cert_validation", test_mongoc_tls_weak_cert_validation);
    TestSuite_Add (suite, "/TLS/crl", test_mongoc_tls_crl);
+   TestSuite_Add (suite, "/TLS/ktls", test_mongoc_tls_ktls);
 #endif
 
 #if !defined(__APPLE__) && !defined(_WIN32) && defined(MONGOC_ENABLE_SSL_OPENSSL)
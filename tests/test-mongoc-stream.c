@@ -154,10 +154,131 @@ test_stream_writev_full (void)
 }
 
 
+typedef struct
+{
+   mongoc_stream_t vtable;
+   int             n_writev;
+   size_t          n_written;
+} counting_stream_t;
+
+static ssize_t
+counting_stream_writev (mongoc_stream_t *stream,
+                        mongoc_iovec_t  *iov,
+                        size_t           iovcnt,
+                        int32_t          timeout_msec)
+{
+   counting_stream_t *cstream = (counting_stream_t *)stream;
+   ssize_t ret = 0;
+   size_t i;
+
+   for (i = 0; i < iovcnt; i++) {
+      ret += iov[i].iov_len;
+   }
+
+   cstream->n_writev++;
+   cstream->n_written += ret;
+
+   return ret;
+}
+
+static ssize_t
+counting_stream_readv (mongoc_stream_t *stream,
+                       mongoc_iovec_t  *iov,
+                       size_t           iovcnt,
+                       size_t           min_bytes,
+                       int32_t          timeout_msec)
+{
+   ssize_t ret = 0;
+   size_t i;
+
+   for (i = 0; i < iovcnt; i++) {
+      memset (iov[i].iov_base, 0, iov[i].iov_len);
+      ret += iov[i].iov_len;
+   }
+
+   return ret;
+}
+
+static int
+counting_stream_flush (mongoc_stream_t *stream)
+{
+   return 0;
+}
+
+static mongoc_stream_t *
+counting_stream_new (void)
+{
+   counting_stream_t *stream;
+
+   stream = bson_malloc0 (sizeof *stream);
+   stream->vtable.type = 999;
+   stream->vtable.writev = counting_stream_writev;
+   stream->vtable.readv = counting_stream_readv;
+   stream->vtable.flush = counting_stream_flush;
+   stream->vtable.destroy = failing_stream_destroy;
+
+   return (mongoc_stream_t *)stream;
+}
+
+
+static void
+test_buffered_write (void)
+{
+   counting_stream_t *base;
+   mongoc_stream_t *buffered;
+   char small[10];
+   char large[200];
+   char reply[4];
+   int i;
+
+   memset (small, 0, sizeof small);
+   memset (large, 0, sizeof large);
+
+   base = (counting_stream_t *)counting_stream_new ();
+   buffered = mongoc_stream_buffered_new ((mongoc_stream_t *)base, 1024);
+   mongoc_stream_buffered_set_write_buffer_size (buffered, 100);
+
+   /* small writes are held until flushed */
+   for (i = 0; i < 5; i++) {
+      ASSERT_CMPINT ((int)mongoc_stream_write (buffered, small, sizeof small,
+                                               100), ==, (int)sizeof small);
+   }
+
+   ASSERT_CMPINT (base->n_writev, ==, 0);
+   ASSERT_CMPINT (mongoc_stream_flush (buffered), ==, 0);
+   ASSERT_CMPINT (base->n_writev, ==, 1);
+   ASSERT_CMPINT ((int)base->n_written, ==, 50);
+
+   /* a write larger than the buffer goes out with what is pending */
+   mongoc_stream_write (buffered, small, sizeof small, 100);
+   mongoc_stream_write (buffered, large, sizeof large, 100);
+   ASSERT_CMPINT (base->n_writev, ==, 2);
+   ASSERT_CMPINT ((int)base->n_written, ==, 260);
+
+   /* writes are sent before reading a reply */
+   mongoc_stream_write (buffered, small, sizeof small, 100);
+   ASSERT_CMPINT ((int)mongoc_stream_read (buffered, reply, sizeof reply,
+                                           sizeof reply, 100), ==,
+                  (int)sizeof reply);
+   ASSERT_CMPINT (base->n_writev, ==, 3);
+
+   /* turning buffering off sends what is pending with the next write */
+   mongoc_stream_write (buffered, small, sizeof small, 100);
+   ASSERT_CMPINT (base->n_writev, ==, 3);
+   mongoc_stream_buffered_set_write_buffer_size (buffered, 0);
+   mongoc_stream_write (buffered, small, sizeof small, 100);
+   ASSERT_CMPINT (base->n_writev, ==, 4);
+   ASSERT_CMPINT ((int)base->n_written, ==, 290);
+
+   mongoc_stream_destroy (buffered);
+}
+
+
 void
 test_stream_install (TestSuite *suite)
 {
    TestSuite_Add (suite, "/Stream/buffered/basic", test_buffered_basic);
    TestSuite_Add (suite, "/Stream/buffered/oversized", test_buffered_oversized);
+   TestSuite_Add (suite, "/Stream/buffered/write", test_buffered_write);
    TestSuite_Add (suite, "/Stream/writev_full", test_stream_writev_full);
 }
@@ -941,6 +941,174 @@ test_invalid_server_id (void)
 }
 
 
+static uint32_t
+_select_mongos (mongoc_topology_t *topology)
+{
+   mongoc_server_description_t *sd;
+
+   sd = mongoc_topology_description_select (&topology->description,
+                                            MONGOC_SS_READ, NULL,
+                                            15, 60000);
+   ASSERT (sd);
+
+   return sd->id;
+}
+
+
+static void
+test_select_power_of_two (void)
+{
+   mongoc_uri_t *uri;
+   mongoc_topology_t *topology;
+   mongoc_server_description_t *sd;
+   uint32_t id;
+   int i;
+
+   uri = mongoc_uri_new ("mongodb://a,b/?serverSelectionPolicy=powerOfTwoChoices");
+   topology = mongoc_topology_new (uri, true);
+   ASSERT_CMPINT (topology->description.policy, ==,
+                  MONGOC_SS_POLICY_POWER_OF_TWO);
+
+   for (id = 1; id <= 2; id++) {
+      sd = mongoc_topology_description_server_by_id (&topology->description,
+                                                     id, NULL);
+      mongoc_topology_description_handle_ismaster (
+         &topology->description, sd,
+         tmp_bson ("{'ok': 1, 'ismaster': true, 'msg': 'isdbgrid',"
+                   " 'minWireVersion': 0, 'maxWireVersion': 4}"),
+         10, NULL);
+   }
+
+   ASSERT_CMPINT (topology->description.type, ==, MONGOC_TOPOLOGY_SHARDED);
+
+   /* before any operation, the heartbeat round trip time */
+   ASSERT_CMPINT64 (mongoc_server_description_latency_percentile (sd, 90), ==,
+                    (int64_t) 10000);
+
+   /* server 1 answers in 1ms, server 2 in 100ms */
+   for (i = 0; i < 10; i++) {
+      _mongoc_topology_record_latency (topology, 1, 1000);
+      _mongoc_topology_record_latency (topology, 2, 100 * 1000);
+   }
+
+   ASSERT_CMPINT64 (mongoc_server_description_latency_percentile (sd, 90), ==,
+                    (int64_t) 100 * 1000);
+
+   /* with two servers, both are always compared */
+   for (i = 0; i < 100; i++) {
+      ASSERT_CMPUINT32 (_select_mongos (topology), ==, (uint32_t) 1);
+   }
+
+   /* a long queue on the fast server outweighs its lower latency */
+   sd = mongoc_topology_description_server_by_id (&topology->description,
+                                                  1, NULL);
+   for (i = 0; i < 200; i++) {
+      mongoc_server_description_operation_started (sd);
+   }
+
+   for (i = 0; i < 100; i++) {
+      ASSERT_CMPUINT32 (_select_mongos (topology), ==, (uint32_t) 2);
+   }
+
+   for (i = 0; i < 200; i++) {
+      mongoc_server_description_operation_finished (sd);
+   }
+
+   mongoc_topology_destroy (topology);
+   mongoc_uri_destroy (uri);
+}
+
+
+static void
+test_select_least_loaded (void)
+{
+   mongoc_uri_t *uri;
+   mongoc_topology_t *topology;
+   mongoc_server_description_t *sd[3];
+   mongoc_server_description_t *copy;
+   uint32_t id;
+   int i;
+
+   uri = mongoc_uri_new ("mongodb://a,b,c/?serverSelectionPolicy=leastLoaded");
+   topology = mongoc_topology_new (uri, true);
+   ASSERT_CMPINT (topology->description.policy, ==,
+                  MONGOC_SS_POLICY_LEAST_LOADED);
+
+   for (id = 1; id <= 3; id++) {
+      sd[id - 1] = mongoc_topology_description_server_by_id (
+         &topology->description, id, NULL);
+      mongoc_topology_description_handle_ismaster (
+         &topology->description, sd[id - 1],
+         tmp_bson ("{'ok': 1, 'ismaster': true, 'msg': 'isdbgrid',"
+                   " 'minWireVersion': 0, 'maxWireVersion': 4}"),
+         10, NULL);
+   }
+
+   /* long-running operations on servers 1 and 3, begun through copies
+    * like those in a mongoc_server_stream_t */
+   copy = mongoc_server_description_new_copy (sd[0]);
+   mongoc_server_description_operation_started (copy);
+   mongoc_server_description_operation_started (copy);
+   mongoc_server_description_destroy (copy);
+
+   copy = mongoc_server_description_new_copy (sd[2]);
+   mongoc_server_description_operation_started (copy);
+
+   ASSERT_CMPINT32 (mongoc_server_description_in_flight (sd[0]), ==, 2);
+   ASSERT_CMPINT32 (mongoc_server_description_in_flight (sd[1]), ==, 0);
+   ASSERT_CMPINT32 (mongoc_server_description_in_flight (sd[2]), ==, 1);
+
+   for (i = 0; i < 100; i++) {
+      ASSERT_CMPUINT32 (_select_mongos (topology), ==, (uint32_t) 2);
+   }
+
+   /* the copy outlives its server's removal */
+   mongoc_topology_destroy (topology);
+   ASSERT_CMPINT32 (mongoc_server_description_in_flight (copy), ==, 1);
+   mongoc_server_description_operation_finished (copy);
+   mongoc_server_description_destroy (copy);
+   mongoc_uri_destroy (uri);
+}
+
+
+static void
+test_in_flight (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_server_description_t **sds;
+   size_t n;
+   future_t *future;
+   request_t *request;
+   bson_error_t error;
+
+   server = mock_server_with_autoismaster (3);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+
+   future = future_client_command_simple (client, "db", tmp_bson ("{'ping': 1}"),
+                                          NULL, NULL, &error);
+   request = mock_server_receives_command (server, "db", MONGOC_QUERY_SLAVE_OK,
+                                           "{'ping': 1}");
+
+   sds = mongoc_client_get_server_descriptions (client, &n);
+   ASSERT_CMPSIZE_T (n, ==, (size_t) 1);
+   ASSERT_CMPINT32 (mongoc_server_description_in_flight (sds[0]), ==, 1);
+
+   mock_server_replies_simple (request, "{'ok': 1}");
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+
+   /* the description counts operations in progress, not when copied */
+   ASSERT_CMPINT32 (mongoc_server_description_in_flight (sds[0]), ==, 0);
+
+   mongoc_server_descriptions_destroy_all (sds, n);
+   request_destroy (request);
+   future_destroy (future);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
 void
 test_topology_install (TestSuite *suite)
 {
@@ -981,4 +1149,7 @@ test_topology_install (TestSuite *suite)
    TestSuite_Add (suite, "/Topology/try_once/succeed", test_select_after_try_once);
 #endif
    TestSuite_AddLive (suite, "/Topology/invalid_server_id", test_invalid_server_id);
+   TestSuite_Add (suite, "/Topology/select/power_of_two", test_select_power_of_two);
+   TestSuite_Add (suite, "/Topology/select/least_loaded", test_select_least_loaded);
+   TestSuite_Add (suite, "/Topology/in_flight", test_in_flight);
 }
@@ -0,0 +1,34 @@
+#! /bin/sh
+
+# Import a file with mongoc-import, export it again with mongoc-export,
+# and check the two files are identical. One thread each, so documents
+# keep their order. Uses $MONGOC_TEST_URI, or a server on localhost.
+
+set -e
+
+uri=${MONGOC_TEST_URI:-mongodb://localhost/}
+collection=tools_roundtrip_$$
+in=tools-roundtrip-in.bson
+out=tools-roundtrip-out.bson
+
+# remove the files and the collection however we exit; importing nothing
+# with -d just drops the collection
+cleanup () {
+   rm -f $in $out
+   ./mongoc-import -q -d "$uri" test $collection /dev/null || true
+}
+trap cleanup EXIT
+trap 'exit 1' HUP INT TERM
+
+# 200 documents {_id: <int32>, x: "doc"}, 25 bytes each
+i=1
+: > $in
+while [ $i -le 200 ]; do
+   printf "\031\000\000\000\020_id\000\\$(printf %03o $i)\000\000\000\002x\000\004\000\000\000doc\000\000" >> $in
+   i=`expr $i + 1`
+done
+
+./mongoc-import -q -j 1 "$uri" test $collection $in
+./mongoc-export -q -j 1 "$uri" test $collection $out
+
+cmp $in $out